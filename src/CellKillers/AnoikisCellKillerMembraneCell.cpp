@@ -22,12 +22,14 @@
 #include "NodeBasedCellPopulation.hpp"
 #include "PanethCellMutationState.hpp"
 #include "TransitCellAnoikisResistantMutationState.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
 #include "MembraneCellProliferativeType.hpp"
 
 AnoikisCellKillerMembraneCell::AnoikisCellKillerMembraneCell(AbstractCellPopulation<2>* pCellPopulation)
     : AbstractCellKiller<2>(pCellPopulation),
     mCellsRemovedByAnoikis(0),
-    mCutOffRadius(1.5)
+    mCutOffRadius(1.5),
+    mGelNeighbourCounts(CryptCellAttributes::MEMBRANE_CELL)
 {
     // Sets up output file
 //	OutputFileHandler output_file_handler(mOutputDirectory + "AnoikisData/", false);
@@ -117,13 +119,27 @@ bool AnoikisCellKillerMembraneCell::HasCellPoppedUp(unsigned nodeIndex)
 
 		unsigned num_gel_neighbours = 0;
 
+		// The crypt population has the type of every node to hand
+		CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(this->mpCellPopulation);
+		const CryptCellAttributes* p_attributes = p_crypt_population ? &(p_crypt_population->rGetCellAttributes()) : NULL;
+
 		// Iterate over the neighbouring cells to check the number of differentiated cell neighbours
 
 		for(std::set<unsigned>::iterator neighbour_iter=neighbours.begin();
 				neighbour_iter != neighbours.end();
 				++neighbour_iter)
 		{
-			if ( (!p_tissue->IsGhostNode(*neighbour_iter))&&(p_tissue->GetCellUsingLocationIndex(*neighbour_iter)->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>()) )
+			bool is_gel_neighbour;
+			if (p_attributes)
+			{
+				// Ghost nodes have no class
+				is_gel_neighbour = (p_attributes->GetCellClass(*neighbour_iter) == CryptCellAttributes::MEMBRANE_CELL);
+			}
+			else
+			{
+				is_gel_neighbour = (!p_tissue->IsGhostNode(*neighbour_iter))&&(p_tissue->GetCellUsingLocationIndex(*neighbour_iter)->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>());
+			}
+			if (is_gel_neighbour)
 			{
 				num_gel_neighbours += 1;
 			}
@@ -163,13 +179,19 @@ bool AnoikisCellKillerMembraneCell::HasCellPoppedUp(unsigned nodeIndex)
 	return has_cell_popped_up;
 }
 
+GelNeighbourCounts& AnoikisCellKillerMembraneCell::rGetGelNeighbourCounts()
+{
+	return mGelNeighbourCounts;
+}
+
 /** A method to return a vector that indicates which cells should be killed by anoikis
  * and which by compression-driven apoptosis
  */
-std::vector<c_vector<unsigned,2> > AnoikisCellKillerMembraneCell::RemoveByAnoikis()
+const std::vector<c_vector<unsigned,2> >& AnoikisCellKillerMembraneCell::RemoveByAnoikis()
 {
 
-    std::vector<c_vector<unsigned,2> > cells_to_remove;
+    std::vector<c_vector<unsigned,2> >& cells_to_remove = mCellsToRemove;
+    cells_to_remove.clear();
     if (dynamic_cast<MeshBasedCellPopulation<2>*>(this->mpCellPopulation))
     {
     	MeshBasedCellPopulation<2>* p_tissue = static_cast<MeshBasedCellPopulation<2>*> (this->mpCellPopulation);
@@ -177,6 +199,12 @@ std::vector<c_vector<unsigned,2> > AnoikisCellKillerMembraneCell::RemoveByAnoiki
 
     	c_vector<unsigned,2> individual_node_information;	// Will store the node index and whether to remove or not (1 or 0)
 
+    	// Whether a cell has popped up only changes when its neighbours do
+    	bool use_gel_neighbour_counts = mGelNeighbourCounts.Update(*(this->mpCellPopulation));
+
+    	CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(this->mpCellPopulation);
+    	const CryptCellAttributes* p_attributes = p_crypt_population ? &(p_crypt_population->rGetCellAttributes()) : NULL;
+
     	for (AbstractCellPopulation<2>::Iterator cell_iter = p_tissue->Begin();
     			cell_iter != p_tissue->End();
     			++cell_iter)
@@ -191,12 +219,23 @@ std::vector<c_vector<unsigned,2> > AnoikisCellKillerMembraneCell::RemoveByAnoiki
     		// Examine each epithelial node to see if it should be removed by anoikis and then if it
     		// should be removed by compression-driven apoptosis
     		// Edit by Phillip Brown: Added a check for anoikis resistant mutation to prevent this kind of cell death
-    		if (!cell_iter->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>()
-    			&& !cell_iter->GetMutationState()->IsType<TransitCellAnoikisResistantMutationState>())
+    		bool can_die_by_anoikis;
+    		if (p_attributes)
+    		{
+    			can_die_by_anoikis = p_attributes->GetCellClass(node_index) != CryptCellAttributes::STROMAL_CELL
+    								 && !p_attributes->HasProperty<TransitCellAnoikisResistantMutationState>(node_index);
+    		}
+    		else
+    		{
+    			can_die_by_anoikis = !cell_iter->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>()
+    								 && !cell_iter->GetMutationState()->IsType<TransitCellAnoikisResistantMutationState>();
+    		}
+    		if (can_die_by_anoikis)
     		{
     			// Determining whether to remove this cell by anoikis
+    			bool has_popped_up = use_gel_neighbour_counts ? (mGelNeighbourCounts.GetNumGelNeighbours(node_index) < 1) : this->HasCellPoppedUp(node_index);
 
-    			if(this->HasCellPoppedUp(node_index))
+    			if(has_popped_up)
     			{
     				individual_node_information[1] = 1;
     			}
@@ -257,7 +296,7 @@ void AnoikisCellKillerMembraneCell::CheckAndLabelCellsForApoptosisOrDeath()
 		//    assert(p_tissue->GetVoronoiTessellation()!=NULL);	// This fails during archiving of a simulation as Voronoi stuff not archived yet
 
 		// Get the information at this timestep for each node index that says whether to remove by anoikis or random apoptosis
-		std::vector<c_vector<unsigned,2> > cells_to_remove = this->RemoveByAnoikis();
+		const std::vector<c_vector<unsigned,2> >& cells_to_remove = this->RemoveByAnoikis();
 
 		// Keep a record of how many cells have been removed at this timestep
 		this->SetNumberCellsRemoved(cells_to_remove);
@@ -281,7 +320,7 @@ void AnoikisCellKillerMembraneCell::CheckAndLabelCellsForApoptosisOrDeath()
 		NodeBasedCellPopulation<2>* p_tissue = static_cast<NodeBasedCellPopulation<2>*> (this->mpCellPopulation);
 
 		// Get the information at this timestep for each node index that says whether to remove by anoikis or random apoptosis
-		std::vector<c_vector<unsigned,2> > cells_to_remove = this->RemoveByAnoikis();
+		const std::vector<c_vector<unsigned,2> >& cells_to_remove = this->RemoveByAnoikis();
 
 		// Keep a record of how many cells have been removed at this timestep
 		this->SetNumberCellsRemoved(cells_to_remove);
@@ -302,13 +341,13 @@ void AnoikisCellKillerMembraneCell::CheckAndLabelCellsForApoptosisOrDeath()
 	}
 }
 
-void AnoikisCellKillerMembraneCell::SetNumberCellsRemoved(std::vector<c_vector<unsigned,2> > cellsRemoved)
+void AnoikisCellKillerMembraneCell::SetNumberCellsRemoved(const std::vector<c_vector<unsigned,2> >& rCellsRemoved)
 {
 	unsigned num_removed_by_anoikis = 0;
 
-    for (unsigned i=0; i<cellsRemoved.size(); i++)
+    for (unsigned i=0; i<rCellsRemoved.size(); i++)
     {
-    	if(cellsRemoved[i][1]==1)
+    	if(rCellsRemoved[i][1]==1)
     	{
     		num_removed_by_anoikis+=1;
     	}
@@ -322,7 +361,7 @@ unsigned AnoikisCellKillerMembraneCell::GetNumberCellsRemoved()
 	return mCellsRemovedByAnoikis;
 }
 
-void AnoikisCellKillerMembraneCell::SetLocationsOfCellsRemovedByAnoikis(std::vector<c_vector<unsigned,2> > cellsRemoved)
+void AnoikisCellKillerMembraneCell::SetLocationsOfCellsRemovedByAnoikis(const std::vector<c_vector<unsigned,2> >& rCellsRemoved)
 {
 	if (dynamic_cast<MeshBasedCellPopulation<2>*>(this->mpCellPopulation))
 	{
@@ -331,13 +370,13 @@ void AnoikisCellKillerMembraneCell::SetLocationsOfCellsRemovedByAnoikis(std::vec
 		c_vector<double, 3> time_and_location;
 
 		// Need to use the node indices to store the locations of where cells are removed
-		for (unsigned i=0; i<cellsRemoved.size(); i++)
+		for (unsigned i=0; i<rCellsRemoved.size(); i++)
 		{
-			if (cellsRemoved[i][1] == 1)		// This cell has been removed by anoikis
+			if (rCellsRemoved[i][1] == 1)		// This cell has been removed by anoikis
 			{
 				time_and_location[0] = SimulationTime::Instance()->GetTime();
 
-				unsigned node_index = cellsRemoved[i][0];
+				unsigned node_index = rCellsRemoved[i][0];
 
 				CellPtr p_cell = p_tissue->GetCellUsingLocationIndex(node_index);
 				x_location = this->mpCellPopulation->GetLocationOfCellCentre(p_cell)[0];
@@ -357,13 +396,13 @@ void AnoikisCellKillerMembraneCell::SetLocationsOfCellsRemovedByAnoikis(std::vec
 		c_vector<double, 3> time_and_location;
 
 		// Need to use the node indices to store the locations of where cells are removed
-		for (unsigned i=0; i<cellsRemoved.size(); i++)
+		for (unsigned i=0; i<rCellsRemoved.size(); i++)
 		{
-			if (cellsRemoved[i][1] == 1)		// This cell has been removed by anoikis
+			if (rCellsRemoved[i][1] == 1)		// This cell has been removed by anoikis
 			{
 				time_and_location[0] = SimulationTime::Instance()->GetTime();
 
-				unsigned node_index = cellsRemoved[i][0];
+				unsigned node_index = rCellsRemoved[i][0];
 
 				CellPtr p_cell = p_tissue->GetCellUsingLocationIndex(node_index);
 				x_location = this->mpCellPopulation->GetLocationOfCellCentre(p_cell)[0];
@@ -378,7 +417,7 @@ void AnoikisCellKillerMembraneCell::SetLocationsOfCellsRemovedByAnoikis(std::vec
 	}
 }
 
-std::vector<c_vector<double,3> > AnoikisCellKillerMembraneCell::GetLocationsOfCellsRemovedByAnoikis()
+const std::vector<c_vector<double,3> >& AnoikisCellKillerMembraneCell::GetLocationsOfCellsRemovedByAnoikis()
 {
 	return mLocationsOfAnoikisCells;
 }
@@ -9,6 +9,7 @@
 
 #include "AbstractCellKiller.hpp"
 #include "DifferentiatedCellProliferativeType.hpp"
+#include "GelNeighbourCounts.hpp"
 
 /*
  * Cell killer that removes any epithelial cell that has detached from the non-epithelial
@@ -33,6 +34,13 @@ private:
 
     std::string mOutputDirectory;
 
+    // The number of gel (membrane) neighbours of each cell, kept between time steps with a
+    // CryptCellPopulationWithGhostNodes
+    GelNeighbourCounts mGelNeighbourCounts;
+
+    // Filled by RemoveByAnoikis() each time step; kept to reuse its storage
+    std::vector<c_vector<unsigned,2> > mCellsToRemove;
+
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & archive, const unsigned int version)
@@ -75,7 +83,11 @@ public:
 
     bool HasCellPoppedUp(unsigned nodeIndex);
 
-    std::vector<c_vector<unsigned,2> > RemoveByAnoikis();
+    /* The gel neighbour counts used by RemoveByAnoikis() */
+    GelNeighbourCounts& rGetGelNeighbourCounts();
+
+
+    const std::vector<c_vector<unsigned,2> >& RemoveByAnoikis();
 
     /**
      *  Loops over and kills cells by anoikis or at the orifice if instructed.
@@ -86,7 +98,7 @@ public:
      * or not is passed to this method which then increments the member variables corresponding to the total number of cells
      * killed by anoikis or apoptosis through compression
      */
-    void SetNumberCellsRemoved(std::vector<c_vector<unsigned,2> > cellsRemoved);
+    void SetNumberCellsRemoved(const std::vector<c_vector<unsigned,2> >& rCellsRemoved);
 
     /* Returns the total number of cells removed by anoikis ([0]) and by compression ([1])
      *
@@ -96,12 +108,12 @@ public:
     /* Storing the x-locations of those epithelial cells that get removed by anoikis
      *
      */
-    void SetLocationsOfCellsRemovedByAnoikis(std::vector<c_vector<unsigned,2> > cellsRemoved);
+    void SetLocationsOfCellsRemovedByAnoikis(const std::vector<c_vector<unsigned,2> >& rCellsRemoved);
 
     /* Returns the x-coordinates of those cells removed by anoikis
      *
      */
-    std::vector<c_vector<double,3> > GetLocationsOfCellsRemovedByAnoikis();
+    const std::vector<c_vector<double,3> >& GetLocationsOfCellsRemovedByAnoikis();
 
     /**
      * Outputs cell killer parameters to file
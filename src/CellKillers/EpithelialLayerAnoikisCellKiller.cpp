@@ -15,12 +15,21 @@
 #include "NodeBasedCellPopulation.hpp"
 #include "PanethCellMutationState.hpp"
 #include "TransitCellAnoikisResistantMutationState.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+
+#include <cfloat>
 
 
 EpithelialLayerAnoikisCellKiller::EpithelialLayerAnoikisCellKiller(AbstractCellPopulation<2>* pCellPopulation)
     : AbstractCellKiller<2>(pCellPopulation),
     mCellsRemovedByAnoikis(0),
-    mCutOffRadius(1.5)
+    mCellsRemovedBySloughing(0),
+    mCellsRemovedByCompression(0),
+    mSloughOrifice(false),
+    mSloughHeight(DBL_MAX),
+    mCompressionThreshold(0.0),
+    mCutOffRadius(1.5),
+    mGelNeighbourCounts(CryptCellAttributes::STROMAL_CELL)
 {
     // Sets up output file
 //	OutputFileHandler output_file_handler(mOutputDirectory + "AnoikisData/", false);
@@ -44,6 +53,37 @@ void EpithelialLayerAnoikisCellKiller::SetCutOffRadius(double cutOffRadius)
 	mCutOffRadius = cutOffRadius;
 }
 
+void EpithelialLayerAnoikisCellKiller::SetSloughOrifice(bool sloughOrifice)
+{
+	mSloughOrifice = sloughOrifice;
+}
+
+bool EpithelialLayerAnoikisCellKiller::GetSloughOrifice()
+{
+	return mSloughOrifice;
+}
+
+void EpithelialLayerAnoikisCellKiller::SetSloughHeight(double sloughHeight)
+{
+	mSloughHeight = sloughHeight;
+}
+
+double EpithelialLayerAnoikisCellKiller::GetSloughHeight()
+{
+	return mSloughHeight;
+}
+
+void EpithelialLayerAnoikisCellKiller::SetCompressionThreshold(double compressionThreshold)
+{
+	assert(compressionThreshold >= 0.0);
+	mCompressionThreshold = compressionThreshold;
+}
+
+double EpithelialLayerAnoikisCellKiller::GetCompressionThreshold()
+{
+	return mCompressionThreshold;
+}
+
 std::set<unsigned> EpithelialLayerAnoikisCellKiller::GetNeighbouringNodeIndices(unsigned nodeIndex)
 {
 	// Create a set of neighbouring node indices
@@ -110,13 +150,27 @@ bool EpithelialLayerAnoikisCellKiller::HasCellPoppedUp(unsigned nodeIndex)
 
 		unsigned num_gel_neighbours = 0;
 
+		// The crypt population has the type of every node to hand
+		CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(this->mpCellPopulation);
+		const CryptCellAttributes* p_attributes = p_crypt_population ? &(p_crypt_population->rGetCellAttributes()) : NULL;
+
 		// Iterate over the neighbouring cells to check the number of differentiated cell neighbours
 
 		for(std::set<unsigned>::iterator neighbour_iter=neighbours.begin();
 				neighbour_iter != neighbours.end();
 				++neighbour_iter)
 		{
-			if ( (!p_tissue->IsGhostNode(*neighbour_iter))&&(p_tissue->GetCellUsingLocationIndex(*neighbour_iter)->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>()) )
+			bool is_gel_neighbour;
+			if (p_attributes)
+			{
+				// Ghost nodes have no class
+				is_gel_neighbour = (p_attributes->GetCellClass(*neighbour_iter) == CryptCellAttributes::STROMAL_CELL);
+			}
+			else
+			{
+				is_gel_neighbour = (!p_tissue->IsGhostNode(*neighbour_iter))&&(p_tissue->GetCellUsingLocationIndex(*neighbour_iter)->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>());
+			}
+			if (is_gel_neighbour)
 			{
 				num_gel_neighbours += 1;
 			}
@@ -156,19 +210,96 @@ bool EpithelialLayerAnoikisCellKiller::HasCellPoppedUp(unsigned nodeIndex)
 	return has_cell_popped_up;
 }
 
+GelNeighbourCounts& EpithelialLayerAnoikisCellKiller::rGetGelNeighbourCounts()
+{
+	return mGelNeighbourCounts;
+}
+
+void EpithelialLayerAnoikisCellKiller::UpdateMeanNeighbourDistances()
+{
+	mMeanNeighbourDistances.assign(this->mpCellPopulation->rGetMesh().GetNumAllNodes(), DBL_MAX);
+
+	CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(this->mpCellPopulation);
+	if (p_crypt_population)
+	{
+		// One pass over the edges between real cells, rather than a neighbour set for each cell
+		MutableMesh<2,2>& r_mesh = p_crypt_population->rGetMesh();
+		std::vector<double> total_distances(r_mesh.GetNumAllNodes(), 0.0);
+		std::vector<unsigned> num_neighbours(r_mesh.GetNumAllNodes(), 0);
+		for (MutableMesh<2,2>::EdgeIterator edge_iter = r_mesh.EdgesBegin();
+			 edge_iter != r_mesh.EdgesEnd();
+			 ++edge_iter)
+		{
+			unsigned node_a = edge_iter.GetNodeA()->GetIndex();
+			unsigned node_b = edge_iter.GetNodeB()->GetIndex();
+			if (p_crypt_population->IsGhostNode(node_a) || p_crypt_population->IsGhostNode(node_b))
+			{
+				continue;
+			}
+			double distance = norm_2(r_mesh.GetVectorFromAtoB(edge_iter.GetNodeA()->rGetLocation(), edge_iter.GetNodeB()->rGetLocation()));
+			total_distances[node_a] += distance;
+			total_distances[node_b] += distance;
+			num_neighbours[node_a]++;
+			num_neighbours[node_b]++;
+		}
+
+		for (unsigned i=0; i<num_neighbours.size(); i++)
+		{
+			if (num_neighbours[i] > 0)
+			{
+				mMeanNeighbourDistances[i] = total_distances[i]/num_neighbours[i];
+			}
+		}
+	}
+	else
+	{
+		for (AbstractCellPopulation<2>::Iterator cell_iter = this->mpCellPopulation->Begin();
+				cell_iter != this->mpCellPopulation->End();
+				++cell_iter)
+		{
+			unsigned node_index = this->mpCellPopulation->GetLocationIndexUsingCell(*cell_iter);
+			const c_vector<double, 2>& r_location = this->mpCellPopulation->GetNode(node_index)->rGetLocation();
+
+			std::set<unsigned> neighbours = GetNeighbouringNodeIndices(node_index);
+			if (neighbours.empty())
+			{
+				continue;
+			}
+
+			double total_distance = 0.0;
+			for (std::set<unsigned>::iterator neighbour_iter=neighbours.begin();
+					neighbour_iter != neighbours.end();
+					++neighbour_iter)
+			{
+				total_distance += norm_2(this->mpCellPopulation->rGetMesh().GetVectorFromAtoB(r_location, this->mpCellPopulation->GetNode(*neighbour_iter)->rGetLocation()));
+			}
+			mMeanNeighbourDistances[node_index] = total_distance/neighbours.size();
+		}
+	}
+}
+
 /** A method to return a vector that indicates which cells should be killed by anoikis
  * and which by compression-driven apoptosis
  */
-std::vector<c_vector<unsigned,2> > EpithelialLayerAnoikisCellKiller::RemoveByAnoikis()
+const std::vector<c_vector<unsigned,2> >& EpithelialLayerAnoikisCellKiller::RemoveByAnoikis()
 {
 
-    std::vector<c_vector<unsigned,2> > cells_to_remove;
+    std::vector<c_vector<unsigned,2> >& cells_to_remove = mCellsToRemove;
+    cells_to_remove.clear();
     if (dynamic_cast<MeshBasedCellPopulation<2>*>(this->mpCellPopulation))
     {
     	MeshBasedCellPopulation<2>* p_tissue = static_cast<MeshBasedCellPopulation<2>*> (this->mpCellPopulation);
     	//    assert(p_tissue->GetVoronoiTessellation()!=NULL);	// This fails during archiving of a simulation as Voronoi stuff not archived yet
 
-    	c_vector<unsigned,2> individual_node_information;	// Will store the node index and whether to remove or not (1 or 0)
+    	c_vector<unsigned,2> individual_node_information;	// Will store the node index and the RemovalCause, if any
+
+    	// Whether a cell has popped up only changes when its neighbours do
+    	bool use_gel_neighbour_counts = mGelNeighbourCounts.Update(*(this->mpCellPopulation));
+
+    	if (mCompressionThreshold > 0.0)
+    	{
+    		UpdateMeanNeighbourDistances();
+    	}
 
     	for (AbstractCellPopulation<2>::Iterator cell_iter = p_tissue->Begin();
     			cell_iter != p_tissue->End();
@@ -179,17 +310,24 @@ std::vector<c_vector<unsigned,2> > EpithelialLayerAnoikisCellKiller::RemoveByAno
 
     		// Initialise
     		individual_node_information[0] = node_index;
-    		individual_node_information[1] = 0;
+    		individual_node_information[1] = NOT_REMOVED;
 
-    		// Examine each epithelial node to see if it should be removed by anoikis and then if it
-    		// should be removed by compression-driven apoptosis
+    		// Examine each epithelial node to see if it should be sloughed, then if it should be removed
+    		// by anoikis and then if it should be removed by compression-driven apoptosis
     		if (!cell_iter->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>())
     		{
-    			// Determining whether to remove this cell by anoikis
-
-    			if(this->HasCellPoppedUp(node_index))
+    			if (mSloughOrifice && p_tissue->GetNode(node_index)->rGetLocation()[1] > mSloughHeight)
     			{
-    				individual_node_information[1] = 1;
+    				individual_node_information[1] = SLOUGHING;
+    			}
+    			else if (use_gel_neighbour_counts ? (mGelNeighbourCounts.GetNumGelNeighbours(node_index) < 1) : this->HasCellPoppedUp(node_index))
+    			{
+    				individual_node_information[1] = ANOIKIS;
+    			}
+    			else if (mCompressionThreshold > 0.0 && !cell_iter->HasApoptosisBegun()
+    					 && mMeanNeighbourDistances[node_index] < mCompressionThreshold)
+    			{
+    				individual_node_information[1] = COMPRESSION;
     			}
     		}
 
@@ -200,7 +338,12 @@ std::vector<c_vector<unsigned,2> > EpithelialLayerAnoikisCellKiller::RemoveByAno
     {
     	NodeBasedCellPopulation<2>* p_tissue = static_cast<NodeBasedCellPopulation<2>*> (this->mpCellPopulation);
 
-    	c_vector<unsigned,2> individual_node_information;	// Will store the node index and whether to remove or not (1 or 0)
+    	c_vector<unsigned,2> individual_node_information;	// Will store the node index and the RemovalCause, if any
+
+    	if (mCompressionThreshold > 0.0)
+    	{
+    		UpdateMeanNeighbourDistances();
+    	}
 
     	for (AbstractCellPopulation<2>::Iterator cell_iter = p_tissue->Begin();
     			cell_iter != p_tissue->End();
@@ -210,17 +353,24 @@ std::vector<c_vector<unsigned,2> > EpithelialLayerAnoikisCellKiller::RemoveByAno
 
     		// Initialise
     		individual_node_information[0] = node_index;
-    		individual_node_information[1] = 0;
+    		individual_node_information[1] = NOT_REMOVED;
 
-    		// Examine each epithelial node to see if it should be removed by anoikis and then if it
-    		// should be removed by compression-driven apoptosis
+    		// Examine each epithelial node to see if it should be sloughed, then if it should be removed
+    		// by anoikis and then if it should be removed by compression-driven apoptosis
     		if (!cell_iter->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>())
     		{
-    			// Determining whether to remove this cell by anoikis
-
-    			if(this->HasCellPoppedUp(node_index))
+    			if (mSloughOrifice && p_tissue->GetNode(node_index)->rGetLocation()[1] > mSloughHeight)
+    			{
+    				individual_node_information[1] = SLOUGHING;
+    			}
+    			else if (this->HasCellPoppedUp(node_index))
+    			{
+    				individual_node_information[1] = ANOIKIS;
+    			}
+    			else if (mCompressionThreshold > 0.0 && !cell_iter->HasApoptosisBegun()
+    					 && mMeanNeighbourDistances[node_index] < mCompressionThreshold)
     			{
-    				individual_node_information[1] = 1;
+    				individual_node_information[1] = COMPRESSION;
     			}
     		}
 
@@ -246,7 +396,7 @@ void EpithelialLayerAnoikisCellKiller::CheckAndLabelCellsForApoptosisOrDeath()
 		//    assert(p_tissue->GetVoronoiTessellation()!=NULL);	// This fails during archiving of a simulation as Voronoi stuff not archived yet
 
 		// Get the information at this timestep for each node index that says whether to remove by anoikis or random apoptosis
-		std::vector<c_vector<unsigned,2> > cells_to_remove = this->RemoveByAnoikis();
+		const std::vector<c_vector<unsigned,2> >& cells_to_remove = this->RemoveByAnoikis();
 
 		// Keep a record of how many cells have been removed at this timestep
 		this->SetNumberCellsRemoved(cells_to_remove);
@@ -257,12 +407,16 @@ void EpithelialLayerAnoikisCellKiller::CheckAndLabelCellsForApoptosisOrDeath()
 
 		for (unsigned i=0; i<cells_to_remove.size(); i++)
 		{
-			if (cells_to_remove[i][1] == 1)
+			if (cells_to_remove[i][1] == ANOIKIS || cells_to_remove[i][1] == SLOUGHING)
 			{
 				// Get cell associated to this node
 				CellPtr p_cell = p_tissue->GetCellUsingLocationIndex(cells_to_remove[i][0]);
 				p_cell->Kill();
 			}
+			else if (cells_to_remove[i][1] == COMPRESSION)
+			{
+				p_tissue->GetCellUsingLocationIndex(cells_to_remove[i][0])->StartApoptosis();
+			}
 		}
 	}
 	else if (dynamic_cast<NodeBasedCellPopulation<2>*>(this->mpCellPopulation))
@@ -270,7 +424,7 @@ void EpithelialLayerAnoikisCellKiller::CheckAndLabelCellsForApoptosisOrDeath()
 		NodeBasedCellPopulation<2>* p_tissue = static_cast<NodeBasedCellPopulation<2>*> (this->mpCellPopulation);
 
 		// Get the information at this timestep for each node index that says whether to remove by anoikis or random apoptosis
-		std::vector<c_vector<unsigned,2> > cells_to_remove = this->RemoveByAnoikis();
+		const std::vector<c_vector<unsigned,2> >& cells_to_remove = this->RemoveByAnoikis();
 
 		// Keep a record of how many cells have been removed at this timestep
 		this->SetNumberCellsRemoved(cells_to_remove);
@@ -281,26 +435,38 @@ void EpithelialLayerAnoikisCellKiller::CheckAndLabelCellsForApoptosisOrDeath()
 
 		for (unsigned i=0; i<cells_to_remove.size(); i++)
 		{
-			if (cells_to_remove[i][1] == 1)
+			if (cells_to_remove[i][1] == ANOIKIS || cells_to_remove[i][1] == SLOUGHING)
 			{
 				// Get cell associated to this node
 				CellPtr p_cell = p_tissue->GetCellUsingLocationIndex(cells_to_remove[i][0]);
 				p_cell->Kill();
 			}
+			else if (cells_to_remove[i][1] == COMPRESSION)
+			{
+				p_tissue->GetCellUsingLocationIndex(cells_to_remove[i][0])->StartApoptosis();
+			}
 		}
 	}
 }
 
-void EpithelialLayerAnoikisCellKiller::SetNumberCellsRemoved(std::vector<c_vector<unsigned,2> > cellsRemoved)
+void EpithelialLayerAnoikisCellKiller::SetNumberCellsRemoved(const std::vector<c_vector<unsigned,2> >& rCellsRemoved)
 {
 	unsigned num_removed_by_anoikis = 0;
 
-    for (unsigned i=0; i<cellsRemoved.size(); i++)
+    for (unsigned i=0; i<rCellsRemoved.size(); i++)
     {
-    	if(cellsRemoved[i][1]==1)
+    	if(rCellsRemoved[i][1]==ANOIKIS)
     	{
     		num_removed_by_anoikis+=1;
     	}
+    	else if (rCellsRemoved[i][1]==SLOUGHING)
+    	{
+    		mCellsRemovedBySloughing++;
+    	}
+    	else if (rCellsRemoved[i][1]==COMPRESSION)
+    	{
+    		mCellsRemovedByCompression++;
+    	}
     }
 
     mCellsRemovedByAnoikis += num_removed_by_anoikis;
@@ -311,7 +477,17 @@ unsigned EpithelialLayerAnoikisCellKiller::GetNumberCellsRemoved()
 	return mCellsRemovedByAnoikis;
 }
 
-void EpithelialLayerAnoikisCellKiller::SetLocationsOfCellsRemovedByAnoikis(std::vector<c_vector<unsigned,2> > cellsRemoved)
+unsigned EpithelialLayerAnoikisCellKiller::GetNumberCellsSloughed()
+{
+	return mCellsRemovedBySloughing;
+}
+
+unsigned EpithelialLayerAnoikisCellKiller::GetNumberCellsRemovedByCompression()
+{
+	return mCellsRemovedByCompression;
+}
+
+void EpithelialLayerAnoikisCellKiller::SetLocationsOfCellsRemovedByAnoikis(const std::vector<c_vector<unsigned,2> >& rCellsRemoved)
 {
 	if (dynamic_cast<MeshBasedCellPopulation<2>*>(this->mpCellPopulation))
 	{
@@ -320,13 +496,13 @@ void EpithelialLayerAnoikisCellKiller::SetLocationsOfCellsRemovedByAnoikis(std::
 		c_vector<double, 3> time_and_location;
 
 		// Need to use the node indices to store the locations of where cells are removed
-		for (unsigned i=0; i<cellsRemoved.size(); i++)
+		for (unsigned i=0; i<rCellsRemoved.size(); i++)
 		{
-			if (cellsRemoved[i][1] == 1)		// This cell has been removed by anoikis
+			if (rCellsRemoved[i][1] != NOT_REMOVED)
 			{
 				time_and_location[0] = SimulationTime::Instance()->GetTime();
 
-				unsigned node_index = cellsRemoved[i][0];
+				unsigned node_index = rCellsRemoved[i][0];
 
 				CellPtr p_cell = p_tissue->GetCellUsingLocationIndex(node_index);
 				x_location = this->mpCellPopulation->GetLocationOfCellCentre(p_cell)[0];
@@ -335,7 +511,17 @@ void EpithelialLayerAnoikisCellKiller::SetLocationsOfCellsRemovedByAnoikis(std::
 				time_and_location[1] = x_location;
 				time_and_location[2] = y_location;
 
-				mLocationsOfAnoikisCells.push_back(time_and_location);
+				if (rCellsRemoved[i][1] == ANOIKIS)		// This cell has been removed by anoikis
+				{
+					mLocationsOfAnoikisCells.push_back(time_and_location);
+				}
+
+				c_vector<double,4> removal_event;
+				removal_event[0] = time_and_location[0];
+				removal_event[1] = x_location;
+				removal_event[2] = y_location;
+				removal_event[3] = rCellsRemoved[i][1];
+				mRemovalEvents.push_back(removal_event);
 			}
 		}
 	}
@@ -346,13 +532,13 @@ void EpithelialLayerAnoikisCellKiller::SetLocationsOfCellsRemovedByAnoikis(std::
 		c_vector<double, 3> time_and_location;
 
 		// Need to use the node indices to store the locations of where cells are removed
-		for (unsigned i=0; i<cellsRemoved.size(); i++)
+		for (unsigned i=0; i<rCellsRemoved.size(); i++)
 		{
-			if (cellsRemoved[i][1] == 1)		// This cell has been removed by anoikis
+			if (rCellsRemoved[i][1] != NOT_REMOVED)
 			{
 				time_and_location[0] = SimulationTime::Instance()->GetTime();
 
-				unsigned node_index = cellsRemoved[i][0];
+				unsigned node_index = rCellsRemoved[i][0];
 
 				CellPtr p_cell = p_tissue->GetCellUsingLocationIndex(node_index);
 				x_location = this->mpCellPopulation->GetLocationOfCellCentre(p_cell)[0];
@@ -361,21 +547,39 @@ void EpithelialLayerAnoikisCellKiller::SetLocationsOfCellsRemovedByAnoikis(std::
 				time_and_location[1] = x_location;
 				time_and_location[2] = y_location;
 
-				mLocationsOfAnoikisCells.push_back(time_and_location);
+				if (rCellsRemoved[i][1] == ANOIKIS)		// This cell has been removed by anoikis
+				{
+					mLocationsOfAnoikisCells.push_back(time_and_location);
+				}
+
+				c_vector<double,4> removal_event;
+				removal_event[0] = time_and_location[0];
+				removal_event[1] = x_location;
+				removal_event[2] = y_location;
+				removal_event[3] = rCellsRemoved[i][1];
+				mRemovalEvents.push_back(removal_event);
 			}
 		}
 	}
 }
 
-std::vector<c_vector<double,3> > EpithelialLayerAnoikisCellKiller::GetLocationsOfCellsRemovedByAnoikis()
+const std::vector<c_vector<double,3> >& EpithelialLayerAnoikisCellKiller::GetLocationsOfCellsRemovedByAnoikis()
 {
 	return mLocationsOfAnoikisCells;
 }
 
+const std::vector<c_vector<double,4> >& EpithelialLayerAnoikisCellKiller::GetRemovalEvents()
+{
+	return mRemovalEvents;
+}
+
 void EpithelialLayerAnoikisCellKiller::OutputCellKillerParameters(out_stream& rParamsFile)
 {
     *rParamsFile << "\t\t\t<CellsRemovedByAnoikis>" << mCellsRemovedByAnoikis << "</CellsRemovedByAnoikis> \n";
     *rParamsFile << "\t\t\t<CutOffRadius>" << mCutOffRadius << "</CutOffRadius> \n";
+    *rParamsFile << "\t\t\t<SloughOrifice>" << mSloughOrifice << "</SloughOrifice> \n";
+    *rParamsFile << "\t\t\t<SloughHeight>" << mSloughHeight << "</SloughHeight> \n";
+    *rParamsFile << "\t\t\t<CompressionThreshold>" << mCompressionThreshold << "</CompressionThreshold> \n";
 
     // Call direct parent class
     AbstractCellKiller<2>::OutputCellKillerParameters(rParamsFile);
@@ -9,21 +9,52 @@
 
 #include "AbstractCellKiller.hpp"
 #include "DifferentiatedCellProliferativeType.hpp"
+#include "GelNeighbourCounts.hpp"
 
 /*
  * Cell killer that removes any epithelial cell that has detached from the non-epithelial
- * region and entered the lumen
+ * region and entered the lumen.
+ *
+ * It can also slough epithelial cells that have reached the orifice (above the slough height),
+ * and start apoptosis in epithelial cells that are compressed (whose mean distance to their
+ * neighbours is below the compression threshold). All three are checked in the same pass over
+ * the cells, and each removal is logged with its cause.
  */
 
 class EpithelialLayerAnoikisCellKiller : public AbstractCellKiller<2>
 {
+public:
+
+	/* Why a cell is removed, as stored in the second entry of each RemoveByAnoikis() result */
+	enum RemovalCause
+	{
+		NOT_REMOVED = 0,
+		ANOIKIS = 1,
+		SLOUGHING = 2,
+		COMPRESSION = 3
+	};
+
 private:
 
 	// Number of cells removed by Anoikis
 	unsigned mCellsRemovedByAnoikis;
 
+	// Number of cells sloughed at the orifice, and started on compression-driven apoptosis
+	unsigned mCellsRemovedBySloughing;
+	unsigned mCellsRemovedByCompression;
+
+	// Whether to slough epithelial cells above mSloughHeight
+	bool mSloughOrifice;
+	double mSloughHeight;
+
+	// Epithelial cells whose mean distance to their neighbours is less than this start apoptosis. Zero turns it off.
+	double mCompressionThreshold;
+
     std::vector<c_vector<double,3> > mLocationsOfAnoikisCells;
 
+    // The time, location and cause (a RemovalCause) of every removal
+    std::vector<c_vector<double,4> > mRemovalEvents;
+
     //Cut off radius for NodeBasedCellPopulations
     double mCutOffRadius;
 
@@ -33,12 +64,30 @@ private:
 
     std::string mOutputDirectory;
 
+    // The number of gel (stromal) neighbours of each cell, kept between time steps with a
+    // CryptCellPopulationWithGhostNodes
+    GelNeighbourCounts mGelNeighbourCounts;
+
+    // Filled by RemoveByAnoikis() each time step; kept to reuse its storage
+    std::vector<c_vector<unsigned,2> > mCellsToRemove;
+
+    // The mean distance from each node to its neighbouring cells, only filled when compression is checked
+    std::vector<double> mMeanNeighbourDistances;
+
+    /* Fill mMeanNeighbourDistances for this time step */
+    void UpdateMeanNeighbourDistances();
+
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & archive, const unsigned int version)
     {
         archive & boost::serialization::base_object<AbstractCellKiller<2> >(*this);
         archive & mCellsRemovedByAnoikis;
+        archive & mCellsRemovedBySloughing;
+        archive & mCellsRemovedByCompression;
+        archive & mSloughOrifice;
+        archive & mSloughHeight;
+        archive & mCompressionThreshold;
         archive & mCutOffRadius;
         archive & mOutputDirectory;
     }
@@ -49,7 +98,6 @@ public:
      * Default constructor.
      *
      * @param pCellPopulation pointer to a tissue
-     * @param sloughOrifice whether to slough compressed cells at crypt orifice
      */
 	EpithelialLayerAnoikisCellKiller(AbstractCellPopulation<2>* pCellPopulation);
 
@@ -71,14 +119,30 @@ public:
      */
     void SetCutOffRadius(double cutOffRadius);
 
+    void SetSloughOrifice(bool sloughOrifice);
+
+    bool GetSloughOrifice();
+
+    void SetSloughHeight(double sloughHeight);
+
+    double GetSloughHeight();
+
+    void SetCompressionThreshold(double compressionThreshold);
+
+    double GetCompressionThreshold();
+
     std::set<unsigned> GetNeighbouringNodeIndices(unsigned nodeIndex);
 
     bool HasCellPoppedUp(unsigned nodeIndex);
 
-    std::vector<c_vector<unsigned,2> > RemoveByAnoikis();
+    /* The gel neighbour counts used by RemoveByAnoikis() */
+    GelNeighbourCounts& rGetGelNeighbourCounts();
+
+    /* For each cell, its node index and the RemovalCause, if any, for this time step */
+    const std::vector<c_vector<unsigned,2> >& RemoveByAnoikis();
 
     /**
-     *  Loops over and kills cells by anoikis or at the orifice if instructed.
+     *  Loops over and kills cells by anoikis or at the orifice, and starts apoptosis in compressed cells, if instructed.
      */
     void CheckAndLabelCellsForApoptosisOrDeath();
 
@@ -86,22 +150,29 @@ public:
      * or not is passed to this method which then increments the member variables corresponding to the total number of cells
      * killed by anoikis or apoptosis through compression
      */
-    void SetNumberCellsRemoved(std::vector<c_vector<unsigned,2> > cellsRemoved);
+    void SetNumberCellsRemoved(const std::vector<c_vector<unsigned,2> >& rCellsRemoved);
 
     /* Returns the total number of cells removed by anoikis ([0]) and by compression ([1])
      *
      */
     unsigned GetNumberCellsRemoved();
 
+    unsigned GetNumberCellsSloughed();
+
+    unsigned GetNumberCellsRemovedByCompression();
+
     /* Storing the x-locations of those epithelial cells that get removed by anoikis
      *
      */
-    void SetLocationsOfCellsRemovedByAnoikis(std::vector<c_vector<unsigned,2> > cellsRemoved);
+    void SetLocationsOfCellsRemovedByAnoikis(const std::vector<c_vector<unsigned,2> >& rCellsRemoved);
 
     /* Returns the x-coordinates of those cells removed by anoikis
      *
      */
-    std::vector<c_vector<double,3> > GetLocationsOfCellsRemovedByAnoikis();
+    const std::vector<c_vector<double,3> >& GetLocationsOfCellsRemovedByAnoikis();
+
+    /* Returns the time, x, y and RemovalCause of every cell removed, by any cause */
+    const std::vector<c_vector<double,4> >& GetRemovalEvents();
 
     /**
      * Outputs cell killer parameters to file
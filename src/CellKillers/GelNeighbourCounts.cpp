@@ -0,0 +1,139 @@
+#include "GelNeighbourCounts.hpp"
+
+GelNeighbourCounts::GelNeighbourCounts(CryptCellAttributes::CellClass gelClass)
+	: mGelClass(gelClass),
+	mTopologyVersion(0),
+	mClassChangeVersion(0),
+	mAreCountsValid(false)
+{
+}
+
+std::set<unsigned> GelNeighbourCounts::GetNeighbouringNodeIndices(CryptCellPopulationWithGhostNodes& rCellPopulation, unsigned nodeIndex)
+{
+	std::set<unsigned> neighbouring_node_indices;
+
+	Node<2>* p_node = rCellPopulation.GetNode(nodeIndex);
+	for (Node<2>::ContainingElementIterator elem_iter = p_node->ContainingElementsBegin();
+		 elem_iter != p_node->ContainingElementsEnd();
+		 ++elem_iter)
+	{
+		Element<2,2>* p_element = rCellPopulation.rGetMesh().GetElement(*elem_iter);
+		for (unsigned local_index=0; local_index<3; local_index++)
+		{
+			unsigned neighbour_index = p_element->GetNodeGlobalIndex(local_index);
+			if (neighbour_index != nodeIndex && !rCellPopulation.IsGhostNode(neighbour_index))
+			{
+				neighbouring_node_indices.insert(neighbour_index);
+			}
+		}
+	}
+
+	return neighbouring_node_indices;
+}
+
+unsigned GelNeighbourCounts::CountGelNeighbours(CryptCellPopulationWithGhostNodes& rCellPopulation, unsigned nodeIndex)
+{
+	const CryptCellAttributes& r_attributes = rCellPopulation.rGetCellAttributes();
+	std::set<unsigned> neighbours = GetNeighbouringNodeIndices(rCellPopulation, nodeIndex);
+
+	unsigned num_gel_neighbours = 0;
+	for (std::set<unsigned>::iterator neighbour_iter = neighbours.begin();
+		 neighbour_iter != neighbours.end();
+		 ++neighbour_iter)
+	{
+		if (r_attributes.GetCellClass(*neighbour_iter) == mGelClass)
+		{
+			num_gel_neighbours++;
+		}
+	}
+	return num_gel_neighbours;
+}
+
+bool GelNeighbourCounts::Update(AbstractCellPopulation<2>& rCellPopulation)
+{
+	CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(&rCellPopulation);
+	if (p_crypt_population == NULL)
+	{
+		return false;
+	}
+
+	MutableMesh<2,2>& r_mesh = p_crypt_population->rGetMesh();
+	const CryptCellAttributes& r_attributes = p_crypt_population->rGetCellAttributes();
+	unsigned topology_version = p_crypt_population->GetTopologyVersion();
+	unsigned class_change_version = r_attributes.GetClassChangeVersion();
+
+	bool recount_all = (!mAreCountsValid
+						|| topology_version > mTopologyVersion + 1
+						|| (topology_version == mTopologyVersion + 1 && !p_crypt_population->IsLastTopologyChangeLocal())
+						|| class_change_version > mClassChangeVersion + 1);
+
+	if (recount_all)
+	{
+		// Count again in one pass over the edges. Ghost nodes have no class, so they are never counted as gel.
+		mNumGelNeighbours.assign(r_mesh.GetNumAllNodes(), 0);
+		for (MutableMesh<2,2>::EdgeIterator edge_iter = r_mesh.EdgesBegin();
+			 edge_iter != r_mesh.EdgesEnd();
+			 ++edge_iter)
+		{
+			unsigned node_a = edge_iter.GetNodeA()->GetIndex();
+			unsigned node_b = edge_iter.GetNodeB()->GetIndex();
+			if (r_attributes.GetCellClass(node_a) == mGelClass)
+			{
+				mNumGelNeighbours[node_b]++;
+			}
+			if (r_attributes.GetCellClass(node_b) == mGelClass)
+			{
+				mNumGelNeighbours[node_a]++;
+			}
+		}
+	}
+	else
+	{
+		std::set<unsigned> nodes_to_recount;
+
+		// Only the nodes of the flipped elements have new neighbours
+		if (topology_version == mTopologyVersion + 1)
+		{
+			const std::set<unsigned>& r_changed_elements = p_crypt_population->rGetChangedElements();
+			for (std::set<unsigned>::const_iterator elem_iter = r_changed_elements.begin();
+				 elem_iter != r_changed_elements.end();
+				 ++elem_iter)
+			{
+				for (unsigned local_index=0; local_index<3; local_index++)
+				{
+					nodes_to_recount.insert(r_mesh.GetElement(*elem_iter)->GetNodeGlobalIndex(local_index));
+				}
+			}
+		}
+
+		// A cell that has become gel, or stopped being gel, changes the counts of its neighbours
+		if (class_change_version == mClassChangeVersion + 1)
+		{
+			const std::vector<unsigned>& r_changed_nodes = r_attributes.rGetNodesWithChangedClass();
+			for (unsigned i=0; i<r_changed_nodes.size(); i++)
+			{
+				std::set<unsigned> neighbours = GetNeighbouringNodeIndices(*p_crypt_population, r_changed_nodes[i]);
+				nodes_to_recount.insert(neighbours.begin(), neighbours.end());
+			}
+		}
+
+		for (std::set<unsigned>::iterator node_iter = nodes_to_recount.begin();
+			 node_iter != nodes_to_recount.end();
+			 ++node_iter)
+		{
+			mNumGelNeighbours[*node_iter] = CountGelNeighbours(*p_crypt_population, *node_iter);
+		}
+	}
+
+	mTopologyVersion = topology_version;
+	mClassChangeVersion = class_change_version;
+	mAreCountsValid = true;
+	return true;
+}
+
+unsigned GelNeighbourCounts::GetNumGelNeighbours(unsigned nodeIndex) const
+{
+	assert(mAreCountsValid);
+	assert(nodeIndex < mNumGelNeighbours.size());
+	return mNumGelNeighbours[nodeIndex];
+}
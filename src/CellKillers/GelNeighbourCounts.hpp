@@ -0,0 +1,56 @@
+#ifndef GELNEIGHBOURCOUNTS_HPP_
+#define GELNEIGHBOURCOUNTS_HPP_
+
+#include "CryptCellAttributes.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+
+#include <set>
+#include <vector>
+
+/*
+ * The number of gel neighbours of each node of a CryptCellPopulationWithGhostNodes, kept
+ * from one time step to the next for the anoikis killers: a cell with no gel neighbours
+ * has popped up. Which class counts as gel is given to the constructor (membrane cells
+ * for AnoikisCellKillerMembraneCell, stromal cells for EpithelialLayerAnoikisCellKiller).
+ *
+ * Update() recounts everything in one pass over the mesh edges after every full remesh,
+ * since that can renumber the nodes and re-triangulate wherever they have drifted. After
+ * a local repair only the nodes of the flipped elements are recounted, and after cells
+ * have changed class (see CryptCellAttributes::GetClassChangeVersion()) only their
+ * neighbours.
+ */
+
+class GelNeighbourCounts
+{
+private:
+
+    CryptCellAttributes::CellClass mGelClass;
+
+    // The number of gel neighbours of each node, indexed by node index
+    std::vector<unsigned> mNumGelNeighbours;
+
+    // The topology version and class change version the counts are for
+    unsigned mTopologyVersion;
+    unsigned mClassChangeVersion;
+    bool mAreCountsValid;
+
+    /* The real nodes that share an element with the node */
+    std::set<unsigned> GetNeighbouringNodeIndices(CryptCellPopulationWithGhostNodes& rCellPopulation, unsigned nodeIndex);
+
+public:
+
+    GelNeighbourCounts(CryptCellAttributes::CellClass gelClass);
+
+    /* Bring the counts up to date with the mesh and the cell classes. Returns false if the
+     * population is not a CryptCellPopulationWithGhostNodes, so there are no counts.
+     */
+    bool Update(AbstractCellPopulation<2>& rCellPopulation);
+
+    /* The number of gel neighbours of a node, counted from its containing elements */
+    unsigned CountGelNeighbours(CryptCellPopulationWithGhostNodes& rCellPopulation, unsigned nodeIndex);
+
+    /* The last count for a node, from Update() */
+    unsigned GetNumGelNeighbours(unsigned nodeIndex) const;
+};
+
+#endif /* GELNEIGHBOURCOUNTS_HPP_ */
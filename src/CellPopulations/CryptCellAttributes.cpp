@@ -0,0 +1,102 @@
+#include "CryptCellAttributes.hpp"
+#include "SimulationTime.hpp"
+#include "MembraneCellProliferativeType.hpp"
+#include "DifferentiatedCellProliferativeType.hpp"
+#include "TransitCellProliferativeType.hpp"
+#include "StemCellProliferativeType.hpp"
+
+const unsigned CryptCellAttributes::NO_CELL;
+
+CryptCellAttributes::CryptCellAttributes()
+	: mClassChangeVersion(0),
+	mIsValid(false),
+	mTimeStepsElapsed(0),
+	mTopologyVersion(0)
+{
+}
+
+CryptCellAttributes::CellClass CryptCellAttributes::ClassifyCell(CellPtr pCell)
+{
+	boost::shared_ptr<AbstractCellProliferativeType> p_type = pCell->GetCellProliferativeType();
+	if (p_type->IsType<MembraneCellProliferativeType>())
+	{
+		return MEMBRANE_CELL;
+	}
+	else if (p_type->IsType<DifferentiatedCellProliferativeType>())
+	{
+		return STROMAL_CELL;
+	}
+	else if (p_type->IsType<TransitCellProliferativeType>() || p_type->IsType<StemCellProliferativeType>())
+	{
+		return EPITHELIAL_CELL;
+	}
+	return OTHER_CELL;
+}
+
+bool CryptCellAttributes::IsCurrent(unsigned topologyVersion) const
+{
+	return mIsValid
+		&& mTopologyVersion == topologyVersion
+		&& mTimeStepsElapsed == SimulationTime::Instance()->GetTimeStepsElapsed();
+}
+
+void CryptCellAttributes::Invalidate()
+{
+	mIsValid = false;
+}
+
+void CryptCellAttributes::Update(AbstractCellPopulation<2>& rCellPopulation, unsigned topologyVersion)
+{
+	unsigned num_nodes = rCellPopulation.GetNumNodes();
+
+	// Kept to spot the cells that have changed class; only the same cell at the same node is compared
+	mPreviousCellClasses.swap(mCellClasses);
+	mPreviousCellIds.swap(mCellIds);
+	std::vector<unsigned> nodes_with_changed_class;
+
+	mAges.assign(num_nodes, 0.0);
+	mApoptosisFactors.assign(num_nodes, 1.0);
+	mCellClasses.assign(num_nodes, OTHER_CELL);
+	mPropertyTags.assign(num_nodes, 0);
+	mCellIds.assign(num_nodes, NO_CELL);
+
+	for (AbstractCellPopulation<2>::Iterator cell_iter = rCellPopulation.Begin();
+		 cell_iter != rCellPopulation.End();
+		 ++cell_iter)
+	{
+		unsigned node_index = rCellPopulation.GetLocationIndexUsingCell(*cell_iter);
+		if (node_index >= num_nodes)
+		{
+			continue;
+		}
+
+		mAges[node_index] = cell_iter->GetAge();
+
+		if (cell_iter->HasApoptosisBegun())
+		{
+			mApoptosisFactors[node_index] = cell_iter->GetTimeUntilDeath()/cell_iter->GetApoptosisTime();
+		}
+
+		mCellClasses[node_index] = ClassifyCell(*cell_iter);
+
+		mPropertyTags[node_index] = GetCryptPropertyTags(*cell_iter);
+
+		mCellIds[node_index] = cell_iter->GetCellId();
+
+		if (node_index < mPreviousCellIds.size() && mPreviousCellIds[node_index] == mCellIds[node_index]
+			&& mPreviousCellClasses[node_index] != mCellClasses[node_index])
+		{
+			nodes_with_changed_class.push_back(node_index);
+		}
+	}
+
+	if (!nodes_with_changed_class.empty())
+	{
+		mClassChangeVersion++;
+		mNodesWithChangedClass.swap(nodes_with_changed_class);
+	}
+
+	mIsValid = true;
+	mTimeStepsElapsed = SimulationTime::Instance()->GetTimeStepsElapsed();
+	mTopologyVersion = topologyVersion;
+}
@@ -0,0 +1,133 @@
+#ifndef CRYPTCELLATTRIBUTES_HPP_
+#define CRYPTCELLATTRIBUTES_HPP_
+
+#include <climits>
+#include <vector>
+
+#include "AbstractCellPopulation.hpp"
+#include "CryptPropertyTags.hpp"
+
+/*
+ * What the forces and killers need to know about each cell, worked out once per time step.
+ *
+ * Each spring evaluation used to ask both of its cells for their age, apoptosis state,
+ * proliferative type and mutation state, through virtual calls and shared pointer copies,
+ * and each cell is in about six springs. Here the answers are stored in flat arrays
+ * indexed by node index, filled once by Update(). Nodes with no cell (ghost nodes)
+ * have class OTHER_CELL and cell id NO_CELL. The project's own cell properties are
+ * kept as a bitset of CryptPropertyTags, so HasProperty<BoundaryCellProperty>() and
+ * the like are one AND.
+ *
+ * Update() also compares each cell's class with the one it had at the last Update(), so
+ * caches that depend on the classes (e.g. the anoikis killers' gel neighbour counts) can
+ * check GetClassChangeVersion() rather than look at every cell themselves.
+ *
+ * The arrays hold for one time step and one triangulation: the owning population calls
+ * Update() again when either has changed (see IsCurrent()), or after Invalidate().
+ */
+
+class CryptCellAttributes
+{
+public:
+
+    // The proliferative types the spring forces tell apart
+    enum CellClass
+    {
+        EPITHELIAL_CELL, // stem or transit
+        MEMBRANE_CELL,
+        STROMAL_CELL,    // differentiated
+        OTHER_CELL
+    };
+
+private:
+
+    std::vector<double> mAges;
+
+    // Multiplies the cell's half of a spring's rest length; below one once apoptosis has begun
+    std::vector<double> mApoptosisFactors;
+
+    std::vector<unsigned char> mCellClasses;
+    std::vector<CryptPropertyBits> mPropertyTags;
+
+    // The id of the cell at each node, or NO_CELL
+    std::vector<unsigned> mCellIds;
+
+    // The classes and ids at the Update() before; kept to reuse their storage
+    std::vector<unsigned char> mPreviousCellClasses;
+    std::vector<unsigned> mPreviousCellIds;
+
+    // Incremented by each Update() that finds a cell with a different class from last time,
+    // and the nodes of those cells
+    unsigned mClassChangeVersion;
+    std::vector<unsigned> mNodesWithChangedClass;
+
+    // The time step and topology version the arrays were filled at
+    bool mIsValid;
+    unsigned mTimeStepsElapsed;
+    unsigned mTopologyVersion;
+
+public:
+
+    static const unsigned NO_CELL = UINT_MAX;
+
+    CryptCellAttributes();
+
+    /* The class of a single cell, as stored by Update() */
+    static CellClass ClassifyCell(CellPtr pCell);
+
+    /* Whether the arrays were filled during this time step, at this topology version */
+    bool IsCurrent(unsigned topologyVersion) const;
+
+    /* Make the next IsCurrent() false, e.g. after cells have been added or their properties changed */
+    void Invalidate();
+
+    /* Fill the arrays from the cells of the population, noting any cell whose class has changed */
+    void Update(AbstractCellPopulation<2>& rCellPopulation, unsigned topologyVersion);
+
+    double GetAge(unsigned nodeIndex) const
+    {
+        return mAges[nodeIndex];
+    }
+
+    double GetApoptosisFactor(unsigned nodeIndex) const
+    {
+        return mApoptosisFactors[nodeIndex];
+    }
+
+    CellClass GetCellClass(unsigned nodeIndex) const
+    {
+        return static_cast<CellClass>(mCellClasses[nodeIndex]);
+    }
+
+    unsigned GetCellId(unsigned nodeIndex) const
+    {
+        return mCellIds[nodeIndex];
+    }
+
+    /* Goes up each time Update() finds cells that have changed class since the Update() before */
+    unsigned GetClassChangeVersion() const
+    {
+        return mClassChangeVersion;
+    }
+
+    /* The nodes of the cells that had changed class at the last increment of GetClassChangeVersion() */
+    const std::vector<unsigned>& rGetNodesWithChangedClass() const
+    {
+        return mNodesWithChangedClass;
+    }
+
+    /* The number of nodes the arrays were filled for */
+    unsigned GetNumNodes() const
+    {
+        return mCellIds.size();
+    }
+
+    /* Whether the cell at the node has the property, which must have a CryptPropertyTag */
+    template<class PROPERTY>
+    bool HasProperty(unsigned nodeIndex) const
+    {
+        return (mPropertyTags[nodeIndex] & CryptPropertyTag<PROPERTY>::BIT) != 0;
+    }
+};
+
+#endif /* CRYPTCELLATTRIBUTES_HPP_ */
@@ -0,0 +1,712 @@
+#include "CryptCellPopulationWithGhostNodes.hpp"
+#include "SimulationTime.hpp"
+#include "BoundaryCellProperty.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <queue>
+
+namespace
+{
+	/* Twice the signed area of the triangle abc; positive if it goes anticlockwise */
+	double SignedArea(MutableMesh<2,2>& rMesh, const c_vector<double, 2>& rA, const c_vector<double, 2>& rB, const c_vector<double, 2>& rC)
+	{
+		c_vector<double, 2> vector_ab = rMesh.GetVectorFromAtoB(rA, rB);
+		c_vector<double, 2> vector_ac = rMesh.GetVectorFromAtoB(rA, rC);
+		return vector_ab[0]*vector_ac[1] - vector_ab[1]*vector_ac[0];
+	}
+}
+
+CryptCellPopulationWithGhostNodes::CryptCellPopulationWithGhostNodes(MutableMesh<2,2>& rMesh,
+																	std::vector<CellPtr>& rCells,
+																	const std::vector<unsigned> locationIndices,
+																	bool deleteMesh,
+																	double ghostSpringStiffness)
+	: MeshBasedCellPopulationWithGhostNodes<2>(rMesh, rCells, locationIndices, deleteMesh, ghostSpringStiffness),
+	mRemeshDisplacementThreshold(0.0),
+	mNumRemeshes(0),
+	mNumSkippedRemeshes(0),
+	mNumGhostLayers(0),
+	mMaxGhostEdgeLength(1.5),
+	mNumGhostNodesAdded(0),
+	mNumGhostNodesRemoved(0),
+	mUseLocalRepair(false),
+	mMaxLocalFlips(100),
+	mNumLocalRepairs(0),
+	mTopologyVersion(0),
+	mIsLastTopologyChangeLocal(false),
+	mPinBoundaryCells(false),
+	mIsPinnedMaskValid(false)
+{
+}
+
+CryptCellPopulationWithGhostNodes::CryptCellPopulationWithGhostNodes(MutableMesh<2,2>& rMesh, double ghostSpringStiffness)
+	: MeshBasedCellPopulationWithGhostNodes<2>(rMesh, ghostSpringStiffness),
+	mRemeshDisplacementThreshold(0.0),
+	mNumRemeshes(0),
+	mNumSkippedRemeshes(0),
+	mNumGhostLayers(0),
+	mMaxGhostEdgeLength(1.5),
+	mNumGhostNodesAdded(0),
+	mNumGhostNodesRemoved(0),
+	mUseLocalRepair(false),
+	mMaxLocalFlips(100),
+	mNumLocalRepairs(0),
+	mTopologyVersion(0),
+	mIsLastTopologyChangeLocal(false),
+	mPinBoundaryCells(false),
+	mIsPinnedMaskValid(false)
+{
+}
+
+CryptCellPopulationWithGhostNodes::~CryptCellPopulationWithGhostNodes()
+{
+}
+
+void CryptCellPopulationWithGhostNodes::SetRemeshDisplacementThreshold(double remeshDisplacementThreshold)
+{
+	assert(remeshDisplacementThreshold >= 0.0);
+	mRemeshDisplacementThreshold = remeshDisplacementThreshold;
+}
+
+double CryptCellPopulationWithGhostNodes::GetRemeshDisplacementThreshold()
+{
+	return mRemeshDisplacementThreshold;
+}
+
+unsigned CryptCellPopulationWithGhostNodes::GetNumRemeshes()
+{
+	return mNumRemeshes;
+}
+
+unsigned CryptCellPopulationWithGhostNodes::GetNumSkippedRemeshes()
+{
+	return mNumSkippedRemeshes;
+}
+
+void CryptCellPopulationWithGhostNodes::SetNumGhostLayers(unsigned numGhostLayers)
+{
+	mNumGhostLayers = numGhostLayers;
+}
+
+unsigned CryptCellPopulationWithGhostNodes::GetNumGhostLayers()
+{
+	return mNumGhostLayers;
+}
+
+void CryptCellPopulationWithGhostNodes::SetMaxGhostEdgeLength(double maxGhostEdgeLength)
+{
+	assert(maxGhostEdgeLength > 0.0);
+	mMaxGhostEdgeLength = maxGhostEdgeLength;
+}
+
+double CryptCellPopulationWithGhostNodes::GetMaxGhostEdgeLength()
+{
+	return mMaxGhostEdgeLength;
+}
+
+unsigned CryptCellPopulationWithGhostNodes::GetNumGhostNodesAdded()
+{
+	return mNumGhostNodesAdded;
+}
+
+unsigned CryptCellPopulationWithGhostNodes::GetNumGhostNodesRemoved()
+{
+	return mNumGhostNodesRemoved;
+}
+
+void CryptCellPopulationWithGhostNodes::SetUseLocalRepair(bool useLocalRepair)
+{
+	mUseLocalRepair = useLocalRepair;
+}
+
+bool CryptCellPopulationWithGhostNodes::GetUseLocalRepair()
+{
+	return mUseLocalRepair;
+}
+
+void CryptCellPopulationWithGhostNodes::SetMaxLocalFlips(unsigned maxLocalFlips)
+{
+	mMaxLocalFlips = maxLocalFlips;
+}
+
+unsigned CryptCellPopulationWithGhostNodes::GetMaxLocalFlips()
+{
+	return mMaxLocalFlips;
+}
+
+unsigned CryptCellPopulationWithGhostNodes::GetNumLocalRepairs()
+{
+	return mNumLocalRepairs;
+}
+
+unsigned CryptCellPopulationWithGhostNodes::GetTopologyVersion()
+{
+	return mTopologyVersion;
+}
+
+bool CryptCellPopulationWithGhostNodes::IsLastTopologyChangeLocal()
+{
+	return mIsLastTopologyChangeLocal;
+}
+
+const std::set<unsigned>& CryptCellPopulationWithGhostNodes::rGetChangedElements()
+{
+	return mChangedElements;
+}
+
+const std::vector<unsigned>& CryptCellPopulationWithGhostNodes::rGetAddedCellIds()
+{
+	return mAddedCellIds;
+}
+
+const std::vector<unsigned>& CryptCellPopulationWithGhostNodes::rGetRemovedCellIds()
+{
+	return mRemovedCellIds;
+}
+
+MarkedSpringRegistry& CryptCellPopulationWithGhostNodes::rGetMarkedSpringRegistry()
+{
+	return mMarkedSpringRegistry;
+}
+
+bool CryptCellPopulationWithGhostNodes::IsMarkedCellPair(unsigned cellIdA, unsigned cellIdB)
+{
+	return mMarkedSpringRegistry.IsMarked(cellIdA, cellIdB, SimulationTime::Instance()->GetTime());
+}
+
+void CryptCellPopulationWithGhostNodes::KeepMarkedSpringsFor(double springGrowthDuration)
+{
+	if (springGrowthDuration > mMarkedSpringRegistry.GetLifetime())
+	{
+		mMarkedSpringRegistry.SetLifetime(springGrowthDuration);
+	}
+}
+
+void CryptCellPopulationWithGhostNodes::RemoveExpiredMarkedSprings()
+{
+	// Chaste's forces only unmark a spring when they next look at it, so drop any that have expired here
+	double time = SimulationTime::Instance()->GetTime();
+	for (std::set<std::pair<CellPtr,CellPtr> >::iterator iter = this->mMarkedSprings.begin();
+		 iter != this->mMarkedSprings.end(); )
+	{
+		if (!mMarkedSpringRegistry.IsMarked(iter->first->GetCellId(), iter->second->GetCellId(), time))
+		{
+			this->mMarkedSprings.erase(iter++);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+const CryptCellAttributes& CryptCellPopulationWithGhostNodes::rGetCellAttributes()
+{
+	if (!mCellAttributes.IsCurrent(mTopologyVersion))
+	{
+		mCellAttributes.Update(*this, mTopologyVersion);
+	}
+	return mCellAttributes;
+}
+
+void CryptCellPopulationWithGhostNodes::InvalidateCellAttributes()
+{
+	mCellAttributes.Invalidate();
+}
+
+void CryptCellPopulationWithGhostNodes::SetPinBoundaryCells(bool pinBoundaryCells)
+{
+	mPinBoundaryCells = pinBoundaryCells;
+	mIsPinnedMaskValid = false;
+}
+
+bool CryptCellPopulationWithGhostNodes::GetPinBoundaryCells()
+{
+	return mPinBoundaryCells;
+}
+
+bool CryptCellPopulationWithGhostNodes::IsPinnedNode(unsigned nodeIndex)
+{
+	if (!mPinBoundaryCells)
+	{
+		return false;
+	}
+	if (!mIsPinnedMaskValid)
+	{
+		UpdatePinnedNodeMask();
+	}
+	return nodeIndex < mIsPinnedNode.size() && mIsPinnedNode[nodeIndex];
+}
+
+void CryptCellPopulationWithGhostNodes::UpdatePinnedNodeMask()
+{
+	mIsPinnedNode.assign(this->rGetMesh().GetNumAllNodes(), false);
+	for (std::list<CellPtr>::iterator cell_iter = this->mCells.begin();
+		 cell_iter != this->mCells.end();
+		 ++cell_iter)
+	{
+		if ((*cell_iter)->HasCellProperty<BoundaryCellProperty>())
+		{
+			mIsPinnedNode[this->GetLocationIndexUsingCell(*cell_iter)] = true;
+		}
+	}
+	mIsPinnedMaskValid = true;
+}
+
+void CryptCellPopulationWithGhostNodes::SetNode(unsigned nodeIndex, ChastePoint<2>& rNewLocation)
+{
+	if (IsPinnedNode(nodeIndex))
+	{
+		return;
+	}
+	MeshBasedCellPopulationWithGhostNodes<2>::SetNode(nodeIndex, rNewLocation);
+}
+
+void CryptCellPopulationWithGhostNodes::SaveLocationsAtLastRemesh()
+{
+	MutableMesh<2,2>& r_mesh = this->rGetMesh();
+
+	mLocationsAtLastRemesh.resize(r_mesh.GetNumAllNodes());
+	for (MutableMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+		 node_iter != r_mesh.GetNodeIteratorEnd();
+		 ++node_iter)
+	{
+		mLocationsAtLastRemesh[node_iter->GetIndex()] = node_iter->rGetLocation();
+	}
+}
+
+std::vector<unsigned> CryptCellPopulationWithGhostNodes::FindMovedNodes()
+{
+	MutableMesh<2,2>& r_mesh = this->rGetMesh();
+
+	std::vector<unsigned> moved_nodes;
+	double threshold_squared = mRemeshDisplacementThreshold*mRemeshDisplacementThreshold;
+	for (MutableMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+		 node_iter != r_mesh.GetNodeIteratorEnd();
+		 ++node_iter)
+	{
+		c_vector<double, 2> displacement = r_mesh.GetVectorFromAtoB(mLocationsAtLastRemesh[node_iter->GetIndex()], node_iter->rGetLocation());
+		if (inner_prod(displacement, displacement) > threshold_squared)
+		{
+			moved_nodes.push_back(node_iter->GetIndex());
+		}
+	}
+
+	return moved_nodes;
+}
+
+bool CryptCellPopulationWithGhostNodes::HasInvertedElement()
+{
+	MutableMesh<2,2>& r_mesh = this->rGetMesh();
+
+	for (MutableMesh<2,2>::ElementIterator elem_iter = r_mesh.GetElementIteratorBegin();
+		 elem_iter != r_mesh.GetElementIteratorEnd();
+		 ++elem_iter)
+	{
+		if (SignedArea(r_mesh, elem_iter->GetNodeLocation(0), elem_iter->GetNodeLocation(1), elem_iter->GetNodeLocation(2)) <= 0.0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool CryptCellPopulationWithGhostNodes::RepairTriangulation(const std::vector<unsigned>& rMovedNodes, std::set<unsigned>& rChangedElements)
+{
+	MutableMesh<2,2>& r_mesh = this->rGetMesh();
+
+	// Any edge of an element around a moved node may no longer be Delaunay
+	std::vector<std::pair<unsigned, unsigned> > edges_to_check;
+	for (unsigned i=0; i<rMovedNodes.size(); i++)
+	{
+		Node<2>* p_node = r_mesh.GetNode(rMovedNodes[i]);
+		for (Node<2>::ContainingElementIterator elem_iter = p_node->ContainingElementsBegin();
+			 elem_iter != p_node->ContainingElementsEnd();
+			 ++elem_iter)
+		{
+			Element<2,2>* p_element = r_mesh.GetElement(*elem_iter);
+			for (unsigned j=0; j<3; j++)
+			{
+				edges_to_check.push_back(std::make_pair(p_element->GetNodeGlobalIndex(j), p_element->GetNodeGlobalIndex((j+1)%3)));
+			}
+		}
+	}
+
+	unsigned num_flips = 0;
+	while (!edges_to_check.empty())
+	{
+		unsigned node_a = edges_to_check.back().first;
+		unsigned node_b = edges_to_check.back().second;
+		edges_to_check.pop_back();
+
+		// The elements either side of the edge; there is only one on the edge of the mesh
+		std::vector<unsigned> shared_elements;
+		const std::set<unsigned>& r_elements_a = r_mesh.GetNode(node_a)->rGetContainingElementIndices();
+		const std::set<unsigned>& r_elements_b = r_mesh.GetNode(node_b)->rGetContainingElementIndices();
+		std::set_intersection(r_elements_a.begin(), r_elements_a.end(), r_elements_b.begin(), r_elements_b.end(), std::back_inserter(shared_elements));
+		if (shared_elements.size() != 2)
+		{
+			continue;
+		}
+
+		Element<2,2>* p_element_1 = r_mesh.GetElement(shared_elements[0]);
+		Element<2,2>* p_element_2 = r_mesh.GetElement(shared_elements[1]);
+		unsigned node_c = p_element_1->GetNodeGlobalIndex(3 - p_element_1->GetNodeLocalIndex(node_a) - p_element_1->GetNodeLocalIndex(node_b));
+		unsigned node_d = p_element_2->GetNodeGlobalIndex(3 - p_element_2->GetNodeLocalIndex(node_a) - p_element_2->GetNodeLocalIndex(node_b));
+
+		const c_vector<double, 2>& r_location_a = r_mesh.GetNode(node_a)->rGetLocation();
+		const c_vector<double, 2>& r_location_b = r_mesh.GetNode(node_b)->rGetLocation();
+		const c_vector<double, 2>& r_location_c = r_mesh.GetNode(node_c)->rGetLocation();
+		const c_vector<double, 2>& r_location_d = r_mesh.GetNode(node_d)->rGetLocation();
+
+		// Is d inside the circumcircle of abc?
+		c_vector<double, 2> vector_da = r_mesh.GetVectorFromAtoB(r_location_d, r_location_a);
+		c_vector<double, 2> vector_db = r_mesh.GetVectorFromAtoB(r_location_d, r_location_b);
+		c_vector<double, 2> vector_dc = r_mesh.GetVectorFromAtoB(r_location_d, r_location_c);
+		double in_circle = inner_prod(vector_da, vector_da)*(vector_db[0]*vector_dc[1] - vector_dc[0]*vector_db[1])
+						 - inner_prod(vector_db, vector_db)*(vector_da[0]*vector_dc[1] - vector_dc[0]*vector_da[1])
+						 + inner_prod(vector_dc, vector_dc)*(vector_da[0]*vector_db[1] - vector_db[0]*vector_da[1]);
+		double orientation = SignedArea(r_mesh, r_location_a, r_location_b, r_location_c);
+		if ((orientation > 0.0 ? in_circle : -in_circle) <= 1e-12)
+		{
+			continue;
+		}
+
+		// Swap edge ab for cd, keeping each element the same way round. Either b goes to d in the first element and
+		// a to c in the second, or the other way about; if neither works abdc isn't convex and can't be flipped.
+		unsigned local_a_1 = p_element_1->GetNodeLocalIndex(node_a);
+		unsigned local_b_1 = p_element_1->GetNodeLocalIndex(node_b);
+		unsigned local_a_2 = p_element_2->GetNodeLocalIndex(node_a);
+		unsigned local_b_2 = p_element_2->GetNodeLocalIndex(node_b);
+		if (KeepsOrientation(p_element_1, local_b_1, node_d) && KeepsOrientation(p_element_2, local_a_2, node_c))
+		{
+			p_element_1->UpdateNode(local_b_1, r_mesh.GetNode(node_d));
+			p_element_2->UpdateNode(local_a_2, r_mesh.GetNode(node_c));
+		}
+		else if (KeepsOrientation(p_element_1, local_a_1, node_d) && KeepsOrientation(p_element_2, local_b_2, node_c))
+		{
+			p_element_1->UpdateNode(local_a_1, r_mesh.GetNode(node_d));
+			p_element_2->UpdateNode(local_b_2, r_mesh.GetNode(node_c));
+		}
+		else
+		{
+			continue;
+		}
+
+		// Too many flips means the mesh has changed too much to patch up
+		num_flips++;
+		if (num_flips > mMaxLocalFlips)
+		{
+			return false;
+		}
+
+		rChangedElements.insert(shared_elements[0]);
+		rChangedElements.insert(shared_elements[1]);
+
+		edges_to_check.push_back(std::make_pair(node_a, node_c));
+		edges_to_check.push_back(std::make_pair(node_c, node_b));
+		edges_to_check.push_back(std::make_pair(node_b, node_d));
+		edges_to_check.push_back(std::make_pair(node_d, node_a));
+	}
+
+	if (num_flips > 0)
+	{
+		r_mesh.RefreshMesh();
+	}
+
+	return true;
+}
+
+bool CryptCellPopulationWithGhostNodes::KeepsOrientation(Element<2,2>* pElement, unsigned localIndex, unsigned newNodeIndex)
+{
+	MutableMesh<2,2>& r_mesh = this->rGetMesh();
+
+	c_vector<double, 2> old_locations[3];
+	c_vector<double, 2> new_locations[3];
+	for (unsigned i=0; i<3; i++)
+	{
+		old_locations[i] = pElement->GetNodeLocation(i);
+		new_locations[i] = (i == localIndex) ? r_mesh.GetNode(newNodeIndex)->rGetLocation() : old_locations[i];
+	}
+
+	double old_area = SignedArea(r_mesh, old_locations[0], old_locations[1], old_locations[2]);
+	double new_area = SignedArea(r_mesh, new_locations[0], new_locations[1], new_locations[2]);
+	return old_area*new_area > 0.0;
+}
+
+void CryptCellPopulationWithGhostNodes::UpdateGhostShell()
+{
+	MutableMesh<2,2>& r_mesh = this->rGetMesh();
+	unsigned num_nodes = r_mesh.GetNumAllNodes();
+
+	// The short edges of the current triangulation. Nodes added since the last remesh have none.
+	std::vector<std::vector<unsigned> > short_neighbours(num_nodes);
+	std::vector<bool> is_on_long_edge(num_nodes, false);
+	for (MutableMesh<2,2>::EdgeIterator edge_iter = r_mesh.EdgesBegin();
+		 edge_iter != r_mesh.EdgesEnd();
+		 ++edge_iter)
+	{
+		unsigned node_a = edge_iter.GetNodeA()->GetIndex();
+		unsigned node_b = edge_iter.GetNodeB()->GetIndex();
+		if (norm_2(r_mesh.GetVectorFromAtoB(edge_iter.GetNodeA()->rGetLocation(), edge_iter.GetNodeB()->rGetLocation())) > mMaxGhostEdgeLength)
+		{
+			is_on_long_edge[node_a] = true;
+			is_on_long_edge[node_b] = true;
+			continue;
+		}
+		short_neighbours[node_a].push_back(node_b);
+		short_neighbours[node_b].push_back(node_a);
+	}
+
+	// Breadth first search out from the real cells
+	std::vector<unsigned> depth(num_nodes, UINT_MAX);
+	std::queue<unsigned> to_visit;
+	for (MutableMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+		 node_iter != r_mesh.GetNodeIteratorEnd();
+		 ++node_iter)
+	{
+		if (!this->mIsGhostNode[node_iter->GetIndex()])
+		{
+			depth[node_iter->GetIndex()] = 0;
+			to_visit.push(node_iter->GetIndex());
+		}
+	}
+	while (!to_visit.empty())
+	{
+		unsigned node_index = to_visit.front();
+		to_visit.pop();
+		if (depth[node_index] == mNumGhostLayers)
+		{
+			continue;
+		}
+		for (unsigned i=0; i<short_neighbours[node_index].size(); i++)
+		{
+			unsigned neighbour_index = short_neighbours[node_index][i];
+			if (depth[neighbour_index] == UINT_MAX)
+			{
+				depth[neighbour_index] = depth[node_index] + 1;
+				to_visit.push(neighbour_index);
+			}
+		}
+	}
+
+	// Add a ghost beyond each real cell on the edge of the mesh or of a hole, unless there is already a node there
+	std::vector<c_vector<double, 2> > new_ghost_locations;
+	for (MutableMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+		 node_iter != r_mesh.GetNodeIteratorEnd();
+		 ++node_iter)
+	{
+		unsigned node_index = node_iter->GetIndex();
+		if (this->mIsGhostNode[node_index] || short_neighbours[node_index].empty()
+			|| !(node_iter->IsBoundaryNode() || is_on_long_edge[node_index]))
+		{
+			continue;
+		}
+
+		c_vector<double, 2> outward = zero_vector<double>(2);
+		for (unsigned i=0; i<short_neighbours[node_index].size(); i++)
+		{
+			outward += r_mesh.GetVectorFromAtoB(r_mesh.GetNode(short_neighbours[node_index][i])->rGetLocation(), node_iter->rGetLocation());
+		}
+		if (norm_2(outward) < 1e-6)
+		{
+			continue;
+		}
+		c_vector<double, 2> new_location = node_iter->rGetLocation() + outward/norm_2(outward);
+
+		bool is_occupied = false;
+		for (unsigned i=0; i<short_neighbours[node_index].size() && !is_occupied; i++)
+		{
+			is_occupied = norm_2(r_mesh.GetVectorFromAtoB(r_mesh.GetNode(short_neighbours[node_index][i])->rGetLocation(), new_location)) < 0.5;
+		}
+		for (unsigned i=0; i<new_ghost_locations.size() && !is_occupied; i++)
+		{
+			is_occupied = norm_2(r_mesh.GetVectorFromAtoB(new_ghost_locations[i], new_location)) < 0.5;
+		}
+		if (!is_occupied)
+		{
+			new_ghost_locations.push_back(new_location);
+		}
+	}
+
+	for (unsigned node_index=0; node_index<num_nodes; node_index++)
+	{
+		if (this->mIsGhostNode[node_index] && depth[node_index] == UINT_MAX && !r_mesh.GetNode(node_index)->IsDeleted())
+		{
+			r_mesh.DeleteNodePriorToReMesh(node_index);
+			mNumGhostNodesRemoved++;
+		}
+	}
+
+	for (unsigned i=0; i<new_ghost_locations.size(); i++)
+	{
+		unsigned new_index = r_mesh.AddNode(new Node<2>(0, new_ghost_locations[i]));
+		if (new_index >= this->mIsGhostNode.size())
+		{
+			this->mIsGhostNode.resize(new_index + 1, false);
+		}
+		this->mIsGhostNode[new_index] = true;
+		mNumGhostNodesAdded++;
+	}
+}
+
+void CryptCellPopulationWithGhostNodes::Update(bool hasHadBirthsOrDeaths)
+{
+	RemoveExpiredMarkedSprings();
+
+	// An inverted element means the triangulation is no longer valid, however little anything moved
+	if (!hasHadBirthsOrDeaths && mRemeshDisplacementThreshold > 0.0
+		&& mLocationsAtLastRemesh.size() == this->rGetMesh().GetNumAllNodes()
+		&& !HasInvertedElement())
+	{
+		std::vector<unsigned> moved_nodes = FindMovedNodes();
+		if (moved_nodes.empty())
+		{
+			mNumSkippedRemeshes++;
+
+			// The nodes have still moved, so the Voronoi tessellation (if any) is out of date
+			this->TessellateIfNeeded();
+			return;
+		}
+
+		std::set<unsigned> changed_elements;
+		if (mUseLocalRepair && RepairTriangulation(moved_nodes, changed_elements))
+		{
+			mNumLocalRepairs++;
+			for (unsigned i=0; i<moved_nodes.size(); i++)
+			{
+				mLocationsAtLastRemesh[moved_nodes[i]] = this->GetNode(moved_nodes[i])->rGetLocation();
+			}
+
+			if (!changed_elements.empty())
+			{
+				mTopologyVersion++;
+				mIsLastTopologyChangeLocal = true;
+				mChangedElements.swap(changed_elements);
+				mAddedCellIds.clear();
+				mRemovedCellIds.clear();
+			}
+
+			this->TessellateIfNeeded();
+			return;
+		}
+	}
+
+	if (mNumGhostLayers > 0)
+	{
+		UpdateGhostShell();
+	}
+
+	MeshBasedCellPopulationWithGhostNodes<2>::Update(hasHadBirthsOrDeaths);
+
+	mNumRemeshes++;
+	SaveLocationsAtLastRemesh();
+
+	// The nodes may have been renumbered
+	mIsPinnedMaskValid = false;
+
+	mTopologyVersion++;
+	mIsLastTopologyChangeLocal = false;
+	mChangedElements.clear();
+	mAddedCellIds.swap(mPendingAddedCellIds);
+	mRemovedCellIds.swap(mPendingRemovedCellIds);
+	mPendingAddedCellIds.clear();
+	mPendingRemovedCellIds.clear();
+}
+
+CellPtr CryptCellPopulationWithGhostNodes::AddCell(CellPtr pNewCell, CellPtr pParentCell)
+{
+	CellPtr p_new_cell = MeshBasedCellPopulationWithGhostNodes<2>::AddCell(pNewCell, pParentCell);
+	mPendingAddedCellIds.push_back(p_new_cell->GetCellId());
+	mIsPinnedMaskValid = false;
+	mCellAttributes.Invalidate();
+
+	// The parent class has just marked the spring for Chaste's own forces; mark it in the registry for ours
+	mMarkedSpringRegistry.Mark(pParentCell->GetCellId(), p_new_cell->GetCellId(), SimulationTime::Instance()->GetTime());
+
+	return p_new_cell;
+}
+
+unsigned CryptCellPopulationWithGhostNodes::RemoveDeadCells()
+{
+	for (std::list<CellPtr>::iterator cell_iter = this->mCells.begin();
+		 cell_iter != this->mCells.end();
+		 ++cell_iter)
+	{
+		if ((*cell_iter)->IsDead())
+		{
+			mPendingRemovedCellIds.push_back((*cell_iter)->GetCellId());
+		}
+	}
+
+	mCellAttributes.Invalidate();
+
+	return MeshBasedCellPopulationWithGhostNodes<2>::RemoveDeadCells();
+}
+
+void CryptCellPopulationWithGhostNodes::ApplyGhostForces()
+{
+	if (mNumGhostLayers == 0)
+	{
+		MeshBasedCellPopulationWithGhostNodes<2>::ApplyGhostForces();
+		return;
+	}
+
+	MutableMesh<2,2>& r_mesh = this->rGetMesh();
+
+	std::vector<c_vector<double, 2> > drdt(r_mesh.GetNumAllNodes(), zero_vector<double>(2));
+	for (MutableMesh<2,2>::EdgeIterator edge_iter = r_mesh.EdgesBegin();
+		 edge_iter != r_mesh.EdgesEnd();
+		 ++edge_iter)
+	{
+		unsigned node_a = edge_iter.GetNodeA()->GetIndex();
+		unsigned node_b = edge_iter.GetNodeB()->GetIndex();
+
+		// Springs across the emptied lumen would pull the shell in on itself
+		if (this->mIsGhostNode[node_a] && this->mIsGhostNode[node_b]
+			&& norm_2(r_mesh.GetVectorFromAtoB(edge_iter.GetNodeA()->rGetLocation(), edge_iter.GetNodeB()->rGetLocation())) > mMaxGhostEdgeLength)
+		{
+			continue;
+		}
+
+		c_vector<double, 2> force = this->CalculateForceBetweenGhostNodes(node_a, node_b);
+		if (this->mIsGhostNode[node_a])
+		{
+			drdt[node_a] += force;
+		}
+		if (this->mIsGhostNode[node_b])
+		{
+			drdt[node_b] -= force;
+		}
+	}
+
+	for (MutableMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+		 node_iter != r_mesh.GetNodeIteratorEnd();
+		 ++node_iter)
+	{
+		if (this->mIsGhostNode[node_iter->GetIndex()])
+		{
+			node_iter->AddAppliedForceContribution(drdt[node_iter->GetIndex()]);
+		}
+	}
+}
+
+void CryptCellPopulationWithGhostNodes::OutputCellPopulationParameters(out_stream& rParamsFile)
+{
+	*rParamsFile <<  "\t\t<RemeshDisplacementThreshold>"<<  mRemeshDisplacementThreshold << "</RemeshDisplacementThreshold> \n";
+	*rParamsFile <<  "\t\t<NumGhostLayers>"<<  mNumGhostLayers << "</NumGhostLayers> \n";
+	*rParamsFile <<  "\t\t<MaxGhostEdgeLength>"<<  mMaxGhostEdgeLength << "</MaxGhostEdgeLength> \n";
+	*rParamsFile <<  "\t\t<UseLocalRepair>"<<  mUseLocalRepair << "</UseLocalRepair> \n";
+	*rParamsFile <<  "\t\t<MaxLocalFlips>"<<  mMaxLocalFlips << "</MaxLocalFlips> \n";
+	*rParamsFile <<  "\t\t<PinBoundaryCells>"<<  mPinBoundaryCells << "</PinBoundaryCells> \n";
+	*rParamsFile <<  "\t\t<MarkedSpringLifetime>"<<  mMarkedSpringRegistry.GetLifetime() << "</MarkedSpringLifetime> \n";
+
+	// Call direct parent class
+	MeshBasedCellPopulationWithGhostNodes<2>::OutputCellPopulationParameters(rParamsFile);
+}
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+CHASTE_CLASS_EXPORT(CryptCellPopulationWithGhostNodes)
@@ -0,0 +1,339 @@
+#ifndef CRYPTCELLPOPULATIONWITHGHOSTNODES_HPP_
+#define CRYPTCELLPOPULATIONWITHGHOSTNODES_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "MeshBasedCellPopulationWithGhostNodes.hpp"
+#include "MarkedSpringRegistry.hpp"
+#include "CryptCellAttributes.hpp"
+
+/*
+ * A MeshBasedCellPopulationWithGhostNodes that only remeshes when it has to.
+ *
+ * The parent class re-triangulates every time step, ghost nodes and all. Here the
+ * locations of all the nodes are saved at each remesh, and Update() only remeshes if
+ *   - cells have been born or killed,
+ *   - some node (real or ghost) has moved further than mRemeshDisplacementThreshold
+ *     since the last remesh, or
+ *   - some element has been turned inside out.
+ * Otherwise the old triangulation is kept.
+ *
+ * A threshold of zero (the default) remeshes every time step, as the parent class does.
+ *
+ * Every real remesh increments mNumRemeshes, which is kept for diagnostics. Caches of
+ * things worked out from the triangulation go by mTopologyVersion instead (see below),
+ * as a local repair changes the triangulation without a remesh.
+ *
+ * Optionally (SetNumGhostLayers()) the ghost nodes are trimmed to a thin shell around
+ * the real cells. Before each remesh, ghosts more than mNumGhostLayers edges away from
+ * every real cell are deleted, and a new ghost is added beyond any real cell that has
+ * been left on the edge of the mesh or of a hole in it. Only edges no longer than
+ * mMaxGhostEdgeLength are followed, so the long edges the triangulation puts across the
+ * emptied lumen don't count, and no ghost spring force is applied along them.
+ *
+ * With SetUseLocalRepair(true), when some nodes have moved past the threshold the
+ * triangulation is patched up around them with Lawson edge flips rather than rebuilt:
+ * each edge of an element containing a moved node is flipped if it is not Delaunay, and
+ * the edges around a flip are checked in turn. If more than mMaxLocalFlips are needed
+ * the population gives up and remeshes in full.
+ *
+ * Every remesh, and every repair that flips an edge, increments mTopologyVersion. Caches
+ * built from the mesh (in the forces and the anoikis killers) save the version they were
+ * built at. If it is unchanged they are still good; if it has gone up by one and the
+ * change was local, only the elements in rGetChangedElements() need redoing; otherwise
+ * they start again. After a full remesh rGetAddedCellIds() and rGetRemovedCellIds() give
+ * the cells born and killed since the version before.
+ *
+ * The springs between newly divided cells are kept in a MarkedSpringRegistry. The spring
+ * forces in this project look them up with IsMarkedCellPair(), and they expire by
+ * themselves mMarkedSpringRegistry.GetLifetime() hours after the division. Each of those
+ * forces calls KeepMarkedSpringsFor() with its spring growth duration, so the lifetime is
+ * the longest of them. Chaste's own spring forces (e.g. GeneralisedLinearSpringForce) only
+ * know the parent class's set of marked springs, so new springs are marked there too, and
+ * Update() drops them from it once they have expired from the registry.
+ *
+ * With SetPinBoundaryCells(true), the nodes of cells with the BoundaryCellProperty are
+ * pinned: SetNode(), which every numerical method moves the nodes through, leaves them
+ * where they are. This does the job of CryptBoundaryCondition without the simulation
+ * having to store and restore the location of every node each time step (see
+ * CryptSimulation). The mask of pinned nodes is rebuilt after each remesh or division.
+ *
+ * rGetCellAttributes() gives the age, apoptosis state and type of the cell at each node,
+ * filled in once per time step (and again after any change to the triangulation), for
+ * the forces and killers to read instead of asking each cell. Adding or removing cells
+ * refreshes it; code that changes a cell's properties mid-step should call
+ * InvalidateCellAttributes().
+ */
+
+class CryptCellPopulationWithGhostNodes : public MeshBasedCellPopulationWithGhostNodes<2>
+{
+private:
+
+    // Largest distance a node may move between remeshes; zero means remesh every step
+    double mRemeshDisplacementThreshold;
+
+    // Number of calls to Update() that did and did not remesh
+    unsigned mNumRemeshes;
+    unsigned mNumSkippedRemeshes;
+
+    // Location of each node at the last remesh, indexed by node index
+    std::vector<c_vector<double, 2> > mLocationsAtLastRemesh;
+
+    // Depth of the ghost shell kept around the real cells; zero keeps every ghost node
+    unsigned mNumGhostLayers;
+
+    // Edges longer than this are across a hole in the ghost shell
+    double mMaxGhostEdgeLength;
+
+    // Diagnostics: number of ghost nodes added to and removed from the shell
+    unsigned mNumGhostNodesAdded;
+    unsigned mNumGhostNodesRemoved;
+
+    // Whether to repair the triangulation with edge flips instead of remeshing
+    bool mUseLocalRepair;
+
+    // Most edge flips a repair may make before falling back to a full remesh
+    unsigned mMaxLocalFlips;
+
+    // Number of calls to Update() that repaired the triangulation
+    unsigned mNumLocalRepairs;
+
+    // Incremented every time the triangulation changes
+    unsigned mTopologyVersion;
+
+    // What changed at the last increment of mTopologyVersion: either some elements were flipped...
+    bool mIsLastTopologyChangeLocal;
+    std::set<unsigned> mChangedElements;
+
+    // ...or everything was remeshed, after these cells were born or killed
+    std::vector<unsigned> mAddedCellIds;
+    std::vector<unsigned> mRemovedCellIds;
+
+    // Cells born or killed since the last remesh
+    std::vector<unsigned> mPendingAddedCellIds;
+    std::vector<unsigned> mPendingRemovedCellIds;
+
+    // The springs between newly divided cells
+    MarkedSpringRegistry mMarkedSpringRegistry;
+
+    // Whether the nodes of cells with the BoundaryCellProperty are held in place
+    bool mPinBoundaryCells;
+
+    // Whether each node is pinned, indexed by node index, and whether that is up to date
+    std::vector<bool> mIsPinnedNode;
+    bool mIsPinnedMaskValid;
+
+    // Snapshot of the cells for the spring forces; not archived
+    CryptCellAttributes mCellAttributes;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<MeshBasedCellPopulationWithGhostNodes<2> >(*this);
+        archive & mRemeshDisplacementThreshold;
+        archive & mNumGhostLayers;
+        archive & mMaxGhostEdgeLength;
+        archive & mUseLocalRepair;
+        archive & mMaxLocalFlips;
+        archive & mMarkedSpringRegistry;
+        archive & mPinBoundaryCells;
+    }
+
+    /* Save the current location of every node */
+    void SaveLocationsAtLastRemesh();
+
+    /* The nodes that have moved further than mRemeshDisplacementThreshold since the last remesh */
+    std::vector<unsigned> FindMovedNodes();
+
+    /* Whether any element has been turned inside out */
+    bool HasInvertedElement();
+
+    /* Flip edges around the moved nodes until the triangulation is Delaunay. Returns false if it needed too many flips. */
+    bool RepairTriangulation(const std::vector<unsigned>& rMovedNodes, std::set<unsigned>& rChangedElements);
+
+    /* Whether replacing one node of the element with another leaves it the same way round */
+    bool KeepsOrientation(Element<2,2>* pElement, unsigned localIndex, unsigned newNodeIndex);
+
+    /* Delete the ghost nodes outside the shell and add any that are missing. Must be followed by a remesh. */
+    void UpdateGhostShell();
+
+    /* Work out which nodes belong to cells with the BoundaryCellProperty */
+    void UpdatePinnedNodeMask();
+
+    /* Unmark the springs in the parent class's set that have expired from mMarkedSpringRegistry */
+    void RemoveExpiredMarkedSprings();
+
+public:
+
+    /*
+     * Create a new cell population, with the same arguments as MeshBasedCellPopulationWithGhostNodes.
+     */
+    CryptCellPopulationWithGhostNodes(MutableMesh<2,2>& rMesh,
+                                      std::vector<CellPtr>& rCells,
+                                      const std::vector<unsigned> locationIndices=std::vector<unsigned>(),
+                                      bool deleteMesh=false,
+                                      double ghostSpringStiffness=15.0);
+
+    /*
+     * Constructor for use by the de-serializer.
+     */
+    CryptCellPopulationWithGhostNodes(MutableMesh<2,2>& rMesh, double ghostSpringStiffness=15.0);
+
+    ~CryptCellPopulationWithGhostNodes();
+
+    void SetRemeshDisplacementThreshold(double remeshDisplacementThreshold);
+
+    double GetRemeshDisplacementThreshold();
+
+    /* Returns the number of times the triangulation has actually been rebuilt */
+    unsigned GetNumRemeshes();
+
+    unsigned GetNumSkippedRemeshes();
+
+    /* Keep only the ghost nodes within this many edges of a real cell. Zero (the default) keeps them all. */
+    void SetNumGhostLayers(unsigned numGhostLayers);
+
+    unsigned GetNumGhostLayers();
+
+    void SetMaxGhostEdgeLength(double maxGhostEdgeLength);
+
+    double GetMaxGhostEdgeLength();
+
+    unsigned GetNumGhostNodesAdded();
+
+    unsigned GetNumGhostNodesRemoved();
+
+    void SetUseLocalRepair(bool useLocalRepair);
+
+    bool GetUseLocalRepair();
+
+    void SetMaxLocalFlips(unsigned maxLocalFlips);
+
+    unsigned GetMaxLocalFlips();
+
+    unsigned GetNumLocalRepairs();
+
+    /* Incremented every time the triangulation changes, by a remesh or a repair */
+    unsigned GetTopologyVersion();
+
+    /* Whether the last change to the triangulation was a local repair rather than a remesh */
+    bool IsLastTopologyChangeLocal();
+
+    /* The elements flipped by the last change, if it was local */
+    const std::set<unsigned>& rGetChangedElements();
+
+    /* The ids of the cells born and killed before the last change, if it was a remesh */
+    const std::vector<unsigned>& rGetAddedCellIds();
+
+    const std::vector<unsigned>& rGetRemovedCellIds();
+
+    MarkedSpringRegistry& rGetMarkedSpringRegistry();
+
+    /* Whether the spring between these two cells is still growing after their division */
+    bool IsMarkedCellPair(unsigned cellIdA, unsigned cellIdB);
+
+    /* Make marked springs last at least this long; the spring forces call it with their spring growth duration */
+    void KeepMarkedSpringsFor(double springGrowthDuration);
+
+    /* The attributes of the cell at each node, as they are at this time step */
+    const CryptCellAttributes& rGetCellAttributes();
+
+    /* Call after changing the properties of a cell part way through a time step */
+    void InvalidateCellAttributes();
+
+    /* Hold the nodes of cells with the BoundaryCellProperty in place. Off by default. */
+    void SetPinBoundaryCells(bool pinBoundaryCells);
+
+    bool GetPinBoundaryCells();
+
+    /* Whether the node is held in place */
+    bool IsPinnedNode(unsigned nodeIndex);
+
+    /**
+     * Overridden SetNode() method.
+     *
+     * Does nothing to a pinned node.
+     *
+     * @param nodeIndex the index of the node to be moved
+     * @param rNewLocation the new target location of the node
+     */
+    void SetNode(unsigned nodeIndex, ChastePoint<2>& rNewLocation);
+
+    /**
+     * Overridden Update() method.
+     *
+     * Remeshes only if cells have been born or killed, or the triangulation may have
+     * become invalid since the last remesh and can't be repaired locally.
+     *
+     * @param hasHadBirthsOrDeaths whether the population has had births or deaths
+     */
+    void Update(bool hasHadBirthsOrDeaths=true);
+
+    /**
+     * Overridden AddCell() method.
+     *
+     * Also records the new cell's id for the next topology change, and marks the spring
+     * between it and its parent in mMarkedSpringRegistry as well as the parent class's set.
+     *
+     * @param pNewCell the cell to add
+     * @param pParentCell pointer to a parent cell
+     * @return address of cell as it appears in the cell list
+     */
+    CellPtr AddCell(CellPtr pNewCell, CellPtr pParentCell);
+
+    /**
+     * Overridden RemoveDeadCells() method.
+     *
+     * Also records the ids of the dead cells for the next topology change.
+     *
+     * @return number of cells removed
+     */
+    unsigned RemoveDeadCells();
+
+    /**
+     * Overridden ApplyGhostForces() method.
+     *
+     * As the parent class, but with no spring between two ghost nodes further apart than
+     * mMaxGhostEdgeLength when the ghost shell is being trimmed.
+     */
+    void ApplyGhostForces();
+
+    /**
+     * Overridden OutputCellPopulationParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputCellPopulationParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+CHASTE_CLASS_EXPORT(CryptCellPopulationWithGhostNodes)
+
+namespace boost
+{
+    namespace serialization
+    {
+        template<class Archive>
+        inline void save_construct_data(
+            Archive & ar, const CryptCellPopulationWithGhostNodes * t, const unsigned int file_version)
+        {
+            const MutableMesh<2,2>* p_mesh = &(t->rGetMesh());
+            ar & p_mesh;
+        }
+
+        template<class Archive>
+        inline void load_construct_data(
+            Archive & ar, CryptCellPopulationWithGhostNodes * t, const unsigned int file_version)
+        {
+            MutableMesh<2,2>* p_mesh;
+            ar >> p_mesh;
+
+            // Invoke inplace constructor to initialise instance
+            ::new(t)CryptCellPopulationWithGhostNodes(*p_mesh);
+        }
+    }
+}
+
+#endif /* CRYPTCELLPOPULATIONWITHGHOSTNODES_HPP_ */
@@ -0,0 +1,120 @@
+#include "MarkedSpringRegistry.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+const unsigned long long MarkedSpringRegistry::EMPTY_KEY;
+
+MarkedSpringRegistry::MarkedSpringRegistry(double lifetime)
+	: mLifetime(lifetime),
+	mKeys(16, EMPTY_KEY),
+	mDivisionTimes(16, 0.0),
+	mNumEntries(0)
+{
+	assert(lifetime > 0.0);
+}
+
+void MarkedSpringRegistry::SetLifetime(double lifetime)
+{
+	assert(lifetime > 0.0);
+	mLifetime = lifetime;
+}
+
+double MarkedSpringRegistry::GetLifetime()
+{
+	return mLifetime;
+}
+
+unsigned long long MarkedSpringRegistry::MakeKey(unsigned cellIdA, unsigned cellIdB)
+{
+	if (cellIdA > cellIdB)
+	{
+		std::swap(cellIdA, cellIdB);
+	}
+	return (static_cast<unsigned long long>(cellIdA) << 32) | cellIdB;
+}
+
+unsigned MarkedSpringRegistry::FindSlot(unsigned long long key) const
+{
+	// Mix the bits, as consecutive cell ids would otherwise fill consecutive slots
+	unsigned long long hash = key;
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+
+	unsigned mask = mKeys.size() - 1;
+	unsigned slot = hash & mask;
+	while (mKeys[slot] != EMPTY_KEY && mKeys[slot] != key)
+	{
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+void MarkedSpringRegistry::Rehash(unsigned numSlots, double time)
+{
+	std::vector<unsigned long long> old_keys(numSlots, EMPTY_KEY);
+	std::vector<double> old_division_times(numSlots, 0.0);
+	old_keys.swap(mKeys);
+	old_division_times.swap(mDivisionTimes);
+
+	mNumEntries = 0;
+	for (unsigned i=0; i<old_keys.size(); i++)
+	{
+		if (old_keys[i] != EMPTY_KEY && time - old_division_times[i] < mLifetime)
+		{
+			unsigned slot = FindSlot(old_keys[i]);
+			mKeys[slot] = old_keys[i];
+			mDivisionTimes[slot] = old_division_times[i];
+			mNumEntries++;
+		}
+	}
+}
+
+void MarkedSpringRegistry::Mark(unsigned cellIdA, unsigned cellIdB, double divisionTime)
+{
+	// Keep the table at most half full, dropping the expired entries before growing it
+	if (2*(mNumEntries + 1) > mKeys.size())
+	{
+		RemoveExpired(divisionTime);
+		if (2*(mNumEntries + 1) > mKeys.size())
+		{
+			Rehash(2*mKeys.size(), divisionTime);
+		}
+	}
+
+	unsigned long long key = MakeKey(cellIdA, cellIdB);
+	unsigned slot = FindSlot(key);
+	if (mKeys[slot] == EMPTY_KEY)
+	{
+		mKeys[slot] = key;
+		mNumEntries++;
+	}
+	mDivisionTimes[slot] = divisionTime;
+}
+
+bool MarkedSpringRegistry::IsMarked(unsigned cellIdA, unsigned cellIdB, double time) const
+{
+	if (mNumEntries == 0)
+	{
+		return false;
+	}
+	unsigned slot = FindSlot(MakeKey(cellIdA, cellIdB));
+	return mKeys[slot] != EMPTY_KEY && time - mDivisionTimes[slot] < mLifetime;
+}
+
+void MarkedSpringRegistry::RemoveExpired(double time)
+{
+	Rehash(mKeys.size(), time);
+}
+
+unsigned MarkedSpringRegistry::GetNumEntries()
+{
+	return mNumEntries;
+}
+
+void MarkedSpringRegistry::Clear()
+{
+	mKeys.assign(mKeys.size(), EMPTY_KEY);
+	mNumEntries = 0;
+}
@@ -0,0 +1,78 @@
+#ifndef MARKEDSPRINGREGISTRY_HPP_
+#define MARKEDSPRINGREGISTRY_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/vector.hpp>
+
+#include <vector>
+
+/*
+ * The springs between newly divided pairs of cells, keyed by the two cell ids.
+ *
+ * Chaste keeps these in a std::set of pairs of CellPtrs, which the spring forces look up
+ * (and then unmark) for every pair of young neighbours. Here each pair is packed into one
+ * 64 bit key and stored in an open addressing hash table with linear probing, together
+ * with the time of the division. An entry is marked for mLifetime hours after the
+ * division and then ignored; expired entries are dropped whenever the table would
+ * otherwise have to grow, so nothing needs to unmark them.
+ */
+
+class MarkedSpringRegistry
+{
+private:
+
+    // How long after the division a spring stays marked
+    double mLifetime;
+
+    // The table: a key for each slot, or EMPTY_KEY, and the division time for that key
+    std::vector<unsigned long long> mKeys;
+    std::vector<double> mDivisionTimes;
+
+    // Number of slots in use
+    unsigned mNumEntries;
+
+    static const unsigned long long EMPTY_KEY = ~0ull;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & mLifetime;
+        archive & mKeys;
+        archive & mDivisionTimes;
+        archive & mNumEntries;
+    }
+
+    /* The key for a pair of cells, the same whichever way round they are given */
+    static unsigned long long MakeKey(unsigned cellIdA, unsigned cellIdB);
+
+    /* The slot holding the key, or the empty slot where it would go */
+    unsigned FindSlot(unsigned long long key) const;
+
+    /* Rebuild the table with the given number of slots (a power of two), keeping only the entries marked at the given time */
+    void Rehash(unsigned numSlots, double time);
+
+public:
+
+    MarkedSpringRegistry(double lifetime=1.0);
+
+    void SetLifetime(double lifetime);
+
+    double GetLifetime();
+
+    /* Mark the spring between two cells that have just divided */
+    void Mark(unsigned cellIdA, unsigned cellIdB, double divisionTime);
+
+    /* Whether the spring between two cells was marked less than mLifetime ago */
+    bool IsMarked(unsigned cellIdA, unsigned cellIdB, double time) const;
+
+    /* Drop the entries that are no longer marked at the given time */
+    void RemoveExpired(double time);
+
+    /* Number of entries in the table, including any that have expired but not been dropped yet */
+    unsigned GetNumEntries();
+
+    void Clear();
+};
+
+#endif /* MARKEDSPRINGREGISTRY_HPP_ */
@@ -0,0 +1,216 @@
+#include "MembraneBondGraph.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+const unsigned MembraneBondGraph::NO_CELL;
+
+MembraneBondGraph::MembraneBondGraph()
+	: mNumBonds(0)
+{
+}
+
+void MembraneBondGraph::Reserve(unsigned cellId)
+{
+	if (cellId >= mCells.size())
+	{
+		// Cell ids only go up, so leave room for the next few
+		unsigned size = std::max<unsigned>(2*mCells.size(), cellId + 1);
+		mPrevious.resize(size, NO_CELL);
+		mNext.resize(size, NO_CELL);
+		mCells.resize(size);
+		mPositions.resize(size, NO_CELL);
+	}
+}
+
+void MembraneBondGraph::AddCell(CellPtr pCell)
+{
+	unsigned cell_id = pCell->GetCellId();
+	if (HasCell(cell_id))
+	{
+		return;
+	}
+	Reserve(cell_id);
+
+	mCells[cell_id] = pCell;
+	mPositions[cell_id] = mCellIds.size();
+	mCellIds.push_back(cell_id);
+}
+
+void MembraneBondGraph::AddBond(CellPtr pPrevious, CellPtr pNext)
+{
+	AddCell(pPrevious);
+	AddCell(pNext);
+
+	unsigned previous_id = pPrevious->GetCellId();
+	unsigned next_id = pNext->GetCellId();
+	assert(previous_id != next_id);
+	assert(mNext[previous_id] == NO_CELL);
+	assert(mPrevious[next_id] == NO_CELL);
+
+	mNext[previous_id] = next_id;
+	mPrevious[next_id] = previous_id;
+	mNumBonds++;
+}
+
+void MembraneBondGraph::AddChain(const std::vector<CellPtr>& rCells)
+{
+	if (rCells.empty())
+	{
+		return;
+	}
+	AddCell(rCells[0]);
+	for (unsigned i=1; i<rCells.size(); i++)
+	{
+		AddBond(rCells[i-1], rCells[i]);
+	}
+}
+
+void MembraneBondGraph::InsertCellBetween(CellPtr pNewCell, CellPtr pPrevious, CellPtr pNext)
+{
+	unsigned previous_id = pPrevious->GetCellId();
+	unsigned next_id = pNext->GetCellId();
+	assert(GetNext(previous_id) == next_id);
+
+	// Break the bond, then bond the new cell in on either side
+	mNext[previous_id] = NO_CELL;
+	mPrevious[next_id] = NO_CELL;
+	mNumBonds--;
+
+	AddBond(pPrevious, pNewCell);
+	AddBond(pNewCell, pNext);
+}
+
+void MembraneBondGraph::RemoveCell(unsigned cellId)
+{
+	assert(HasCell(cellId));
+
+	unsigned previous_id = mPrevious[cellId];
+	unsigned next_id = mNext[cellId];
+	if (previous_id != NO_CELL)
+	{
+		mNext[previous_id] = NO_CELL;
+		mNumBonds--;
+	}
+	if (next_id != NO_CELL)
+	{
+		mPrevious[next_id] = NO_CELL;
+		mNumBonds--;
+	}
+
+	// Close the gap, unless the cells either side are the same one, i.e. this was a loop of two
+	if (previous_id != NO_CELL && next_id != NO_CELL && previous_id != next_id)
+	{
+		mNext[previous_id] = next_id;
+		mPrevious[next_id] = previous_id;
+		mNumBonds++;
+	}
+
+	mPrevious[cellId] = NO_CELL;
+	mNext[cellId] = NO_CELL;
+	mCells[cellId].reset();
+
+	// Swap the last id into this cell's place
+	unsigned position = mPositions[cellId];
+	mCellIds[position] = mCellIds.back();
+	mPositions[mCellIds[position]] = position;
+	mCellIds.pop_back();
+	mPositions[cellId] = NO_CELL;
+}
+
+unsigned MembraneBondGraph::RemoveDeadCells()
+{
+	unsigned num_removed = 0;
+	for (unsigned i=0; i<mCellIds.size(); )
+	{
+		unsigned cell_id = mCellIds[i];
+		if (mCells[cell_id]->IsDead())
+		{
+			// The last id is swapped into position i, so look at i again
+			RemoveCell(cell_id);
+			num_removed++;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return num_removed;
+}
+
+bool MembraneBondGraph::HasCell(unsigned cellId) const
+{
+	return cellId < mPositions.size() && mPositions[cellId] != NO_CELL;
+}
+
+CellPtr MembraneBondGraph::GetCell(unsigned cellId) const
+{
+	assert(HasCell(cellId));
+	return mCells[cellId];
+}
+
+const std::vector<unsigned>& MembraneBondGraph::rGetCellIds() const
+{
+	return mCellIds;
+}
+
+unsigned MembraneBondGraph::GetNumCells() const
+{
+	return mCellIds.size();
+}
+
+unsigned MembraneBondGraph::GetNumBonds() const
+{
+	return mNumBonds;
+}
+
+std::vector<std::vector<unsigned> > MembraneBondGraph::GetChains() const
+{
+	std::vector<std::vector<unsigned> > chains;
+	std::vector<bool> is_visited(mCells.size(), false);
+
+	// Open chains first, from the cell with nothing before it
+	for (unsigned i=0; i<mCellIds.size(); i++)
+	{
+		if (mPrevious[mCellIds[i]] == NO_CELL)
+		{
+			std::vector<unsigned> chain;
+			for (unsigned cell_id = mCellIds[i]; cell_id != NO_CELL; cell_id = mNext[cell_id])
+			{
+				chain.push_back(cell_id);
+				is_visited[cell_id] = true;
+			}
+			chains.push_back(chain);
+		}
+	}
+
+	// Anything left is on a closed loop
+	for (unsigned i=0; i<mCellIds.size(); i++)
+	{
+		if (!is_visited[mCellIds[i]])
+		{
+			std::vector<unsigned> chain;
+			unsigned cell_id = mCellIds[i];
+			do
+			{
+				chain.push_back(cell_id);
+				is_visited[cell_id] = true;
+				cell_id = mNext[cell_id];
+			}
+			while (cell_id != mCellIds[i]);
+			chains.push_back(chain);
+		}
+	}
+
+	return chains;
+}
+
+void MembraneBondGraph::Clear()
+{
+	mPrevious.clear();
+	mNext.clear();
+	mCells.clear();
+	mCellIds.clear();
+	mPositions.clear();
+	mNumBonds = 0;
+}
@@ -0,0 +1,114 @@
+#ifndef MEMBRANEBONDGRAPH_HPP_
+#define MEMBRANEBONDGRAPH_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+
+#include "Cell.hpp"
+
+#include <climits>
+#include <vector>
+
+/*
+ * The bonds between neighbouring membrane cells, kept from one time step to the next.
+ *
+ * Without this the membrane is found again every time step by walking the Delaunay (or
+ * nearby) neighbours from cell to cell, which costs a neighbour search per membrane cell
+ * and can step onto the wrong membrane cell after a remesh. Here each membrane cell has at
+ * most one previous and one next cell along its chain, stored by cell id, so finding a
+ * cell's neighbours, adding a cell between two others and dropping a dead cell are all O(1).
+ *
+ * Cell ids don't change when the mesh is rebuilt, so the bonds survive remeshing. Dead cells
+ * are taken out by RemoveDeadCells(), which joins up the cells either side of them.
+ */
+
+class MembraneBondGraph
+{
+private:
+
+    // For each cell id, the previous and next cell ids along the chain, or NO_CELL
+    std::vector<unsigned> mPrevious;
+    std::vector<unsigned> mNext;
+
+    // For each cell id, the cell if it is in the graph
+    std::vector<CellPtr> mCells;
+
+    // The ids of the cells in the graph, and the position of each id in that list
+    std::vector<unsigned> mCellIds;
+    std::vector<unsigned> mPositions;
+
+    // Number of bonds
+    unsigned mNumBonds;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & mPrevious;
+        archive & mNext;
+        archive & mCells;
+        archive & mCellIds;
+        archive & mPositions;
+        archive & mNumBonds;
+    }
+
+    /* Make room for a cell id */
+    void Reserve(unsigned cellId);
+
+public:
+
+    static const unsigned NO_CELL = UINT_MAX;
+
+    MembraneBondGraph();
+
+    /* Add a cell with no bonds. Does nothing if it is already in the graph. */
+    void AddCell(CellPtr pCell);
+
+    /* Bond pNext on after pPrevious. Both are added if need be; pPrevious must not have a next cell, nor pNext a previous one. */
+    void AddBond(CellPtr pPrevious, CellPtr pNext);
+
+    /* Bond the cells one after another, in the order given */
+    void AddChain(const std::vector<CellPtr>& rCells);
+
+    /* Put a new cell between two bonded cells, e.g. when the membrane grows */
+    void InsertCellBetween(CellPtr pNewCell, CellPtr pPrevious, CellPtr pNext);
+
+    /* Take a cell out of the graph, bonding the cells either side of it to each other */
+    void RemoveCell(unsigned cellId);
+
+    /* Take out every cell that has died, and return how many there were */
+    unsigned RemoveDeadCells();
+
+    bool HasCell(unsigned cellId) const;
+
+    CellPtr GetCell(unsigned cellId) const;
+
+    /* The previous and next cell ids along the chain, or NO_CELL at the end of one */
+    unsigned GetPrevious(unsigned cellId) const
+    {
+        return cellId < mPrevious.size() ? mPrevious[cellId] : NO_CELL;
+    }
+
+    unsigned GetNext(unsigned cellId) const
+    {
+        return cellId < mNext.size() ? mNext[cellId] : NO_CELL;
+    }
+
+    /* The cell ids in the graph, in no particular order */
+    const std::vector<unsigned>& rGetCellIds() const;
+
+    unsigned GetNumCells() const;
+
+    unsigned GetNumBonds() const;
+
+    /*
+     * The cell ids of each chain, in order from its first cell. A closed loop is given once,
+     * starting from any of its cells, without repeating that cell at the end.
+     */
+    std::vector<std::vector<unsigned> > GetChains() const;
+
+    void Clear();
+};
+
+#endif /* MEMBRANEBONDGRAPH_HPP_ */
@@ -0,0 +1,36 @@
+#include "CryptPropertyTags.hpp"
+#include "BoundaryCellProperty.hpp"
+#include "MembraneCellProliferativeType.hpp"
+#include "PanethCellMutationState.hpp"
+#include "DifferentiatedMembraneState.hpp"
+#include "TransitCellAnoikisResistantMutationState.hpp"
+
+CryptPropertyBits GetCryptPropertyTags(CellPtr pCell)
+{
+	CryptPropertyBits tags = 0;
+
+	if (pCell->HasCellProperty<BoundaryCellProperty>())
+	{
+		tags |= CryptPropertyTag<BoundaryCellProperty>::BIT;
+	}
+	if (pCell->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>())
+	{
+		tags |= CryptPropertyTag<MembraneCellProliferativeType>::BIT;
+	}
+
+	boost::shared_ptr<AbstractCellMutationState> p_state = pCell->GetMutationState();
+	if (p_state->IsType<PanethCellMutationState>())
+	{
+		tags |= CryptPropertyTag<PanethCellMutationState>::BIT;
+	}
+	else if (p_state->IsType<DifferentiatedMembraneState>())
+	{
+		tags |= CryptPropertyTag<DifferentiatedMembraneState>::BIT;
+	}
+	else if (p_state->IsType<TransitCellAnoikisResistantMutationState>())
+	{
+		tags |= CryptPropertyTag<TransitCellAnoikisResistantMutationState>::BIT;
+	}
+
+	return tags;
+}
@@ -0,0 +1,37 @@
+#ifndef CRYPTPROPERTYTAGS_HPP_
+#define CRYPTPROPERTYTAGS_HPP_
+
+#include "Cell.hpp"
+
+/*
+ * Small integer tags for this project's own cell properties.
+ *
+ * Asking a cell whether it has one of these means searching its property collection
+ * (or a virtual IsType<>() call on its mutation state or proliferative type). Instead
+ * each property is given a bit, and GetCryptPropertyTags() packs the ones a cell has
+ * into a bitset, so a membership test is one AND (see CryptCellAttributes::HasProperty()).
+ *
+ * To tag another property, add a bit here and a line to GetCryptPropertyTags().
+ */
+
+class BoundaryCellProperty;
+class MembraneCellProliferativeType;
+class PanethCellMutationState;
+class DifferentiatedMembraneState;
+class TransitCellAnoikisResistantMutationState;
+
+typedef unsigned char CryptPropertyBits;
+
+template<class PROPERTY>
+struct CryptPropertyTag;
+
+template<> struct CryptPropertyTag<BoundaryCellProperty>                     { static const CryptPropertyBits BIT = 1u << 0; };
+template<> struct CryptPropertyTag<MembraneCellProliferativeType>            { static const CryptPropertyBits BIT = 1u << 1; };
+template<> struct CryptPropertyTag<PanethCellMutationState>                  { static const CryptPropertyBits BIT = 1u << 2; };
+template<> struct CryptPropertyTag<DifferentiatedMembraneState>              { static const CryptPropertyBits BIT = 1u << 3; };
+template<> struct CryptPropertyTag<TransitCellAnoikisResistantMutationState> { static const CryptPropertyBits BIT = 1u << 4; };
+
+/* The bits of all the tagged properties the cell has */
+CryptPropertyBits GetCryptPropertyTags(CellPtr pCell);
+
+#endif /* CRYPTPROPERTYTAGS_HPP_ */
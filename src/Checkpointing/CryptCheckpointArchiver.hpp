@@ -0,0 +1,183 @@
+#ifndef CRYPTCHECKPOINTARCHIVER_HPP_
+#define CRYPTCHECKPOINTARCHIVER_HPP_
+
+#include "CellBasedSimulationArchiver.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdlib>
+
+#include "OutputFileHandler.hpp"
+#include "FileFinder.hpp"
+#include "SimulationTime.hpp"
+
+/*
+ * Periodic checkpointing on top of CellBasedSimulationArchiver.
+ *
+ * The checkpoints themselves are written and read by CellBasedSimulationArchiver, so they
+ * are the usual text archives, in <output directory>/archive/ as
+ *     cell_population_sim_at_time_<time>.arch
+ * alongside mesh_<time>.* for the mesh. (A binary archive would be smaller and faster, but
+ * every class in the object graph, Chaste's own included, would have to be exported for the
+ * binary archive types, and Chaste only exports them for the text ones.)
+ *
+ * SolveWithCheckpoints() runs a simulation in chunks, saving after each one and keeping
+ * only the most recent few, and FindLatestCheckpoint() finds where to pick up from after
+ * the job has been killed.
+ */
+
+template<unsigned ELEMENT_DIM, class SIM, unsigned SPACE_DIM=ELEMENT_DIM>
+class CryptCheckpointArchiver
+{
+private:
+
+    static std::string GetTimeStamp(double time)
+    {
+        // The same formatting as CellBasedSimulationArchiver uses for its file names
+        std::ostringstream time_stamp;
+        time_stamp << time;
+        return time_stamp.str();
+    }
+
+    static std::string GetArchiveFilename(const std::string& rTimeStamp)
+    {
+        return "cell_population_sim_at_time_" + rTimeStamp + ".arch";
+    }
+
+    /*
+     * The time and time stamp of each checkpoint in an output directory, oldest first.
+     */
+    static std::vector<std::pair<double, std::string> > GetCheckpoints(const std::string& rArchiveDirectory)
+    {
+        std::vector<std::pair<double, std::string> > checkpoints;
+
+        FileFinder archive_dir(rArchiveDirectory + "/archive/", RelativeTo::ChasteTestOutput);
+        if (!archive_dir.IsDir())
+        {
+            return checkpoints;
+        }
+
+        const std::string prefix = "cell_population_sim_at_time_";
+        const std::string suffix = ".arch";
+
+        std::vector<FileFinder> archive_files = archive_dir.FindMatches(prefix + "*" + suffix);
+        for (unsigned i=0; i<archive_files.size(); i++)
+        {
+            std::string leaf_name = archive_files[i].GetLeafName();
+            std::string time_stamp = leaf_name.substr(prefix.size(), leaf_name.size() - prefix.size() - suffix.size());
+            checkpoints.push_back(std::make_pair(atof(time_stamp.c_str()), time_stamp));
+        }
+        std::sort(checkpoints.begin(), checkpoints.end());
+        return checkpoints;
+    }
+
+    /*
+     * Remove a checkpoint's archive and mesh files.
+     */
+    static void RemoveCheckpoint(const std::string& rArchiveDirectory, const std::string& rTimeStamp)
+    {
+        OutputFileHandler handler(rArchiveDirectory + "/archive/", false);
+        handler.FindFile(GetArchiveFilename(rTimeStamp)).Remove();
+
+        std::vector<FileFinder> mesh_files = handler.FindFile("").FindMatches("mesh_" + rTimeStamp + ".*");
+        for (unsigned i=0; i<mesh_files.size(); i++)
+        {
+            mesh_files[i].Remove();
+        }
+    }
+
+public:
+
+    /*
+     * Save a simulation at the current time, to the archive folder of its output directory.
+     */
+    static void Save(SIM* pSim)
+    {
+        CellBasedSimulationArchiver<ELEMENT_DIM, SIM, SPACE_DIM>::Save(pSim);
+    }
+
+    /*
+     * Load a simulation saved by Save().
+     *
+     * As with CellBasedSimulationArchiver, SimulationTime must have been set up before
+     * calling this; the archive then overwrites it with the saved time.
+     *
+     * @param rArchiveDirectory the output directory the simulation was saved from, relative to CHASTE_TEST_OUTPUT
+     * @param rTimeStamp the time at which it was saved
+     */
+    static SIM* Load(const std::string& rArchiveDirectory, const double& rTimeStamp)
+    {
+        return CellBasedSimulationArchiver<ELEMENT_DIM, SIM, SPACE_DIM>::Load(rArchiveDirectory, rTimeStamp);
+    }
+
+    /*
+     * Find the most recent checkpoint in an output directory.
+     *
+     * @param rArchiveDirectory the output directory, relative to CHASTE_TEST_OUTPUT
+     * @param rTimeStamp set to the time of the latest checkpoint, if there is one
+     * @return whether any checkpoint was found
+     */
+    static bool FindLatestCheckpoint(const std::string& rArchiveDirectory, double& rTimeStamp)
+    {
+        std::vector<std::pair<double, std::string> > checkpoints = GetCheckpoints(rArchiveDirectory);
+        if (checkpoints.empty())
+        {
+            return false;
+        }
+        rTimeStamp = checkpoints.back().first;
+        return true;
+    }
+
+    /*
+     * Run a simulation up to endTime, saving a checkpoint every checkpointInterval
+     * hours. Only the last numCheckpointsToKeep checkpoints are kept on disk, counting
+     * those already there from before a restart.
+     *
+     * To resume after the job has been stopped, load the checkpoint given by
+     * FindLatestCheckpoint() and call this again with the same end time.
+     */
+    static void SolveWithCheckpoints(SIM* pSim, double endTime, double checkpointInterval, unsigned numCheckpointsToKeep=2)
+    {
+        assert(checkpointInterval > 0.0);
+        assert(numCheckpointsToKeep > 0);
+
+        // Start from what is on disk, so the checkpoints of a run that has been restarted are pruned too
+        std::string output_directory = pSim->GetOutputDirectory();
+        std::vector<std::pair<double, std::string> > checkpoints = GetCheckpoints(output_directory);
+        std::deque<std::string> saved_time_stamps;
+        for (unsigned i=0; i<checkpoints.size(); i++)
+        {
+            saved_time_stamps.push_back(checkpoints[i].second);
+        }
+
+        double time = SimulationTime::Instance()->GetTime();
+        while (time < endTime - 1e-10)
+        {
+            double next_checkpoint_time = std::min(time + checkpointInterval, endTime);
+
+            pSim->SetEndTime(next_checkpoint_time);
+            pSim->Solve();
+            Save(pSim);
+
+            time = SimulationTime::Instance()->GetTime();
+            std::string time_stamp = GetTimeStamp(time);
+            if (std::find(saved_time_stamps.begin(), saved_time_stamps.end(), time_stamp) == saved_time_stamps.end())
+            {
+                saved_time_stamps.push_back(time_stamp);
+            }
+
+            // Remove the oldest checkpoints (archive and mesh files) once we have enough newer ones
+            while (saved_time_stamps.size() > numCheckpointsToKeep)
+            {
+                RemoveCheckpoint(output_directory, saved_time_stamps.front());
+                saved_time_stamps.pop_front();
+            }
+        }
+    }
+};
+
+#endif /* CRYPTCHECKPOINTARCHIVER_HPP_ */
@@ -0,0 +1,76 @@
+#include "CryptSnapshotLibrary.hpp"
+#include "CryptCheckpointArchiver.hpp"
+#include "OutputFileHandler.hpp"
+#include "FileFinder.hpp"
+#include "SimulationTime.hpp"
+#include "Exception.hpp"
+
+#include <fstream>
+#include <iomanip>
+
+CryptSnapshotLibrary::CryptSnapshotLibrary(std::string libraryDirectory)
+	: mLibraryDirectory(libraryDirectory)
+{
+}
+
+std::string CryptSnapshotLibrary::GetLibraryDirectory()
+{
+	return mLibraryDirectory;
+}
+
+std::string CryptSnapshotLibrary::GetSnapshotDirectory(const std::string& rName)
+{
+	return mLibraryDirectory + "/" + rName;
+}
+
+void CryptSnapshotLibrary::Store(OffLatticeSimulation<2>* pSimulation, const std::string& rName)
+{
+	// The archiver writes to the simulation's own output directory, so point it at the library while saving
+	std::string output_directory = pSimulation->GetOutputDirectory();
+
+	OutputFileHandler handler(GetSnapshotDirectory(rName) + "/", true);
+	pSimulation->SetOutputDirectory(GetSnapshotDirectory(rName));
+	CryptCheckpointArchiver<2, OffLatticeSimulation<2> >::Save(pSimulation);
+	pSimulation->SetOutputDirectory(output_directory);
+
+	// Record the time last, so a snapshot that failed to save isn't picked up
+	out_stream p_time_file = handler.OpenOutputFile("snapshot_time.txt");
+	*p_time_file << std::setprecision(17) << SimulationTime::Instance()->GetTime() << "\n";
+	p_time_file->close();
+}
+
+bool CryptSnapshotLibrary::Contains(const std::string& rName)
+{
+	FileFinder time_file(GetSnapshotDirectory(rName) + "/snapshot_time.txt", RelativeTo::ChasteTestOutput);
+	return time_file.IsFile();
+}
+
+double CryptSnapshotLibrary::GetSnapshotTime(const std::string& rName)
+{
+	if (!Contains(rName))
+	{
+		EXCEPTION("There is no crypt snapshot called " + rName + " in " + mLibraryDirectory);
+	}
+
+	FileFinder time_file(GetSnapshotDirectory(rName) + "/snapshot_time.txt", RelativeTo::ChasteTestOutput);
+	std::ifstream time_stream(time_file.GetAbsolutePath().c_str());
+	double snapshot_time;
+	time_stream >> snapshot_time;
+	return snapshot_time;
+}
+
+OffLatticeSimulation<2>* CryptSnapshotLibrary::Fork(const std::string& rName, const std::string& rOutputDirectory)
+{
+	double snapshot_time = GetSnapshotTime(rName);
+
+	// Load() needs SimulationTime to exist; the archive then sets it back to the snapshot time
+	if (!SimulationTime::Instance()->IsStartTimeSetUp())
+	{
+		SimulationTime::Instance()->SetStartTime(0.0);
+	}
+
+	OffLatticeSimulation<2>* p_simulation = CryptCheckpointArchiver<2, OffLatticeSimulation<2> >::Load(GetSnapshotDirectory(rName), snapshot_time);
+	p_simulation->SetOutputDirectory(rOutputDirectory);
+
+	return p_simulation;
+}
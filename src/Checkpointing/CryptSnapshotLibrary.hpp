@@ -0,0 +1,55 @@
+#ifndef CRYPTSNAPSHOTLIBRARY_HPP_
+#define CRYPTSNAPSHOTLIBRARY_HPP_
+
+#include <string>
+
+#include "OffLatticeSimulation.hpp"
+
+/*
+ * A library of equilibrated crypt simulations to start experiments from.
+ *
+ * Equilibrating a crypt from the honeycomb mesh takes most of the run time of a
+ * perturbation experiment, so the relaxed simulation is stored once under a name,
+ * and then each experiment forks its own copy from it, changes what it wants to
+ * (mutate a cell, change a stiffness, ...) and solves on from the snapshot time.
+ *
+ * Snapshots are checkpoints written by CellBasedSimulationArchiver, stored under <library directory>/<name>/ relative
+ * to CHASTE_TEST_OUTPUT, together with the time they were taken.
+ *
+ * Each fork restores the random number generator as it was when the snapshot was
+ * taken, so reseed it after forking if the experiments should see different noise.
+ */
+
+class CryptSnapshotLibrary
+{
+private:
+
+    // Output directory holding the snapshots, relative to CHASTE_TEST_OUTPUT
+    std::string mLibraryDirectory;
+
+    std::string GetSnapshotDirectory(const std::string& rName);
+
+public:
+
+    CryptSnapshotLibrary(std::string libraryDirectory="CryptSnapshots");
+
+    std::string GetLibraryDirectory();
+
+    /* Store the current state of a simulation under the given name, replacing any previous snapshot of that name */
+    void Store(OffLatticeSimulation<2>* pSimulation, const std::string& rName);
+
+    /* Returns whether a snapshot with the given name has been stored */
+    bool Contains(const std::string& rName);
+
+    /* Returns the simulation time at which the named snapshot was taken */
+    double GetSnapshotTime(const std::string& rName);
+
+    /*
+     * Load a new copy of the named snapshot, writing its results to outputDirectory.
+     * The caller owns the returned simulation, and should set its end time relative
+     * to GetSnapshotTime() before solving.
+     */
+    OffLatticeSimulation<2>* Fork(const std::string& rName, const std::string& rOutputDirectory);
+};
+
+#endif /* CRYPTSNAPSHOTLIBRARY_HPP_ */
@@ -4,6 +4,7 @@
 
 #include "AbstractCellPopulationBoundaryCondition.hpp"
 #include "BoundaryCellProperty.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
 #include "Debug.hpp"
 
 // Forces all cells marked with the BoundaryCellProperty to keep their y position 0
@@ -27,6 +28,10 @@ public:
 
     void ImposeBoundaryCondition(const std::map<Node<2>*, c_vector<double, 2> >& rOldLocations)
     {
+        // The crypt population has the boundary cells tagged in its per-step cell attributes
+        CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(this->mpCellPopulation);
+        const CryptCellAttributes* p_attributes = p_crypt_population ? &(p_crypt_population->rGetCellAttributes()) : NULL;
+
         for (AbstractCellPopulation<2>::Iterator cell_iter = this->mpCellPopulation->Begin();
              cell_iter != this->mpCellPopulation->End();
              ++cell_iter)
@@ -36,7 +41,8 @@ public:
             double y_coordinate = p_node->rGetLocation()[1];
             double x_coordinate = p_node->rGetLocation()[0];
 
-            if (cell_iter->HasCellProperty<BoundaryCellProperty>())
+            bool is_boundary_cell = p_attributes ? p_attributes->HasProperty<BoundaryCellProperty>(node_index) : cell_iter->HasCellProperty<BoundaryCellProperty>();
+            if (is_boundary_cell)
             {
                 // PRINT_VARIABLE(rOldLocations[p_node])
                 typename std::map<Node<2>*, c_vector<double, 2> >::const_iterator it = rOldLocations.find(p_node);
@@ -0,0 +1,305 @@
+#include "TestTubeCryptBuilder.hpp"
+#include "UniformCellCycleModel.hpp"
+#include "NoCellCycleModel.hpp"
+#include "WildTypeCellMutationState.hpp"
+#include "DifferentiatedCellProliferativeType.hpp"
+#include "TransitCellProliferativeType.hpp"
+#include "StemCellProliferativeType.hpp"
+#include "MembraneCellProliferativeType.hpp"
+#include "BoundaryCellProperty.hpp"
+#include "CellPropertyRegistry.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "Exception.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+TestTubeCryptSpec::TestTubeCryptSpec()
+	: cellsAcross(30),
+	cellsUp(30),
+	numGhosts(4),
+	circleCentreY(10.0),
+	circleRadius(5.0),
+	ringWidth(0.9),
+	lumenGap(0.5),
+	transitWidth(0.5),
+	birthTimeSpread(12.0),
+	markBoundaryCells(true),
+	enforceMonolayer(true),
+	addMembraneLayer(true)
+{
+}
+
+void TestTubeCryptSpec::LoadFromFile(const FileFinder& rSpecFile)
+{
+	std::ifstream spec_stream(rSpecFile.GetAbsolutePath().c_str());
+	if (!spec_stream.is_open())
+	{
+		EXCEPTION("Could not open crypt spec file " + rSpecFile.GetAbsolutePath());
+	}
+
+	std::string line;
+	while (std::getline(spec_stream, line))
+	{
+		size_t comment_start = line.find('#');
+		if (comment_start != std::string::npos)
+		{
+			line = line.substr(0, comment_start);
+		}
+
+		std::istringstream line_stream(line);
+		std::string key;
+		if (!(line_stream >> key))
+		{
+			continue;
+		}
+
+		if (key == "cells_across") { line_stream >> cellsAcross; }
+		else if (key == "cells_up") { line_stream >> cellsUp; }
+		else if (key == "ghosts") { line_stream >> numGhosts; }
+		else if (key == "circle_centre_y") { line_stream >> circleCentreY; }
+		else if (key == "circle_radius") { line_stream >> circleRadius; }
+		else if (key == "ring_width") { line_stream >> ringWidth; }
+		else if (key == "lumen_gap") { line_stream >> lumenGap; }
+		else if (key == "transit_width") { line_stream >> transitWidth; }
+		else if (key == "birth_time_spread") { line_stream >> birthTimeSpread; }
+		else if (key == "mark_boundary_cells") { line_stream >> markBoundaryCells; }
+		else if (key == "enforce_monolayer") { line_stream >> enforceMonolayer; }
+		else if (key == "add_membrane_layer") { line_stream >> addMembraneLayer; }
+		else
+		{
+			EXCEPTION("Unknown key '" + key + "' in crypt spec file " + rSpecFile.GetAbsolutePath());
+		}
+
+		if (line_stream.fail())
+		{
+			EXCEPTION("Bad value for '" + key + "' in crypt spec file " + rSpecFile.GetAbsolutePath());
+		}
+	}
+}
+
+TestTubeCryptBuilder::TestTubeCryptBuilder(const TestTubeCryptSpec& rSpec)
+	: mSpec(rSpec)
+{
+	mpGenerator = new CylindricalHoneycombMeshGenerator(mSpec.cellsAcross, mSpec.cellsUp, mSpec.numGhosts);
+	mpMesh = mpGenerator->GetCylindricalMesh();
+
+	ClassifyNodes();
+	CacheNeighbours();
+	AssignCellKinds();
+}
+
+TestTubeCryptBuilder::~TestTubeCryptBuilder()
+{
+	delete mpGenerator;
+}
+
+void TestTubeCryptBuilder::ClassifyNodes()
+{
+	// Integer division, as the crypt set-up this replaces did, so odd widths put the lumen in the same place
+	double centre_x = mSpec.cellsAcross/2;
+	double centre_y = mSpec.circleCentreY;
+	double radius_squared = mSpec.circleRadius*mSpec.circleRadius;
+	double stem_radius_squared = (mSpec.circleRadius + mSpec.ringWidth)*(mSpec.circleRadius + mSpec.ringWidth);
+	double wall_offset = mSpec.circleRadius + mSpec.lumenGap;
+
+	mIsRealNode.assign(mpMesh->GetNumNodes(), false);
+
+	std::vector<unsigned> initial_real_indices = mpGenerator->GetCellLocationIndices();
+	for (unsigned i=0; i<initial_real_indices.size(); i++)
+	{
+		unsigned node_index = initial_real_indices[i];
+		double x = mpMesh->GetNode(node_index)->rGetLocation()[0];
+		double y = mpMesh->GetNode(node_index)->rGetLocation()[1];
+		double distance_squared = (x - centre_x)*(x - centre_x) + (y - centre_y)*(y - centre_y);
+
+		if (y <= centre_y)
+		{
+			// The curved crypt base
+			if (distance_squared > radius_squared)
+			{
+				mRealIndices.push_back(node_index);
+				mIsRealNode[node_index] = true;
+				mCellKinds.push_back(distance_squared < stem_radius_squared ? STEM : DIFFERENTIATED);
+			}
+		}
+		else if (x <= centre_x - wall_offset || x >= centre_x + wall_offset)
+		{
+			// The walls, lined with transit cells
+			mRealIndices.push_back(node_index);
+			mIsRealNode[node_index] = true;
+			double distance_from_lumen = fabs(x - centre_x) - wall_offset;
+			mCellKinds.push_back(distance_from_lumen <= mSpec.transitWidth ? TRANSIT : DIFFERENTIATED);
+		}
+	}
+}
+
+void TestTubeCryptBuilder::CacheNeighbours()
+{
+	mNeighbours.assign(mpMesh->GetNumNodes(), std::vector<unsigned>());
+
+	for (MutableMesh<2,2>::ElementIterator elem_iter = mpMesh->GetElementIteratorBegin();
+		 elem_iter != mpMesh->GetElementIteratorEnd();
+		 ++elem_iter)
+	{
+		for (unsigned i=0; i<3; i++)
+		{
+			unsigned node_index = elem_iter->GetNodeGlobalIndex(i);
+			for (unsigned j=0; j<3; j++)
+			{
+				if (j != i)
+				{
+					mNeighbours[node_index].push_back(elem_iter->GetNodeGlobalIndex(j));
+				}
+			}
+		}
+	}
+
+	// Sorted like the sets the population would give us, so cells are visited in the same order
+	for (unsigned i=0; i<mNeighbours.size(); i++)
+	{
+		std::sort(mNeighbours[i].begin(), mNeighbours[i].end());
+		mNeighbours[i].erase(std::unique(mNeighbours[i].begin(), mNeighbours[i].end()), mNeighbours[i].end());
+	}
+}
+
+bool TestTubeCryptBuilder::HasGhostNeighbour(unsigned nodeIndex)
+{
+	for (unsigned i=0; i<mNeighbours[nodeIndex].size(); i++)
+	{
+		if (!mIsRealNode[mNeighbours[nodeIndex][i]])
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void TestTubeCryptBuilder::AssignCellKinds()
+{
+	mInitialCellKinds = mCellKinds;
+
+	if (!mSpec.enforceMonolayer && !mSpec.addMembraneLayer)
+	{
+		return;
+	}
+
+	std::vector<unsigned> cell_of_node(mpMesh->GetNumNodes(), UINT_MAX);
+	for (unsigned i=0; i<mRealIndices.size(); i++)
+	{
+		cell_of_node[mRealIndices[i]] = i;
+	}
+
+	// Changes made while visiting one cell affect the cells visited after it, so this
+	// has to go through the cells in order
+	for (unsigned i=0; i<mRealIndices.size(); i++)
+	{
+		if (mCellKinds[i] != STEM && mCellKinds[i] != TRANSIT)
+		{
+			continue;
+		}
+
+		unsigned node_index = mRealIndices[i];
+
+		// A cell with no ghost neighbours isn't on the surface, so isn't part of the monolayer
+		if (mSpec.enforceMonolayer && !HasGhostNeighbour(node_index))
+		{
+			mCellKinds[i] = DIFFERENTIATED;
+		}
+		else if (mSpec.addMembraneLayer)
+		{
+			for (unsigned j=0; j<mNeighbours[node_index].size(); j++)
+			{
+				unsigned neighbour_index = mNeighbours[node_index][j];
+				if (mIsRealNode[neighbour_index] && mCellKinds[cell_of_node[neighbour_index]] == DIFFERENTIATED)
+				{
+					mCellKinds[cell_of_node[neighbour_index]] = MEMBRANE;
+				}
+			}
+		}
+	}
+}
+
+const TestTubeCryptSpec& TestTubeCryptBuilder::rGetSpec()
+{
+	return mSpec;
+}
+
+Cylindrical2dMesh* TestTubeCryptBuilder::GetMesh()
+{
+	return mpMesh;
+}
+
+const std::vector<unsigned>& TestTubeCryptBuilder::rGetRealIndices()
+{
+	return mRealIndices;
+}
+
+const std::vector<unsigned>& TestTubeCryptBuilder::rGetNeighbours(unsigned nodeIndex)
+{
+	return mNeighbours[nodeIndex];
+}
+
+boost::shared_ptr<AbstractCellProperty> TestTubeCryptBuilder::GetProliferativeType(CellKind kind)
+{
+	switch (kind)
+	{
+		case STEM:
+			return CellPropertyRegistry::Instance()->Get<StemCellProliferativeType>();
+		case TRANSIT:
+			return CellPropertyRegistry::Instance()->Get<TransitCellProliferativeType>();
+		case MEMBRANE:
+			return CellPropertyRegistry::Instance()->Get<MembraneCellProliferativeType>();
+		default:
+			return CellPropertyRegistry::Instance()->Get<DifferentiatedCellProliferativeType>();
+	}
+}
+
+std::vector<CellPtr> TestTubeCryptBuilder::BuildCells()
+{
+	boost::shared_ptr<AbstractCellProperty> p_state = CellPropertyRegistry::Instance()->Get<WildTypeCellMutationState>();
+	boost::shared_ptr<AbstractCellProperty> p_boundary = CellPropertyRegistry::Instance()->Get<BoundaryCellProperty>();
+
+	std::vector<CellPtr> cells;
+	cells.reserve(mRealIndices.size());
+
+	for (unsigned i=0; i<mRealIndices.size(); i++)
+	{
+		UniformCellCycleModel* p_cycle_model = new UniformCellCycleModel();
+		double birth_time = mSpec.birthTimeSpread*RandomNumberGenerator::Instance()->ranf();
+		p_cycle_model->SetBirthTime(-birth_time);
+
+		CellPtr p_cell(new Cell(p_state, p_cycle_model));
+
+		/*
+		 * Initialise with the kind the cell had before the monolayer and membrane layer were
+		 * decided, then change it, as converting a population in place would. Stem and transit
+		 * cells draw their cycle durations here, so demoted cells keep theirs and the random
+		 * number generator is used in the same order.
+		 */
+		p_cell->SetCellProliferativeType(GetProliferativeType(mInitialCellKinds[i]));
+
+		if (mSpec.markBoundaryCells && mpMesh->GetNode(mRealIndices[i])->rGetLocation()[1] == 0.0)
+		{
+			p_cell->AddCellProperty(p_boundary);
+		}
+
+		p_cell->InitialiseCellCycleModel();
+
+		if (mCellKinds[i] != mInitialCellKinds[i])
+		{
+			p_cell->SetCellProliferativeType(GetProliferativeType(mCellKinds[i]));
+			if (mCellKinds[i] == MEMBRANE)
+			{
+				p_cell->SetCellCycleModel(new NoCellCycleModel());
+			}
+		}
+
+		cells.push_back(p_cell);
+	}
+
+	return cells;
+}
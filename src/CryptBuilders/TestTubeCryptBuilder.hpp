@@ -0,0 +1,129 @@
+#ifndef TESTTUBECRYPTBUILDER_HPP_
+#define TESTTUBECRYPTBUILDER_HPP_
+
+#include <string>
+#include <vector>
+
+#include "CylindricalHoneycombMeshGenerator.hpp"
+#include "Cell.hpp"
+#include "FileFinder.hpp"
+
+/*
+ * The shape of a test tube crypt: a honeycomb mesh with a lumen cut out of it, ending in a
+ * semicircular base. The lumen is ghost nodes, stem cells sit in a ring around the base and
+ * transit cells line the walls.
+ *
+ * Can be read from a file of "key value" lines ('#' starts a comment), with the keys named
+ * after the members below, e.g.
+ *
+ *     cells_across 30
+ *     circle_radius 5
+ *     add_membrane_layer 1
+ */
+struct TestTubeCryptSpec
+{
+    unsigned cellsAcross;
+    unsigned cellsUp;
+    unsigned numGhosts;
+
+    // The base of the lumen is a circle centred halfway across the mesh at this height
+    double circleCentreY;
+    double circleRadius;
+
+    // Width of the ring of stem cells around the base
+    double ringWidth;
+
+    // Gap between the lumen and the walls of the crypt, and the width of the transit cell band on each wall
+    double lumenGap;
+    double transitWidth;
+
+    // Cells are given birth times uniformly spread over this many hours, to stop pulsing behaviour
+    double birthTimeSpread;
+
+    // Whether to add BoundaryCellProperty to cells on the bottom row
+    bool markBoundaryCells;
+
+    // Whether to turn stem and transit cells with no ghost neighbours back into differentiated cells
+    bool enforceMonolayer;
+
+    // Whether to put a layer of membrane cells under the epithelium
+    bool addMembraneLayer;
+
+    TestTubeCryptSpec();
+
+    void LoadFromFile(const FileFinder& rSpecFile);
+};
+
+/*
+ * Builds the mesh and cells for a test tube crypt from a TestTubeCryptSpec.
+ *
+ * Node neighbours are read once from the mesh elements and cached, so deciding the
+ * monolayer and membrane layer doesn't need a population or a set per cell. Cell types
+ * are decided before any cells exist, visiting cells in the same order as a population
+ * iterator would. Cells are then made with their original types and changed afterwards,
+ * so the types, cycle models and random numbers drawn are the same as converting the
+ * cells of a population in place.
+ *
+ * The builder owns the mesh, so it must outlive any population built on it.
+ */
+class TestTubeCryptBuilder
+{
+private:
+
+    TestTubeCryptSpec mSpec;
+
+    CylindricalHoneycombMeshGenerator* mpGenerator;
+
+    Cylindrical2dMesh* mpMesh;
+
+    // Indices of the nodes that get cells; the rest are ghosts
+    std::vector<unsigned> mRealIndices;
+
+    std::vector<bool> mIsRealNode;
+
+    // Neighbours of each node, including ghosts, from the mesh elements
+    std::vector<std::vector<unsigned> > mNeighbours;
+
+    enum CellKind
+    {
+        DIFFERENTIATED,
+        STEM,
+        TRANSIT,
+        MEMBRANE
+    };
+
+    // The kind of cell on each real node, in the order of mRealIndices
+    std::vector<CellKind> mCellKinds;
+
+    // The kinds before the monolayer and membrane layer were decided
+    std::vector<CellKind> mInitialCellKinds;
+
+    void ClassifyNodes();
+
+    void CacheNeighbours();
+
+    void AssignCellKinds();
+
+    bool HasGhostNeighbour(unsigned nodeIndex);
+
+    boost::shared_ptr<AbstractCellProperty> GetProliferativeType(CellKind kind);
+
+public:
+
+    TestTubeCryptBuilder(const TestTubeCryptSpec& rSpec);
+
+    ~TestTubeCryptBuilder();
+
+    const TestTubeCryptSpec& rGetSpec();
+
+    Cylindrical2dMesh* GetMesh();
+
+    const std::vector<unsigned>& rGetRealIndices();
+
+    const std::vector<unsigned>& rGetNeighbours(unsigned nodeIndex);
+
+    /* Make a new set of cells, in the order of rGetRealIndices(). Uses the random number generator for birth times. */
+    std::vector<CellPtr> BuildCells();
+};
+
+#endif /* TESTTUBECRYPTBUILDER_HPP_ */
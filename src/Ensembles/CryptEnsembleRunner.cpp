@@ -0,0 +1,182 @@
+#include "CryptEnsembleRunner.hpp"
+#include "CryptProcessPool.hpp"
+#include "Exception.hpp"
+
+#include <cmath>
+#include <sstream>
+
+CryptEnsembleRunner::CryptEnsembleRunner(ReplicateFunction replicateFunction, unsigned numReplicates, std::string outputDirectory)
+	: mReplicateFunction(replicateFunction),
+	mNumReplicates(numReplicates),
+	mOutputDirectory(outputDirectory),
+	mNumProcesses(0),
+	mBaseSeed(0),
+	mNumCompletedReplicates(0),
+	mNumFailedReplicates(0)
+{
+}
+
+void CryptEnsembleRunner::SetNumProcesses(unsigned numProcesses)
+{
+	mNumProcesses = numProcesses;
+}
+
+void CryptEnsembleRunner::SetBaseSeed(unsigned baseSeed)
+{
+	mBaseSeed = baseSeed;
+}
+
+unsigned CryptEnsembleRunner::GetSeed(unsigned replicate)
+{
+	return mBaseSeed + replicate;
+}
+
+void CryptEnsembleRunner::SetSummaryNames(const std::vector<std::string>& rSummaryNames)
+{
+	mSummaryNames = rSummaryNames;
+}
+
+std::vector<double> CryptEnsembleRunner::RunReplicate(unsigned replicate)
+{
+	CryptProcessPool::ResetSimulationState(GetSeed(replicate));
+
+	std::stringstream replicate_directory;
+	replicate_directory << mOutputDirectory << "/Replicate_" << replicate;
+
+	return mReplicateFunction(replicate_directory.str(), GetSeed(replicate));
+}
+
+void CryptEnsembleRunner::RecordReplicate(unsigned replicate, bool success, const std::vector<double>& rSummary)
+{
+	*mpReplicatesFile << replicate << "\t" << GetSeed(replicate);
+
+	if (!success)
+	{
+		mNumFailedReplicates++;
+		*mpReplicatesFile << "\tfailed\n";
+		mpReplicatesFile->flush();
+		return;
+	}
+
+	if (mMeans.empty())
+	{
+		mMeans.resize(rSummary.size(), 0.0);
+		mSumSquaredDeviations.resize(rSummary.size(), 0.0);
+	}
+	if (rSummary.size() != mMeans.size())
+	{
+		// Throwing here would leave the other children running; Run() throws once they have all finished
+		mNumFailedReplicates++;
+		*mpReplicatesFile << "\tfailed\n";
+		mpReplicatesFile->flush();
+		if (mReplicateError.empty())
+		{
+			std::stringstream message;
+			message << "Replicate " << replicate << " returned " << rSummary.size() << " summary values, but earlier replicates returned " << mMeans.size();
+			mReplicateError = message.str();
+		}
+		return;
+	}
+
+	mReplicateSummaries[replicate] = rSummary;
+	mNumCompletedReplicates++;
+
+	for (unsigned i=0; i<rSummary.size(); i++)
+	{
+		double delta = rSummary[i] - mMeans[i];
+		mMeans[i] += delta/mNumCompletedReplicates;
+		mSumSquaredDeviations[i] += delta*(rSummary[i] - mMeans[i]);
+
+		*mpReplicatesFile << "\t" << rSummary[i];
+	}
+	*mpReplicatesFile << "\n";
+	mpReplicatesFile->flush();
+}
+
+void CryptEnsembleRunner::Run()
+{
+	mReplicateSummaries.assign(mNumReplicates, std::vector<double>());
+	mNumCompletedReplicates = 0;
+	mNumFailedReplicates = 0;
+	mMeans.clear();
+	mSumSquaredDeviations.clear();
+	mReplicateError.clear();
+
+	OutputFileHandler output_file_handler(mOutputDirectory + "/", true);
+	mpReplicatesFile = output_file_handler.OpenOutputFile("ensemble_replicates.dat");
+
+	*mpReplicatesFile << "replicate\tseed";
+	for (unsigned i=0; i<mSummaryNames.size(); i++)
+	{
+		*mpReplicatesFile << "\t" << mSummaryNames[i];
+	}
+	*mpReplicatesFile << "\n";
+
+	std::vector<unsigned> replicates;
+	for (unsigned i=0; i<mNumReplicates; i++)
+	{
+		replicates.push_back(i);
+	}
+
+	CryptProcessPool pool(mNumProcesses);
+	pool.Run(replicates,
+			 [this](unsigned replicate) { return RunReplicate(replicate); },
+			 [this](unsigned replicate, bool success, const std::vector<double>& rSummary) { RecordReplicate(replicate, success, rSummary); });
+
+	mpReplicatesFile->close();
+
+	if (!mReplicateError.empty())
+	{
+		EXCEPTION(mReplicateError);
+	}
+
+	out_stream p_statistics_file = output_file_handler.OpenOutputFile("ensemble_statistics.dat");
+	*p_statistics_file << "summary\tmean\tstandard_deviation\tnum_replicates\n";
+	std::vector<double> standard_deviations = GetStandardDeviations();
+	for (unsigned i=0; i<mMeans.size(); i++)
+	{
+		if (i < mSummaryNames.size())
+		{
+			*p_statistics_file << mSummaryNames[i];
+		}
+		else
+		{
+			*p_statistics_file << i;
+		}
+		*p_statistics_file << "\t" << mMeans[i] << "\t" << standard_deviations[i] << "\t" << mNumCompletedReplicates << "\n";
+	}
+	p_statistics_file->close();
+}
+
+unsigned CryptEnsembleRunner::GetNumCompletedReplicates()
+{
+	return mNumCompletedReplicates;
+}
+
+unsigned CryptEnsembleRunner::GetNumFailedReplicates()
+{
+	return mNumFailedReplicates;
+}
+
+const std::vector<std::vector<double> >& CryptEnsembleRunner::rGetReplicateSummaries()
+{
+	return mReplicateSummaries;
+}
+
+std::vector<double> CryptEnsembleRunner::GetMeans()
+{
+	return mMeans;
+}
+
+std::vector<double> CryptEnsembleRunner::GetStandardDeviations()
+{
+	std::vector<double> standard_deviations(mMeans.size(), 0.0);
+	if (mNumCompletedReplicates > 1)
+	{
+		for (unsigned i=0; i<mMeans.size(); i++)
+		{
+			standard_deviations[i] = sqrt(mSumSquaredDeviations[i]/(mNumCompletedReplicates - 1));
+		}
+	}
+	return standard_deviations;
+}
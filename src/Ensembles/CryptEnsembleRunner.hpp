@@ -0,0 +1,93 @@
+#ifndef CRYPTENSEMBLERUNNER_HPP_
+#define CRYPTENSEMBLERUNNER_HPP_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "OutputFileHandler.hpp"
+
+/*
+ * Runs an ensemble of independent replicates of a stochastic crypt simulation across
+ * the cores of the machine, one process per replicate.
+ *
+ * Replicate i is seeded with baseSeed + i and writes to <output directory>/Replicate_i,
+ * so any replicate can be rerun on its own and get the same answer. The replicate
+ * function builds and solves its simulation and returns a few summary numbers (the
+ * number of cells lost to anoikis, crypt height, ...). As each replicate finishes its
+ * numbers are written to ensemble_replicates.dat and folded into running means and
+ * standard deviations, which are written to ensemble_statistics.dat at the end.
+ */
+
+class CryptEnsembleRunner
+{
+public:
+
+    /* Builds and solves one replicate: takes the replicate's output directory and seed, returns its summary */
+    typedef std::function<std::vector<double>(const std::string&, unsigned)> ReplicateFunction;
+
+private:
+
+    ReplicateFunction mReplicateFunction;
+
+    unsigned mNumReplicates;
+
+    // Output directory for the ensemble, relative to CHASTE_TEST_OUTPUT
+    std::string mOutputDirectory;
+
+    // Maximum number of replicates running at once; 0 means one per core
+    unsigned mNumProcesses;
+
+    unsigned mBaseSeed;
+
+    // Names of the summary entries, used as column headers in the output
+    std::vector<std::string> mSummaryNames;
+
+    // Summary of each replicate, empty if it failed
+    std::vector<std::vector<double> > mReplicateSummaries;
+
+    unsigned mNumCompletedReplicates;
+    unsigned mNumFailedReplicates;
+
+    // The first problem with a replicate's results, thrown by Run() once every replicate has finished
+    std::string mReplicateError;
+
+    // Running statistics (Welford's method), updated as each replicate finishes
+    std::vector<double> mMeans;
+    std::vector<double> mSumSquaredDeviations;
+
+    out_stream mpReplicatesFile;
+
+    /* Reset the singletons and run one replicate in a child process */
+    std::vector<double> RunReplicate(unsigned replicate);
+
+    /* Record the summary of a finished replicate in the parent process */
+    void RecordReplicate(unsigned replicate, bool success, const std::vector<double>& rSummary);
+
+public:
+
+    CryptEnsembleRunner(ReplicateFunction replicateFunction, unsigned numReplicates, std::string outputDirectory);
+
+    void SetNumProcesses(unsigned numProcesses);
+
+    void SetBaseSeed(unsigned baseSeed);
+
+    unsigned GetSeed(unsigned replicate);
+
+    void SetSummaryNames(const std::vector<std::string>& rSummaryNames);
+
+    /* Run every replicate. Returns once they have all finished. */
+    void Run();
+
+    unsigned GetNumCompletedReplicates();
+
+    unsigned GetNumFailedReplicates();
+
+    const std::vector<std::vector<double> >& rGetReplicateSummaries();
+
+    std::vector<double> GetMeans();
+
+    std::vector<double> GetStandardDeviations();
+};
+
+#endif /* CRYPTENSEMBLERUNNER_HPP_ */
@@ -0,0 +1,452 @@
+#include "CryptParameterSweep.hpp"
+#include "CryptProcessPool.hpp"
+#include "OutputFileHandler.hpp"
+#include "Exception.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+namespace
+{
+	/* The last entry on a line of the config file, which must be a whole number */
+	unsigned ParseUnsigned(std::istringstream& rLineStream, const std::string& rLine)
+	{
+		std::string token;
+		std::string rest;
+		if (!(rLineStream >> token) || (rLineStream >> rest)
+			|| token.find_first_not_of("0123456789") != std::string::npos || token.size() > 9)
+		{
+			EXCEPTION("Expected a whole number at the end of this line of the sweep configuration: " + rLine);
+		}
+		return atoi(token.c_str());
+	}
+
+	/*
+	 * A uniform number in (0,1) from the raw output of the generator. std::mt19937 gives the same
+	 * numbers everywhere, but the standard library's distributions and std::shuffle don't, so the
+	 * design is drawn from the raw numbers directly.
+	 */
+	double DrawUniform(std::mt19937& rGenerator)
+	{
+		return (rGenerator() + 0.5)/4294967296.0;
+	}
+}
+
+CryptParameterSweep::CryptParameterSweep(PointFunction pointFunction, std::string outputDirectory)
+	: mPointFunction(pointFunction),
+	mOutputDirectory(outputDirectory),
+	mDesign("grid"),
+	mNumSamples(1),
+	mSeed(0),
+	mNumProcesses(0),
+	mNumPointsRun(0),
+	mNumPointsSkipped(0),
+	mNumPointsFailed(0)
+{
+}
+
+void CryptParameterSweep::LoadConfiguration(const FileFinder& rConfigFile)
+{
+	std::ifstream config_stream(rConfigFile.GetAbsolutePath().c_str());
+	if (!config_stream.is_open())
+	{
+		EXCEPTION("Could not open sweep configuration file " + rConfigFile.GetAbsolutePath());
+	}
+
+	std::string line;
+	while (std::getline(config_stream, line))
+	{
+		// Strip comments
+		size_t comment_start = line.find('#');
+		if (comment_start != std::string::npos)
+		{
+			line = line.substr(0, comment_start);
+		}
+
+		std::istringstream line_stream(line);
+		std::string key;
+		if (!(line_stream >> key))
+		{
+			continue;
+		}
+
+		if (key == "design")
+		{
+			std::string design;
+			line_stream >> design;
+			SetDesign(design);
+		}
+		else if (key == "samples")
+		{
+			mNumSamples = ParseUnsigned(line_stream, line);
+			if (mNumSamples == 0)
+			{
+				EXCEPTION("Sweep samples must be at least 1: " + line);
+			}
+		}
+		else if (key == "seed")
+		{
+			mSeed = ParseUnsigned(line_stream, line);
+		}
+		else if (key == "parameter")
+		{
+			std::string name;
+			double minimum;
+			double maximum;
+			unsigned num_values = 1;
+			if (!(line_stream >> name >> minimum >> maximum))
+			{
+				EXCEPTION("Sweep parameters need a name, minimum and maximum: " + line);
+			}
+			// The number of values is optional
+			if (!(line_stream >> std::ws).eof())
+			{
+				num_values = ParseUnsigned(line_stream, line);
+				if (num_values == 0)
+				{
+					EXCEPTION("Sweep parameters need at least one value: " + line);
+				}
+			}
+			AddParameter(name, minimum, maximum, num_values);
+		}
+		else
+		{
+			EXCEPTION("Unknown key '" + key + "' in sweep configuration file " + rConfigFile.GetAbsolutePath());
+		}
+	}
+}
+
+void CryptParameterSweep::SetDesign(std::string design)
+{
+	if (design != "grid" && design != "lhs")
+	{
+		EXCEPTION("Sweep design must be grid or lhs, not " + design);
+	}
+	mDesign = design;
+}
+
+void CryptParameterSweep::SetNumSamples(unsigned numSamples)
+{
+	mNumSamples = numSamples;
+}
+
+void CryptParameterSweep::SetSeed(unsigned seed)
+{
+	mSeed = seed;
+}
+
+void CryptParameterSweep::SetNumProcesses(unsigned numProcesses)
+{
+	mNumProcesses = numProcesses;
+}
+
+void CryptParameterSweep::AddParameter(std::string name, double minimum, double maximum, unsigned numValues)
+{
+	assert(numValues > 0);
+	mParameterNames.push_back(name);
+	mParameterMinima.push_back(minimum);
+	mParameterMaxima.push_back(maximum);
+	mParameterNumValues.push_back(numValues);
+}
+
+void CryptParameterSweep::GenerateGridDesign()
+{
+	// Every combination of values, with the last parameter varying fastest
+	unsigned num_points = 1;
+	for (unsigned i=0; i<mParameterNames.size(); i++)
+	{
+		num_points *= mParameterNumValues[i];
+	}
+
+	for (unsigned point=0; point<num_points; point++)
+	{
+		std::vector<double> values(mParameterNames.size());
+		unsigned remainder = point;
+		for (unsigned i=mParameterNames.size(); i-- > 0; )
+		{
+			unsigned value_index = remainder % mParameterNumValues[i];
+			remainder /= mParameterNumValues[i];
+
+			values[i] = mParameterMinima[i];
+			if (mParameterNumValues[i] > 1)
+			{
+				values[i] += value_index*(mParameterMaxima[i] - mParameterMinima[i])/(mParameterNumValues[i] - 1);
+			}
+		}
+		mPoints.push_back(values);
+	}
+}
+
+void CryptParameterSweep::GenerateLatinHypercubeDesign()
+{
+	// Each parameter's range is cut into mNumSamples strata and every stratum is used once.
+	// The design gets its own generator so it's the same every time the sweep is resumed.
+	if (mNumSamples == 0)
+	{
+		EXCEPTION("A Latin hypercube design needs at least one sample");
+	}
+	std::mt19937 generator(mSeed);
+
+	mPoints.assign(mNumSamples, std::vector<double>(mParameterNames.size()));
+	for (unsigned i=0; i<mParameterNames.size(); i++)
+	{
+		std::vector<unsigned> strata(mNumSamples);
+		for (unsigned point=0; point<mNumSamples; point++)
+		{
+			strata[point] = point;
+		}
+
+		// Fisher-Yates shuffle
+		for (unsigned j=mNumSamples; j-- > 1; )
+		{
+			unsigned k = std::min(j, static_cast<unsigned>(DrawUniform(generator)*(j + 1)));
+			std::swap(strata[j], strata[k]);
+		}
+
+		for (unsigned point=0; point<mNumSamples; point++)
+		{
+			double fraction = (strata[point] + DrawUniform(generator))/mNumSamples;
+			mPoints[point][i] = mParameterMinima[i] + fraction*(mParameterMaxima[i] - mParameterMinima[i]);
+		}
+	}
+}
+
+void CryptParameterSweep::GenerateDesign()
+{
+	mPoints.clear();
+	if (mDesign == "lhs")
+	{
+		GenerateLatinHypercubeDesign();
+	}
+	else
+	{
+		GenerateGridDesign();
+	}
+}
+
+std::map<std::string, double> CryptParameterSweep::GetParameterMap(unsigned point)
+{
+	std::map<std::string, double> parameters;
+	for (unsigned i=0; i<mParameterNames.size(); i++)
+	{
+		parameters[mParameterNames[i]] = mPoints[point][i];
+	}
+	return parameters;
+}
+
+std::string CryptParameterSweep::GetPointDirectory(unsigned point)
+{
+	std::stringstream point_directory;
+	point_directory << mOutputDirectory << "/Point_" << point;
+	return point_directory.str();
+}
+
+bool CryptParameterSweep::ReadPointResult(unsigned point)
+{
+	FileFinder result_file(GetPointDirectory(point) + "/result.dat", RelativeTo::ChasteTestOutput);
+	if (!result_file.IsFile())
+	{
+		return false;
+	}
+
+	// Only use the result if it was run with this point's seed and parameter values. If the
+	// configuration has changed since, Point_i is a different point and has to be run again.
+	std::ifstream result_stream(result_file.GetAbsolutePath().c_str());
+	std::string key;
+	unsigned seed;
+	if (!(result_stream >> key >> seed) || key != "seed" || seed != mSeed + point)
+	{
+		return false;
+	}
+	for (unsigned i=0; i<mParameterNames.size(); i++)
+	{
+		double value;
+		if (!(result_stream >> key >> value) || key != mParameterNames[i] || value != mPoints[point][i])
+		{
+			return false;
+		}
+	}
+	if (!(result_stream >> key) || key != "results")
+	{
+		return false;
+	}
+
+	std::vector<double> result;
+	double value;
+	while (result_stream >> value)
+	{
+		result.push_back(value);
+	}
+	mResults[point] = result;
+	return true;
+}
+
+void CryptParameterSweep::RecordPointResult(unsigned point, bool success, const std::vector<double>& rResult)
+{
+	if (!success)
+	{
+		mNumPointsFailed++;
+		return;
+	}
+
+	mResults[point] = rResult;
+	mNumPointsRun++;
+
+	// Write to a temporary file and rename it, so result.dat only ever exists complete
+	OutputFileHandler point_handler(GetPointDirectory(point) + "/", false);
+	out_stream p_result_file = point_handler.OpenOutputFile("result.dat.tmp");
+	*p_result_file << std::setprecision(17);
+	*p_result_file << "seed\t" << mSeed + point << "\n";
+	for (unsigned i=0; i<mParameterNames.size(); i++)
+	{
+		*p_result_file << mParameterNames[i] << "\t" << mPoints[point][i] << "\n";
+	}
+	*p_result_file << "results";
+	for (unsigned i=0; i<rResult.size(); i++)
+	{
+		*p_result_file << "\t" << rResult[i];
+	}
+	*p_result_file << "\n";
+	p_result_file->close();
+
+	std::string point_path = point_handler.GetOutputDirectoryFullPath();
+	if (std::rename((point_path + "result.dat.tmp").c_str(), (point_path + "result.dat").c_str()) != 0)
+	{
+		EXCEPTION("Could not write the result of sweep point " + point_path);
+	}
+}
+
+void CryptParameterSweep::Run()
+{
+	GenerateDesign();
+
+	mResults.assign(mPoints.size(), std::vector<double>());
+	mNumPointsRun = 0;
+	mNumPointsSkipped = 0;
+	mNumPointsFailed = 0;
+
+	// Never clean the sweep directory: that's where the results of earlier runs are
+	OutputFileHandler output_file_handler(mOutputDirectory + "/", false);
+
+	out_stream p_design_file = output_file_handler.OpenOutputFile("sweep_design.dat");
+	*p_design_file << "point";
+	for (unsigned i=0; i<mParameterNames.size(); i++)
+	{
+		*p_design_file << "\t" << mParameterNames[i];
+	}
+	*p_design_file << "\n" << std::setprecision(17);
+	for (unsigned point=0; point<mPoints.size(); point++)
+	{
+		*p_design_file << point;
+		for (unsigned i=0; i<mPoints[point].size(); i++)
+		{
+			*p_design_file << "\t" << mPoints[point][i];
+		}
+		*p_design_file << "\n";
+	}
+	p_design_file->close();
+
+	std::vector<unsigned> points_to_run;
+	for (unsigned point=0; point<mPoints.size(); point++)
+	{
+		if (ReadPointResult(point))
+		{
+			mNumPointsSkipped++;
+		}
+		else
+		{
+			points_to_run.push_back(point);
+		}
+	}
+
+	// A result that can't be written is thrown once the pool has finished, so no child is left running
+	std::string record_error;
+	CryptProcessPool pool(mNumProcesses);
+	pool.Run(points_to_run,
+			 [this](unsigned point)
+			 {
+				 CryptProcessPool::ResetSimulationState(mSeed + point);
+				 return mPointFunction(GetParameterMap(point), GetPointDirectory(point));
+			 },
+			 [this, &record_error](unsigned point, bool success, const std::vector<double>& rResult)
+			 {
+				 try
+				 {
+					 RecordPointResult(point, success, rResult);
+				 }
+				 catch (Exception& e)
+				 {
+					 if (record_error.empty())
+					 {
+						 record_error = e.GetMessage();
+					 }
+				 }
+			 });
+
+	if (!record_error.empty())
+	{
+		EXCEPTION(record_error);
+	}
+
+	out_stream p_results_file = output_file_handler.OpenOutputFile("sweep_results.dat");
+	*p_results_file << "point";
+	for (unsigned i=0; i<mParameterNames.size(); i++)
+	{
+		*p_results_file << "\t" << mParameterNames[i];
+	}
+	*p_results_file << "\tresults\n";
+	for (unsigned point=0; point<mPoints.size(); point++)
+	{
+		*p_results_file << point;
+		for (unsigned i=0; i<mPoints[point].size(); i++)
+		{
+			*p_results_file << "\t" << mPoints[point][i];
+		}
+		for (unsigned i=0; i<mResults[point].size(); i++)
+		{
+			*p_results_file << "\t" << mResults[point][i];
+		}
+		*p_results_file << "\n";
+	}
+	p_results_file->close();
+}
+
+unsigned CryptParameterSweep::GetNumPoints()
+{
+	return mPoints.size();
+}
+
+const std::vector<std::string>& CryptParameterSweep::rGetParameterNames()
+{
+	return mParameterNames;
+}
+
+const std::vector<std::vector<double> >& CryptParameterSweep::rGetPoints()
+{
+	return mPoints;
+}
+
+const std::vector<std::vector<double> >& CryptParameterSweep::rGetResults()
+{
+	return mResults;
+}
+
+unsigned CryptParameterSweep::GetNumPointsRun()
+{
+	return mNumPointsRun;
+}
+
+unsigned CryptParameterSweep::GetNumPointsSkipped()
+{
+	return mNumPointsSkipped;
+}
+
+unsigned CryptParameterSweep::GetNumPointsFailed()
+{
+	return mNumPointsFailed;
+}
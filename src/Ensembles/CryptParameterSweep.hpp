@@ -0,0 +1,125 @@
+#ifndef CRYPTPARAMETERSWEEP_HPP_
+#define CRYPTPARAMETERSWEEP_HPP_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "FileFinder.hpp"
+
+/*
+ * Runs a crypt simulation at every point of a parameter design, across the cores of the machine.
+ *
+ * The design is read from a config file of "key value" lines ('#' starts a comment):
+ *
+ *     design grid              # grid or lhs (Latin hypercube)
+ *     samples 20               # number of points, lhs only
+ *     seed 0                   # seeds the lhs design and each point's simulation
+ *     parameter torsional_stiffness 10 40 4    # name, min, max, number of values (grid only)
+ *     parameter membraneStiffness 15 25 3
+ *
+ * Point i writes its simulation output to <output directory>/Point_i. When it finishes, its
+ * seed, parameter values and summary numbers are written to Point_i/result.dat, which is
+ * renamed into place so a killed sweep never leaves a half-written result. A point whose
+ * result.dat has the same seed and parameter values is skipped, so rerunning an interrupted
+ * sweep only runs what's left; if the configuration has changed, the points that have changed
+ * are run again. The design is written to sweep_design.dat and every point's parameters and
+ * results are gathered in sweep_results.dat.
+ *
+ * The Latin hypercube is drawn from the raw output of std::mt19937, not the standard library's
+ * distributions, so the same seed gives the same design with any compiler.
+ */
+
+class CryptParameterSweep
+{
+public:
+
+    /* Builds and solves the simulation at one point: takes the parameter values and output directory, returns its summary */
+    typedef std::function<std::vector<double>(const std::map<std::string, double>&, const std::string&)> PointFunction;
+
+private:
+
+    PointFunction mPointFunction;
+
+    // Output directory for the sweep, relative to CHASTE_TEST_OUTPUT
+    std::string mOutputDirectory;
+
+    // "grid" or "lhs"
+    std::string mDesign;
+
+    unsigned mNumSamples;
+
+    unsigned mSeed;
+
+    // Maximum number of points running at once; 0 means one per core
+    unsigned mNumProcesses;
+
+    std::vector<std::string> mParameterNames;
+    std::vector<double> mParameterMinima;
+    std::vector<double> mParameterMaxima;
+    std::vector<unsigned> mParameterNumValues;
+
+    // Parameter values at each point, in the order of mParameterNames
+    std::vector<std::vector<double> > mPoints;
+
+    // Summary of each point, empty if it hasn't been run or failed
+    std::vector<std::vector<double> > mResults;
+
+    unsigned mNumPointsRun;
+    unsigned mNumPointsSkipped;
+    unsigned mNumPointsFailed;
+
+    void GenerateGridDesign();
+
+    void GenerateLatinHypercubeDesign();
+
+    std::map<std::string, double> GetParameterMap(unsigned point);
+
+    std::string GetPointDirectory(unsigned point);
+
+    /* Read the result of a point from a previous run, returning false if there isn't one */
+    bool ReadPointResult(unsigned point);
+
+    /* Write the result of a finished point in the parent process */
+    void RecordPointResult(unsigned point, bool success, const std::vector<double>& rResult);
+
+public:
+
+    CryptParameterSweep(PointFunction pointFunction, std::string outputDirectory);
+
+    /* Read the design and parameter ranges from a config file */
+    void LoadConfiguration(const FileFinder& rConfigFile);
+
+    void SetDesign(std::string design);
+
+    void SetNumSamples(unsigned numSamples);
+
+    void SetSeed(unsigned seed);
+
+    void SetNumProcesses(unsigned numProcesses);
+
+    void AddParameter(std::string name, double minimum, double maximum, unsigned numValues=1);
+
+    /* Build the design. Called by Run(), but can be called first to look at the points. */
+    void GenerateDesign();
+
+    /* Run every point that doesn't already have a result. Returns once they have all finished. */
+    void Run();
+
+    unsigned GetNumPoints();
+
+    const std::vector<std::string>& rGetParameterNames();
+
+    const std::vector<std::vector<double> >& rGetPoints();
+
+    const std::vector<std::vector<double> >& rGetResults();
+
+    unsigned GetNumPointsRun();
+
+    unsigned GetNumPointsSkipped();
+
+    unsigned GetNumPointsFailed();
+};
+
+#endif /* CRYPTPARAMETERSWEEP_HPP_ */
@@ -0,0 +1,192 @@
+#include "CryptProcessPool.hpp"
+#include "Exception.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "SimulationTime.hpp"
+#include "CellId.hpp"
+
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <iostream>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+namespace
+{
+	/* Write the whole buffer, coping with partial writes and interrupts */
+	bool WriteAll(int fileDescriptor, const char* pData, size_t numBytes)
+	{
+		while (numBytes > 0)
+		{
+			ssize_t written = write(fileDescriptor, pData, numBytes);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				return false;
+			}
+			pData += written;
+			numBytes -= written;
+		}
+		return true;
+	}
+
+	/* Read exactly numBytes, returning false if the pipe closes first */
+	bool ReadAll(int fileDescriptor, char* pData, size_t numBytes)
+	{
+		while (numBytes > 0)
+		{
+			ssize_t num_read = read(fileDescriptor, pData, numBytes);
+			if (num_read < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (num_read <= 0)
+			{
+				return false;
+			}
+			pData += num_read;
+			numBytes -= num_read;
+		}
+		return true;
+	}
+}
+
+CryptProcessPool::CryptProcessPool(unsigned numProcesses)
+	: mNumProcesses(numProcesses)
+{
+	if (mNumProcesses == 0)
+	{
+		mNumProcesses = std::max(1u, std::thread::hardware_concurrency());
+	}
+}
+
+unsigned CryptProcessPool::GetNumProcesses()
+{
+	return mNumProcesses;
+}
+
+void CryptProcessPool::Run(const std::vector<unsigned>& rJobIndices, JobFunction jobFunction, ResultFunction resultFunction)
+{
+	// Running children: pid -> (job index, read end of its pipe)
+	std::map<pid_t, std::pair<unsigned, int> > running_jobs;
+
+	unsigned next_job = 0;
+	while (next_job < rJobIndices.size() || !running_jobs.empty())
+	{
+		// Start as many jobs as we're allowed
+		while (next_job < rJobIndices.size() && running_jobs.size() < mNumProcesses)
+		{
+			unsigned job_index = rJobIndices[next_job];
+			next_job++;
+
+			int pipe_ends[2];
+			if (pipe(pipe_ends) != 0)
+			{
+				EXCEPTION("Could not create a pipe for a crypt job");
+			}
+
+			// Make sure nothing buffered in the parent gets written twice
+			std::cout.flush();
+			std::cerr.flush();
+
+			pid_t pid = fork();
+			if (pid < 0)
+			{
+				EXCEPTION("Could not fork a process for a crypt job");
+			}
+
+			if (pid == 0)
+			{
+				// Child: run the job, send the results back and leave without running any destructors
+				close(pipe_ends[0]);
+				int exit_code = 0;
+				try
+				{
+					std::vector<double> results = jobFunction(job_index);
+
+					unsigned num_results = results.size();
+					bool written = WriteAll(pipe_ends[1], reinterpret_cast<const char*>(&num_results), sizeof(unsigned));
+					if (written && num_results > 0)
+					{
+						written = WriteAll(pipe_ends[1], reinterpret_cast<const char*>(&results[0]), num_results*sizeof(double));
+					}
+					exit_code = written ? 0 : 1;
+				}
+				catch (Exception& e)
+				{
+					std::cerr << "Crypt job " << job_index << " failed: " << e.GetMessage() << std::endl;
+					exit_code = 1;
+				}
+				catch (std::exception& e)
+				{
+					std::cerr << "Crypt job " << job_index << " failed: " << e.what() << std::endl;
+					exit_code = 1;
+				}
+				close(pipe_ends[1]);
+				std::cout.flush();
+				std::cerr.flush();
+				_exit(exit_code);
+			}
+
+			// Parent
+			close(pipe_ends[1]);
+			running_jobs[pid] = std::make_pair(job_index, pipe_ends[0]);
+		}
+
+		// Wait for any child to finish. Results are a handful of numbers, so they fit
+		// in the pipe buffer and the child never blocks waiting for us to read.
+		int status;
+		pid_t finished_pid = waitpid(-1, &status, 0);
+		if (finished_pid < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			EXCEPTION("Lost track of the crypt job processes");
+		}
+
+		std::map<pid_t, std::pair<unsigned, int> >::iterator it = running_jobs.find(finished_pid);
+		if (it == running_jobs.end())
+		{
+			// Not one of ours
+			continue;
+		}
+		unsigned job_index = it->second.first;
+		int read_end = it->second.second;
+		running_jobs.erase(it);
+
+		std::vector<double> results;
+		bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		if (success)
+		{
+			unsigned num_results = 0;
+			success = ReadAll(read_end, reinterpret_cast<char*>(&num_results), sizeof(unsigned));
+			if (success && num_results > 0)
+			{
+				results.resize(num_results);
+				success = ReadAll(read_end, reinterpret_cast<char*>(&results[0]), num_results*sizeof(double));
+			}
+		}
+		close(read_end);
+
+		if (!success)
+		{
+			results.clear();
+		}
+		resultFunction(job_index, success, results);
+	}
+}
+
+void CryptProcessPool::ResetSimulationState(unsigned seed)
+{
+	RandomNumberGenerator::Instance()->Reseed(seed);
+	SimulationTime::Destroy();
+	SimulationTime::Instance()->SetStartTime(0.0);
+	CellId::ResetMaxCellId();
+}
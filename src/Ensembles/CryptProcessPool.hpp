@@ -0,0 +1,57 @@
+#ifndef CRYPTPROCESSPOOL_HPP_
+#define CRYPTPROCESSPOOL_HPP_
+
+#include <functional>
+#include <vector>
+
+/*
+ * Runs independent jobs in forked child processes, a few at a time.
+ *
+ * Chaste's singletons (SimulationTime, RandomNumberGenerator, CellPropertyRegistry...)
+ * mean only one simulation can run in a process, so each job gets a process of its own.
+ * A job returns a short vector of numbers, which is sent back to the parent through a
+ * pipe and handed to the result function as soon as that job finishes, in whatever
+ * order the jobs complete.
+ *
+ * The parent process should not be in the middle of a simulation when Run() is called,
+ * as every child starts from a copy of its state.
+ */
+
+class CryptProcessPool
+{
+public:
+
+    /* Runs in the child process: takes the job index and returns the job's results */
+    typedef std::function<std::vector<double>(unsigned)> JobFunction;
+
+    /* Runs in the parent process: job index, whether the job succeeded, and its results */
+    typedef std::function<void(unsigned, bool, const std::vector<double>&)> ResultFunction;
+
+private:
+
+    // Maximum number of child processes running at once
+    unsigned mNumProcesses;
+
+public:
+
+    /*
+     * @param numProcesses the maximum number of jobs to run at once; 0 means one per core
+     */
+    CryptProcessPool(unsigned numProcesses=0);
+
+    unsigned GetNumProcesses();
+
+    /*
+     * Run every job in rJobIndices, calling resultFunction in this process as each one finishes.
+     * Returns once all jobs have finished.
+     */
+    void Run(const std::vector<unsigned>& rJobIndices, JobFunction jobFunction, ResultFunction resultFunction);
+
+    /*
+     * For use at the start of a job: the child is a copy of the parent, so put
+     * SimulationTime, the cell ids and the random number generator back to a clean start.
+     */
+    static void ResetSimulationState(unsigned seed);
+};
+
+#endif /* CRYPTPROCESSPOOL_HPP_ */
@@ -0,0 +1,101 @@
+#include "CryptSpringRestLength.hpp"
+#include "AbstractCentreBasedCellPopulation.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+#include "IsNan.hpp"
+#include "SimulationTime.hpp"
+
+template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
+double CryptSpringRestLength<ELEMENT_DIM,SPACE_DIM>::GetRestLengthAfterDivision(AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation,
+                                                                                unsigned nodeAGlobalIndex,
+                                                                                unsigned nodeBGlobalIndex,
+                                                                                double restLength,
+                                                                                double divisionRestingSpringLength,
+                                                                                double springGrowthDuration)
+{
+    CellPtr p_cell_A = rCellPopulation.GetCellUsingLocationIndex(nodeAGlobalIndex);
+    CellPtr p_cell_B = rCellPopulation.GetCellUsingLocationIndex(nodeBGlobalIndex);
+
+    // The crypt population works out the ages, apoptosis and types of its cells once per time step
+    CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(&rCellPopulation);
+    const CryptCellAttributes* p_attributes = p_crypt_population ? &(p_crypt_population->rGetCellAttributes()) : NULL;
+
+    double ageA = p_attributes ? p_attributes->GetAge(nodeAGlobalIndex) : p_cell_A->GetAge();
+    double ageB = p_attributes ? p_attributes->GetAge(nodeBGlobalIndex) : p_cell_B->GetAge();
+
+    assert(!std::isnan(ageA));
+    assert(!std::isnan(ageB));
+
+    if (ageA >= springGrowthDuration || ageB >= springGrowthDuration)
+    {
+        return restLength;
+    }
+
+    bool is_marked_spring = false;
+
+    // The crypt population keeps its marked springs by cell id, and they expire on their own
+    if (p_crypt_population)
+    {
+        p_crypt_population->KeepMarkedSpringsFor(springGrowthDuration);
+        is_marked_spring = p_crypt_population->IsMarkedCellPair(p_cell_A->GetCellId(), p_cell_B->GetCellId());
+    }
+    else
+    {
+        AbstractCentreBasedCellPopulation<ELEMENT_DIM,SPACE_DIM>* p_static_cast_cell_population = static_cast<AbstractCentreBasedCellPopulation<ELEMENT_DIM,SPACE_DIM>*>(&rCellPopulation);
+
+        std::pair<CellPtr,CellPtr> cell_pair = p_static_cast_cell_population->CreateCellPair(p_cell_A, p_cell_B);
+
+        is_marked_spring = p_static_cast_cell_population->IsMarkedSpring(cell_pair);
+
+        if (ageA + SimulationTime::Instance()->GetTimeStep() >= springGrowthDuration)
+        {
+            // This spring is about to go out of scope
+            p_static_cast_cell_population->UnmarkSpring(cell_pair);
+        }
+    }
+
+    if (is_marked_spring)
+    {
+        // Spring rest length increases from a small value to the normal rest length over 1 hour
+        double lambda = divisionRestingSpringLength;
+        return lambda + (restLength - lambda) * ageA/springGrowthDuration;
+    }
+    return restLength;
+}
+
+template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
+void CryptSpringRestLength<ELEMENT_DIM,SPACE_DIM>::ApplyApoptosis(AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation,
+                                                                  unsigned nodeAGlobalIndex,
+                                                                  unsigned nodeBGlobalIndex,
+                                                                  double& rARestLength,
+                                                                  double& rBRestLength)
+{
+    CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(&rCellPopulation);
+    if (p_crypt_population)
+    {
+        const CryptCellAttributes& r_attributes = p_crypt_population->rGetCellAttributes();
+        rARestLength *= r_attributes.GetApoptosisFactor(nodeAGlobalIndex);
+        rBRestLength *= r_attributes.GetApoptosisFactor(nodeBGlobalIndex);
+        return;
+    }
+
+    CellPtr p_cell_A = rCellPopulation.GetCellUsingLocationIndex(nodeAGlobalIndex);
+    CellPtr p_cell_B = rCellPopulation.GetCellUsingLocationIndex(nodeBGlobalIndex);
+    if (p_cell_A->HasApoptosisBegun())
+    {
+        double time_until_death_a = p_cell_A->GetTimeUntilDeath();
+        rARestLength = rARestLength * time_until_death_a / p_cell_A->GetApoptosisTime();
+    }
+    if (p_cell_B->HasApoptosisBegun())
+    {
+        double time_until_death_b = p_cell_B->GetTimeUntilDeath();
+        rBRestLength = rBRestLength * time_until_death_b / p_cell_B->GetApoptosisTime();
+    }
+}
+
+// Explicit instantiation
+template class CryptSpringRestLength<1,1>;
+template class CryptSpringRestLength<1,2>;
+template class CryptSpringRestLength<2,2>;
+template class CryptSpringRestLength<1,3>;
+template class CryptSpringRestLength<2,3>;
+template class CryptSpringRestLength<3,3>;
@@ -0,0 +1,41 @@
+#ifndef CRYPTSPRINGRESTLENGTH_HPP_
+#define CRYPTSPRINGRESTLENGTH_HPP_
+
+#include "AbstractCellPopulation.hpp"
+
+/*
+ * The parts of a spring's rest length that the crypt spring forces (EpithelialLayerLinearSpringForce,
+ * LinearSpringForceMembraneCell, LinearSpringSmallMembraneCell and LinearTest) share: the short spring
+ * between two newly divided cells, and the shrinking of an apoptotic cell. Both read the ages and
+ * apoptosis of a CryptCellPopulationWithGhostNodes from its CryptCellAttributes, and its marked springs
+ * from its registry; any other population is asked cell by cell, as in Chaste's own spring forces.
+ */
+template<unsigned ELEMENT_DIM, unsigned SPACE_DIM=ELEMENT_DIM>
+class CryptSpringRestLength
+{
+public:
+
+    /*
+     * The rest length of the spring between two nodes given its full length: if the cells are both
+     * newly divided and the spring is marked, it grows linearly from divisionRestingSpringLength to
+     * the full length over springGrowthDuration after division.
+     */
+    static double GetRestLengthAfterDivision(AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation,
+                                             unsigned nodeAGlobalIndex,
+                                             unsigned nodeBGlobalIndex,
+                                             double restLength,
+                                             double divisionRestingSpringLength,
+                                             double springGrowthDuration);
+
+    /*
+     * Shrink the two halves of a spring for any cell at either end that has begun apoptosis, linearly
+     * with its time until death.
+     */
+    static void ApplyApoptosis(AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation,
+                               unsigned nodeAGlobalIndex,
+                               unsigned nodeBGlobalIndex,
+                               double& rARestLength,
+                               double& rBRestLength);
+};
+
+#endif /* CRYPTSPRINGRESTLENGTH_HPP_ */
@@ -1,6 +1,9 @@
 #include "EpithelialLayerBasementMembraneForce.hpp"
 #include "AbstractCellProperty.hpp"
-#include "Debug.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+
+#include <cfloat>
+#include <climits>
 
 /*
  * Created on: 21/12/2014
@@ -14,7 +17,10 @@
 EpithelialLayerBasementMembraneForce::EpithelialLayerBasementMembraneForce()
    :  AbstractForce<2>(),
    mBasementMembraneParameter(DOUBLE_UNSET),
-   mTargetCurvature(DOUBLE_UNSET)
+   mTargetCurvature(DOUBLE_UNSET),
+   mpCachedPairsPopulation(NULL),
+   mCachedPairsTopologyVersion(0),
+   mGelNeighbourRadius(1.5)
 {
 }
 
@@ -46,6 +52,16 @@ double EpithelialLayerBasementMembraneForce::GetTargetCurvature()
 	return mTargetCurvature;
 }
 
+void EpithelialLayerBasementMembraneForce::SetTargetCurvatureField(boost::shared_ptr<TargetCurvatureField> pTargetCurvatureField)
+{
+	mpTargetCurvatureField = pTargetCurvatureField;
+}
+
+boost::shared_ptr<TargetCurvatureField> EpithelialLayerBasementMembraneForce::GetTargetCurvatureField()
+{
+	return mpTargetCurvatureField;
+}
+
 void EpithelialLayerBasementMembraneForce::RemoveDuplicates1D(std::vector<unsigned>& rVectorWithDuplicates)
 {
     std::sort(rVectorWithDuplicates.begin(), rVectorWithDuplicates.end());
@@ -65,7 +81,6 @@ std::vector<c_vector<unsigned, 2> > EpithelialLayerBasementMembraneForce::GetEpi
 
     // Create a vector to record the pairs of nodes corresponding to *joined* epithelial and gel nodes
     std::vector<c_vector<unsigned, 2> > node_pairs;
-    c_vector<double, 2> pair;
 
     // We iterate over all cells in the tissue, and deal only with those that are epithelial cells
     for (AbstractCellPopulation<2>::Iterator cell_iter = rCellPopulation.Begin();
@@ -77,104 +92,177 @@ std::vector<c_vector<unsigned, 2> > EpithelialLayerBasementMembraneForce::GetEpi
     	// Need these to not be stromal cells (and not dead)
     	if ( (p_type->IsType<DifferentiatedCellProliferativeType>()==false) && (!cell_iter->IsDead()) )	// an epithelial cell
     	{
-    		Node<2>* p_node = p_tissue->GetNodeCorrespondingToCell(*cell_iter);	// Pointer to node
-    		unsigned node_index = p_node->GetIndex();
+    		unsigned node_index = p_tissue->GetNodeCorrespondingToCell(*cell_iter)->GetIndex();
+    		AddEpithelialGelPairsForNode(rCellPopulation, node_index, node_pairs);
+    	}
+    }
+	return node_pairs;
+}
+
+/*
+ * Add the pairs between the epithelial node at nodeIndex and the gel nodes it shares an element
+ * (with no ghost nodes) with. Split out of GetEpithelialGelPairs() so that the cached pairs can
+ * be redone one node at a time.
+ */
+void EpithelialLayerBasementMembraneForce::AddEpithelialGelPairsForNode(AbstractCellPopulation<2>& rCellPopulation, unsigned nodeIndex,
+		std::vector<c_vector<unsigned, 2> >& rNodePairs)
+{
+	MeshBasedCellPopulation<2>* p_tissue = static_cast<MeshBasedCellPopulation<2>*>(&rCellPopulation);
+
+	Node<2>* p_node = p_tissue->GetNode(nodeIndex);
+	unsigned node_index = nodeIndex;
+	c_vector<double, 2> pair;
 
-    		assert(!(p_tissue->IsGhostNode(node_index)));  // bit unnecessary at this stage but paranoia demands it
+	assert(!(p_tissue->IsGhostNode(node_index)));  // bit unnecessary at this stage but paranoia demands it
 
-    		// ITERATE OVER CONTAINING ELEMENTS and only work with those that DO NOT contain ghost nodes
+	// ITERATE OVER CONTAINING ELEMENTS and only work with those that DO NOT contain ghost nodes
 
-    		std::vector<unsigned> gel_nodes;
+	std::vector<unsigned> gel_nodes;
 
-    		for (Node<2>::ContainingElementIterator iter = p_node->ContainingElementsBegin();
-		         iter != p_node->ContainingElementsEnd();
-		         ++iter)
-    		{
-    			bool element_contains_ghost_nodes = false;
+	for (Node<2>::ContainingElementIterator iter = p_node->ContainingElementsBegin();
+         iter != p_node->ContainingElementsEnd();
+         ++iter)
+	{
+		bool element_contains_ghost_nodes = false;
 
-    			// Get a pointer to the element
-    			Element<2,2>* p_element = p_tissue->rGetMesh().GetElement(*iter);
+		// Get a pointer to the element
+		Element<2,2>* p_element = p_tissue->rGetMesh().GetElement(*iter);
 
-    			// ITERATE OVER NODES owned by this element
-    			for (unsigned local_index=0; local_index<3; local_index++)
-    			{
-    				unsigned nodeBGlobalIndex = p_element->GetNodeGlobalIndex(local_index);
+		// ITERATE OVER NODES owned by this element
+		for (unsigned local_index=0; local_index<3; local_index++)
+		{
+			unsigned nodeBGlobalIndex = p_element->GetNodeGlobalIndex(local_index);
 
-    				if (p_tissue->IsGhostNode(nodeBGlobalIndex) == true)
-    				{
-    					element_contains_ghost_nodes = true;
-    					break; 				// This should break out of the inner for loop
-    				}
-    			}
+			if (p_tissue->IsGhostNode(nodeBGlobalIndex) == true)
+			{
+				element_contains_ghost_nodes = true;
+				break; 				// This should break out of the inner for loop
+			}
+		}
 
-				if (element_contains_ghost_nodes==false)
+		if (element_contains_ghost_nodes==false)
+		{
+            // ITERATE OVER NODES owned by this element
+            for (unsigned local_index=0; local_index<3; local_index++)
+            {
+                unsigned nodeBGlobalIndex = p_element->GetNodeGlobalIndex(local_index);
+
+                CellPtr p_cell = rCellPopulation.GetCellUsingLocationIndex(nodeBGlobalIndex);
+
+				if (p_cell->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType	>()==true)
 				{
-                    // ITERATE OVER NODES owned by this element
-                    for (unsigned local_index=0; local_index<3; local_index++)
-                    {
-                        unsigned nodeBGlobalIndex = p_element->GetNodeGlobalIndex(local_index);
-
-                        CellPtr p_cell = rCellPopulation.GetCellUsingLocationIndex(nodeBGlobalIndex);
-
-						if (p_cell->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType	>()==true)
-						{
-							// Store the index of each gel node that is attached to the epithelial
-							// node. There will be repetitions due to iterating over neighbouring elements
-							gel_nodes.push_back(nodeBGlobalIndex);
-						}
-                    }
+					// Store the index of each gel node that is attached to the epithelial
+					// node. There will be repetitions due to iterating over neighbouring elements
+					gel_nodes.push_back(nodeBGlobalIndex);
 				}
-			}
+            }
+		}
+	}
 
-    		// Remove any nodes that have been found twice
-    		RemoveDuplicates1D(gel_nodes);
+	// Remove any nodes that have been found twice
+	RemoveDuplicates1D(gel_nodes);
 
-    		// Now construct the vector of node pairs
-    		for (unsigned i=0; i<gel_nodes.size(); i++)
-    		{
-    			pair[0] = node_index;
-    			pair[1] = gel_nodes[i];
-    			node_pairs.push_back(pair);
+	// Now construct the vector of node pairs
+	for (unsigned i=0; i<gel_nodes.size(); i++)
+	{
+		pair[0] = node_index;
+		pair[1] = gel_nodes[i];
+		rNodePairs.push_back(pair);
 
-    			// Check that these node share a common element
-				bool has_common_element = false;
+		// Check that these node share a common element
+		bool has_common_element = false;
 
-				// The elements that contain this epithelial node:
-				std::set<unsigned> epithelial_elements = rCellPopulation.GetNode(node_index)->rGetContainingElementIndices();
-				assert(epithelial_elements.size() != 0);
+		// The elements that contain this epithelial node:
+		std::set<unsigned> epithelial_elements = rCellPopulation.GetNode(node_index)->rGetContainingElementIndices();
+		assert(epithelial_elements.size() != 0);
 
-				// The elements that contain the gel node:
-				std::set<unsigned> gel_elements = rCellPopulation.GetNode(gel_nodes[i])->rGetContainingElementIndices();
-				assert(gel_elements.size() != 0);
+		// The elements that contain the gel node:
+		std::set<unsigned> gel_elements = rCellPopulation.GetNode(gel_nodes[i])->rGetContainingElementIndices();
+		assert(gel_elements.size() != 0);
 
-				// Loop over all elements that contain the gel node
-				for (Node<2>::ContainingElementIterator elt_it = rCellPopulation.GetNode(gel_nodes[i])->ContainingElementsBegin();
-				         elt_it != rCellPopulation.GetNode(gel_nodes[i])->ContainingElementsEnd();
-				         ++elt_it)
-				{
-					unsigned elt_index = *elt_it;
+		// Loop over all elements that contain the gel node
+		for (Node<2>::ContainingElementIterator elt_it = rCellPopulation.GetNode(gel_nodes[i])->ContainingElementsBegin();
+		         elt_it != rCellPopulation.GetNode(gel_nodes[i])->ContainingElementsEnd();
+		         ++elt_it)
+		{
+			unsigned elt_index = *elt_it;
 
-					bool elt_contains_ghost_nodes = DoesElementContainGhostNodes(rCellPopulation, elt_index);
+			bool elt_contains_ghost_nodes = DoesElementContainGhostNodes(rCellPopulation, elt_index);
 
-					// Keep only those elements that also contain the epithelial node, but do not have ghost nodes
-					if ( (elt_contains_ghost_nodes == false) && (epithelial_elements.find(elt_index) != epithelial_elements.end()) )
-					{
-						// Common element
-						has_common_element = true;
-						break;
-					}
-				}
+			// Keep only those elements that also contain the epithelial node, but do not have ghost nodes
+			if ( (elt_contains_ghost_nodes == false) && (epithelial_elements.find(elt_index) != epithelial_elements.end()) )
+			{
+				// Common element
+				has_common_element = true;
+				break;
+			}
+		}
 
-				if (!has_common_element)
-				{
-					TRACE("No common element between:");
-					PRINT_2_VARIABLES(node_index,gel_nodes[i]);
-				}
-				assert(has_common_element);
-    		}
-    	}
-    }
-	return node_pairs;
+		assert(has_common_element);
+		UNUSED_OPT(has_common_element);
+	}
+}
+
+const std::vector<c_vector<unsigned, 2> >& EpithelialLayerBasementMembraneForce::rGetCachedEpithelialGelPairs(AbstractCellPopulation<2>& rCellPopulation)
+{
+	CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(&rCellPopulation);
+
+	if (p_crypt_population == NULL
+		|| mpCachedPairsPopulation != &rCellPopulation
+		|| p_crypt_population->GetTopologyVersion() > mCachedPairsTopologyVersion + 1
+		|| (p_crypt_population->GetTopologyVersion() == mCachedPairsTopologyVersion + 1 && !p_crypt_population->IsLastTopologyChangeLocal()))
+	{
+		mCachedNodePairs = GetEpithelialGelPairs(rCellPopulation);
+		mpCachedPairsPopulation = &rCellPopulation;
+	}
+	else if (p_crypt_population->GetTopologyVersion() == mCachedPairsTopologyVersion + 1)
+	{
+		// Only the epithelial nodes of the flipped elements can have gained or lost a pair
+		std::set<unsigned> changed_nodes;
+		const std::set<unsigned>& r_changed_elements = p_crypt_population->rGetChangedElements();
+		for (std::set<unsigned>::const_iterator elem_iter = r_changed_elements.begin();
+			 elem_iter != r_changed_elements.end();
+			 ++elem_iter)
+		{
+			Element<2,2>* p_element = p_crypt_population->rGetMesh().GetElement(*elem_iter);
+			for (unsigned local_index=0; local_index<3; local_index++)
+			{
+				changed_nodes.insert(p_element->GetNodeGlobalIndex(local_index));
+			}
+		}
+
+		unsigned num_kept = 0;
+		for (unsigned i=0; i<mCachedNodePairs.size(); i++)
+		{
+			if (changed_nodes.find(mCachedNodePairs[i][0]) == changed_nodes.end())
+			{
+				mCachedNodePairs[num_kept++] = mCachedNodePairs[i];
+			}
+		}
+		mCachedNodePairs.resize(num_kept);
+
+		for (std::set<unsigned>::iterator node_iter = changed_nodes.begin();
+			 node_iter != changed_nodes.end();
+			 ++node_iter)
+		{
+			if (p_crypt_population->IsGhostNode(*node_iter))
+			{
+				continue;
+			}
+			CellPtr p_cell = p_crypt_population->GetCellUsingLocationIndex(*node_iter);
+			if (!p_cell->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>() && !p_cell->IsDead())
+			{
+				AddEpithelialGelPairsForNode(rCellPopulation, *node_iter, mCachedNodePairs);
+			}
+		}
+	}
+
+	if (p_crypt_population != NULL)
+	{
+		mCachedPairsTopologyVersion = p_crypt_population->GetTopologyVersion();
+	}
+
+	return mCachedNodePairs;
 }
 
 /*
@@ -402,7 +490,14 @@ double EpithelialLayerBasementMembraneForce::GetCurvatureFromNodePair(AbstractCe
     	c_vector<double, 2> epithelial_location = p_tissue->GetNode(epithelialNodeIndex)->rGetLocation();
 
     	//Subtract the target curvature
-    	curvature -= mTargetCurvature;
+    	if (mpTargetCurvatureField)
+    	{
+    		curvature -= mpTargetCurvatureField->GetTargetCurvature(epithelial_location[1]);
+    	}
+    	else
+    	{
+    		curvature -= mTargetCurvature;
+    	}
 
     	assert(!isnan(curvature));
     	return curvature;
@@ -416,9 +511,9 @@ double EpithelialLayerBasementMembraneForce::GetCurvatureFromNodePair(AbstractCe
  */
 
 double EpithelialLayerBasementMembraneForce::GetCurvatureFromMidpoints(AbstractCellPopulation<2>& rCellPopulation,
-																c_vector<double, 2> leftMidpoint,
-																c_vector<double, 2> centreMidpoint,
-																c_vector<double, 2> rightMidpoint)
+																const c_vector<double, 2>& leftMidpoint,
+																const c_vector<double, 2>& centreMidpoint,
+																const c_vector<double, 2>& rightMidpoint)
 {
 	MeshBasedCellPopulation<2>* p_tissue = static_cast<MeshBasedCellPopulation<2>*>(&rCellPopulation);
 
@@ -443,9 +538,9 @@ double EpithelialLayerBasementMembraneForce::GetCurvatureFromMidpoints(AbstractC
 */
 
 double EpithelialLayerBasementMembraneForce::FindParametricCurvature(AbstractCellPopulation<2>& rCellPopulation,
-															c_vector<double, 2> leftMidpoint,
-															c_vector<double, 2> centreMidpoint,
-															c_vector<double, 2> rightMidpoint)
+															const c_vector<double, 2>& leftMidpoint,
+															const c_vector<double, 2>& centreMidpoint,
+															const c_vector<double, 2>& rightMidpoint)
 {
 	//Get the relevant vectors (all possible differences)
 	c_vector<double, 2> left_to_centre = rCellPopulation.rGetMesh().GetVectorFromAtoB(leftMidpoint, centreMidpoint);
@@ -590,14 +685,168 @@ bool EpithelialLayerBasementMembraneForce::HasEpithelialCellDetachedFromBasement
 
 	return has_cell_detached;
 }
+void EpithelialLayerBasementMembraneForce::SetGelNeighbourRadius(double gelNeighbourRadius)
+{
+	assert(gelNeighbourRadius > 0.0);
+	mGelNeighbourRadius = gelNeighbourRadius;
+}
+
+double EpithelialLayerBasementMembraneForce::GetGelNeighbourRadius()
+{
+	return mGelNeighbourRadius;
+}
+
+std::set<unsigned> EpithelialLayerBasementMembraneForce::GetNeighbouringNodeIndicesByRadius(AbstractCellPopulation<2>& rCellPopulation, unsigned nodeIndex)
+{
+	const c_vector<double, 2>& r_location = rCellPopulation.GetNode(nodeIndex)->rGetLocation();
+
+	std::set<unsigned> neighbouring_node_indices;
+	std::set<unsigned> candidate_indices = rCellPopulation.GetNeighbouringNodeIndices(nodeIndex);
+	for (std::set<unsigned>::iterator iter = candidate_indices.begin();
+		 iter != candidate_indices.end();
+		 ++iter)
+	{
+		if (norm_2(rCellPopulation.rGetMesh().GetVectorFromAtoB(r_location, rCellPopulation.GetNode(*iter)->rGetLocation())) <= mGelNeighbourRadius)
+		{
+			neighbouring_node_indices.insert(*iter);
+		}
+	}
+	return neighbouring_node_indices;
+}
+
+std::vector<c_vector<unsigned, 2> > EpithelialLayerBasementMembraneForce::GetEpithelialGelPairsByRadius(AbstractCellPopulation<2>& rCellPopulation)
+{
+	std::vector<c_vector<unsigned, 2> > node_pairs;
+	c_vector<unsigned, 2> pair;
+
+	for (AbstractCellPopulation<2>::Iterator cell_iter = rCellPopulation.Begin();
+		 cell_iter != rCellPopulation.End();
+		 ++cell_iter)
+	{
+		if (cell_iter->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>() || cell_iter->IsDead())
+		{
+			continue;
+		}
+
+		unsigned node_index = rCellPopulation.GetLocationIndexUsingCell(*cell_iter);
+		std::set<unsigned> neighbours = GetNeighbouringNodeIndicesByRadius(rCellPopulation, node_index);
+		for (std::set<unsigned>::iterator iter = neighbours.begin();
+			 iter != neighbours.end();
+			 ++iter)
+		{
+			if (rCellPopulation.GetCellUsingLocationIndex(*iter)->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>())
+			{
+				pair[0] = node_index;
+				pair[1] = *iter;
+				node_pairs.push_back(pair);
+			}
+		}
+	}
+	return node_pairs;
+}
+
+c_vector<double, 2> EpithelialLayerBasementMembraneForce::GetSpringMidpoint(AbstractCellPopulation<2>& rCellPopulation, unsigned epithelialNodeIndex,
+																unsigned gelNodeIndex, unsigned otherNodeIndex)
+{
+	const c_vector<double, 2>& r_epithelial_location = rCellPopulation.GetNode(epithelialNodeIndex)->rGetLocation();
+	c_vector<double, 2> vector_E_to_P = rCellPopulation.rGetMesh().GetVectorFromAtoB(r_epithelial_location, rCellPopulation.GetNode(otherNodeIndex)->rGetLocation());
+
+	if (rCellPopulation.GetCellUsingLocationIndex(otherNodeIndex)->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>())
+	{
+		// P = Gel, so the E->P spring
+		return r_epithelial_location + 0.5*vector_E_to_P;
+	}
+
+	// P = Epithelial, so the P->G spring
+	c_vector<double, 2> vector_P_to_G = rCellPopulation.rGetMesh().GetVectorFromAtoB(rCellPopulation.GetNode(otherNodeIndex)->rGetLocation(), rCellPopulation.GetNode(gelNodeIndex)->rGetLocation());
+	return r_epithelial_location + vector_E_to_P + 0.5*vector_P_to_G;
+}
+
+double EpithelialLayerBasementMembraneForce::GetCurvatureFromNodePairByRadius(AbstractCellPopulation<2>& rCellPopulation, unsigned epithelialNodeIndex,
+																unsigned gelNodeIndex)
+{
+	const c_vector<double, 2>& r_epithelial_location = rCellPopulation.GetNode(epithelialNodeIndex)->rGetLocation();
+	const c_vector<double, 2>& r_gel_location = rCellPopulation.GetNode(gelNodeIndex)->rGetLocation();
+	c_vector<double, 2> vector_G_to_E = rCellPopulation.rGetMesh().GetVectorFromAtoB(r_gel_location, r_epithelial_location);
+
+	// The nodes within the radius of both, which could each make an element with the pair
+	std::set<unsigned> epithelial_neighbours = GetNeighbouringNodeIndicesByRadius(rCellPopulation, epithelialNodeIndex);
+	std::set<unsigned> gel_neighbours = GetNeighbouringNodeIndicesByRadius(rCellPopulation, gelNodeIndex);
+
+	// On either side of the pair (det > 0 and det < 0), the one that sees the pair at the widest angle
+	unsigned other_index_a = UINT_MAX;
+	unsigned other_index_c = UINT_MAX;
+	double smallest_cosine_a = DBL_MAX;
+	double smallest_cosine_c = DBL_MAX;
+	for (std::set<unsigned>::iterator iter = epithelial_neighbours.begin();
+		 iter != epithelial_neighbours.end();
+		 ++iter)
+	{
+		if (*iter == gelNodeIndex || gel_neighbours.find(*iter) == gel_neighbours.end())
+		{
+			continue;
+		}
+
+		const c_vector<double, 2>& r_location = rCellPopulation.GetNode(*iter)->rGetLocation();
+		c_vector<double, 2> vector_E_to_P = rCellPopulation.rGetMesh().GetVectorFromAtoB(r_epithelial_location, r_location);
+		c_vector<double, 2> vector_P_to_E = -vector_E_to_P;
+		c_vector<double, 2> vector_P_to_G = rCellPopulation.rGetMesh().GetVectorFromAtoB(r_location, r_gel_location);
+
+		double det = vector_G_to_E[0]*vector_E_to_P[1] - vector_G_to_E[1]*vector_E_to_P[0];
+		double cosine = inner_prod(vector_P_to_E, vector_P_to_G)/(norm_2(vector_P_to_E)*norm_2(vector_P_to_G));
+
+		if (det > 0.0 && cosine < smallest_cosine_a)
+		{
+			smallest_cosine_a = cosine;
+			other_index_a = *iter;
+		}
+		else if (det < 0.0 && cosine < smallest_cosine_c)
+		{
+			smallest_cosine_c = cosine;
+			other_index_c = *iter;
+		}
+	}
+
+	// With nothing on one side, this epithelial node is at an end of the layer, as with a single common element
+	if (other_index_a == UINT_MAX || other_index_c == UINT_MAX)
+	{
+		return 0.0;
+	}
+
+	c_vector<double, 2> spring_midpoint_a = GetSpringMidpoint(rCellPopulation, epithelialNodeIndex, gelNodeIndex, other_index_a);
+	c_vector<double, 2> spring_midpoint_b = r_epithelial_location - 0.5*vector_G_to_E;
+	c_vector<double, 2> spring_midpoint_c = GetSpringMidpoint(rCellPopulation, epithelialNodeIndex, gelNodeIndex, other_index_c);
+
+	double curvature = FindParametricCurvature(rCellPopulation, spring_midpoint_a, spring_midpoint_b, spring_midpoint_c);
+
+	//Subtract the target curvature
+	if (mpTargetCurvatureField)
+	{
+		curvature -= mpTargetCurvatureField->GetTargetCurvature(r_epithelial_location[1]);
+	}
+	else
+	{
+		curvature -= mTargetCurvature;
+	}
+
+	assert(!isnan(curvature));
+	return curvature;
+}
+
 //Method overriding the virtual method for AbstractForce. The crux of what really needs to be done.
 void EpithelialLayerBasementMembraneForce::AddForceContribution(AbstractCellPopulation<2>& rCellPopulation)
 {
-	MeshBasedCellPopulation<2>* p_tissue = static_cast<MeshBasedCellPopulation<2>*>(&rCellPopulation);
+	// With no mesh the pairs are found by distance, and change as the cells move, so aren't cached
+	bool is_node_based = (dynamic_cast<NodeBasedCellPopulation<2>*>(&rCellPopulation) != NULL);
+	std::vector<c_vector<unsigned, 2> > node_based_pairs;
+	if (is_node_based)
+	{
+		node_based_pairs = GetEpithelialGelPairsByRadius(rCellPopulation);
+	}
 
 	// First determine the force acting on each epithelial cell due to the basement membrane
 	// Start by identifying the epithelial-gel node pairs (now also returns any apc2hit-gel pairs)
-	std::vector<c_vector<unsigned, 2> > node_pairs = GetEpithelialGelPairs(rCellPopulation);
+	const std::vector<c_vector<unsigned, 2> >& node_pairs = is_node_based ? node_based_pairs : rGetCachedEpithelialGelPairs(rCellPopulation);
 
 	// We loop over the epithelial-gel node pairs to find the force acting on that
 	// epithelial node, and the direction in which it acts
@@ -606,17 +855,17 @@ void EpithelialLayerBasementMembraneForce::AddForceContribution(AbstractCellPopu
 		unsigned epithelial_node_index = node_pairs[i][0];
 		unsigned gel_node_index = node_pairs[i][1];
 
-   		CellPtr p_cell_epithelial = p_tissue->GetCellUsingLocationIndex(epithelial_node_index);
+   		CellPtr p_cell_epithelial = rCellPopulation.GetCellUsingLocationIndex(epithelial_node_index);
    		assert(p_cell_epithelial->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>() == false);
 
-		CellPtr p_cell_gel = p_tissue->GetCellUsingLocationIndex(gel_node_index);
+		CellPtr p_cell_gel = rCellPopulation.GetCellUsingLocationIndex(gel_node_index);
 		assert(p_cell_gel->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>() == true);
 
 		c_vector<double, 2> epithelial_location = rCellPopulation.GetNode(epithelial_node_index)->rGetLocation();
 		c_vector<double, 2> gel_location = rCellPopulation.GetNode(gel_node_index)->rGetLocation();
 
 		// The force due to the basal lamina acts along the spring connecting the epithelial and gel nodes, G->E direction
-		c_vector<double, 2> curvature_force_direction = p_tissue->rGetMesh().GetVectorFromAtoB(gel_location, epithelial_location);
+		c_vector<double, 2> curvature_force_direction = rCellPopulation.rGetMesh().GetVectorFromAtoB(gel_location, epithelial_location);
 
 		double distance_between_nodes = norm_2(curvature_force_direction);
 		assert(distance_between_nodes > 0);
@@ -624,7 +873,8 @@ void EpithelialLayerBasementMembraneForce::AddForceContribution(AbstractCellPopu
 
 		curvature_force_direction /= distance_between_nodes;
 
-		double curvature = GetCurvatureFromNodePair(rCellPopulation, epithelial_node_index, gel_node_index);
+		double curvature = is_node_based ? GetCurvatureFromNodePairByRadius(rCellPopulation, epithelial_node_index, gel_node_index)
+										 : GetCurvatureFromNodePair(rCellPopulation, epithelial_node_index, gel_node_index);
 		//std::cout << "curvature: " << curvature << std::endl;
 		//std::cout << "Node: " << epithelial_node_index << std::endl;
 
@@ -642,6 +892,7 @@ void EpithelialLayerBasementMembraneForce::OutputForceParameters(out_stream& rPa
 {
 	*rParamsFile <<  "\t\t\t<BasementMembraneParameter>"<<  mBasementMembraneParameter << "</BasementMembraneParameter> \n";
 	*rParamsFile <<  "\t\t\t<TargetCurvature>"<< mTargetCurvature << "</TargetCurvature> \n";
+	*rParamsFile <<  "\t\t\t<GelNeighbourRadius>"<< mGelNeighbourRadius << "</GelNeighbourRadius> \n";
 
 	// Call direct parent class
 	AbstractForce<2>::OutputForceParameters(rParamsFile);
@@ -3,12 +3,15 @@
 
 #include "ChasteSerialization.hpp"
 #include <boost/serialization/base_object.hpp>
+#include <boost/serialization/shared_ptr.hpp>
 
 #include "AbstractForce.hpp"
 #include "MeshBasedCellPopulation.hpp"
+#include "NodeBasedCellPopulation.hpp"
 #include "DifferentiatedCellProliferativeType.hpp"
 #include "TransitCellProliferativeType.hpp"
 #include "StemCellProliferativeType.hpp"
+#include "TargetCurvatureField.hpp"
 
 #include <cmath>
 #include <list>
@@ -16,6 +19,10 @@
 
 /**
  * A force class that defines the force due to the basement membrane.
+ *
+ * Works with a MeshBasedCellPopulation, where the epithelial-gel springs are the Delaunay edges,
+ * or with a NodeBasedCellPopulation, where each epithelial cell is paired with the gel cells
+ * within mGelNeighbourRadius (see GetEpithelialGelPairsByRadius()).
  */
 
 class EpithelialLayerBasementMembraneForce : public AbstractForce<2>
@@ -30,6 +37,21 @@ private :
     /** Target curvature for the layer of cells */
     double mTargetCurvature;
 
+    /* If set, the target curvature at the height of each epithelial node, used instead of mTargetCurvature */
+    boost::shared_ptr<TargetCurvatureField> mpTargetCurvatureField;
+
+    /* The epithelial-gel pairs found last time, and the population and topology version they were found for.
+     * Only reused with a CryptCellPopulationWithGhostNodes, which says when and where its mesh has changed.
+     */
+    std::vector<c_vector<unsigned, 2> > mCachedNodePairs;
+    AbstractCellPopulation<2>* mpCachedPairsPopulation;
+    unsigned mCachedPairsTopologyVersion;
+
+    /* How far apart an epithelial cell and a gel cell can be and still be paired in a NodeBasedCellPopulation.
+     * It should be no more than the population's interaction distance.
+     */
+    double mGelNeighbourRadius;
+
     /** Needed for serialization. */
     friend class boost::serialization::access;
     /**
@@ -46,6 +68,8 @@ private :
         archive & boost::serialization::base_object<AbstractForce<2> >(*this);
         archive & mBasementMembraneParameter;
         archive & mTargetCurvature;
+        archive & mpTargetCurvatureField;
+        archive & mGelNeighbourRadius;
     }
 
 public :
@@ -76,6 +100,11 @@ public :
      */
     double GetTargetCurvature();
 
+    /* Take the target curvature from a field over height, e.g. to only curve the crypt base */
+    void SetTargetCurvatureField(boost::shared_ptr<TargetCurvatureField> pTargetCurvatureField);
+
+    boost::shared_ptr<TargetCurvatureField> GetTargetCurvatureField();
+
     /* Removing duplicated entries of a vector
      */
     void RemoveDuplicates1D(std::vector<unsigned>& rVectorWithDuplicates);
@@ -88,6 +117,15 @@ public :
      */
     std::vector<c_vector<unsigned, 2> > GetEpithelialGelPairs(AbstractCellPopulation<2>& rCellPopulation);
 
+    /* Add the pairs for a single epithelial node to rNodePairs
+     */
+    void AddEpithelialGelPairsForNode(AbstractCellPopulation<2>& rCellPopulation, unsigned nodeIndex,
+    		std::vector<c_vector<unsigned, 2> >& rNodePairs);
+
+    /* As GetEpithelialGelPairs(), but only redone where the mesh has changed
+     */
+    const std::vector<c_vector<unsigned, 2> >& rGetCachedEpithelialGelPairs(AbstractCellPopulation<2>& rCellPopulation);
+
     /* Takes an epithelial node index and a tissue node index and returns the curvature of
      * the curve passing through the midpoints of the epithelial-tissue springs of the
      * common elements
@@ -100,25 +138,20 @@ public :
      * to the vector joining the left and right midpoints, and then find the perpendicular distance of
      * the centre midpoint from the left->right vector
      */
-    double GetCurvatureFromMidpoints(AbstractCellPopulation<2>& rCellPopulation, c_vector<double, 2> leftMidpoint,
-    														c_vector<double, 2> centreMidpoint,
-    														c_vector<double, 2> rightMidpoint);
+    double GetCurvatureFromMidpoints(AbstractCellPopulation<2>& rCellPopulation, const c_vector<double, 2>& leftMidpoint,
+    														const c_vector<double, 2>& centreMidpoint,
+    														const c_vector<double, 2>& rightMidpoint);
 
     double FindParametricCurvature(AbstractCellPopulation<2>& rCellPopulation,
-    								c_vector<double, 2> leftMidpoint,
-									c_vector<double, 2> centreMidpoint,
-									c_vector<double, 2> rightMidpoint);
+    								const c_vector<double, 2>& leftMidpoint,
+									const c_vector<double, 2>& centreMidpoint,
+									const c_vector<double, 2>& rightMidpoint);
 
     /* Finding the number of elements that a node belongs to, which contain only real nodes
      * and not ghost nodes
      */
     unsigned GetNumContainingElementsWithoutGhostNodes(AbstractCellPopulation<2>& rCellPopulation, unsigned nodeIndex);
 
-    /* Finding the y-coordinates of the crypt orifice and crypt base
-     * The first entry of the resulting vector is the orifice, the second is the base
-     */
-//    c_vector<double,2> GetCryptHeightExtremes(AbstractCellPopulation<2>& rCellPopulation);
-
     /*
      * Method to return the nodes connected to a particular node via the Delaunay
      * triangulation, excluding ghost nodes.
@@ -129,6 +162,32 @@ public :
      */
     bool HasEpithelialCellDetachedFromBasementMembrane(AbstractCellPopulation<2>& rCellPopulation, unsigned nodeIndex);
 
+    void SetGelNeighbourRadius(double gelNeighbourRadius);
+
+    double GetGelNeighbourRadius();
+
+    /* The cells within mGelNeighbourRadius of a node, for a population with no mesh
+     */
+    std::set<unsigned> GetNeighbouringNodeIndicesByRadius(AbstractCellPopulation<2>& rCellPopulation, unsigned nodeIndex);
+
+    /* As GetEpithelialGelPairs(), for a population with no mesh. Each epithelial node is paired with
+     * every gel node within mGelNeighbourRadius.
+     */
+    std::vector<c_vector<unsigned, 2> > GetEpithelialGelPairsByRadius(AbstractCellPopulation<2>& rCellPopulation);
+
+    /* As GetCurvatureFromNodePair(), for a population with no mesh. On each side of the pair, the third node
+     * of the Delaunay element would be the common neighbour that sees the pair at the widest angle, so that
+     * node is used, and the spring midpoints are the ones the mesh would give.
+     */
+    double GetCurvatureFromNodePairByRadius(AbstractCellPopulation<2>& rCellPopulation, unsigned epithelialNodeIndex,
+    		unsigned gelNodeIndex);
+
+    /* The midpoint of the spring from the third node of an element to the gel node if the third node
+     * is epithelial, or from the epithelial node to the third node if it is gel
+     */
+    c_vector<double, 2> GetSpringMidpoint(AbstractCellPopulation<2>& rCellPopulation, unsigned epithelialNodeIndex,
+    		unsigned gelNodeIndex, unsigned otherNodeIndex);
+
     /**
      * Overridden AddForceContribution method.
      *
@@ -1,6 +1,5 @@
 #include "EpithelialLayerBasementMembraneForceModified.hpp"
 #include "AbstractCellProperty.hpp"
-#include "Debug.hpp"
 
 /*
  * Created on: 21/12/2014
@@ -137,12 +136,8 @@ std::vector<c_vector<unsigned, 2> > EpithelialLayerBasementMembraneForceModified
 			}
 		}
 
-		if (!has_common_element)
-		{
-			TRACE("No common element between:");
-			PRINT_2_VARIABLES(node_index,gel_node_index);
-		}
 		assert(has_common_element);
+		UNUSED_OPT(has_common_element);
 	}
 	return node_pairs;
 }
@@ -473,9 +468,9 @@ double EpithelialLayerBasementMembraneForceModified::GetCurvatureFromNodePair(Ab
  */
 
 double EpithelialLayerBasementMembraneForceModified::GetCurvatureFromMidpoints(AbstractCellPopulation<2>& rCellPopulation,
-																c_vector<double, 2> leftMidpoint,
-																c_vector<double, 2> centreMidpoint,
-																c_vector<double, 2> rightMidpoint)
+																const c_vector<double, 2>& leftMidpoint,
+																const c_vector<double, 2>& centreMidpoint,
+																const c_vector<double, 2>& rightMidpoint)
 {
 	MeshBasedCellPopulation<2>* p_tissue = static_cast<MeshBasedCellPopulation<2>*>(&rCellPopulation);
 
@@ -500,9 +495,9 @@ double EpithelialLayerBasementMembraneForceModified::GetCurvatureFromMidpoints(A
 */
 
 double EpithelialLayerBasementMembraneForceModified::FindParametricCurvature(AbstractCellPopulation<2>& rCellPopulation,
-															c_vector<double, 2> leftMidpoint,
-															c_vector<double, 2> centreMidpoint,
-															c_vector<double, 2> rightMidpoint)
+															const c_vector<double, 2>& leftMidpoint,
+															const c_vector<double, 2>& centreMidpoint,
+															const c_vector<double, 2>& rightMidpoint)
 {
 	//Get the relevant vectors (all possible differences)
 	c_vector<double, 2> left_to_centre = rCellPopulation.rGetMesh().GetVectorFromAtoB(leftMidpoint, centreMidpoint);
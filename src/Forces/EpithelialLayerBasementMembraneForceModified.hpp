@@ -103,25 +103,20 @@ public :
      * to the vector joining the left and right midpoints, and then find the perpendicular distance of
      * the centre midpoint from the left->right vector
      */
-    double GetCurvatureFromMidpoints(AbstractCellPopulation<2>& rCellPopulation, c_vector<double, 2> leftMidpoint,
-    														c_vector<double, 2> centreMidpoint,
-    														c_vector<double, 2> rightMidpoint);
+    double GetCurvatureFromMidpoints(AbstractCellPopulation<2>& rCellPopulation, const c_vector<double, 2>& leftMidpoint,
+    														const c_vector<double, 2>& centreMidpoint,
+    														const c_vector<double, 2>& rightMidpoint);
 
     double FindParametricCurvature(AbstractCellPopulation<2>& rCellPopulation,
-    								c_vector<double, 2> leftMidpoint,
-									c_vector<double, 2> centreMidpoint,
-									c_vector<double, 2> rightMidpoint);
+    								const c_vector<double, 2>& leftMidpoint,
+									const c_vector<double, 2>& centreMidpoint,
+									const c_vector<double, 2>& rightMidpoint);
 
     /* Finding the number of elements that a node belongs to, which contain only real nodes
      * and not ghost nodes
      */
     unsigned GetNumContainingElementsWithoutGhostNodes(AbstractCellPopulation<2>& rCellPopulation, unsigned nodeIndex);
 
-    /* Finding the y-coordinates of the crypt orifice and crypt base
-     * The first entry of the resulting vector is the orifice, the second is the base
-     */
-//    c_vector<double,2> GetCryptHeightExtremes(AbstractCellPopulation<2>& rCellPopulation);
-
     /*
      * Method to return the nodes connected to a particular node via the Delaunay
      * triangulation, excluding ghost nodes.
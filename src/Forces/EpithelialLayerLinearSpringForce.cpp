@@ -38,6 +38,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "AbstractCellProperty.hpp"
 
 #include "PanethCellMutationState.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+#include "CryptSpringRestLength.hpp"
 
 template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
 EpithelialLayerLinearSpringForce<ELEMENT_DIM,SPACE_DIM>::EpithelialLayerLinearSpringForce()
@@ -144,34 +146,13 @@ c_vector<double, SPACE_DIM> EpithelialLayerLinearSpringForce<ELEMENT_DIM,SPACE_D
     CellPtr p_cell_A = rCellPopulation.GetCellUsingLocationIndex(nodeAGlobalIndex);
     CellPtr p_cell_B = rCellPopulation.GetCellUsingLocationIndex(nodeBGlobalIndex);
 
-    double ageA = p_cell_A->GetAge();
-    double ageB = p_cell_B->GetAge();
+    // The crypt population works out the types of its cells once per time step
+    CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(&rCellPopulation);
+    const CryptCellAttributes* p_attributes = p_crypt_population ? &(p_crypt_population->rGetCellAttributes()) : NULL;
 
-    assert(!std::isnan(ageA));
-    assert(!std::isnan(ageB));
-
-    /*
-     * If the cells are both newly divided, then the rest length of the spring
-     * connecting them grows linearly with time, until 1 hour after division.
-     */
-    if (ageA < mMeinekeSpringGrowthDuration && ageB < mMeinekeSpringGrowthDuration)
-    {
-        AbstractCentreBasedCellPopulation<ELEMENT_DIM,SPACE_DIM>* p_static_cast_cell_population = static_cast<AbstractCentreBasedCellPopulation<ELEMENT_DIM,SPACE_DIM>*>(&rCellPopulation);
-
-        std::pair<CellPtr,CellPtr> cell_pair = p_static_cast_cell_population->CreateCellPair(p_cell_A, p_cell_B);
-
-        if (p_static_cast_cell_population->IsMarkedSpring(cell_pair))
-        {
-            // Spring rest length increases from a small value to the normal rest length over 1 hour
-            double lambda = mMeinekeDivisionRestingSpringLength;
-            rest_length = lambda + (rest_length_final - lambda) * ageA/mMeinekeSpringGrowthDuration;
-        }
-        if (ageA + SimulationTime::Instance()->GetTimeStep() >= mMeinekeSpringGrowthDuration)
-        {
-            // This spring is about to go out of scope
-            p_static_cast_cell_population->UnmarkSpring(cell_pair);
-        }
-    }
+    // Newly divided cells start off closer together
+    rest_length = CryptSpringRestLength<ELEMENT_DIM,SPACE_DIM>::GetRestLengthAfterDivision(rCellPopulation, nodeAGlobalIndex, nodeBGlobalIndex, rest_length,
+                                                                                          mMeinekeDivisionRestingSpringLength, mMeinekeSpringGrowthDuration);
 
     /*
      * For apoptosis, progressively reduce the radius of the cell
@@ -190,23 +171,27 @@ c_vector<double, SPACE_DIM> EpithelialLayerLinearSpringForce<ELEMENT_DIM,SPACE_D
      * If either of the cells has begun apoptosis, then the length of the spring
      * connecting them decreases linearly with time.
      */
-    if (p_cell_A->HasApoptosisBegun())
-    {
-        double time_until_death_a = p_cell_A->GetTimeUntilDeath();
-        a_rest_length = a_rest_length * time_until_death_a / p_cell_A->GetApoptosisTime();
-    }
-    if (p_cell_B->HasApoptosisBegun())
-    {
-    	double time_until_death_b = p_cell_B->GetTimeUntilDeath();
-    	b_rest_length = b_rest_length * time_until_death_b / p_cell_B->GetApoptosisTime();
-    }
+    CryptSpringRestLength<ELEMENT_DIM,SPACE_DIM>::ApplyApoptosis(rCellPopulation, nodeAGlobalIndex, nodeBGlobalIndex, a_rest_length, b_rest_length);
 
     rest_length = a_rest_length + b_rest_length;
     //assert(rest_length <= 1.0+1e-12); ///\todo #1884 Magic number: would "<= 1.0" do?
 
-    //Checks if A and B are proliferative or differentiated cells.
-    bool typeA = p_cell_A->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
-    bool typeB = p_cell_B->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
+    //Checks if A and B are proliferative or differentiated cells, and whether they are Paneth cells.
+    bool typeA, typeB, panethA, panethB;
+    if (p_attributes)
+    {
+        typeA = (p_attributes->GetCellClass(nodeAGlobalIndex) == CryptCellAttributes::STROMAL_CELL);
+        typeB = (p_attributes->GetCellClass(nodeBGlobalIndex) == CryptCellAttributes::STROMAL_CELL);
+        panethA = p_attributes->HasProperty<PanethCellMutationState>(nodeAGlobalIndex);
+        panethB = p_attributes->HasProperty<PanethCellMutationState>(nodeBGlobalIndex);
+    }
+    else
+    {
+        typeA = p_cell_A->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
+        typeB = p_cell_B->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
+        panethA = p_cell_A->GetMutationState()->IsType<PanethCellMutationState>();
+        panethB = p_cell_B->GetMutationState()->IsType<PanethCellMutationState>();
+    }
 	double overlap = distance_between_nodes - rest_length;
 	bool is_closer_than_rest_length = (overlap <= 0);
 	double multiplication_factor = VariableSpringConstantMultiplicationFactor(nodeAGlobalIndex, nodeBGlobalIndex, rCellPopulation, is_closer_than_rest_length);
@@ -218,7 +203,7 @@ c_vector<double, SPACE_DIM> EpithelialLayerLinearSpringForce<ELEMENT_DIM,SPACE_D
     	double epithelial_epithelial_spring_stiffness = mEpithelialEpithelialSpringStiffness;
 
     	//If one of the cells is a paneth cell
-    	if( (p_cell_A->GetMutationState()->IsType<PanethCellMutationState>())||(p_cell_B->GetMutationState()->IsType<PanethCellMutationState>()) )
+    	if (panethA || panethB)
     	{
         	epithelial_epithelial_spring_stiffness *= mPanethCellStiffnessRatio;
     	}
@@ -279,12 +264,12 @@ c_vector<double, SPACE_DIM> EpithelialLayerLinearSpringForce<ELEMENT_DIM,SPACE_D
     	double epithelial_nonepithelial_spring_stiffness = mEpithelialNonepithelialSpringStiffness;
 
     	//If the cell is a Paneth cell (either A or B)
-    	if(p_cell_A->GetMutationState()->IsType<PanethCellMutationState>())
+    	if (panethA)
     	{
     		epithelial_nonepithelial_spring_stiffness *= mPanethCellStiffnessRatio;
 
     	}
-    	else if (p_cell_B->GetMutationState()->IsType<PanethCellMutationState>())
+    	else if (panethB)
     	{
     		epithelial_nonepithelial_spring_stiffness *= mPanethCellStiffnessRatio;
     	}
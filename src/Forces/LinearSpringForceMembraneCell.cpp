@@ -42,6 +42,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "MembraneCellProliferativeType.hpp"
 #include "TransitCellProliferativeType.hpp"
 #include "StemCellProliferativeType.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+#include "CryptSpringRestLength.hpp"
 
 template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
 LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>::LinearSpringForceMembraneCell()
@@ -70,10 +72,79 @@ LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>::~LinearSpringForceMembrane
 {
 }
 
+template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
+void LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>::SetMembraneBondGraph(boost::shared_ptr<MembraneBondGraph> pMembraneBondGraph)
+{
+    mpMembraneBondGraph = pMembraneBondGraph;
+}
+
+template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
+boost::shared_ptr<MembraneBondGraph> LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>::GetMembraneBondGraph()
+{
+    return mpMembraneBondGraph;
+}
+
+template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
+void LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>::AddForceContribution(AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation)
+{
+    AbstractTwoBodyInteractionForce<ELEMENT_DIM,SPACE_DIM>::AddForceContribution(rCellPopulation);
+    AddBondForceContribution(rCellPopulation);
+}
+
+template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
+void LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>::AddBondForceContribution(AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation)
+{
+    if (!mpMembraneBondGraph || mpMembraneBondGraph->GetNumCells() == 0)
+    {
+        return;
+    }
+
+    // The dead cells have already gone from the population, so drop them (and join up their neighbours) first
+    mpMembraneBondGraph->RemoveDeadCells();
+
+    const std::vector<unsigned>& r_cell_ids = mpMembraneBondGraph->rGetCellIds();
+    for (unsigned i=0; i<r_cell_ids.size(); i++)
+    {
+        unsigned next_id = mpMembraneBondGraph->GetNext(r_cell_ids[i]);
+        if (next_id != MembraneBondGraph::NO_CELL)
+        {
+            unsigned node_a_index = rCellPopulation.GetLocationIndexUsingCell(mpMembraneBondGraph->GetCell(r_cell_ids[i]));
+            unsigned node_b_index = rCellPopulation.GetLocationIndexUsingCell(mpMembraneBondGraph->GetCell(next_id));
+
+            // A bond holds however far apart its cells get, so the cut-off length does not apply
+            c_vector<double, SPACE_DIM> force = CalculateSpringForce(node_a_index, node_b_index, rCellPopulation, false);
+            rCellPopulation.GetNode(node_a_index)->AddAppliedForceContribution(force);
+            c_vector<double, SPACE_DIM> negative_force = -1.0*force;
+            rCellPopulation.GetNode(node_b_index)->AddAppliedForceContribution(negative_force);
+        }
+    }
+}
+
 template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
 c_vector<double, SPACE_DIM> LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>::CalculateForceBetweenNodes(unsigned nodeAGlobalIndex,
                                                                                     unsigned nodeBGlobalIndex,
                                                                                     AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation)
+{
+    // The springs between membrane cells come from the bond graph, whichever membrane cells the mesh happens to join
+    if (mpMembraneBondGraph && mpMembraneBondGraph->GetNumCells() > 0)
+    {
+        CellPtr p_cell_A = rCellPopulation.GetCellUsingLocationIndex(nodeAGlobalIndex);
+        CellPtr p_cell_B = rCellPopulation.GetCellUsingLocationIndex(nodeBGlobalIndex);
+        if (p_cell_A->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>()
+            && p_cell_B->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>())
+        {
+            return zero_vector<double>(SPACE_DIM);
+        }
+    }
+
+    return CalculateSpringForce(nodeAGlobalIndex, nodeBGlobalIndex, rCellPopulation, this->mUseCutOffLength);
+}
+
+template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
+c_vector<double, SPACE_DIM> LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>::CalculateSpringForce(unsigned nodeAGlobalIndex,
+                                                                                    unsigned nodeBGlobalIndex,
+                                                                                    AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation,
+                                                                                    bool useCutOffLength)
 {
     // We should only ever calculate the force between two distinct nodes
     assert(nodeAGlobalIndex != nodeBGlobalIndex);
@@ -113,10 +184,10 @@ c_vector<double, SPACE_DIM> LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>
     unitForceDirection /= distance_between_nodes;
 
     /*
-     * If mUseCutOffLength has been set, then there is zero force between
+     * If useCutOffLength is set, then there is zero force between
      * two nodes located a distance apart greater than mMechanicsCutOffLength in AbstractTwoBodyInteractionForce.
      */
-    if (this->mUseCutOffLength)
+    if (useCutOffLength)
     {
         if (distance_between_nodes >= this->GetCutOffLength())
         {
@@ -145,34 +216,13 @@ c_vector<double, SPACE_DIM> LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>
     CellPtr p_cell_A = rCellPopulation.GetCellUsingLocationIndex(nodeAGlobalIndex);
     CellPtr p_cell_B = rCellPopulation.GetCellUsingLocationIndex(nodeBGlobalIndex);
 
-    double ageA = p_cell_A->GetAge();
-    double ageB = p_cell_B->GetAge();
-
-    assert(!std::isnan(ageA));
-    assert(!std::isnan(ageB));
+    // The crypt population works out the types of its cells once per time step
+    CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(&rCellPopulation);
+    const CryptCellAttributes* p_attributes = p_crypt_population ? &(p_crypt_population->rGetCellAttributes()) : NULL;
 
-    /*
-     * If the cells are both newly divided, then the rest length of the spring
-     * connecting them grows linearly with time, until 1 hour after division.
-     */
-    if (ageA < mMeinekeSpringGrowthDuration && ageB < mMeinekeSpringGrowthDuration)
-    {
-        AbstractCentreBasedCellPopulation<ELEMENT_DIM,SPACE_DIM>* p_static_cast_cell_population = static_cast<AbstractCentreBasedCellPopulation<ELEMENT_DIM,SPACE_DIM>*>(&rCellPopulation);
-
-        std::pair<CellPtr,CellPtr> cell_pair = p_static_cast_cell_population->CreateCellPair(p_cell_A, p_cell_B);
-
-        if (p_static_cast_cell_population->IsMarkedSpring(cell_pair))
-        {
-            // Spring rest length increases from a small value to the normal rest length over 1 hour
-            double lambda = mMeinekeDivisionRestingSpringLength;
-            rest_length = lambda + (rest_length_final - lambda) * ageA/mMeinekeSpringGrowthDuration;
-        }
-        if (ageA + SimulationTime::Instance()->GetTimeStep() >= mMeinekeSpringGrowthDuration)
-        {
-            // This spring is about to go out of scope
-            p_static_cast_cell_population->UnmarkSpring(cell_pair);
-        }
-    }
+    // Newly divided cells start off closer together
+    rest_length = CryptSpringRestLength<ELEMENT_DIM,SPACE_DIM>::GetRestLengthAfterDivision(rCellPopulation, nodeAGlobalIndex, nodeBGlobalIndex, rest_length,
+                                                                                          mMeinekeDivisionRestingSpringLength, mMeinekeSpringGrowthDuration);
 
     /*
      * For apoptosis, progressively reduce the radius of the cell
@@ -191,16 +241,7 @@ c_vector<double, SPACE_DIM> LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>
      * If either of the cells has begun apoptosis, then the length of the spring
      * connecting them decreases linearly with time.
      */
-    if (p_cell_A->HasApoptosisBegun())
-    {
-        double time_until_death_a = p_cell_A->GetTimeUntilDeath();
-        a_rest_length = a_rest_length * time_until_death_a / p_cell_A->GetApoptosisTime();
-    }
-    if (p_cell_B->HasApoptosisBegun())
-    {
-        double time_until_death_b = p_cell_B->GetTimeUntilDeath();
-        b_rest_length = b_rest_length * time_until_death_b / p_cell_B->GetApoptosisTime();
-    }
+    CryptSpringRestLength<ELEMENT_DIM,SPACE_DIM>::ApplyApoptosis(rCellPopulation, nodeAGlobalIndex, nodeBGlobalIndex, a_rest_length, b_rest_length);
 
     rest_length = a_rest_length + b_rest_length;
     //assert(rest_length <= 1.0+1e-12); ///\todo #1884 Magic number: would "<= 1.0" do?
@@ -217,14 +258,32 @@ c_vector<double, SPACE_DIM> LinearSpringForceMembraneCell<ELEMENT_DIM,SPACE_DIM>
 
     // First, determine what we've got
 
-    bool membraneA = p_cell_A->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>();
-    bool membraneB = p_cell_B->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>();
+    bool membraneA, membraneB, stromalA, stromalB, epiA, epiB;
+    if (p_attributes)
+    {
+        CryptCellAttributes::CellClass class_a = p_attributes->GetCellClass(nodeAGlobalIndex);
+        CryptCellAttributes::CellClass class_b = p_attributes->GetCellClass(nodeBGlobalIndex);
+
+        membraneA = (class_a == CryptCellAttributes::MEMBRANE_CELL);
+        membraneB = (class_b == CryptCellAttributes::MEMBRANE_CELL);
 
-    bool stromalA = p_cell_A->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
-    bool stromalB = p_cell_B->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
+        stromalA = (class_a == CryptCellAttributes::STROMAL_CELL);
+        stromalB = (class_b == CryptCellAttributes::STROMAL_CELL);
 
-    bool epiA = ( p_cell_A->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || p_cell_A->GetCellProliferativeType()->IsType<StemCellProliferativeType>() );
-    bool epiB = ( p_cell_B->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || p_cell_B->GetCellProliferativeType()->IsType<StemCellProliferativeType>() );
+        epiA = (class_a == CryptCellAttributes::EPITHELIAL_CELL);
+        epiB = (class_b == CryptCellAttributes::EPITHELIAL_CELL);
+    }
+    else
+    {
+        membraneA = p_cell_A->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>();
+        membraneB = p_cell_B->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>();
+
+        stromalA = p_cell_A->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
+        stromalB = p_cell_B->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
+
+        epiA = ( p_cell_A->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || p_cell_A->GetCellProliferativeType()->IsType<StemCellProliferativeType>() );
+        epiB = ( p_cell_B->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || p_cell_B->GetCellProliferativeType()->IsType<StemCellProliferativeType>() );
+    }
 
     // Next go through the combinations
     // This lacks any error catching
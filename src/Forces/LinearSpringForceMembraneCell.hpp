@@ -43,9 +43,11 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "AbstractTwoBodyInteractionForce.hpp"
 #include "DifferentiatedCellProliferativeType.hpp"
+#include "MembraneBondGraph.hpp"
 
 #include "ChasteSerialization.hpp"
 #include <boost/serialization/base_object.hpp>
+#include <boost/serialization/shared_ptr.hpp>
 
 /**
  * A force law initially employed by Meineke et al (2001) in their off-lattice
@@ -95,6 +97,7 @@ private:
         archive & mMeinekeDivisionRestingSpringLength;
         archive & mMeinekeSpringGrowthDuration;
         archive & mPanethCellStiffnessRatio;
+        archive & mpMembraneBondGraph;
     }
 
 protected:
@@ -132,6 +135,22 @@ protected:
 
     double mPanethCellStiffnessRatio;
 
+    /*
+     * If set (and not empty), the springs between membrane cells are the bonds in this graph
+     * rather than the edges of the mesh, and are shared with MembraneCellForce
+     */
+    boost::shared_ptr<MembraneBondGraph> mpMembraneBondGraph;
+
+    /*
+     * The spring force on node A from node B, whether or not they are neighbours in the mesh.
+     * CalculateForceBetweenNodes() uses this for every pair except two membrane cells when there is a bond graph,
+     * with the cut-off length if one has been set; the bonds of the graph ignore it.
+     */
+    c_vector<double, SPACE_DIM> CalculateSpringForce(unsigned nodeAGlobalIndex,
+                                                     unsigned nodeBGlobalIndex,
+                                                     AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation,
+                                                     bool useCutOffLength);
+
 public:
 
     /**
@@ -168,6 +187,8 @@ public:
      * Calculates the force between two nodes.
      *
      * Note that this assumes they are connected and is called by AddForceContribution()
+     * With a bond graph, the force between two membrane cells is zero here, as their springs
+     * are added from the graph instead.
      *
      * @param nodeAGlobalIndex index of one neighbouring node
      * @param nodeBGlobalIndex index of the other neighbouring node
@@ -219,6 +240,23 @@ public:
      */
     void SetPanethCellStiffnessRatio(double panethCellStiffnessRatio);
 
+    /* Take the springs between membrane cells from a bond graph rather than from the mesh */
+    void SetMembraneBondGraph(boost::shared_ptr<MembraneBondGraph> pMembraneBondGraph);
+
+    boost::shared_ptr<MembraneBondGraph> GetMembraneBondGraph();
+
+    /**
+     * Overridden AddForceContribution() method.
+     *
+     * As the parent class, then adds the springs along the bonds of mpMembraneBondGraph if there is one.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void AddForceContribution(AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation);
+
+    /* Add just the springs along the bonds of mpMembraneBondGraph, if there is one */
+    void AddBondForceContribution(AbstractCellPopulation<ELEMENT_DIM,SPACE_DIM>& rCellPopulation);
+
     /**
      * Overridden OutputForceParameters() method.
      *
@@ -42,6 +42,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "MembraneCellProliferativeType.hpp"
 #include "TransitCellProliferativeType.hpp"
 #include "StemCellProliferativeType.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+#include "CryptSpringRestLength.hpp"
 
 template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
 LinearTest<ELEMENT_DIM,SPACE_DIM>::LinearTest()
@@ -145,34 +147,13 @@ c_vector<double, SPACE_DIM> LinearTest<ELEMENT_DIM,SPACE_DIM>::CalculateForceBet
     CellPtr p_cell_A = rCellPopulation.GetCellUsingLocationIndex(nodeAGlobalIndex);
     CellPtr p_cell_B = rCellPopulation.GetCellUsingLocationIndex(nodeBGlobalIndex);
 
-    double ageA = p_cell_A->GetAge();
-    double ageB = p_cell_B->GetAge();
+    // The crypt population works out the types of its cells once per time step
+    CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(&rCellPopulation);
+    const CryptCellAttributes* p_attributes = p_crypt_population ? &(p_crypt_population->rGetCellAttributes()) : NULL;
 
-    assert(!std::isnan(ageA));
-    assert(!std::isnan(ageB));
-
-    /*
-     * If the cells are both newly divided, then the rest length of the spring
-     * connecting them grows linearly with time, until 1 hour after division.
-     */
-    if (ageA < mMeinekeSpringGrowthDuration && ageB < mMeinekeSpringGrowthDuration)
-    {
-        AbstractCentreBasedCellPopulation<ELEMENT_DIM,SPACE_DIM>* p_static_cast_cell_population = static_cast<AbstractCentreBasedCellPopulation<ELEMENT_DIM,SPACE_DIM>*>(&rCellPopulation);
-
-        std::pair<CellPtr,CellPtr> cell_pair = p_static_cast_cell_population->CreateCellPair(p_cell_A, p_cell_B);
-
-        if (p_static_cast_cell_population->IsMarkedSpring(cell_pair))
-        {
-            // Spring rest length increases from a small value to the normal rest length over 1 hour
-            double lambda = mMeinekeDivisionRestingSpringLength;
-            rest_length = lambda + (rest_length_final - lambda) * ageA/mMeinekeSpringGrowthDuration;
-        }
-        if (ageA + SimulationTime::Instance()->GetTimeStep() >= mMeinekeSpringGrowthDuration)
-        {
-            // This spring is about to go out of scope
-            p_static_cast_cell_population->UnmarkSpring(cell_pair);
-        }
-    }
+    // Newly divided cells start off closer together
+    rest_length = CryptSpringRestLength<ELEMENT_DIM,SPACE_DIM>::GetRestLengthAfterDivision(rCellPopulation, nodeAGlobalIndex, nodeBGlobalIndex, rest_length,
+                                                                                          mMeinekeDivisionRestingSpringLength, mMeinekeSpringGrowthDuration);
 
     /*
      * For apoptosis, progressively reduce the radius of the cell
@@ -191,16 +172,7 @@ c_vector<double, SPACE_DIM> LinearTest<ELEMENT_DIM,SPACE_DIM>::CalculateForceBet
      * If either of the cells has begun apoptosis, then the length of the spring
      * connecting them decreases linearly with time.
      */
-    if (p_cell_A->HasApoptosisBegun())
-    {
-        double time_until_death_a = p_cell_A->GetTimeUntilDeath();
-        a_rest_length = a_rest_length * time_until_death_a / p_cell_A->GetApoptosisTime();
-    }
-    if (p_cell_B->HasApoptosisBegun())
-    {
-        double time_until_death_b = p_cell_B->GetTimeUntilDeath();
-        b_rest_length = b_rest_length * time_until_death_b / p_cell_B->GetApoptosisTime();
-    }
+    CryptSpringRestLength<ELEMENT_DIM,SPACE_DIM>::ApplyApoptosis(rCellPopulation, nodeAGlobalIndex, nodeBGlobalIndex, a_rest_length, b_rest_length);
 
     rest_length = a_rest_length + b_rest_length;
     //assert(rest_length <= 1.0+1e-12); ///\todo #1884 Magic number: would "<= 1.0" do?
@@ -217,14 +189,32 @@ c_vector<double, SPACE_DIM> LinearTest<ELEMENT_DIM,SPACE_DIM>::CalculateForceBet
 
     // First, determine what we've got
 
-    bool membraneA = p_cell_A->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>();
-    bool membraneB = p_cell_B->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>();
+    bool membraneA, membraneB, stromalA, stromalB, epiA, epiB;
+    if (p_attributes)
+    {
+        CryptCellAttributes::CellClass class_a = p_attributes->GetCellClass(nodeAGlobalIndex);
+        CryptCellAttributes::CellClass class_b = p_attributes->GetCellClass(nodeBGlobalIndex);
+
+        membraneA = (class_a == CryptCellAttributes::MEMBRANE_CELL);
+        membraneB = (class_b == CryptCellAttributes::MEMBRANE_CELL);
 
-    bool stromalA = p_cell_A->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
-    bool stromalB = p_cell_B->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
+        stromalA = (class_a == CryptCellAttributes::STROMAL_CELL);
+        stromalB = (class_b == CryptCellAttributes::STROMAL_CELL);
 
-    bool epiA = ( p_cell_A->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || p_cell_A->GetCellProliferativeType()->IsType<StemCellProliferativeType>() );
-    bool epiB = ( p_cell_B->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || p_cell_B->GetCellProliferativeType()->IsType<StemCellProliferativeType>() );
+        epiA = (class_a == CryptCellAttributes::EPITHELIAL_CELL);
+        epiB = (class_b == CryptCellAttributes::EPITHELIAL_CELL);
+    }
+    else
+    {
+        membraneA = p_cell_A->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>();
+        membraneB = p_cell_B->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>();
+
+        stromalA = p_cell_A->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
+        stromalB = p_cell_B->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>();
+
+        epiA = ( p_cell_A->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || p_cell_A->GetCellProliferativeType()->IsType<StemCellProliferativeType>() );
+        epiB = ( p_cell_B->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || p_cell_B->GetCellProliferativeType()->IsType<StemCellProliferativeType>() );
+    }
 
     // Next go through the combinations
     // This lacks any error catching
@@ -1,7 +1,14 @@
 #include "MembraneCellForce.hpp"
 #include "AbstractCellProperty.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
 #include "Debug.hpp"
 
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <deque>
+#include <map>
+
 /*
  * Created by: PHILLIP BROWN, 27/10/2017
  * Initial Structure borrows heavily from "EpithelialLayerBasementMembraneForce.cpp"
@@ -17,7 +24,12 @@ MembraneCellForce::MembraneCellForce()
    mBasementMembraneTorsionalStiffness(5.0),
    mTargetCurvatureStemStem(DOUBLE_UNSET),
    mTargetCurvatureStemTrans(DOUBLE_UNSET),
-   mTargetCurvatureTransTrans(DOUBLE_UNSET)
+   mTargetCurvatureTransTrans(DOUBLE_UNSET),
+   mpCachedSectionsPopulation(NULL),
+   mCachedSectionsTopologyVersion(0),
+   mMembraneNeighbourRadius(1.0),
+   mCachedSectionsNumCells(0),
+   mCachedSectionsMaxCellId(0)
 {
 }
 
@@ -44,6 +56,16 @@ void MembraneCellForce::SetTargetCurvatures(double targetCurvatureStemStem, doub
 	mTargetCurvatureTransTrans = targetCurvatureTransTrans;
 }
 
+void MembraneCellForce::SetTargetCurvatureField(boost::shared_ptr<TargetCurvatureField> pTargetCurvatureField)
+{
+	mpTargetCurvatureField = pTargetCurvatureField;
+}
+
+boost::shared_ptr<TargetCurvatureField> MembraneCellForce::GetTargetCurvatureField()
+{
+	return mpTargetCurvatureField;
+}
+
 
 /*
  * A method to find all the pairs of connections between healthy epithelial cells and labelled gel cells.
@@ -53,15 +75,13 @@ void MembraneCellForce::SetTargetCurvatures(double targetCurvatureStemStem, doub
 
 
 double MembraneCellForce::GetAngleFromTriplet(AbstractCellPopulation<2>& rCellPopulation,
-															c_vector<double, 2> leftNode,
-															c_vector<double, 2> centreNode,
-															c_vector<double, 2> rightNode)
+															const c_vector<double, 2>& leftNode,
+															const c_vector<double, 2>& centreNode,
+															const c_vector<double, 2>& rightNode)
 {
 	// Given three node which we know are neighbours, determine the angle their centres make
-	MeshBasedCellPopulation<2>* p_tissue = static_cast<MeshBasedCellPopulation<2>*>(&rCellPopulation);
-
-	c_vector<double, 2> vector_AB = p_tissue->rGetMesh().GetVectorFromAtoB(centreNode,leftNode);
-	c_vector<double, 2> vector_AC = p_tissue->rGetMesh().GetVectorFromAtoB(centreNode,rightNode);
+	c_vector<double, 2> vector_AB = rCellPopulation.rGetMesh().GetVectorFromAtoB(centreNode,leftNode);
+	c_vector<double, 2> vector_AC = rCellPopulation.rGetMesh().GetVectorFromAtoB(centreNode,rightNode);
 
 	double inner_product_AB_AC = vector_AB[0] * vector_AC[0] + vector_AB[1] * vector_AC[1];
 	double length_AB = norm_2(vector_AB);
@@ -90,9 +110,9 @@ double MembraneCellForce::GetAngleFromTriplet(AbstractCellPopulation<2>& rCellPo
 */
 
 double MembraneCellForce::FindParametricCurvature(AbstractCellPopulation<2>& rCellPopulation,
-															c_vector<double, 2> leftCell,
-															c_vector<double, 2> centreCell,
-															c_vector<double, 2> rightCell)
+															const c_vector<double, 2>& leftCell,
+															const c_vector<double, 2>& centreCell,
+															const c_vector<double, 2>& rightCell)
 {
 	//Get the relevant vectors (all possible differences)
 	c_vector<double, 2> left_to_centre = rCellPopulation.rGetMesh().GetVectorFromAtoB(leftCell, centreCell);
@@ -121,29 +141,39 @@ double MembraneCellForce::FindParametricCurvature(AbstractCellPopulation<2>& rCe
 
 
 double MembraneCellForce::GetTargetAngle(AbstractCellPopulation<2>& rCellPopulation, CellPtr centre_cell,
-																		c_vector<double, 2> leftCell,
-																		c_vector<double, 2> centreCell,
-																		c_vector<double, 2> rightCell)
+																		const c_vector<double, 2>& leftCell,
+																		const c_vector<double, 2>& centreCell,
+																		const c_vector<double, 2>& rightCell)
 {
 	// Returns the angle that we're aiming for
 	// At the moment, it doesn't handle membrane cells with both types separately, but treats them like  they're attached to transit cells
-	MeshBasedCellPopulation<2>* cell_population = static_cast<MeshBasedCellPopulation<2>*>(&rCellPopulation);
+	// Null for a NodeBasedCellPopulation, which has no ghost nodes
+	MeshBasedCellPopulation<2>* p_mesh_population = dynamic_cast<MeshBasedCellPopulation<2>*>(&rCellPopulation);
+
+	if (mpTargetCurvatureField)
+	{
+		// The target only depends on where the centre node is, so its neighbours don't need looking at
+		double target_curvature = mpTargetCurvatureField->GetTargetCurvature(centreCell[1]);
+		double length_AB = norm_2(rCellPopulation.rGetMesh().GetVectorFromAtoB(centreCell,leftCell));
+		double length_AC = norm_2(rCellPopulation.rGetMesh().GetVectorFromAtoB(centreCell,rightCell));
+		return acos(length_AC * target_curvature / 2) + acos(length_AB * target_curvature / 2);
+	}
 
 	bool contact_with_stem = false;
 	bool contact_with_trans = false;
 	bool contact_with_stromal = false;
 	bool contact_only_with_ghost = true;
 
-	unsigned centre_cell_index = cell_population->GetLocationIndexUsingCell(centre_cell);
+	unsigned centre_cell_index = rCellPopulation.GetLocationIndexUsingCell(centre_cell);
 	std::set<unsigned> neighbouring_node_indices = rCellPopulation.GetNeighbouringNodeIndices(centre_cell_index);
 
 	for (std::set<unsigned>::iterator iter = neighbouring_node_indices.begin();
 	         			iter != neighbouring_node_indices.end();
 	         				++iter)
 	{
-		if (!cell_population->IsGhostNode(*iter))
+		if (!p_mesh_population || !p_mesh_population->IsGhostNode(*iter))
 		{
-			CellPtr neighbour = cell_population->GetCellUsingLocationIndex(*iter);
+			CellPtr neighbour = rCellPopulation.GetCellUsingLocationIndex(*iter);
 			if (!neighbour->IsDead())
 			{
 			//check if the cell type is differentiated, then if it is, add the "mutation"
@@ -170,8 +200,8 @@ double MembraneCellForce::GetTargetAngle(AbstractCellPopulation<2>& rCellPopulat
 
 	double target_angle = M_PI; // Assume we're dealing with transit cells as default
 
-	c_vector<double, 2> vector_AB = cell_population->rGetMesh().GetVectorFromAtoB(centreCell,leftCell);
-	c_vector<double, 2> vector_AC = cell_population->rGetMesh().GetVectorFromAtoB(centreCell,rightCell);
+	c_vector<double, 2> vector_AB = rCellPopulation.rGetMesh().GetVectorFromAtoB(centreCell,leftCell);
+	c_vector<double, 2> vector_AC = rCellPopulation.rGetMesh().GetVectorFromAtoB(centreCell,rightCell);
 
 	double length_AB = norm_2(vector_AB);
 	double length_AC = norm_2(vector_AC);
@@ -316,95 +346,341 @@ std::vector<std::vector<unsigned>> MembraneCellForce::GetMembraneSections(Abstra
     return membraneSections;
 }
 
+void MembraneCellForce::SetMembraneNeighbourRadius(double membraneNeighbourRadius)
+{
+	assert(membraneNeighbourRadius > 0.0);
+	mMembraneNeighbourRadius = membraneNeighbourRadius;
+}
 
-//Method overriding the virtual method for AbstractForce. The crux of what really needs to be done.
-void MembraneCellForce::AddForceContribution(AbstractCellPopulation<2>& rCellPopulation)
+double MembraneCellForce::GetMembraneNeighbourRadius()
 {
-	MeshBasedCellPopulation<2>* p_tissue = static_cast<MeshBasedCellPopulation<2>*>(&rCellPopulation);
-	
-	// Need to determine the restoring force on the membrane putting it back to it's preferred shape
-	std::vector<std::vector<unsigned>> membraneSections = GetMembraneSections(rCellPopulation);
+	return mMembraneNeighbourRadius;
+}
 
-	//std::cout << "The number of membrane cells is: " << membraneIndices.size() << std::endl;
+std::vector<std::vector<unsigned>> MembraneCellForce::GetMembraneSectionsByRadius(AbstractCellPopulation<2>& rCellPopulation)
+{
+	// The membrane cells, and the membrane cells within the radius of each one
+	std::vector<unsigned> membrane_indices;
+	std::map<unsigned, std::vector<unsigned> > membrane_neighbours;
+	for (AbstractCellPopulation<2>::Iterator cell_iter = rCellPopulation.Begin();
+		 cell_iter != rCellPopulation.End();
+		 ++cell_iter)
+	{
+		if (cell_iter->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>())
+		{
+			membrane_indices.push_back(rCellPopulation.GetLocationIndexUsingCell(*cell_iter));
+		}
+	}
+	for (unsigned i=0; i<membrane_indices.size(); i++)
+	{
+		unsigned node_index = membrane_indices[i];
+		const c_vector<double, 2>& r_location = rCellPopulation.GetNode(node_index)->rGetLocation();
+		std::vector<unsigned>& r_neighbours = membrane_neighbours[node_index];
+
+		std::set<unsigned> neighbouring_node_indices = rCellPopulation.GetNeighbouringNodeIndices(node_index);
+		for (std::set<unsigned>::iterator iter = neighbouring_node_indices.begin();
+			 iter != neighbouring_node_indices.end();
+			 ++iter)
+		{
+			if (rCellPopulation.GetCellUsingLocationIndex(*iter)->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>()
+				&& norm_2(rCellPopulation.rGetMesh().GetVectorFromAtoB(r_location, rCellPopulation.GetNode(*iter)->rGetLocation())) <= mMembraneNeighbourRadius)
+			{
+				r_neighbours.push_back(*iter);
+			}
+		}
+	}
 
-	for (std::vector<std::vector<unsigned>>::iterator iter = membraneSections.begin(); iter != membraneSections.end(); ++iter)
+	std::set<unsigned> used_indices;
+	std::vector<std::vector<unsigned>> membraneSections;
+	for (unsigned i=0; i<membrane_indices.size(); i++)
 	{
-		std::vector<unsigned> membraneIndices = *iter;
-	// We loop through the membrane sections to set the restoring forces
-		for (unsigned i=0; i<membraneIndices.size()-2; i++)
+		if (used_indices.find(membrane_indices[i]) != used_indices.end())
 		{
-			
-			unsigned left_node = membraneIndices[i];
-			unsigned centre_node = membraneIndices[i+1];
-			unsigned right_node = membraneIndices[i+2];
+			continue;
+		}
 
-			CellPtr left_cell = p_tissue->GetCellUsingLocationIndex(left_node);
-			CellPtr centre_cell = p_tissue->GetCellUsingLocationIndex(centre_node);
-			CellPtr right_cell = p_tissue->GetCellUsingLocationIndex(right_node);
+		// Walk one way from this cell, then the other way, always to the nearest unused membrane neighbour
+		std::deque<unsigned> section;
+		section.push_back(membrane_indices[i]);
+		used_indices.insert(membrane_indices[i]);
+		for (unsigned direction=0; direction<2; direction++)
+		{
+			unsigned current_index = membrane_indices[i];
+			while (true)
+			{
+				const c_vector<double, 2>& r_location = rCellPopulation.GetNode(current_index)->rGetLocation();
+				const std::vector<unsigned>& r_neighbours = membrane_neighbours[current_index];
 
-			c_vector<double, 2> left_location = p_tissue->GetLocationOfCellCentre(left_cell);
-			c_vector<double, 2> right_location = p_tissue->GetLocationOfCellCentre(right_cell);
-			c_vector<double, 2> centre_location = p_tissue->GetLocationOfCellCentre(centre_cell);
-			
-			double current_angle = GetAngleFromTriplet(rCellPopulation, left_location, centre_location, right_location);
-			double current_curvature = FindParametricCurvature(rCellPopulation, left_location, centre_location, right_location);
-			
-			if (std::abs(current_curvature) < 1e-5)
+				unsigned next_index = UINT_MAX;
+				double next_distance = DBL_MAX;
+				for (unsigned j=0; j<r_neighbours.size(); j++)
+				{
+					if (used_indices.find(r_neighbours[j]) == used_indices.end())
+					{
+						double distance = norm_2(rCellPopulation.rGetMesh().GetVectorFromAtoB(r_location, rCellPopulation.GetNode(r_neighbours[j])->rGetLocation()));
+						if (distance < next_distance)
+						{
+							next_index = r_neighbours[j];
+							next_distance = distance;
+						}
+					}
+				}
+				if (next_index == UINT_MAX)
+				{
+					break;
+				}
+
+				used_indices.insert(next_index);
+				if (direction == 0)
+				{
+					section.push_back(next_index);
+				}
+				else
+				{
+					section.push_front(next_index);
+				}
+				current_index = next_index;
+			}
+		}
+		membraneSections.push_back(std::vector<unsigned>(section.begin(), section.end()));
+	}
+
+	return membraneSections;
+}
+
+void MembraneCellForce::SetMembraneBondGraph(boost::shared_ptr<MembraneBondGraph> pMembraneBondGraph)
+{
+	mpMembraneBondGraph = pMembraneBondGraph;
+}
+
+boost::shared_ptr<MembraneBondGraph> MembraneCellForce::GetMembraneBondGraph()
+{
+	return mpMembraneBondGraph;
+}
+
+void MembraneCellForce::InitialiseMembraneBondGraph(AbstractCellPopulation<2>& rCellPopulation)
+{
+	assert(mpMembraneBondGraph);
+	mpMembraneBondGraph->Clear();
+
+	std::vector<std::vector<unsigned>> membraneSections;
+	if (dynamic_cast<NodeBasedCellPopulation<2>*>(&rCellPopulation))
+	{
+		membraneSections = GetMembraneSectionsByRadius(rCellPopulation);
+	}
+	else
+	{
+		membraneSections = GetMembraneSections(rCellPopulation);
+	}
+
+	for (unsigned i=0; i<membraneSections.size(); i++)
+	{
+		std::vector<CellPtr> section_cells;
+		for (unsigned j=0; j<membraneSections[i].size(); j++)
+		{
+			section_cells.push_back(rCellPopulation.GetCellUsingLocationIndex(membraneSections[i][j]));
+		}
+		mpMembraneBondGraph->AddChain(section_cells);
+	}
+}
+
+const std::vector<std::vector<unsigned>>& MembraneCellForce::rGetCachedMembraneSections(AbstractCellPopulation<2>& rCellPopulation)
+{
+	if (mpMembraneBondGraph)
+	{
+		if (mpMembraneBondGraph->GetNumCells() == 0)
+		{
+			InitialiseMembraneBondGraph(rCellPopulation);
+		}
+		mpMembraneBondGraph->RemoveDeadCells();
+
+		// The bonds are kept by cell id, so only the node indices need looking up
+		std::vector<std::vector<unsigned> > chains = mpMembraneBondGraph->GetChains();
+		mCachedMembraneSections.resize(chains.size());
+		for (unsigned i=0; i<chains.size(); i++)
+		{
+			mCachedMembraneSections[i].resize(chains[i].size());
+			for (unsigned j=0; j<chains[i].size(); j++)
 			{
-				// Close enough
-				current_curvature = 0.0;
-				// We need to use the sign of the curvature to determine the angle correctly
-				// Extrememly small curvatures due to precision errors might play havock with this
+				mCachedMembraneSections[i][j] = rCellPopulation.GetLocationIndexUsingCell(mpMembraneBondGraph->GetCell(chains[i][j]));
 			}
+		}
+
+		// Anything cached from the mesh no longer matches
+		mpCachedSectionsPopulation = NULL;
+		return mCachedMembraneSections;
+	}
+
+	if (dynamic_cast<NodeBasedCellPopulation<2>*>(&rCellPopulation))
+	{
+		// The membrane cells keep their node indices and their place in the chain while no cells are added or removed
+		unsigned max_cell_id = 0;
+		for (AbstractCellPopulation<2>::Iterator cell_iter = rCellPopulation.Begin();
+			 cell_iter != rCellPopulation.End();
+			 ++cell_iter)
+		{
+			max_cell_id = std::max(max_cell_id, cell_iter->GetCellId());
+		}
 
-			// The method of calculating the angle is not oriented by the lumen, so need to adjust
-			if (current_curvature < 0)
+		if (mpCachedSectionsPopulation != &rCellPopulation
+			|| mCachedSectionsNumCells != rCellPopulation.GetNumRealCells()
+			|| mCachedSectionsMaxCellId != max_cell_id)
+		{
+			mCachedMembraneSections = GetMembraneSectionsByRadius(rCellPopulation);
+			mpCachedSectionsPopulation = &rCellPopulation;
+			mCachedSectionsNumCells = rCellPopulation.GetNumRealCells();
+			mCachedSectionsMaxCellId = max_cell_id;
+		}
+		return mCachedMembraneSections;
+	}
+
+	CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(&rCellPopulation);
+
+	// The sections only change when the triangulation does
+	bool is_cache_valid = (p_crypt_population != NULL && mpCachedSectionsPopulation == &rCellPopulation);
+
+	// A local repair since last time only matters if it flipped an edge next to the membrane
+	if (is_cache_valid && mCachedSectionsTopologyVersion != p_crypt_population->GetTopologyVersion())
+	{
+		is_cache_valid = (p_crypt_population->GetTopologyVersion() == mCachedSectionsTopologyVersion + 1
+						  && p_crypt_population->IsLastTopologyChangeLocal());
+
+		const std::set<unsigned>& r_changed_elements = p_crypt_population->rGetChangedElements();
+		for (std::set<unsigned>::const_iterator elem_iter = r_changed_elements.begin();
+			 elem_iter != r_changed_elements.end() && is_cache_valid;
+			 ++elem_iter)
+		{
+			Element<2,2>* p_element = p_crypt_population->rGetMesh().GetElement(*elem_iter);
+			for (unsigned i=0; i<3; i++)
 			{
-				current_angle = 2 * M_PI - current_angle;
+				unsigned node_index = p_element->GetNodeGlobalIndex(i);
+				if (!p_crypt_population->IsGhostNode(node_index)
+					&& p_crypt_population->GetCellUsingLocationIndex(node_index)->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>())
+				{
+					is_cache_valid = false;
+				}
 			}
+		}
+	}
+
+	if (!is_cache_valid)
+	{
+		mCachedMembraneSections = GetMembraneSections(rCellPopulation);
+		mpCachedSectionsPopulation = &rCellPopulation;
+	}
+	if (p_crypt_population != NULL)
+	{
+		mCachedSectionsTopologyVersion = p_crypt_population->GetTopologyVersion();
+	}
+
+	return mCachedMembraneSections;
+}
+
 
-			double target_angle = GetTargetAngle(rCellPopulation, centre_cell, left_location, centre_location, right_location);
+/*
+ * The forces on the two outer nodes of one membrane triplet. Split out so the forces can be
+ * evaluated at trial positions, as the semi-implicit numerical method does.
+ */
+void MembraneCellForce::CalculateTripletForces(AbstractCellPopulation<2>& rCellPopulation, CellPtr centreCell,
+															const c_vector<double, 2>& leftLocation,
+															const c_vector<double, 2>& centreLocation,
+															const c_vector<double, 2>& rightLocation,
+															c_vector<double, 2>& rForceLeft,
+															c_vector<double, 2>& rForceRight)
+{
+	double current_angle = GetAngleFromTriplet(rCellPopulation, leftLocation, centreLocation, rightLocation);
+	double current_curvature = FindParametricCurvature(rCellPopulation, leftLocation, centreLocation, rightLocation);
+	
+	if (std::abs(current_curvature) < 1e-5)
+	{
+		// Close enough
+		current_curvature = 0.0;
+		// We need to use the sign of the curvature to determine the angle correctly
+		// Extrememly small curvatures due to precision errors might play havock with this
+	}
 
-			double torque = mBasementMembraneTorsionalStiffness * (current_angle - target_angle); // Positive torque means force points into lumen
+	// The method of calculating the angle is not oriented by the lumen, so need to adjust
+	if (current_curvature < 0)
+	{
+		current_angle = 2 * M_PI - current_angle;
+	}
 
-			c_vector<double, 2> vector_CL = p_tissue->rGetMesh().GetVectorFromAtoB(centre_location,left_location);
-			c_vector<double, 2> vector_CR = p_tissue->rGetMesh().GetVectorFromAtoB(centre_location,right_location);
-			c_vector<double, 2> vector_LR = p_tissue->rGetMesh().GetVectorFromAtoB(left_location,right_location); // Used for determining where lumen is
+	double target_angle = GetTargetAngle(rCellPopulation, centreCell, leftLocation, centreLocation, rightLocation);
+
+	double torque = mBasementMembraneTorsionalStiffness * (current_angle - target_angle); // Positive torque means force points into lumen
+
+	c_vector<double, 2> vector_CL = rCellPopulation.rGetMesh().GetVectorFromAtoB(centreLocation,leftLocation);
+	c_vector<double, 2> vector_CR = rCellPopulation.rGetMesh().GetVectorFromAtoB(centreLocation,rightLocation);
+	c_vector<double, 2> vector_LR = rCellPopulation.rGetMesh().GetVectorFromAtoB(leftLocation,rightLocation); // Used for determining where lumen is
+
+	double membraneRestoringRate = mBasementMembraneTorsionalStiffness; // For the sake of consistant naming until I fix things up
+
+
+	double length_CL = norm_2(vector_CL);
+	double length_CR = norm_2(vector_CR);
+	double length_LR = norm_2(vector_LR);
+
+	// Determine the force vectors applied to the left and right nodes
+	double forceMagnitude = - membraneRestoringRate * (current_angle - target_angle); // +ve force means away from lumen
+	double forceMagnitudeLeft = torque/length_CL;
+	double forceMagnitudeRight = torque/length_CR;
+
+	c_vector<double, 2> forceDirection; // Trying a force like SJD
+	c_vector<double, 2> forceDirectionLeft;
+	c_vector<double, 2> forceDirectionRight;
+
+	// Use the CL and CR vectors to determine the line that the force will act on
+	// If we have a vector (a, b), then the vector (b, -a) is perpendicular and creates a clockwise rotation when added to the end of (a,b)
+	// while (-b, a) creates an anticlockwise rotation
+	// forceDirectionLeft will always end up pointing into the lumen, and forceDirectionRight will always point out
+	// Given we have decided that the actual direction of the force is encoded in the sign on the torque this is all we need to do
+	
+	forceDirection[0] = - vector_LR[1] / length_LR; // This must be perpendicular to the LR vector
+	forceDirection[1] = vector_LR[0] / length_LR;
 
-			double membraneRestoringRate = mBasementMembraneTorsionalStiffness; // For the sake of consistant naming until I fix things up
+	forceDirectionLeft[0] = vector_CL[1] / length_CL;
+	forceDirectionLeft[1] = - vector_CL[0] / length_CL;
 
+	forceDirectionRight[0] = - vector_CR[1] / length_CR;
+	forceDirectionRight[1] = vector_CR[0] / length_CR;
 
-			double length_CL = norm_2(vector_CL);
-			double length_CR = norm_2(vector_CR);
-			double length_LR = norm_2(vector_LR);
+	c_vector<double, 2> forceVector = forceMagnitude * forceDirection;
+	rForceLeft = forceMagnitudeLeft * forceDirectionLeft;
+	rForceRight = forceMagnitudeRight * forceDirectionRight;
+}
 
-			// Determine the force vectors applied to the left and right nodes
-			double forceMagnitude = - membraneRestoringRate * (current_angle - target_angle); // +ve force means away from lumen
-			double forceMagnitudeLeft = torque/length_CL;
-			double forceMagnitudeRight = torque/length_CR;
+//Method overriding the virtual method for AbstractForce. The crux of what really needs to be done.
+void MembraneCellForce::AddForceContribution(AbstractCellPopulation<2>& rCellPopulation)
+{
+	AbstractCellPopulation<2>* p_tissue = &rCellPopulation;
+	
+	// Need to determine the restoring force on the membrane putting it back to it's preferred shape
+	const std::vector<std::vector<unsigned>>& membraneSections = rGetCachedMembraneSections(rCellPopulation);
 
-			c_vector<double, 2> forceDirection; // Trying a force like SJD
-			c_vector<double, 2> forceDirectionLeft;
-			c_vector<double, 2> forceDirectionRight;
+	//std::cout << "The number of membrane cells is: " << membraneIndices.size() << std::endl;
 
-			// Use the CL and CR vectors to determine the line that the force will act on
-			// If we have a vector (a, b), then the vector (b, -a) is perpendicular and creates a clockwise rotation when added to the end of (a,b)
-			// while (-b, a) creates an anticlockwise rotation
-			// forceDirectionLeft will always end up pointing into the lumen, and forceDirectionRight will always point out
-			// Given we have decided that the actual direction of the force is encoded in the sign on the torque this is all we need to do
+	for (std::vector<std::vector<unsigned>>::const_iterator iter = membraneSections.begin(); iter != membraneSections.end(); ++iter)
+	{
+		const std::vector<unsigned>& membraneIndices = *iter;
+	// We loop through the membrane sections to set the restoring forces
+		for (unsigned i=0; i+2<membraneIndices.size(); i++)
+		{
 			
-			forceDirection[0] = - vector_LR[1] / length_LR; // This must be perpendicular to the LR vector
-			forceDirection[1] = vector_LR[0] / length_LR;
+			unsigned left_node = membraneIndices[i];
+			unsigned centre_node = membraneIndices[i+1];
+			unsigned right_node = membraneIndices[i+2];
 
-			forceDirectionLeft[0] = vector_CL[1] / length_CL;
-			forceDirectionLeft[1] = - vector_CL[0] / length_CL;
+			CellPtr left_cell = p_tissue->GetCellUsingLocationIndex(left_node);
+			CellPtr centre_cell = p_tissue->GetCellUsingLocationIndex(centre_node);
+			CellPtr right_cell = p_tissue->GetCellUsingLocationIndex(right_node);
 
-			forceDirectionRight[0] = - vector_CR[1] / length_CR;
-			forceDirectionRight[1] = vector_CR[0] / length_CR;
+			c_vector<double, 2> left_location = p_tissue->GetLocationOfCellCentre(left_cell);
+			c_vector<double, 2> right_location = p_tissue->GetLocationOfCellCentre(right_cell);
+			c_vector<double, 2> centre_location = p_tissue->GetLocationOfCellCentre(centre_cell);
 
-			c_vector<double, 2> forceVector = forceMagnitude * forceDirection;
-			c_vector<double, 2> forceVectorLeft = forceMagnitudeLeft * forceDirectionLeft;
-			c_vector<double, 2> forceVectorRight = forceMagnitudeRight * forceDirectionRight;
+			c_vector<double, 2> forceVectorLeft;
+			c_vector<double, 2> forceVectorRight;
+			CalculateTripletForces(rCellPopulation, centre_cell, left_location, centre_location, right_location, forceVectorLeft, forceVectorRight);
 
 			//rCellPopulation.GetNode(centre_node)->AddAppliedForceContribution(forceVector);
 			rCellPopulation.GetNode(left_node)->AddAppliedForceContribution(forceVectorLeft);
@@ -417,6 +693,7 @@ void MembraneCellForce::AddForceContribution(AbstractCellPopulation<2>& rCellPop
 void MembraneCellForce::OutputForceParameters(out_stream& rParamsFile)
 {
 	*rParamsFile <<  "\t\t\t<BasementMembraneTorsionalStiffness>"<<  mBasementMembraneTorsionalStiffness << "</BasementMembraneTorsionalStiffness> \n";
+	*rParamsFile <<  "\t\t\t<MembraneNeighbourRadius>"<<  mMembraneNeighbourRadius << "</MembraneNeighbourRadius> \n";
 	//*rParamsFile <<  "\t\t\t<TargetCurvature>"<< mTargetCurvature << "</TargetCurvature> \n";
 
 	// Call direct parent class
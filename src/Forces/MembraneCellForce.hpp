@@ -3,14 +3,18 @@
 
 #include "ChasteSerialization.hpp"
 #include <boost/serialization/base_object.hpp>
+#include <boost/serialization/shared_ptr.hpp>
 
 #include "AbstractForce.hpp"
 #include "MeshBasedCellPopulation.hpp"
+#include "NodeBasedCellPopulation.hpp"
 #include "DifferentiatedCellProliferativeType.hpp"
 
 #include "TransitCellProliferativeType.hpp"
 #include "StemCellProliferativeType.hpp"
 #include "MembraneCellProliferativeType.hpp"
+#include "TargetCurvatureField.hpp"
+#include "MembraneBondGraph.hpp"
 
 #include <cmath>
 #include <list>
@@ -18,6 +22,13 @@
 
 /**
  * A force class that defines the force due to the basement membrane.
+ *
+ * Works with a MeshBasedCellPopulation, where the membrane is ordered along the Delaunay
+ * edges, or with a NodeBasedCellPopulation, where it is ordered by walking to the nearest
+ * membrane cell within mMembraneNeighbourRadius (see GetMembraneSectionsByRadius()).
+ *
+ * If a MembraneBondGraph is set, the membrane is ordered by its bonds instead, and neither is
+ * searched for again unless the graph is empty.
  */
 
 /*
@@ -40,6 +51,30 @@ private :
     double mTargetCurvatureStemTrans;
     double mTargetCurvatureTransTrans;
 
+    /* If set, the target curvature at the height of each membrane node, used instead of the curvatures above */
+    boost::shared_ptr<TargetCurvatureField> mpTargetCurvatureField;
+
+    /* The membrane sections found last time, and the population and topology version they were found for.
+     * Only reused with a CryptCellPopulationWithGhostNodes, which says when and where its mesh has changed.
+     */
+    std::vector<std::vector<unsigned>> mCachedMembraneSections;
+    AbstractCellPopulation<2>* mpCachedSectionsPopulation;
+    unsigned mCachedSectionsTopologyVersion;
+
+    /* How far apart neighbouring membrane cells can be in a NodeBasedCellPopulation. It should be no more
+     * than the population's interaction distance.
+     */
+    double mMembraneNeighbourRadius;
+
+    // The number of cells and the largest cell id when the sections of a NodeBasedCellPopulation were found.
+    // Node indices there don't change while the cells stay the same, so neither does the membrane chain.
+    // Cell ids only go up, so a birth changes the largest id even if a death keeps the number the same.
+    unsigned mCachedSectionsNumCells;
+    unsigned mCachedSectionsMaxCellId;
+
+    /* If set, the bonds along the membrane, shared with the spring force */
+    boost::shared_ptr<MembraneBondGraph> mpMembraneBondGraph;
+
     /** Needed for serialization. */
     friend class boost::serialization::access;
     /**
@@ -58,6 +93,9 @@ private :
         archive & mTargetCurvatureStemStem;
         archive & mTargetCurvatureStemTrans;
         archive & mTargetCurvatureTransTrans;
+        archive & mpTargetCurvatureField;
+        archive & mMembraneNeighbourRadius;
+        archive & mpMembraneBondGraph;
     }
 
 public :
@@ -73,11 +111,20 @@ public :
     ~MembraneCellForce();
 
     double GetTargetAngle(AbstractCellPopulation<2>& rCellPopulation, CellPtr centre_cell,
-                                                                        c_vector<double, 2> leftCell,
-                                                                        c_vector<double, 2> centreCell,
-                                                                        c_vector<double, 2> rightCell);
+                                                                        const c_vector<double, 2>& leftCell,
+                                                                        const c_vector<double, 2>& centreCell,
+                                                                        const c_vector<double, 2>& rightCell);
     std::vector<unsigned> GetMembraneIndices(AbstractCellPopulation<2>& rCellPopulation, unsigned starting_membrane_index);
 
+    /* The torsional forces on the left and right nodes of a membrane triplet, with the nodes at the given locations
+     */
+    void CalculateTripletForces(AbstractCellPopulation<2>& rCellPopulation, CellPtr centreCell,
+                                const c_vector<double, 2>& leftLocation,
+                                const c_vector<double, 2>& centreLocation,
+                                const c_vector<double, 2>& rightLocation,
+                                c_vector<double, 2>& rForceLeft,
+                                c_vector<double, 2>& rForceRight);
+
     /**
      * Pure virtual, must implement
      */
@@ -99,6 +146,11 @@ public :
     /* Value of Target Curvature in epithelial layer */
     void SetTargetCurvatures(double targetCurvatureStemStem, double targetCurvatureStemTrans, double targetCurvatureTransTrans);
 
+    /* Take the target curvature from a field over height rather than from the types of each node's neighbours */
+    void SetTargetCurvatureField(boost::shared_ptr<TargetCurvatureField> pTargetCurvatureField);
+
+    boost::shared_ptr<TargetCurvatureField> GetTargetCurvatureField();
+
     /* Removing duplicated entries of a vector
      */
     void RemoveDuplicates1D(std::vector<unsigned>& rVectorWithDuplicates);
@@ -108,9 +160,9 @@ public :
     bool DoesElementContainGhostNodes(AbstractCellPopulation<2>& rCellPopulation, unsigned elementIndex);
 
     double GetAngleFromTriplet(AbstractCellPopulation<2>& rCellPopulation,
-                                                            c_vector<double, 2> leftNode,
-                                                            c_vector<double, 2> centreNode,
-                                                            c_vector<double, 2> rightNode);
+                                                            const c_vector<double, 2>& leftNode,
+                                                            const c_vector<double, 2>& centreNode,
+                                                            const c_vector<double, 2>& rightNode);
     /* Finding the connected pairs of epithelial-tissue nodes
      */
     std::vector<c_vector<unsigned, 2> > GetEpithelialGelPairs(AbstractCellPopulation<2>& rCellPopulation);
@@ -127,25 +179,20 @@ public :
      * to the vector joining the left and right midpoints, and then find the perpendicular distance of
      * the centre midpoint from the left->right vector
      */
-    double GetCurvatureFromMidpoints(AbstractCellPopulation<2>& rCellPopulation, c_vector<double, 2> leftMidpoint,
-    														c_vector<double, 2> centreMidpoint,
-    														c_vector<double, 2> rightMidpoint);
+    double GetCurvatureFromMidpoints(AbstractCellPopulation<2>& rCellPopulation, const c_vector<double, 2>& leftMidpoint,
+    														const c_vector<double, 2>& centreMidpoint,
+    														const c_vector<double, 2>& rightMidpoint);
 
     double FindParametricCurvature(AbstractCellPopulation<2>& rCellPopulation,
-    								c_vector<double, 2> leftMidpoint,
-									c_vector<double, 2> centreMidpoint,
-									c_vector<double, 2> rightMidpoint);
+    								const c_vector<double, 2>& leftMidpoint,
+									const c_vector<double, 2>& centreMidpoint,
+									const c_vector<double, 2>& rightMidpoint);
 
     /* Finding the number of elements that a node belongs to, which contain only real nodes
      * and not ghost nodes
      */
     unsigned GetNumContainingElementsWithoutGhostNodes(AbstractCellPopulation<2>& rCellPopulation, unsigned nodeIndex);
 
-    /* Finding the y-coordinates of the crypt orifice and crypt base
-     * The first entry of the resulting vector is the orifice, the second is the base
-     */
-//    c_vector<double,2> GetCryptHeightExtremes(AbstractCellPopulation<2>& rCellPopulation);
-
     /*
      * Method to return the nodes connected to a particular node via the Delaunay
      * triangulation, excluding ghost nodes.
@@ -160,6 +207,26 @@ public :
     // Returns each distinct membrane
     std::vector<std::vector<unsigned>> GetMembraneSections(AbstractCellPopulation<2>& rCellPopulation);
 
+    // As GetMembraneSections(), for a population with no mesh. Each section is built by walking from a membrane cell to
+    // the nearest membrane cell within mMembraneNeighbourRadius that isn't in a section yet, in both directions.
+    std::vector<std::vector<unsigned>> GetMembraneSectionsByRadius(AbstractCellPopulation<2>& rCellPopulation);
+
+    void SetMembraneNeighbourRadius(double membraneNeighbourRadius);
+
+    double GetMembraneNeighbourRadius();
+
+    /* Order the membrane by the bonds in a graph, rather than by searching the neighbours of each membrane cell */
+    void SetMembraneBondGraph(boost::shared_ptr<MembraneBondGraph> pMembraneBondGraph);
+
+    boost::shared_ptr<MembraneBondGraph> GetMembraneBondGraph();
+
+    // Fill the bond graph with the membrane sections as found from the mesh, or by radius for a NodeBasedCellPopulation
+    void InitialiseMembraneBondGraph(AbstractCellPopulation<2>& rCellPopulation);
+
+    // As GetMembraneSections(), but only worked out again when the mesh around the membrane has changed.
+    // With a bond graph, the sections are its chains.
+    const std::vector<std::vector<unsigned>>& rGetCachedMembraneSections(AbstractCellPopulation<2>& rCellPopulation);
+
    
 
 };
@@ -0,0 +1,80 @@
+#include "TargetCurvatureField.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+TargetCurvatureField::TargetCurvatureField()
+	: mMinHeight(0.0),
+	mSpacing(1.0)
+{
+}
+
+double TargetCurvatureField::InterpolateControlPoints(double height) const
+{
+	assert(!mControlHeights.empty());
+
+	if (height <= mControlHeights.front())
+	{
+		return mControlCurvatures.front();
+	}
+	if (height >= mControlHeights.back())
+	{
+		return mControlCurvatures.back();
+	}
+
+	// The first control point above this height
+	unsigned upper = std::upper_bound(mControlHeights.begin(), mControlHeights.end(), height) - mControlHeights.begin();
+	unsigned lower = upper - 1;
+	double fraction = (height - mControlHeights[lower])/(mControlHeights[upper] - mControlHeights[lower]);
+	return (1.0 - fraction)*mControlCurvatures[lower] + fraction*mControlCurvatures[upper];
+}
+
+void TargetCurvatureField::SetControlPoints(const std::vector<double>& rHeights, const std::vector<double>& rCurvatures, unsigned numSamples)
+{
+	assert(!rHeights.empty());
+	assert(rHeights.size() == rCurvatures.size());
+	assert(numSamples > 1);
+	for (unsigned i=1; i<rHeights.size(); i++)
+	{
+		assert(rHeights[i] > rHeights[i-1]);
+	}
+
+	mControlHeights = rHeights;
+	mControlCurvatures = rCurvatures;
+
+	if (rHeights.size() == 1)
+	{
+		mTable.assign(1, rCurvatures[0]);
+		mMinHeight = rHeights[0];
+		mSpacing = 1.0;
+		return;
+	}
+
+	mMinHeight = rHeights.front();
+	mSpacing = (rHeights.back() - rHeights.front())/(numSamples - 1);
+	mTable.resize(numSamples);
+	for (unsigned i=0; i<numSamples; i++)
+	{
+		mTable[i] = InterpolateControlPoints(mMinHeight + i*mSpacing);
+	}
+}
+
+void TargetCurvatureField::SetConstant(double curvature)
+{
+	SetControlPoints(std::vector<double>(1, 0.0), std::vector<double>(1, curvature));
+}
+
+const std::vector<double>& TargetCurvatureField::rGetControlHeights() const
+{
+	return mControlHeights;
+}
+
+const std::vector<double>& TargetCurvatureField::rGetControlCurvatures() const
+{
+	return mControlCurvatures;
+}
+
+unsigned TargetCurvatureField::GetNumSamples() const
+{
+	return mTable.size();
+}
@@ -0,0 +1,92 @@
+#ifndef TARGETCURVATUREFIELD_HPP_
+#define TARGETCURVATUREFIELD_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/vector.hpp>
+
+#include <vector>
+
+/*
+ * A target curvature that depends on height, e.g. curved in the crypt base and flat up the
+ * sides of the crypt.
+ *
+ * The profile is given as control points (height, curvature), joined by straight lines and
+ * held constant beyond the first and last point. It is sampled once into a table with
+ * evenly spaced heights, so that GetTargetCurvature() is an index calculation and one linear
+ * interpolation, however many control points there are.
+ */
+
+class TargetCurvatureField
+{
+private:
+
+    std::vector<double> mControlHeights;
+    std::vector<double> mControlCurvatures;
+
+    // The curvature at mMinHeight + i*mSpacing
+    std::vector<double> mTable;
+    double mMinHeight;
+    double mSpacing;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & mControlHeights;
+        archive & mControlCurvatures;
+        archive & mTable;
+        archive & mMinHeight;
+        archive & mSpacing;
+    }
+
+    /* The curvature at a height straight from the control points */
+    double InterpolateControlPoints(double height) const;
+
+public:
+
+    /* A field that is zero everywhere until SetControlPoints() is called */
+    TargetCurvatureField();
+
+    /*
+     * Set the profile and build the table. The heights must be increasing.
+     *
+     * @param rHeights the heights of the control points
+     * @param rCurvatures the target curvature at each height
+     * @param numSamples the number of entries in the table
+     */
+    void SetControlPoints(const std::vector<double>& rHeights, const std::vector<double>& rCurvatures, unsigned numSamples=256);
+
+    /* The same target curvature everywhere */
+    void SetConstant(double curvature);
+
+    const std::vector<double>& rGetControlHeights() const;
+
+    const std::vector<double>& rGetControlCurvatures() const;
+
+    unsigned GetNumSamples() const;
+
+    double GetTargetCurvature(double height) const
+    {
+        if (mTable.size() < 2)
+        {
+            return mTable.empty() ? 0.0 : mTable[0];
+        }
+
+        double position = (height - mMinHeight)/mSpacing;
+        if (position <= 0.0)
+        {
+            return mTable.front();
+        }
+        unsigned last = mTable.size() - 1;
+        if (position >= last)
+        {
+            return mTable.back();
+        }
+
+        unsigned i = static_cast<unsigned>(position);
+        double fraction = position - i;
+        return (1.0 - fraction)*mTable[i] + fraction*mTable[i+1];
+    }
+};
+
+#endif /* TARGETCURVATUREFIELD_HPP_ */
@@ -0,0 +1,182 @@
+#include "CryptAdaptiveNumericalMethod.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+CryptAdaptiveNumericalMethod::CryptAdaptiveNumericalMethod()
+	: ForwardEulerNumericalMethod<2,2>(),
+	mMaxDisplacement(0.05),
+	mMinTimeStep(1e-5),
+	mEventStepFraction(0.1),
+	mNextStepSize(DBL_MAX),
+	mLastNumCells(0),
+	mLastMaxCellId(0),
+	mLastTopologyVersion(0),
+	mNumTimeSteps(0),
+	mNumSubsteps(0),
+	mSmallestStepSize(DBL_MAX)
+{
+}
+
+CryptAdaptiveNumericalMethod::~CryptAdaptiveNumericalMethod()
+{
+}
+
+void CryptAdaptiveNumericalMethod::SetMaxDisplacement(double maxDisplacement)
+{
+	assert(maxDisplacement > 0.0);
+	mMaxDisplacement = maxDisplacement;
+}
+
+double CryptAdaptiveNumericalMethod::GetMaxDisplacement()
+{
+	return mMaxDisplacement;
+}
+
+void CryptAdaptiveNumericalMethod::SetMinTimeStep(double minTimeStep)
+{
+	assert(minTimeStep > 0.0);
+	mMinTimeStep = minTimeStep;
+}
+
+double CryptAdaptiveNumericalMethod::GetMinTimeStep()
+{
+	return mMinTimeStep;
+}
+
+void CryptAdaptiveNumericalMethod::SetEventStepFraction(double eventStepFraction)
+{
+	assert(eventStepFraction > 0.0 && eventStepFraction <= 1.0);
+	mEventStepFraction = eventStepFraction;
+}
+
+double CryptAdaptiveNumericalMethod::GetEventStepFraction()
+{
+	return mEventStepFraction;
+}
+
+double CryptAdaptiveNumericalMethod::GetMeanSubstepsPerTimeStep()
+{
+	if (mNumTimeSteps == 0)
+	{
+		return 0.0;
+	}
+	return double(mNumSubsteps)/mNumTimeSteps;
+}
+
+double CryptAdaptiveNumericalMethod::GetSmallestStepSize()
+{
+	return mSmallestStepSize;
+}
+
+bool CryptAdaptiveNumericalMethod::HasHadBirthsOrDeaths()
+{
+	bool is_first_step = (mLastNumCells == 0);
+	bool has_had_births_or_deaths = false;
+
+	unsigned num_cells = this->mpCellPopulation->GetNumRealCells();
+
+	CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(this->mpCellPopulation);
+	if (p_crypt_population)
+	{
+		// Births and deaths always make the population remesh, and it keeps the ids of the cells involved
+		unsigned topology_version = p_crypt_population->GetTopologyVersion();
+		if (topology_version != mLastTopologyVersion && !p_crypt_population->IsLastTopologyChangeLocal())
+		{
+			has_had_births_or_deaths = !p_crypt_population->rGetAddedCellIds().empty()
+				|| !p_crypt_population->rGetRemovedCellIds().empty();
+		}
+		mLastTopologyVersion = topology_version;
+	}
+	else
+	{
+		// Cell ids only go up, so a birth gives a larger id than any seen before, even if a death keeps the count the same
+		unsigned max_cell_id = 0;
+		for (AbstractCellPopulation<2>::Iterator cell_iter = this->mpCellPopulation->Begin();
+			 cell_iter != this->mpCellPopulation->End();
+			 ++cell_iter)
+		{
+			max_cell_id = std::max(max_cell_id, cell_iter->GetCellId());
+		}
+		has_had_births_or_deaths = (max_cell_id > mLastMaxCellId || num_cells != mLastNumCells);
+		mLastMaxCellId = max_cell_id;
+	}
+	mLastNumCells = num_cells;
+
+	return has_had_births_or_deaths && !is_first_step;
+}
+
+void CryptAdaptiveNumericalMethod::UpdateAllNodePositions(double dt)
+{
+	if (this->mUseUpdateNodeLocation)
+	{
+		// The population moves its own nodes, so we can't substep
+		ForwardEulerNumericalMethod<2,2>::UpdateAllNodePositions(dt);
+		return;
+	}
+
+	mNumTimeSteps++;
+
+	double step_size = std::min(mNextStepSize, dt);
+
+	// Cut the first substep back if cells have been born or killed since the last time step
+	if (HasHadBirthsOrDeaths())
+	{
+		step_size = std::min(step_size, mEventStepFraction*dt);
+	}
+
+	double time_remaining = dt;
+	while (time_remaining > 0.0)
+	{
+		std::vector<c_vector<double, 2> > forces = this->ComputeForcesIncludingDamping();
+
+		double max_speed = 0.0;
+		for (unsigned i=0; i<forces.size(); i++)
+		{
+			max_speed = std::max(max_speed, norm_2(forces[i]));
+		}
+
+		// Grow by at most a factor of two, and keep the displacement bounded
+		double allowed_step = mMaxDisplacement/std::max(max_speed, DBL_MIN);
+		double controlled_step = std::max(std::min(step_size, allowed_step), mMinTimeStep);
+
+		// Don't leave a tiny sliver at the end of the time step
+		double present_step = controlled_step;
+		if (present_step >= time_remaining || time_remaining - present_step < mMinTimeStep)
+		{
+			present_step = time_remaining;
+		}
+
+		unsigned index = 0;
+		for (AbstractMesh<2,2>::NodeIterator node_iter = this->mpCellPopulation->rGetMesh().GetNodeIteratorBegin();
+			 node_iter != this->mpCellPopulation->rGetMesh().GetNodeIteratorEnd();
+			 ++node_iter, ++index)
+		{
+			c_vector<double, 2> new_location = node_iter->rGetLocation() + present_step*forces[index];
+			this->SafeNodePositionUpdate(node_iter->GetIndex(), new_location);
+		}
+
+		time_remaining -= present_step;
+		mNumSubsteps++;
+		mSmallestStepSize = std::min(mSmallestStepSize, present_step);
+
+		step_size = 2.0*controlled_step;
+	}
+
+	mNextStepSize = step_size;
+}
+
+void CryptAdaptiveNumericalMethod::OutputNumericalMethodParameters(out_stream& rParamsFile)
+{
+	*rParamsFile <<  "\t\t\t<MaxDisplacement>"<<  mMaxDisplacement << "</MaxDisplacement> \n";
+	*rParamsFile <<  "\t\t\t<MinTimeStep>"<<  mMinTimeStep << "</MinTimeStep> \n";
+	*rParamsFile <<  "\t\t\t<EventStepFraction>"<<  mEventStepFraction << "</EventStepFraction> \n";
+
+	// Call direct parent class
+	ForwardEulerNumericalMethod<2,2>::OutputNumericalMethodParameters(rParamsFile);
+}
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+CHASTE_CLASS_EXPORT(CryptAdaptiveNumericalMethod)
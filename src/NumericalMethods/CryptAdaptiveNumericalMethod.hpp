@@ -0,0 +1,109 @@
+#ifndef CRYPTADAPTIVENUMERICALMETHOD_HPP_
+#define CRYPTADAPTIVENUMERICALMETHOD_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "ForwardEulerNumericalMethod.hpp"
+
+/*
+ * Forward Euler with a step size controlled by the forces on the nodes.
+ *
+ * SimulationTime still advances by the simulation's fixed dt, so cell cycles and the
+ * age-dependent spring rest lengths and apoptosis timing in the spring forces see the
+ * same times as before. Each time step is covered by as many substeps as are needed
+ * to keep every node's displacement in a substep below mMaxDisplacement. When the
+ * tissue is quiet one substep covers the whole time step, so the simulation's dt can
+ * be set well above the 0.005 needed for the stiffest interactions.
+ *
+ * The substep grows by at most a factor of two per substep, and is cut back to
+ * mEventStepFraction of dt on the first step after cells are born or killed, as new
+ * springs after a division or the gap left by an anoikis death give large forces
+ * before they have been computed. A CryptCellPopulationWithGhostNodes says which cells
+ * were born and killed at each remesh; for other populations a new cell is spotted by
+ * its id being larger than any seen before, and a death by the number of cells.
+ */
+
+class CryptAdaptiveNumericalMethod : public ForwardEulerNumericalMethod<2,2>
+{
+private:
+
+    // Largest distance any node may move in one substep
+    double mMaxDisplacement;
+
+    // Smallest substep allowed, so a bad configuration can't stall the simulation
+    double mMinTimeStep;
+
+    // Largest first substep after a division or death, as a fraction of dt
+    double mEventStepFraction;
+
+    // Substep to start the next time step with, carried over from the last one
+    double mNextStepSize;
+
+    // Number of real cells, largest cell id and topology version at the last time step, to spot divisions and deaths
+    unsigned mLastNumCells;
+    unsigned mLastMaxCellId;
+    unsigned mLastTopologyVersion;
+
+    // Diagnostics
+    unsigned mNumTimeSteps;
+    unsigned mNumSubsteps;
+    double mSmallestStepSize;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<ForwardEulerNumericalMethod<2,2> >(*this);
+        archive & mMaxDisplacement;
+        archive & mMinTimeStep;
+        archive & mEventStepFraction;
+    }
+
+    /* Whether cells have been born or killed since the last time step */
+    bool HasHadBirthsOrDeaths();
+
+public:
+
+    CryptAdaptiveNumericalMethod();
+
+    ~CryptAdaptiveNumericalMethod();
+
+    void SetMaxDisplacement(double maxDisplacement);
+
+    double GetMaxDisplacement();
+
+    void SetMinTimeStep(double minTimeStep);
+
+    double GetMinTimeStep();
+
+    void SetEventStepFraction(double eventStepFraction);
+
+    double GetEventStepFraction();
+
+    /* Average number of substeps per time step so far */
+    double GetMeanSubstepsPerTimeStep();
+
+    double GetSmallestStepSize();
+
+    /**
+     * Overridden UpdateAllNodePositions() method.
+     *
+     * Moves the nodes through a whole time step of length dt in force-limited substeps.
+     *
+     * @param dt the simulation time step
+     */
+    void UpdateAllNodePositions(double dt);
+
+    /**
+     * Overridden OutputNumericalMethodParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputNumericalMethodParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+CHASTE_CLASS_EXPORT(CryptAdaptiveNumericalMethod)
+
+#endif /* CRYPTADAPTIVENUMERICALMETHOD_HPP_ */
@@ -0,0 +1,257 @@
+#include "CryptMultiRateNumericalMethod.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+#include "MembraneCellProliferativeType.hpp"
+#include "TransitCellProliferativeType.hpp"
+#include "StemCellProliferativeType.hpp"
+
+CryptMultiRateNumericalMethod::CryptMultiRateNumericalMethod()
+	: ForwardEulerNumericalMethod<2,2>(),
+	mNumSubsteps(5),
+	mNumSlowForceEvaluations(0),
+	mNumFastForceEvaluations(0),
+	mFastNodesTopologyVersion(UINT_MAX),
+	mFastNodesClassChangeVersion(UINT_MAX)
+{
+}
+
+CryptMultiRateNumericalMethod::~CryptMultiRateNumericalMethod()
+{
+}
+
+void CryptMultiRateNumericalMethod::AddFastForce(boost::shared_ptr<AbstractForce<2,2> > pForce)
+{
+	mFastForces.push_back(pForce);
+}
+
+const std::vector<boost::shared_ptr<AbstractForce<2,2> > >& CryptMultiRateNumericalMethod::rGetFastForces()
+{
+	return mFastForces;
+}
+
+void CryptMultiRateNumericalMethod::SetMembraneSpringForce(boost::shared_ptr<LinearSpringForceMembraneCell<2> > pMembraneSpringForce)
+{
+	mpMembraneSpringForce = pMembraneSpringForce;
+}
+
+boost::shared_ptr<LinearSpringForceMembraneCell<2> > CryptMultiRateNumericalMethod::GetMembraneSpringForce()
+{
+	return mpMembraneSpringForce;
+}
+
+void CryptMultiRateNumericalMethod::SetNumSubsteps(unsigned numSubsteps)
+{
+	assert(numSubsteps > 0);
+	mNumSubsteps = numSubsteps;
+}
+
+unsigned CryptMultiRateNumericalMethod::GetNumSubsteps()
+{
+	return mNumSubsteps;
+}
+
+unsigned CryptMultiRateNumericalMethod::GetNumSlowForceEvaluations()
+{
+	return mNumSlowForceEvaluations;
+}
+
+unsigned CryptMultiRateNumericalMethod::GetNumFastForceEvaluations()
+{
+	return mNumFastForceEvaluations;
+}
+
+bool CryptMultiRateNumericalMethod::IsFastNode(unsigned nodeIndex)
+{
+	return nodeIndex < mIsFastNode.size() && mIsFastNode[nodeIndex];
+}
+
+void CryptMultiRateNumericalMethod::FindFastNodes()
+{
+	// Nothing to do if neither the crypt population's triangulation nor any cell's type has changed since last time
+	CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(this->mpCellPopulation);
+	if (p_crypt_population)
+	{
+		unsigned class_change_version = p_crypt_population->rGetCellAttributes().GetClassChangeVersion();
+		if (p_crypt_population->GetTopologyVersion() == mFastNodesTopologyVersion
+			&& class_change_version == mFastNodesClassChangeVersion)
+		{
+			return;
+		}
+		mFastNodesTopologyVersion = p_crypt_population->GetTopologyVersion();
+		mFastNodesClassChangeVersion = class_change_version;
+	}
+
+	mIsFastNode.assign(this->mpCellPopulation->rGetMesh().GetNumAllNodes(), false);
+	mMembraneSpringPairs.clear();
+
+	for (AbstractCellPopulation<2>::Iterator cell_iter = this->mpCellPopulation->Begin();
+		 cell_iter != this->mpCellPopulation->End();
+		 ++cell_iter)
+	{
+		if (!cell_iter->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>())
+		{
+			continue;
+		}
+
+		unsigned node_index = this->mpCellPopulation->GetLocationIndexUsingCell(*cell_iter);
+		mIsFastNode[node_index] = true;
+
+		std::set<unsigned> neighbouring_node_indices = this->mpCellPopulation->GetNeighbouringNodeIndices(node_index);
+		for (std::set<unsigned>::iterator iter = neighbouring_node_indices.begin();
+			 iter != neighbouring_node_indices.end();
+			 ++iter)
+		{
+			if (this->mpCellPopulation->IsGhostNode(*iter))
+			{
+				continue;
+			}
+			boost::shared_ptr<AbstractCellProliferativeType> p_type = this->mpCellPopulation->GetCellUsingLocationIndex(*iter)->GetCellProliferativeType();
+
+			// A spring between two membrane cells is seen from both ends, so only list it from the lower index
+			if (!p_type->IsType<MembraneCellProliferativeType>() || node_index < *iter)
+			{
+				mMembraneSpringPairs.push_back(std::make_pair(node_index, *iter));
+			}
+
+			// The epithelial cells attached to the membrane are dragged along with it
+			if (p_type->IsType<StemCellProliferativeType>() || p_type->IsType<TransitCellProliferativeType>())
+			{
+				mIsFastNode[*iter] = true;
+			}
+		}
+	}
+}
+
+void CryptMultiRateNumericalMethod::AddMembraneSpringForces()
+{
+	for (unsigned i=0; i<mMembraneSpringPairs.size(); i++)
+	{
+		unsigned node_a_index = mMembraneSpringPairs[i].first;
+		unsigned node_b_index = mMembraneSpringPairs[i].second;
+
+		c_vector<double, 2> force = mpMembraneSpringForce->CalculateForceBetweenNodes(node_a_index, node_b_index, *(this->mpCellPopulation));
+		this->mpCellPopulation->GetNode(node_a_index)->AddAppliedForceContribution(force);
+		c_vector<double, 2> negative_force = -1.0*force;
+		this->mpCellPopulation->GetNode(node_b_index)->AddAppliedForceContribution(negative_force);
+	}
+	mpMembraneSpringForce->AddBondForceContribution(*(this->mpCellPopulation));
+}
+
+void CryptMultiRateNumericalMethod::UpdateAllNodePositions(double dt)
+{
+	if (this->mUseUpdateNodeLocation || (mFastForces.empty() && !mpMembraneSpringForce))
+	{
+		// Nothing to substep
+		ForwardEulerNumericalMethod<2,2>::UpdateAllNodePositions(dt);
+		mNumSlowForceEvaluations++;
+		return;
+	}
+
+	FindFastNodes();
+
+	AbstractMesh<2,2>& r_mesh = this->mpCellPopulation->rGetMesh();
+
+	// Slow velocities, evaluated once at the start of the time step
+	std::vector<c_vector<double, 2> > forces = this->ComputeForcesIncludingDamping();
+	mNumSlowForceEvaluations++;
+
+	std::vector<c_vector<double, 2> >& slow_velocities = mSlowVelocities;
+	slow_velocities.assign(r_mesh.GetNumAllNodes(), zero_vector<double>(2));
+	unsigned index = 0;
+	for (AbstractMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+		 node_iter != r_mesh.GetNodeIteratorEnd();
+		 ++node_iter, ++index)
+	{
+		slow_velocities[node_iter->GetIndex()] = forces[index];
+	}
+
+	// The springs on the membrane are in the slow forces too, so take them back out
+	if (mpMembraneSpringForce)
+	{
+		for (AbstractMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+			 node_iter != r_mesh.GetNodeIteratorEnd();
+			 ++node_iter)
+		{
+			node_iter->ClearAppliedForce();
+		}
+
+		AddMembraneSpringForces();
+
+		for (AbstractMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+			 node_iter != r_mesh.GetNodeIteratorEnd();
+			 ++node_iter)
+		{
+			unsigned node_index = node_iter->GetIndex();
+			slow_velocities[node_index] -= node_iter->rGetAppliedForce()/this->mpCellPopulation->GetDampingConstant(node_index);
+		}
+	}
+
+	// Displacement of the slow nodes from the fast forces, applied at the end
+	std::vector<c_vector<double, 2> >& slow_node_fast_displacements = mSlowNodeFastDisplacements;
+	slow_node_fast_displacements.assign(r_mesh.GetNumAllNodes(), zero_vector<double>(2));
+
+	double substep = dt/mNumSubsteps;
+	for (unsigned step=0; step<mNumSubsteps; step++)
+	{
+		for (AbstractMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+			 node_iter != r_mesh.GetNodeIteratorEnd();
+			 ++node_iter)
+		{
+			node_iter->ClearAppliedForce();
+		}
+
+		for (unsigned i=0; i<mFastForces.size(); i++)
+		{
+			mFastForces[i]->AddForceContribution(*(this->mpCellPopulation));
+		}
+		if (mpMembraneSpringForce)
+		{
+			AddMembraneSpringForces();
+		}
+		mNumFastForceEvaluations++;
+
+		for (AbstractMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+			 node_iter != r_mesh.GetNodeIteratorEnd();
+			 ++node_iter)
+		{
+			unsigned node_index = node_iter->GetIndex();
+			c_vector<double, 2> fast_velocity = node_iter->rGetAppliedForce()/this->mpCellPopulation->GetDampingConstant(node_index);
+
+			if (mIsFastNode[node_index])
+			{
+				c_vector<double, 2> new_location = node_iter->rGetLocation() + substep*(slow_velocities[node_index] + fast_velocity);
+				this->SafeNodePositionUpdate(node_index, new_location);
+			}
+			else
+			{
+				slow_node_fast_displacements[node_index] += substep*fast_velocity;
+			}
+		}
+	}
+
+	// Now move everything else through the whole time step
+	for (AbstractMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+		 node_iter != r_mesh.GetNodeIteratorEnd();
+		 ++node_iter)
+	{
+		unsigned node_index = node_iter->GetIndex();
+		if (!mIsFastNode[node_index])
+		{
+			c_vector<double, 2> new_location = node_iter->rGetLocation() + dt*slow_velocities[node_index] + slow_node_fast_displacements[node_index];
+			this->SafeNodePositionUpdate(node_index, new_location);
+		}
+	}
+}
+
+void CryptMultiRateNumericalMethod::OutputNumericalMethodParameters(out_stream& rParamsFile)
+{
+	*rParamsFile <<  "\t\t\t<NumSubsteps>"<<  mNumSubsteps << "</NumSubsteps> \n";
+	*rParamsFile <<  "\t\t\t<NumFastForces>"<<  mFastForces.size() << "</NumFastForces> \n";
+	*rParamsFile <<  "\t\t\t<FastMembraneSprings>"<<  bool(mpMembraneSpringForce) << "</FastMembraneSprings> \n";
+
+	// Call direct parent class
+	ForwardEulerNumericalMethod<2,2>::OutputNumericalMethodParameters(rParamsFile);
+}
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+CHASTE_CLASS_EXPORT(CryptMultiRateNumericalMethod)
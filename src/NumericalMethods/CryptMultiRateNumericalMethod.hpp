@@ -0,0 +1,132 @@
+#ifndef CRYPTMULTIRATENUMERICALMETHOD_HPP_
+#define CRYPTMULTIRATENUMERICALMETHOD_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+
+#include "ForwardEulerNumericalMethod.hpp"
+#include "AbstractForce.hpp"
+#include "LinearSpringForceMembraneCell.hpp"
+
+#include <climits>
+
+/*
+ * Forward Euler with two rates: the stiff forces on the membrane are integrated with
+ * a fine step, everything else with the simulation's dt.
+ *
+ * The forces added to the simulation are the slow forces. They are evaluated once per
+ * time step, as usual. The fast forces (e.g. MembraneCellForce) are given to this class
+ * with AddFastForce() instead of to the simulation. They are evaluated mNumSubsteps
+ * times per time step.
+ *
+ * The springs joined to the membrane are as stiff as the membrane torsion. If the
+ * simulation's LinearSpringForceMembraneCell is given with SetMembraneSpringForce(), its
+ * springs with a membrane cell at either end (and its membrane bonds, if it has a
+ * MembraneBondGraph) are taken out of the slow velocities and evaluated at every substep
+ * with the fast forces. The force itself stays in the simulation.
+ *
+ * The fast nodes are the membrane cells and the stem and transit cells next to them.
+ * They are moved in each substep by their slow velocity plus the current fast force.
+ * Every other node is moved once at the end of the time step, by its slow velocity
+ * plus whatever fast force reached it during the substeps.
+ *
+ * The fast nodes and membrane springs are found from the mesh. With a
+ * CryptCellPopulationWithGhostNodes they are kept until its topology version changes;
+ * with any other population they are found again every time step.
+ */
+
+class CryptMultiRateNumericalMethod : public ForwardEulerNumericalMethod<2,2>
+{
+private:
+
+    // Forces evaluated at every substep
+    std::vector<boost::shared_ptr<AbstractForce<2,2> > > mFastForces;
+
+    // Number of fast substeps per simulation time step
+    unsigned mNumSubsteps;
+
+    // Diagnostics: number of times each set of forces has been evaluated
+    unsigned mNumSlowForceEvaluations;
+    unsigned mNumFastForceEvaluations;
+
+    // The simulation's spring force, whose springs on the membrane are integrated with the fast forces
+    boost::shared_ptr<LinearSpringForceMembraneCell<2> > mpMembraneSpringForce;
+
+    // Whether each node is fast, and the pairs of neighbouring real nodes with a membrane cell at either end
+    std::vector<bool> mIsFastNode;
+    std::vector<std::pair<unsigned, unsigned> > mMembraneSpringPairs;
+
+    // Topology and class change versions of the crypt population when the above were found; UINT_MAX if not yet found. Not archived.
+    unsigned mFastNodesTopologyVersion;
+    unsigned mFastNodesClassChangeVersion;
+
+    // Scratch space for each time step, kept so it is only allocated once. Not archived.
+    std::vector<c_vector<double, 2> > mSlowVelocities;
+    std::vector<c_vector<double, 2> > mSlowNodeFastDisplacements;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<ForwardEulerNumericalMethod<2,2> >(*this);
+        archive & mFastForces;
+        archive & mNumSubsteps;
+        archive & mpMembraneSpringForce;
+    }
+
+    /* Mark the membrane nodes and the epithelial nodes attached to them as fast, and list the springs on the membrane */
+    void FindFastNodes();
+
+    /* Add the forces of the springs on the membrane to the nodes */
+    void AddMembraneSpringForces();
+
+public:
+
+    CryptMultiRateNumericalMethod();
+
+    ~CryptMultiRateNumericalMethod();
+
+    /* Add a force to be evaluated at every substep. It should not also be added to the simulation. */
+    void AddFastForce(boost::shared_ptr<AbstractForce<2,2> > pForce);
+
+    const std::vector<boost::shared_ptr<AbstractForce<2,2> > >& rGetFastForces();
+
+    /* Integrate the springs of this force (which stays in the simulation) that are joined to the membrane with the fast forces */
+    void SetMembraneSpringForce(boost::shared_ptr<LinearSpringForceMembraneCell<2> > pMembraneSpringForce);
+
+    boost::shared_ptr<LinearSpringForceMembraneCell<2> > GetMembraneSpringForce();
+
+    void SetNumSubsteps(unsigned numSubsteps);
+
+    unsigned GetNumSubsteps();
+
+    unsigned GetNumSlowForceEvaluations();
+
+    unsigned GetNumFastForceEvaluations();
+
+    /* Whether the node was moved with the fine step in the last time step */
+    bool IsFastNode(unsigned nodeIndex);
+
+    /**
+     * Overridden UpdateAllNodePositions() method.
+     *
+     * Evaluates the slow forces once, then substeps the fast nodes under the fast forces.
+     *
+     * @param dt the simulation time step
+     */
+    void UpdateAllNodePositions(double dt);
+
+    /**
+     * Overridden OutputNumericalMethodParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputNumericalMethodParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+CHASTE_CLASS_EXPORT(CryptMultiRateNumericalMethod)
+
+#endif /* CRYPTMULTIRATENUMERICALMETHOD_HPP_ */
@@ -0,0 +1,286 @@
+#include "CryptSemiImplicitNumericalMethod.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	/*
+	 * Solve A x = b in place for a banded matrix A with half-bandwidth hb, using Gaussian
+	 * elimination with partial pivoting. Row i of A is stored in rBand[i*(3*hb+1) ...] and
+	 * holds columns i-hb to i+2*hb; the extra hb columns on the right take the fill-in
+	 * from row swaps. Returns false if A is singular.
+	 */
+	bool SolveBandedSystem(std::vector<double>& rBand, std::vector<double>& rRhs, unsigned size, unsigned hb)
+	{
+		unsigned width = 3*hb + 1;
+		auto band = [&](unsigned i, unsigned j) -> double& { return rBand[i*width + j + hb - i]; };
+
+		for (unsigned k=0; k<size; k++)
+		{
+			unsigned last_row = std::min(size - 1, k + hb);
+			unsigned last_column = std::min(size - 1, k + 2*hb);
+
+			unsigned pivot = k;
+			for (unsigned i=k+1; i<=last_row; i++)
+			{
+				if (fabs(band(i, k)) > fabs(band(pivot, k)))
+				{
+					pivot = i;
+				}
+			}
+			if (fabs(band(pivot, k)) < 1e-14)
+			{
+				return false;
+			}
+
+			if (pivot != k)
+			{
+				for (unsigned j=k; j<=last_column; j++)
+				{
+					std::swap(band(k, j), band(pivot, j));
+				}
+				std::swap(rRhs[k], rRhs[pivot]);
+			}
+
+			for (unsigned i=k+1; i<=last_row; i++)
+			{
+				double factor = band(i, k)/band(k, k);
+				if (factor == 0.0)
+				{
+					continue;
+				}
+				for (unsigned j=k; j<=last_column; j++)
+				{
+					band(i, j) -= factor*band(k, j);
+				}
+				rRhs[i] -= factor*rRhs[k];
+			}
+		}
+
+		for (unsigned i=size; i-- > 0; )
+		{
+			double sum = rRhs[i];
+			unsigned last_column = std::min(size - 1, i + 2*hb);
+			for (unsigned j=i+1; j<=last_column; j++)
+			{
+				sum -= band(i, j)*rRhs[j];
+			}
+			rRhs[i] = sum/band(i, i);
+		}
+
+		return true;
+	}
+}
+
+CryptSemiImplicitNumericalMethod::CryptSemiImplicitNumericalMethod()
+	: ForwardEulerNumericalMethod<2,2>(),
+	mFiniteDifferenceStep(1e-6),
+	mNumExplicitFallbacks(0)
+{
+}
+
+CryptSemiImplicitNumericalMethod::~CryptSemiImplicitNumericalMethod()
+{
+}
+
+void CryptSemiImplicitNumericalMethod::SetMembraneForce(boost::shared_ptr<MembraneCellForce> pMembraneForce)
+{
+	mpMembraneForce = pMembraneForce;
+}
+
+boost::shared_ptr<MembraneCellForce> CryptSemiImplicitNumericalMethod::GetMembraneForce()
+{
+	return mpMembraneForce;
+}
+
+void CryptSemiImplicitNumericalMethod::SetFiniteDifferenceStep(double finiteDifferenceStep)
+{
+	assert(finiteDifferenceStep > 0.0);
+	mFiniteDifferenceStep = finiteDifferenceStep;
+}
+
+unsigned CryptSemiImplicitNumericalMethod::GetNumExplicitFallbacks()
+{
+	return mNumExplicitFallbacks;
+}
+
+bool CryptSemiImplicitNumericalMethod::SolveSection(const std::vector<unsigned>& rSection,
+															const std::vector<c_vector<double, 2> >& rExplicitVelocities,
+															double dt,
+															std::vector<c_vector<double, 2> >& rDisplacements)
+{
+	unsigned num_nodes = rSection.size();
+	unsigned size = 2*num_nodes;
+
+	// A triplet's forces depend on its three nodes, so a node's force depends on the nodes up to two either side
+	unsigned hb = 5;
+	unsigned width = 3*hb + 1;
+
+	// Reuse the scratch buffers from the last section; they only grow
+	std::vector<c_vector<double, 2> >& locations = mLocations;
+	std::vector<double>& damping = mDamping;
+	std::vector<CellPtr>& section_cells = mSectionCells;
+	locations.resize(num_nodes);
+	damping.resize(num_nodes);
+	section_cells.resize(num_nodes);
+	for (unsigned i=0; i<num_nodes; i++)
+	{
+		locations[i] = this->mpCellPopulation->GetNode(rSection[i])->rGetLocation();
+		damping[i] = this->mpCellPopulation->GetDampingConstant(rSection[i]);
+		section_cells[i] = this->mpCellPopulation->GetCellUsingLocationIndex(rSection[i]);
+	}
+
+	// Forces from each triplet at the current positions
+	std::vector<c_vector<double, 2> >& triplet_left = mTripletLeft;
+	std::vector<c_vector<double, 2> >& triplet_right = mTripletRight;
+	std::vector<c_vector<double, 2> >& forces = mSectionForces;
+	triplet_left.assign(num_nodes, zero_vector<double>(2));
+	triplet_right.assign(num_nodes, zero_vector<double>(2));
+	forces.assign(num_nodes, zero_vector<double>(2));
+	for (unsigned t=0; t+2<num_nodes; t++)
+	{
+		mpMembraneForce->CalculateTripletForces(*(this->mpCellPopulation), section_cells[t+1], locations[t], locations[t+1], locations[t+2], triplet_left[t], triplet_right[t]);
+		forces[t] += triplet_left[t];
+		forces[t+2] += triplet_right[t];
+	}
+
+	// Start from the identity
+	std::vector<double>& band = mBand;
+	band.assign(size*width, 0.0);
+	for (unsigned i=0; i<size; i++)
+	{
+		band[i*width + hb] = 1.0;
+	}
+
+	// Subtract dt/eta J, one column at a time. Moving node k only changes the triplets that start at k-2, k-1 and k.
+	std::vector<c_vector<double, 2> >& perturbed_locations = mPerturbedLocations;
+	for (unsigned k=0; k<num_nodes; k++)
+	{
+		unsigned first_triplet = (k >= 2) ? k - 2 : 0;
+		for (unsigned d=0; d<2; d++)
+		{
+			perturbed_locations.assign(locations.begin() + first_triplet, locations.begin() + std::min(num_nodes, k + 3));
+			perturbed_locations[k - first_triplet][d] += mFiniteDifferenceStep;
+
+			unsigned column = 2*k + d;
+			for (unsigned t=first_triplet; t<=k && t+2<num_nodes; t++)
+			{
+				c_vector<double, 2> force_left;
+				c_vector<double, 2> force_right;
+				mpMembraneForce->CalculateTripletForces(*(this->mpCellPopulation), section_cells[t+1],
+						perturbed_locations[t - first_triplet], perturbed_locations[t + 1 - first_triplet], perturbed_locations[t + 2 - first_triplet],
+						force_left, force_right);
+
+				for (unsigned e=0; e<2; e++)
+				{
+					unsigned left_row = 2*t + e;
+					unsigned right_row = 2*(t+2) + e;
+					band[left_row*width + column + hb - left_row] -= dt/damping[t]*(force_left[e] - triplet_left[t][e])/mFiniteDifferenceStep;
+					band[right_row*width + column + hb - right_row] -= dt/damping[t+2]*(force_right[e] - triplet_right[t][e])/mFiniteDifferenceStep;
+				}
+			}
+		}
+	}
+
+	std::vector<double>& rhs = mRhs;
+	rhs.resize(size);
+	for (unsigned i=0; i<num_nodes; i++)
+	{
+		for (unsigned e=0; e<2; e++)
+		{
+			rhs[2*i + e] = dt*(rExplicitVelocities[i][e] + forces[i][e]/damping[i]);
+		}
+	}
+
+	bool solved = SolveBandedSystem(band, rhs, size, hb);
+
+	rDisplacements.resize(num_nodes);
+	for (unsigned i=0; i<num_nodes; i++)
+	{
+		if (solved)
+		{
+			rDisplacements[i][0] = rhs[2*i];
+			rDisplacements[i][1] = rhs[2*i + 1];
+		}
+		else
+		{
+			rDisplacements[i] = dt*(rExplicitVelocities[i] + forces[i]/damping[i]);
+		}
+	}
+
+	return solved;
+}
+
+void CryptSemiImplicitNumericalMethod::UpdateAllNodePositions(double dt)
+{
+	if (this->mUseUpdateNodeLocation || !mpMembraneForce)
+	{
+		ForwardEulerNumericalMethod<2,2>::UpdateAllNodePositions(dt);
+		return;
+	}
+
+	AbstractMesh<2,2>& r_mesh = this->mpCellPopulation->rGetMesh();
+
+	// Velocities from every other force
+	std::vector<c_vector<double, 2> > forces = this->ComputeForcesIncludingDamping();
+
+	std::vector<c_vector<double, 2> >& displacements = mDisplacements;
+	displacements.assign(r_mesh.GetNumAllNodes(), zero_vector<double>(2));
+	unsigned index = 0;
+	for (AbstractMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+		 node_iter != r_mesh.GetNodeIteratorEnd();
+		 ++node_iter, ++index)
+	{
+		displacements[node_iter->GetIndex()] = dt*forces[index];
+	}
+
+	// Replace the explicit displacements of the membrane with the implicit ones
+	const std::vector<std::vector<unsigned> >& membrane_sections = mpMembraneForce->rGetCachedMembraneSections(*(this->mpCellPopulation));
+	for (unsigned s=0; s<membrane_sections.size(); s++)
+	{
+		const std::vector<unsigned>& r_section = membrane_sections[s];
+		if (r_section.size() < 3)
+		{
+			continue;
+		}
+
+		std::vector<c_vector<double, 2> >& explicit_velocities = mExplicitVelocities;
+		explicit_velocities.resize(r_section.size());
+		for (unsigned i=0; i<r_section.size(); i++)
+		{
+			explicit_velocities[i] = displacements[r_section[i]]/dt;
+		}
+
+		std::vector<c_vector<double, 2> >& section_displacements = mSectionDisplacements;
+		if (!SolveSection(r_section, explicit_velocities, dt, section_displacements))
+		{
+			mNumExplicitFallbacks++;
+		}
+
+		for (unsigned i=0; i<r_section.size(); i++)
+		{
+			displacements[r_section[i]] = section_displacements[i];
+		}
+	}
+
+	for (AbstractMesh<2,2>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+		 node_iter != r_mesh.GetNodeIteratorEnd();
+		 ++node_iter)
+	{
+		c_vector<double, 2> new_location = node_iter->rGetLocation() + displacements[node_iter->GetIndex()];
+		this->SafeNodePositionUpdate(node_iter->GetIndex(), new_location);
+	}
+}
+
+void CryptSemiImplicitNumericalMethod::OutputNumericalMethodParameters(out_stream& rParamsFile)
+{
+	*rParamsFile <<  "\t\t\t<FiniteDifferenceStep>"<<  mFiniteDifferenceStep << "</FiniteDifferenceStep> \n";
+
+	// Call direct parent class
+	ForwardEulerNumericalMethod<2,2>::OutputNumericalMethodParameters(rParamsFile);
+}
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+CHASTE_CLASS_EXPORT(CryptSemiImplicitNumericalMethod)
@@ -0,0 +1,109 @@
+#ifndef CRYPTSEMIIMPLICITNUMERICALMETHOD_HPP_
+#define CRYPTSEMIIMPLICITNUMERICALMETHOD_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+
+#include "ForwardEulerNumericalMethod.hpp"
+#include "MembraneCellForce.hpp"
+
+/*
+ * Forward Euler for the tissue, linearly implicit (backward) Euler for the membrane torsion.
+ *
+ * The MembraneCellForce is given to this class with SetMembraneForce() instead of to the
+ * simulation. Every other force is integrated explicitly as usual. Each membrane section
+ * from GetMembraneSections() is ordered along the chain, and the torsion on a node only
+ * depends on the nodes up to two places either side of it. So the linearised system
+ *
+ *     (I - dt/eta J) dx = dt (v + f(x)/eta)
+ *
+ * for the displacement dx of the section is banded, with half-bandwidth 5 in the x and y
+ * unknowns. Here J is the Jacobian of the torsion forces, found by finite differences one
+ * triplet at a time, and v is the explicit velocity from the other forces. It is solved
+ * with banded Gaussian elimination with partial pivoting, so the cost is linear in the
+ * length of the membrane.
+ *
+ * If a section's system is singular, that section falls back to an explicit step.
+ */
+
+class CryptSemiImplicitNumericalMethod : public ForwardEulerNumericalMethod<2,2>
+{
+private:
+
+    boost::shared_ptr<MembraneCellForce> mpMembraneForce;
+
+    // Step used for the finite difference Jacobian
+    double mFiniteDifferenceStep;
+
+    // Number of section solves that fell back to an explicit step
+    unsigned mNumExplicitFallbacks;
+
+    /*
+     * Scratch space, kept between time steps so that the per-node and per-section vectors
+     * are allocated once rather than every step. Not archived.
+     */
+    std::vector<c_vector<double, 2> > mDisplacements;
+    std::vector<c_vector<double, 2> > mExplicitVelocities;
+    std::vector<c_vector<double, 2> > mSectionDisplacements;
+    std::vector<c_vector<double, 2> > mLocations;
+    std::vector<double> mDamping;
+    std::vector<CellPtr> mSectionCells;
+    std::vector<c_vector<double, 2> > mTripletLeft;
+    std::vector<c_vector<double, 2> > mTripletRight;
+    std::vector<c_vector<double, 2> > mSectionForces;
+    std::vector<c_vector<double, 2> > mPerturbedLocations;
+    std::vector<double> mBand;
+    std::vector<double> mRhs;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<ForwardEulerNumericalMethod<2,2> >(*this);
+        archive & mpMembraneForce;
+        archive & mFiniteDifferenceStep;
+    }
+
+    /* Work out the displacement of each node of a section for this time step. Returns false if the system is singular. */
+    bool SolveSection(const std::vector<unsigned>& rSection,
+                      const std::vector<c_vector<double, 2> >& rExplicitVelocities,
+                      double dt,
+                      std::vector<c_vector<double, 2> >& rDisplacements);
+
+public:
+
+    CryptSemiImplicitNumericalMethod();
+
+    ~CryptSemiImplicitNumericalMethod();
+
+    /* The membrane force to treat implicitly. It should not also be added to the simulation. */
+    void SetMembraneForce(boost::shared_ptr<MembraneCellForce> pMembraneForce);
+
+    boost::shared_ptr<MembraneCellForce> GetMembraneForce();
+
+    void SetFiniteDifferenceStep(double finiteDifferenceStep);
+
+    unsigned GetNumExplicitFallbacks();
+
+    /**
+     * Overridden UpdateAllNodePositions() method.
+     *
+     * Moves the membrane sections with a linearly implicit step and everything else explicitly.
+     *
+     * @param dt the simulation time step
+     */
+    void UpdateAllNodePositions(double dt);
+
+    /**
+     * Overridden OutputNumericalMethodParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputNumericalMethodParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+CHASTE_CLASS_EXPORT(CryptSemiImplicitNumericalMethod)
+
+#endif /* CRYPTSEMIIMPLICITNUMERICALMETHOD_HPP_ */
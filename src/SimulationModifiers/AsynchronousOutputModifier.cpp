@@ -0,0 +1,196 @@
+#include "AsynchronousOutputModifier.hpp"
+#include "SimulationTime.hpp"
+#include "AbstractCellProliferativeType.hpp"
+
+AsynchronousOutputModifier::AsynchronousOutputModifier()
+	: AbstractCellBasedSimulationModifier<2>(),
+	mSamplingTimestepMultiple(1),
+	mNumBuffers(2),
+	mNumStalls(0),
+	mFinished(true)
+{
+}
+
+AsynchronousOutputModifier::~AsynchronousOutputModifier()
+{
+	StopWriterThread();
+}
+
+void AsynchronousOutputModifier::SetSamplingTimestepMultiple(unsigned samplingTimestepMultiple)
+{
+	assert(samplingTimestepMultiple > 0);
+	mSamplingTimestepMultiple = samplingTimestepMultiple;
+}
+
+unsigned AsynchronousOutputModifier::GetSamplingTimestepMultiple()
+{
+	return mSamplingTimestepMultiple;
+}
+
+void AsynchronousOutputModifier::SetNumBuffers(unsigned numBuffers)
+{
+	assert(numBuffers > 1);
+	mNumBuffers = numBuffers;
+}
+
+unsigned AsynchronousOutputModifier::GetNumBuffers()
+{
+	return mNumBuffers;
+}
+
+unsigned AsynchronousOutputModifier::GetNumStalls()
+{
+	return mNumStalls;
+}
+
+void AsynchronousOutputModifier::SetupSolve(AbstractCellPopulation<2,2>& rCellPopulation, std::string outputDirectory)
+{
+	// In case Solve() is called again without the previous run finishing cleanly
+	StopWriterThread();
+
+	OutputFileHandler output_file_handler(outputDirectory + "/", false);
+	mpSamplesFile = output_file_handler.OpenOutputFile("cellsamples.dat");
+
+	// Allocate the buffers up front, sized for the current population so the first
+	// few samples don't have to grow them
+	unsigned num_cells = rCellPopulation.GetNumRealCells();
+	mBuffers.resize(mNumBuffers);
+	mFreeBuffers.clear();
+	mFilledBuffers.clear();
+	for (unsigned i=0; i<mNumBuffers; i++)
+	{
+		mBuffers[i].mCellData.reserve(3*num_cells);
+		mBuffers[i].mLocations.reserve(2*num_cells);
+		mFreeBuffers.push_back(i);
+	}
+
+	mFinished = false;
+	mWriterThread = std::thread(&AsynchronousOutputModifier::WriteSamples, this);
+
+	TakeSample(rCellPopulation);
+}
+
+void AsynchronousOutputModifier::UpdateAtEndOfTimeStep(AbstractCellPopulation<2,2>& rCellPopulation)
+{
+	if (SimulationTime::Instance()->GetTimeStepsElapsed() % mSamplingTimestepMultiple == 0)
+	{
+		TakeSample(rCellPopulation);
+	}
+}
+
+void AsynchronousOutputModifier::UpdateAtEndOfSolve(AbstractCellPopulation<2,2>& rCellPopulation)
+{
+	StopWriterThread();
+}
+
+void AsynchronousOutputModifier::TakeSample(AbstractCellPopulation<2>& rCellPopulation)
+{
+	unsigned buffer_index;
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		if (mFreeBuffers.empty())
+		{
+			// The writer has fallen behind, so wait for it to hand a buffer back
+			mNumStalls++;
+			mBufferFreed.wait(lock, [this]{ return !mFreeBuffers.empty(); });
+		}
+		buffer_index = mFreeBuffers.front();
+		mFreeBuffers.pop_front();
+	}
+
+	// Only this thread touches the buffer until it is queued, so no lock is needed to fill it.
+	// clear() keeps the capacity, so once the buffers have grown to fit the population
+	// this doesn't allocate.
+	SampleBuffer& r_buffer = mBuffers[buffer_index];
+	r_buffer.mTime = SimulationTime::Instance()->GetTime();
+	r_buffer.mCellData.clear();
+	r_buffer.mLocations.clear();
+
+	for (AbstractCellPopulation<2>::Iterator cell_iter = rCellPopulation.Begin();
+		 cell_iter != rCellPopulation.End();
+		 ++cell_iter)
+	{
+		c_vector<double, 2> location = rCellPopulation.GetLocationOfCellCentre(*cell_iter);
+
+		r_buffer.mCellData.push_back(rCellPopulation.GetLocationIndexUsingCell(*cell_iter));
+		r_buffer.mCellData.push_back(cell_iter->GetCellId());
+		r_buffer.mCellData.push_back(cell_iter->GetCellProliferativeType()->GetColour());
+		r_buffer.mLocations.push_back(location[0]);
+		r_buffer.mLocations.push_back(location[1]);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFilledBuffers.push_back(buffer_index);
+	}
+	mBufferFilled.notify_one();
+}
+
+void AsynchronousOutputModifier::WriteSamples()
+{
+	while (true)
+	{
+		unsigned buffer_index;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mBufferFilled.wait(lock, [this]{ return !mFilledBuffers.empty() || mFinished; });
+
+			if (mFilledBuffers.empty())
+			{
+				// Finished and nothing left to write
+				break;
+			}
+			buffer_index = mFilledBuffers.front();
+			mFilledBuffers.pop_front();
+		}
+
+		WriteBuffer(mBuffers[buffer_index]);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mFreeBuffers.push_back(buffer_index);
+		}
+		mBufferFreed.notify_one();
+	}
+
+	mpSamplesFile->close();
+}
+
+void AsynchronousOutputModifier::WriteBuffer(const SampleBuffer& rBuffer)
+{
+	*mpSamplesFile << rBuffer.mTime;
+
+	unsigned num_cells = rBuffer.mLocations.size()/2;
+	for (unsigned i=0; i<num_cells; i++)
+	{
+		*mpSamplesFile << "\t" << rBuffer.mCellData[3*i] << " " << rBuffer.mCellData[3*i+1] << " " << rBuffer.mCellData[3*i+2]
+					   << " " << rBuffer.mLocations[2*i] << " " << rBuffer.mLocations[2*i+1];
+	}
+	*mpSamplesFile << "\n";
+}
+
+void AsynchronousOutputModifier::StopWriterThread()
+{
+	if (mWriterThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mFinished = true;
+		}
+		mBufferFilled.notify_one();
+		mWriterThread.join();
+	}
+}
+
+void AsynchronousOutputModifier::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+	*rParamsFile << "\t\t\t<SamplingTimestepMultiple>" << mSamplingTimestepMultiple << "</SamplingTimestepMultiple> \n";
+	*rParamsFile << "\t\t\t<NumBuffers>" << mNumBuffers << "</NumBuffers> \n";
+
+	// Call method on direct parent class
+	AbstractCellBasedSimulationModifier<2>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+CHASTE_CLASS_EXPORT(AsynchronousOutputModifier)
@@ -0,0 +1,155 @@
+#ifndef ASYNCHRONOUSOUTPUTMODIFIER_HPP_
+#define ASYNCHRONOUSOUTPUTMODIFIER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+#include "OutputFileHandler.hpp"
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * A modifier that takes the per-sample output off the simulation thread.
+ *
+ * At each sampling step the cell locations, ids and proliferative type colours are
+ * copied into one of a small pool of preallocated buffers and handed to a writer
+ * thread, which formats and writes them to "cellsamples.dat" while the simulation
+ * carries on. If every buffer is still waiting to be written the simulation blocks
+ * until one is free, so a slow disk slows the run down rather than using up memory.
+ *
+ * Each line of the output is
+ *     time  [location_index cell_id colour x y] for each cell
+ *
+ * This replaces the simulation's own per-sample output rather than adding to it: give the
+ * simulation a SetSamplingTimestepMultiple() much larger than this modifier's (or no population
+ * writers), so that the blocking population writers only run occasionally, e.g. for the odd
+ * Voronoi snapshot, and the frequent samples go through here.
+ */
+
+class AsynchronousOutputModifier : public AbstractCellBasedSimulationModifier<2>
+{
+private:
+
+    /* A snapshot of the fields needed for one output line */
+    struct SampleBuffer
+    {
+        double mTime;
+        std::vector<unsigned> mCellData;   // location index, cell id, colour for each cell
+        std::vector<double> mLocations;    // x, y for each cell
+    };
+
+    // Number of time steps between samples
+    unsigned mSamplingTimestepMultiple;
+
+    // Number of sample buffers; two gives double buffering
+    unsigned mNumBuffers;
+
+    // Number of times the simulation had to wait for the writer thread
+    unsigned mNumStalls;
+
+    std::vector<SampleBuffer> mBuffers;
+
+    // Indices into mBuffers that are free to fill, and that are waiting to be written
+    std::deque<unsigned> mFreeBuffers;
+    std::deque<unsigned> mFilledBuffers;
+
+    std::mutex mMutex;
+    std::condition_variable mBufferFreed;
+    std::condition_variable mBufferFilled;
+
+    std::thread mWriterThread;
+
+    // Set when no more samples will be produced, so the writer thread can drain and stop
+    bool mFinished;
+
+    // Only touched by the writer thread while it is running
+    out_stream mpSamplesFile;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<2> >(*this);
+        archive & mSamplingTimestepMultiple;
+        archive & mNumBuffers;
+    }
+
+    /* Copy the current state of the population into a free buffer and queue it for writing */
+    void TakeSample(AbstractCellPopulation<2>& rCellPopulation);
+
+    /* Main loop of the writer thread */
+    void WriteSamples();
+
+    /* Format a single buffer to the output file */
+    void WriteBuffer(const SampleBuffer& rBuffer);
+
+    /* Tell the writer thread to finish and wait for it */
+    void StopWriterThread();
+
+public:
+
+    AsynchronousOutputModifier();
+
+    ~AsynchronousOutputModifier();
+
+    void SetSamplingTimestepMultiple(unsigned samplingTimestepMultiple);
+
+    unsigned GetSamplingTimestepMultiple();
+
+    /*
+     * Set the number of buffers shared with the writer thread. Must be at least 2,
+     * and must be called before the simulation is solved.
+     */
+    void SetNumBuffers(unsigned numBuffers);
+
+    unsigned GetNumBuffers();
+
+    /* Returns the number of samples for which the simulation had to wait for a free buffer */
+    unsigned GetNumStalls();
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Takes a sample every mSamplingTimestepMultiple time steps.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void UpdateAtEndOfTimeStep(AbstractCellPopulation<2,2>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Allocates the buffers, opens the output file, starts the writer thread and
+     * takes the initial sample.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    void SetupSolve(AbstractCellPopulation<2,2>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     *
+     * Waits for every outstanding sample to be written and closes the file.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void UpdateAtEndOfSolve(AbstractCellPopulation<2,2>& rCellPopulation);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+CHASTE_CLASS_EXPORT(AsynchronousOutputModifier)
+
+#endif /* ASYNCHRONOUSOUTPUTMODIFIER_HPP_ */
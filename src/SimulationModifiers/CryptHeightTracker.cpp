@@ -0,0 +1,102 @@
+#include "CryptHeightTracker.hpp"
+#include "CryptCellPopulationWithGhostNodes.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+const unsigned CryptHeightTracker::NUM_CLASSES;
+
+CryptHeightTracker::CryptHeightTracker()
+	: AbstractCellBasedSimulationModifier<2>()
+{
+	for (unsigned c=0; c<NUM_CLASSES; c++)
+	{
+		mMinHeights[c] = DBL_MAX;
+		mMaxHeights[c] = -DBL_MAX;
+		mNumCells[c] = 0;
+	}
+}
+
+CryptHeightTracker::~CryptHeightTracker()
+{
+}
+
+double CryptHeightTracker::GetOrificeHeight()
+{
+	return mMaxHeights[CryptCellAttributes::EPITHELIAL_CELL];
+}
+
+double CryptHeightTracker::GetBaseHeight()
+{
+	return mMinHeights[CryptCellAttributes::EPITHELIAL_CELL];
+}
+
+c_vector<double,2> CryptHeightTracker::GetCryptHeightExtremes()
+{
+	c_vector<double,2> extremes;
+	extremes[0] = GetOrificeHeight();
+	extremes[1] = GetBaseHeight();
+	return extremes;
+}
+
+double CryptHeightTracker::GetMinHeight(CryptCellAttributes::CellClass cellClass)
+{
+	return mMinHeights[cellClass];
+}
+
+double CryptHeightTracker::GetMaxHeight(CryptCellAttributes::CellClass cellClass)
+{
+	return mMaxHeights[cellClass];
+}
+
+unsigned CryptHeightTracker::GetNumCells(CryptCellAttributes::CellClass cellClass)
+{
+	return mNumCells[cellClass];
+}
+
+void CryptHeightTracker::UpdateHeights(AbstractCellPopulation<2>& rCellPopulation)
+{
+	for (unsigned c=0; c<NUM_CLASSES; c++)
+	{
+		mMinHeights[c] = DBL_MAX;
+		mMaxHeights[c] = -DBL_MAX;
+		mNumCells[c] = 0;
+	}
+
+	// The crypt population has the class of every node to hand
+	CryptCellPopulationWithGhostNodes* p_crypt_population = dynamic_cast<CryptCellPopulationWithGhostNodes*>(&rCellPopulation);
+	const CryptCellAttributes* p_attributes = p_crypt_population ? &(p_crypt_population->rGetCellAttributes()) : NULL;
+
+	for (AbstractCellPopulation<2>::Iterator cell_iter = rCellPopulation.Begin();
+		 cell_iter != rCellPopulation.End();
+		 ++cell_iter)
+	{
+		unsigned node_index = rCellPopulation.GetLocationIndexUsingCell(*cell_iter);
+		unsigned cell_class = p_attributes ? p_attributes->GetCellClass(node_index) : CryptCellAttributes::ClassifyCell(*cell_iter);
+		double height = rCellPopulation.GetNode(node_index)->rGetLocation()[1];
+
+		mMinHeights[cell_class] = std::min(mMinHeights[cell_class], height);
+		mMaxHeights[cell_class] = std::max(mMaxHeights[cell_class], height);
+		mNumCells[cell_class]++;
+	}
+}
+
+void CryptHeightTracker::SetupSolve(AbstractCellPopulation<2,2>& rCellPopulation, std::string outputDirectory)
+{
+	UpdateHeights(rCellPopulation);
+}
+
+void CryptHeightTracker::UpdateAtEndOfTimeStep(AbstractCellPopulation<2,2>& rCellPopulation)
+{
+	UpdateHeights(rCellPopulation);
+}
+
+void CryptHeightTracker::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+	// No parameters to output, so just call method on direct parent class
+	AbstractCellBasedSimulationModifier<2>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+CHASTE_CLASS_EXPORT(CryptHeightTracker)
@@ -0,0 +1,92 @@
+#ifndef CRYPTHEIGHTTRACKER_HPP_
+#define CRYPTHEIGHTTRACKER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+#include "CryptCellAttributes.hpp"
+
+/*
+ * A modifier that keeps track of the lowest and highest cell of each class (see
+ * CryptCellAttributes::CellClass), and so of the crypt base and orifice, as the cells move.
+ *
+ * At the end of each time step every cell is looked at once, and the extremes and number of
+ * cells of each class are stored, so the getters below are O(1) for killers, forces and
+ * output that need them during the next step instead of each scanning the cells itself.
+ */
+
+class CryptHeightTracker : public AbstractCellBasedSimulationModifier<2>
+{
+private:
+
+    static const unsigned NUM_CLASSES = CryptCellAttributes::OTHER_CELL + 1;
+
+    // The extremes and number of cells of each class at the last update
+    double mMinHeights[NUM_CLASSES];
+    double mMaxHeights[NUM_CLASSES];
+    unsigned mNumCells[NUM_CLASSES];
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<2> >(*this);
+    }
+
+    /* Find the extremes from the cells' current heights */
+    void UpdateHeights(AbstractCellPopulation<2>& rCellPopulation);
+
+public:
+
+    CryptHeightTracker();
+
+    ~CryptHeightTracker();
+
+    /* The height of the highest epithelial cell */
+    double GetOrificeHeight();
+
+    /* The height of the lowest epithelial cell */
+    double GetBaseHeight();
+
+    /* The orifice height followed by the base height, as the commented out GetCryptHeightExtremes() in the forces gave */
+    c_vector<double,2> GetCryptHeightExtremes();
+
+    /* The lowest and highest cell of a class at the last update. DBL_MAX and -DBL_MAX if there are none. */
+    double GetMinHeight(CryptCellAttributes::CellClass cellClass);
+
+    double GetMaxHeight(CryptCellAttributes::CellClass cellClass);
+
+    unsigned GetNumCells(CryptCellAttributes::CellClass cellClass);
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Finds the new extremes.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void UpdateAtEndOfTimeStep(AbstractCellPopulation<2,2>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Finds the extremes at the start of the simulation.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    void SetupSolve(AbstractCellPopulation<2,2>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+CHASTE_CLASS_EXPORT(CryptHeightTracker)
+
+#endif /* CRYPTHEIGHTTRACKER_HPP_ */
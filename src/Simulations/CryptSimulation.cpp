@@ -0,0 +1,248 @@
+#include "CryptSimulation.hpp"
+#include "CellBasedEventHandler.hpp"
+#include "StepSizeException.hpp"
+#include "Warnings.hpp"
+#include "AbstractSimpleCellCycleModel.hpp"
+#include "NoCellCycleModel.hpp"
+#include "SimulationTime.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+CryptSimulation::CryptSimulation(AbstractCellPopulation<2>& rCellPopulation,
+								bool deleteCellPopulationInDestructor,
+								bool initialiseCells)
+	: OffLatticeSimulation<2>(rCellPopulation, deleteCellPopulationInDestructor, initialiseCells),
+	mNumStepsWithOldLocations(0),
+	mNumStepsWithoutOldLocations(0),
+	mHasStepSizeExceptionOccurred(false),
+	mUseDivisionQueue(false),
+	mIsDivisionQueueBuilt(false),
+	mNumDivisionChecks(0)
+{
+}
+
+unsigned CryptSimulation::GetNumStepsWithOldLocations()
+{
+	return mNumStepsWithOldLocations;
+}
+
+unsigned CryptSimulation::GetNumStepsWithoutOldLocations()
+{
+	return mNumStepsWithoutOldLocations;
+}
+
+void CryptSimulation::SetUseDivisionQueue(bool useDivisionQueue)
+{
+	mUseDivisionQueue = useDivisionQueue;
+	mIsDivisionQueueBuilt = false;
+}
+
+bool CryptSimulation::GetUseDivisionQueue()
+{
+	return mUseDivisionQueue;
+}
+
+unsigned CryptSimulation::GetNumDivisionChecks()
+{
+	return mNumDivisionChecks;
+}
+
+void CryptSimulation::BuildDivisionQueue()
+{
+	mDivisionQueue = std::priority_queue<ScheduledDivision>();
+	mPolledCells.clear();
+
+	for (AbstractCellPopulation<2>::Iterator cell_iter = this->mrCellPopulation.Begin();
+		 cell_iter != this->mrCellPopulation.End();
+		 ++cell_iter)
+	{
+		ScheduleDivision(*cell_iter);
+	}
+	mIsDivisionQueueBuilt = true;
+}
+
+void CryptSimulation::ScheduleDivision(CellPtr pCell)
+{
+	AbstractCellCycleModel* p_model = pCell->GetCellCycleModel();
+
+	if (dynamic_cast<NoCellCycleModel*>(p_model))
+	{
+		return;
+	}
+
+	AbstractSimpleCellCycleModel* p_simple_model = dynamic_cast<AbstractSimpleCellCycleModel*>(p_model);
+	if (p_simple_model)
+	{
+		// Differentiated cells are given an infinite cell cycle
+		double duration = p_simple_model->GetCellCycleDuration();
+		if (duration < DBL_MAX)
+		{
+			ScheduledDivision division;
+			division.mTime = p_simple_model->GetBirthTime() + duration;
+			division.mpCell = pCell;
+			mDivisionQueue.push(division);
+		}
+		return;
+	}
+
+	mPolledCells.push_back(pCell);
+}
+
+CellPtr CryptSimulation::TryToDivide(CellPtr pCell)
+{
+	// As the parent class: a cell born this step can't divide yet
+	mNumDivisionChecks++;
+	if (pCell->GetAge() > 0.0 && pCell->ReadyToDivide() && this->mrCellPopulation.IsRoomToDivide(pCell))
+	{
+		CellPtr p_new_cell = pCell->Divide();
+		this->mrCellPopulation.AddCell(p_new_cell, pCell);
+		return p_new_cell;
+	}
+	return CellPtr();
+}
+
+unsigned CryptSimulation::DoCellBirth()
+{
+	if (!mUseDivisionQueue || this->mNoBirth)
+	{
+		return OffLatticeSimulation<2>::DoCellBirth();
+	}
+
+	if (!mIsDivisionQueueBuilt)
+	{
+		BuildDivisionQueue();
+	}
+
+	unsigned num_births_this_step = 0;
+	double time = SimulationTime::Instance()->GetTime();
+	double dt = SimulationTime::Instance()->GetTimeStep();
+
+	// Cells due to divide this step, and those due but not yet able to
+	std::vector<std::pair<unsigned, CellPtr> > due_cells;
+	std::vector<CellPtr> postponed_cells;
+	while (!mDivisionQueue.empty() && mDivisionQueue.top().mTime <= time + 0.5*dt)
+	{
+		CellPtr p_cell = mDivisionQueue.top().mpCell;
+		due_cells.push_back(std::make_pair(p_cell->GetCellId(), p_cell));
+		mDivisionQueue.pop();
+	}
+
+	/*
+	 * Divide them in the order the parent class would meet them. Cells are added to the end of the
+	 * population, so that is the order of their ids, and the random numbers drawn for each division
+	 * go to the same cells as when every cell is polled.
+	 */
+	std::sort(due_cells.begin(), due_cells.end());
+
+	for (unsigned i=0; i<due_cells.size(); i++)
+	{
+		CellPtr p_cell = due_cells[i].second;
+		if (p_cell->IsDead())
+		{
+			continue;
+		}
+
+		CellPtr p_new_cell = TryToDivide(p_cell);
+		if (p_new_cell)
+		{
+			// Both cells start a new cell cycle
+			ScheduleDivision(p_cell);
+			ScheduleDivision(p_new_cell);
+			num_births_this_step++;
+		}
+		else
+		{
+			postponed_cells.push_back(p_cell);
+		}
+	}
+
+	// Try again next step
+	for (unsigned i=0; i<postponed_cells.size(); i++)
+	{
+		ScheduledDivision division;
+		division.mTime = time + dt;
+		division.mpCell = postponed_cells[i];
+		mDivisionQueue.push(division);
+	}
+
+	// Everything else is asked every step, as in the parent class
+	unsigned num_polled_cells = mPolledCells.size();
+	for (unsigned i=0; i<num_polled_cells; i++)
+	{
+		CellPtr p_cell = mPolledCells[i];
+		if (p_cell->IsDead())
+		{
+			continue;
+		}
+
+		CellPtr p_new_cell = TryToDivide(p_cell);
+		if (p_new_cell)
+		{
+			ScheduleDivision(p_new_cell);
+			num_births_this_step++;
+		}
+	}
+
+	// Forget the polled cells that have been removed
+	unsigned num_alive = 0;
+	for (unsigned i=0; i<mPolledCells.size(); i++)
+	{
+		if (!mPolledCells[i]->IsDead())
+		{
+			mPolledCells[num_alive++] = mPolledCells[i];
+		}
+	}
+	mPolledCells.resize(num_alive);
+
+	return num_births_this_step;
+}
+
+void CryptSimulation::UpdateCellLocationsAndTopology()
+{
+	// The boundary conditions restore nodes from the old locations, and an adaptive step reverts to them
+	if (!this->mBoundaryConditions.empty() || this->mpNumericalMethod->HasAdaptiveTimestep())
+	{
+		mNumStepsWithOldLocations++;
+		OffLatticeSimulation<2>::UpdateCellLocationsAndTopology();
+		return;
+	}
+
+	mNumStepsWithoutOldLocations++;
+
+	CellBasedEventHandler::BeginEvent(CellBasedEventHandler::POSITION);
+	try
+	{
+		this->mpNumericalMethod->UpdateAllNodePositions(this->mDt);
+	}
+	catch (StepSizeException& e)
+	{
+		// Stop cleanly at the end of this step, as the parent class does without an adaptive time step
+		WARNING(e.what() << " Simulation stopping.");
+		mHasStepSizeExceptionOccurred = true;
+	}
+	CellBasedEventHandler::EndEvent(CellBasedEventHandler::POSITION);
+}
+
+bool CryptSimulation::StoppingEventHasOccurred()
+{
+	if (mHasStepSizeExceptionOccurred)
+	{
+		// Only stop once, so that Solve() can be called again
+		mHasStepSizeExceptionOccurred = false;
+		return true;
+	}
+	return OffLatticeSimulation<2>::StoppingEventHasOccurred();
+}
+
+void CryptSimulation::OutputSimulationParameters(out_stream& rParamsFile)
+{
+	*rParamsFile <<  "\t\t<UseDivisionQueue>"<<  mUseDivisionQueue << "</UseDivisionQueue> \n";
+
+	// Call direct parent class
+	OffLatticeSimulation<2>::OutputSimulationParameters(rParamsFile);
+}
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+CHASTE_CLASS_EXPORT(CryptSimulation)
@@ -0,0 +1,173 @@
+#ifndef CRYPTSIMULATION_HPP_
+#define CRYPTSIMULATION_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include <queue>
+#include <vector>
+
+#include "OffLatticeSimulation.hpp"
+
+/*
+ * An OffLatticeSimulation that only stores the old node locations when it needs them.
+ *
+ * Each time step the parent class copies the location of every node into a map, so
+ * that the boundary conditions can put nodes back and an adaptive numerical method can
+ * undo a step that went too far. When the crypt is held in place by pinning its boundary
+ * cells (CryptCellPopulationWithGhostNodes::SetPinBoundaryCells()) instead of by a
+ * CryptBoundaryCondition, neither is needed, and this class just moves the nodes.
+ * With any boundary condition or an adaptive time step it does exactly what the parent
+ * class does. Otherwise a StepSizeException gives a warning and stops the simulation at
+ * the end of the step, as in the parent class, but the nodes moved before the exception
+ * are left where they are, as there are no old locations to put them back to.
+ *
+ * With SetUseDivisionQueue(true), cells are no longer asked every time step whether they
+ * are ready to divide. A cell with a simple cell cycle model (e.g. UniformCellCycleModel)
+ * divides at its birth time plus its cell cycle duration, so it is put in a priority
+ * queue keyed on that time, and only the cells at the front of the queue that are due
+ * are checked. Cells that can never divide (a NoCellCycleModel, or a differentiated
+ * cell whose duration is DBL_MAX) are left out altogether, and any other cell cycle
+ * model is polled every step as before. The queue is built from the population on the
+ * first time step (and after loading from an archive), and is kept up to date with the
+ * cells this class divides; call SetUseDivisionQueue(true) again after adding cells to
+ * the population by hand.
+ */
+
+class CryptSimulation : public OffLatticeSimulation<2>
+{
+private:
+
+    // Number of time steps that did and did not need the old node locations
+    unsigned mNumStepsWithOldLocations;
+    unsigned mNumStepsWithoutOldLocations;
+
+    // Whether a node moved too far in the last step without the old locations, so the simulation should stop
+    bool mHasStepSizeExceptionOccurred;
+
+    // A cell due to divide at a given time
+    struct ScheduledDivision
+    {
+        double mTime;
+        CellPtr mpCell;
+
+        // Reversed, so that the std::priority_queue gives the earliest first
+        bool operator<(const ScheduledDivision& rOther) const
+        {
+            return mTime > rOther.mTime;
+        }
+    };
+
+    // Whether to schedule divisions with mDivisionQueue rather than asking every cell every step
+    bool mUseDivisionQueue;
+
+    // Whether the queue has been built from the population; the queue is not archived
+    bool mIsDivisionQueueBuilt;
+
+    std::priority_queue<ScheduledDivision> mDivisionQueue;
+
+    // Cells whose cell cycle models can't say when they will divide, asked every step
+    std::vector<CellPtr> mPolledCells;
+
+    // Diagnostics: number of times a cell has been asked whether it is ready to divide
+    unsigned mNumDivisionChecks;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<OffLatticeSimulation<2> >(*this);
+        archive & mUseDivisionQueue;
+    }
+
+    /* Put every cell of the population that may divide in the queue or the polled cells */
+    void BuildDivisionQueue();
+
+    /* Add a cell to the queue, the polled cells, or neither */
+    void ScheduleDivision(CellPtr pCell);
+
+    /* Divide the cell if it is ready and there is room; returns the new cell, or an empty pointer */
+    CellPtr TryToDivide(CellPtr pCell);
+
+protected:
+
+    /**
+     * Overridden UpdateCellLocationsAndTopology() method.
+     *
+     * Skips building the map of old node locations if there is nothing to use it.
+     */
+    virtual void UpdateCellLocationsAndTopology();
+
+    /**
+     * Overridden DoCellBirth() method.
+     *
+     * Only asks the cells due to divide this step, if the division queue is used.
+     *
+     * @return the number of births that occurred
+     */
+    virtual unsigned DoCellBirth();
+
+    /**
+     * Overridden StoppingEventHasOccurred() method.
+     *
+     * @return true if a node moved too far in the last step, or if the parent class says to stop
+     */
+    virtual bool StoppingEventHasOccurred();
+
+public:
+
+    /*
+     * Create a new simulation, with the same arguments as OffLatticeSimulation.
+     */
+    CryptSimulation(AbstractCellPopulation<2>& rCellPopulation,
+                    bool deleteCellPopulationInDestructor=false,
+                    bool initialiseCells=true);
+
+    unsigned GetNumStepsWithOldLocations();
+
+    unsigned GetNumStepsWithoutOldLocations();
+
+    void SetUseDivisionQueue(bool useDivisionQueue);
+
+    bool GetUseDivisionQueue();
+
+    unsigned GetNumDivisionChecks();
+
+    /**
+     * Overridden OutputSimulationParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+CHASTE_CLASS_EXPORT(CryptSimulation)
+
+namespace boost
+{
+    namespace serialization
+    {
+        template<class Archive>
+        inline void save_construct_data(
+            Archive & ar, const CryptSimulation * t, const unsigned int file_version)
+        {
+            const AbstractCellPopulation<2>* p_cell_population = &(t->rGetCellPopulation());
+            ar & p_cell_population;
+        }
+
+        template<class Archive>
+        inline void load_construct_data(
+            Archive & ar, CryptSimulation * t, const unsigned int file_version)
+        {
+            AbstractCellPopulation<2>* p_cell_population;
+            ar >> p_cell_population;
+
+            // Invoke inplace constructor to initialise instance; the population is owned by the
+            // simulation once loaded, and its cells are already initialised
+            ::new(t)CryptSimulation(*p_cell_population, true, false);
+        }
+    }
+}
+
+#endif /* CRYPTSIMULATION_HPP_ */
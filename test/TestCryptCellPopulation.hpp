@@ -0,0 +1,782 @@
+/* A Chaste test that runs the test tube crypt with the crypt-specific cell population
+ */
+
+#include <cxxtest/TestSuite.h> //Needed for all test files
+#include "AbstractCellBasedTestSuite.hpp" //Needed for cell-based tests: times simulations, generates random numbers and has cell properties
+#include "CheckpointArchiveTypes.hpp" //Needed if we use GetIdentifier() method (which we do)
+#include "SmartPointers.hpp" //Enables macros to save typing
+
+#include "TestTubeCryptBuilder.hpp"
+#include "OffLatticeSimulation.hpp" //Simulates the evolution of the population
+#include "CryptCellPopulationWithGhostNodes.hpp"
+#include "MarkedSpringRegistry.hpp"
+#include "MembraneBondGraph.hpp"
+#include "CryptSimulation.hpp"
+#include "CryptHeightTracker.hpp"
+#include "AbstractSimpleCellCycleModel.hpp"
+#include "FakePetscSetup.hpp"
+
+#include <cfloat>
+#include <map>
+
+#include "AnoikisCellKillerMembraneCell.hpp"
+#include "EpithelialLayerAnoikisCellKiller.hpp"
+#include "LinearSpringForceMembraneCell.hpp"
+#include "MembraneCellForce.hpp"
+#include "TargetCurvatureField.hpp"
+#include "CryptBoundaryCondition.hpp"
+#include "BoundaryCellProperty.hpp"
+#include "MembraneCellProliferativeType.hpp"
+#include "DifferentiatedCellProliferativeType.hpp"
+#include "PanethCellMutationState.hpp"
+#include "CellPropertyRegistry.hpp"
+
+class TestCryptCellPopulation : public AbstractCellBasedTestSuite
+{
+	private:
+	/* Check the killer's kept gel neighbour counts against a fresh count for every cell */
+	void CheckGelNeighbourCounts(AnoikisCellKillerMembraneCell& rKiller, CryptCellPopulationWithGhostNodes& rCellPopulation)
+	{
+		GelNeighbourCounts& r_counts = rKiller.rGetGelNeighbourCounts();
+		TS_ASSERT(r_counts.Update(rCellPopulation));
+		for (AbstractCellPopulation<2>::Iterator cell_iter = rCellPopulation.Begin();
+			 cell_iter != rCellPopulation.End();
+			 ++cell_iter)
+		{
+			unsigned node_index = rCellPopulation.GetLocationIndexUsingCell(*cell_iter);
+			TS_ASSERT_EQUALS(r_counts.GetNumGelNeighbours(node_index), r_counts.CountGelNeighbours(rCellPopulation, node_index));
+		}
+	}
+
+	/* Add the usual test tube crypt forces, killer and (unless the boundary cells are pinned) boundary condition */
+	void SetUpCryptSimulation(OffLatticeSimulation<2>& rSimulator, CryptCellPopulationWithGhostNodes& rCellPopulation, bool addBoundaryCondition=true)
+	{
+		MAKE_PTR_ARGS(AnoikisCellKillerMembraneCell, p_anoikis_killer, (&rCellPopulation));
+		rSimulator.AddCellKiller(p_anoikis_killer);
+
+		MAKE_PTR(LinearSpringForceMembraneCell<2>, p_spring_force);
+		p_spring_force->SetCutOffLength(1.5);
+		rSimulator.AddForce(p_spring_force);
+
+		MAKE_PTR(MembraneCellForce, p_membrane_force);
+		p_membrane_force->SetBasementMembraneTorsionalStiffness(25.0);
+		p_membrane_force->SetTargetCurvatures(0.2, 0.0, 0.0);
+		rSimulator.AddForce(p_membrane_force);
+
+		if (addBoundaryCondition)
+		{
+			MAKE_PTR_ARGS(CryptBoundaryCondition, p_bc, (&rCellPopulation));
+			rSimulator.AddCellPopulationBoundaryCondition(p_bc);
+		}
+	}
+
+	/*
+	 * Run the small crypt from a clean start for two hours, with a CryptSimulation dividing cells from its
+	 * queue or an OffLatticeSimulation polling every cell. Returns the birth time of each cell left at the
+	 * end, by cell id, and checks no cell was left waiting past its division time.
+	 */
+	std::map<unsigned, double> RunDividingCrypt(std::string outputDirectory, bool useDivisionQueue, unsigned& rNumDivisionChecks)
+	{
+		RandomNumberGenerator::Instance()->Reseed(0);
+		SimulationTime::Destroy();
+		SimulationTime::Instance()->SetStartTime(0.0);
+		CellId::ResetMaxCellId();
+
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+		boost::shared_ptr<OffLatticeSimulation<2> > p_simulator;
+		if (useDivisionQueue)
+		{
+			boost::shared_ptr<CryptSimulation> p_crypt_simulator(new CryptSimulation(cell_population));
+			p_crypt_simulator->SetUseDivisionQueue(true);
+			p_simulator = p_crypt_simulator;
+		}
+		else
+		{
+			p_simulator.reset(new OffLatticeSimulation<2>(cell_population));
+		}
+		p_simulator->SetOutputDirectory(outputDirectory);
+		p_simulator->SetDt(0.005);
+		p_simulator->SetSamplingTimestepMultiple(100);
+		p_simulator->SetEndTime(2.0);
+
+		SetUpCryptSimulation(*p_simulator, cell_population);
+
+		p_simulator->Solve();
+
+		rNumDivisionChecks = 0;
+		if (useDivisionQueue)
+		{
+			rNumDivisionChecks = boost::static_pointer_cast<CryptSimulation>(p_simulator)->GetNumDivisionChecks();
+		}
+
+		std::map<unsigned, double> birth_times;
+		for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+			 cell_iter != cell_population.End();
+			 ++cell_iter)
+		{
+			birth_times[cell_iter->GetCellId()] = cell_iter->GetBirthTime();
+
+			AbstractSimpleCellCycleModel* p_model = dynamic_cast<AbstractSimpleCellCycleModel*>(cell_iter->GetCellCycleModel());
+			if (p_model)
+			{
+				TS_ASSERT_LESS_THAN(cell_iter->GetAge(), p_model->GetCellCycleDuration() + 0.005 + 1e-9);
+			}
+		}
+		return birth_times;
+	}
+
+	/* A 20x20 crypt with a lumen of radius 4 */
+	TestTubeCryptSpec GetSmallCryptSpec()
+	{
+		TestTubeCryptSpec spec;
+		spec.cellsAcross = 20;
+		spec.cellsUp = 20;
+		spec.circleCentreY = 8.0;
+		spec.circleRadius = 4.0;
+		return spec;
+	}
+
+	public:
+	void TestSkipRemesh() throw(Exception)
+	{
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+		cell_population.SetRemeshDisplacementThreshold(0.1);
+
+		OffLatticeSimulation<2> simulator(cell_population);
+		simulator.SetOutputDirectory("TestCryptSkipRemesh");
+		simulator.SetDt(0.005);
+		simulator.SetSamplingTimestepMultiple(100);
+		simulator.SetEndTime(1.0);
+
+		SetUpCryptSimulation(simulator, cell_population);
+
+		simulator.Solve();
+
+		// Most of the 200 time steps shouldn't need a new triangulation
+		TS_ASSERT_LESS_THAN(0u, cell_population.GetNumRemeshes());
+		TS_ASSERT_LESS_THAN(cell_population.GetNumRemeshes(), cell_population.GetNumSkippedRemeshes());
+		TS_ASSERT_LESS_THAN(0u, cell_population.GetNumRealCells());
+
+		// Without local repair, the topology only changes when it remeshes
+		TS_ASSERT_EQUALS(cell_population.GetTopologyVersion(), cell_population.GetNumRemeshes());
+
+		// With no threshold it remeshes every time step, like the parent class
+		cell_population.SetRemeshDisplacementThreshold(0.0);
+		unsigned num_remeshes = cell_population.GetNumRemeshes();
+		cell_population.Update(false);
+		TS_ASSERT_EQUALS(cell_population.GetNumRemeshes(), num_remeshes + 1);
+
+		// A killed cell is reported with the next topology change
+		CellPtr p_cell = *(cell_population.Begin());
+		p_cell->Kill();
+		cell_population.RemoveDeadCells();
+		unsigned topology_version = cell_population.GetTopologyVersion();
+		cell_population.Update(true);
+		TS_ASSERT_EQUALS(cell_population.GetTopologyVersion(), topology_version + 1);
+		TS_ASSERT_EQUALS(cell_population.IsLastTopologyChangeLocal(), false);
+		TS_ASSERT_EQUALS(cell_population.rGetRemovedCellIds().size(), 1u);
+		TS_ASSERT_EQUALS(cell_population.rGetRemovedCellIds()[0], p_cell->GetCellId());
+		TS_ASSERT_EQUALS(cell_population.rGetAddedCellIds().size(), 0u);
+	};
+
+	void TestGhostNodePruning() throw(Exception)
+	{
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+		cell_population.SetNumGhostLayers(2);
+
+		unsigned num_ghosts_before = cell_population.rGetMesh().GetNumNodes() - cell_population.GetNumRealCells();
+
+		OffLatticeSimulation<2> simulator(cell_population);
+		simulator.SetOutputDirectory("TestCryptGhostNodePruning");
+		simulator.SetDt(0.005);
+		simulator.SetSamplingTimestepMultiple(100);
+		simulator.SetEndTime(1.0);
+
+		SetUpCryptSimulation(simulator, cell_population);
+
+		simulator.Solve();
+
+		// The lumen and the outer ghost layers have been emptied down to a shell two ghosts deep
+		unsigned num_ghosts_after = cell_population.rGetMesh().GetNumNodes() - cell_population.GetNumRealCells();
+		TS_ASSERT_LESS_THAN(num_ghosts_after, num_ghosts_before);
+		TS_ASSERT_LESS_THAN(0u, cell_population.GetNumGhostNodesRemoved());
+		TS_ASSERT_LESS_THAN(0u, cell_population.GetNumRealCells());
+	};
+
+	void TestLocalDelaunayRepair() throw(Exception)
+	{
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+		cell_population.SetRemeshDisplacementThreshold(0.05);
+		cell_population.SetUseLocalRepair(true);
+
+		OffLatticeSimulation<2> simulator(cell_population);
+		simulator.SetOutputDirectory("TestCryptLocalDelaunayRepair");
+		simulator.SetDt(0.005);
+		simulator.SetSamplingTimestepMultiple(100);
+		simulator.SetEndTime(1.0);
+
+		SetUpCryptSimulation(simulator, cell_population);
+
+		simulator.Solve();
+
+		// Nodes that moved past the threshold were patched up in place rather than remeshed
+		TS_ASSERT_LESS_THAN(0u, cell_population.GetNumLocalRepairs());
+		TS_ASSERT_LESS_THAN(cell_population.GetNumRemeshes(), cell_population.GetNumLocalRepairs() + cell_population.GetNumSkippedRemeshes());
+
+		// Repairs that didn't need any flips don't change the topology
+		TS_ASSERT_LESS_THAN_EQUALS(cell_population.GetTopologyVersion(), cell_population.GetNumRemeshes() + cell_population.GetNumLocalRepairs());
+
+		// A full remesh of the repaired mesh gives the same number of elements
+		unsigned num_elements = cell_population.rGetMesh().GetNumElements();
+		cell_population.Update(true);
+		TS_ASSERT_EQUALS(cell_population.rGetMesh().GetNumElements(), num_elements);
+	};
+
+	void TestMarkedSpringRegistry() throw(Exception)
+	{
+		MarkedSpringRegistry registry(1.0);
+
+		// Enough divisions to make the table grow a few times
+		for (unsigned i=0; i<100; i++)
+		{
+			registry.Mark(2*i, 2*i + 1, 0.01*i);
+		}
+		TS_ASSERT_EQUALS(registry.GetNumEntries(), 100u);
+
+		// Either way round, until the lifetime is up
+		TS_ASSERT(registry.IsMarked(11, 10, 0.5));
+		TS_ASSERT(!registry.IsMarked(10, 12, 0.5));
+		TS_ASSERT(!registry.IsMarked(10, 11, 1.05));
+		TS_ASSERT(registry.IsMarked(198, 199, 1.05));
+
+		registry.RemoveExpired(1.05);
+		TS_ASSERT_EQUALS(registry.GetNumEntries(), 94u);
+		TS_ASSERT(registry.IsMarked(198, 199, 1.05));
+
+		// A division in the crypt population is marked in its registry, and in the parent class's set for Chaste's own forces
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+		CellPtr p_parent_cell = *(cell_population.Begin());
+		CellPtr p_daughter_cell(new Cell(p_parent_cell->GetMutationState(), p_parent_cell->GetCellCycleModel()->CreateCellCycleModel()));
+		p_daughter_cell->SetCellProliferativeType(p_parent_cell->GetCellProliferativeType());
+		cell_population.AddCell(p_daughter_cell, p_parent_cell);
+
+		TS_ASSERT(cell_population.IsMarkedCellPair(p_parent_cell->GetCellId(), p_daughter_cell->GetCellId()));
+		TS_ASSERT_EQUALS(cell_population.rGetMarkedSprings().size(), 1u);
+		TS_ASSERT_EQUALS(cell_population.rGetMarkedSpringRegistry().GetNumEntries(), 1u);
+
+		// The lifetime is the longest spring growth duration of the forces
+		cell_population.KeepMarkedSpringsFor(2.0);
+		cell_population.KeepMarkedSpringsFor(0.5);
+		TS_ASSERT_DELTA(cell_population.rGetMarkedSpringRegistry().GetLifetime(), 2.0, 1e-12);
+
+		// Still marked after an hour; the parent class's set is emptied once the spring has expired
+		SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(3.0, 3);
+		SimulationTime::Instance()->IncrementTimeOneStep();
+		cell_population.Update(true);
+		TS_ASSERT(cell_population.IsMarkedCellPair(p_parent_cell->GetCellId(), p_daughter_cell->GetCellId()));
+		TS_ASSERT_EQUALS(cell_population.rGetMarkedSprings().size(), 1u);
+
+		SimulationTime::Instance()->IncrementTimeOneStep();
+		SimulationTime::Instance()->IncrementTimeOneStep();
+		cell_population.Update(true);
+		TS_ASSERT(!cell_population.IsMarkedCellPair(p_parent_cell->GetCellId(), p_daughter_cell->GetCellId()));
+		TS_ASSERT(cell_population.rGetMarkedSprings().empty());
+	};
+
+	void TestPinnedBoundaryCells() throw(Exception)
+	{
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+		cell_population.SetPinBoundaryCells(true);
+
+		std::map<CellPtr, c_vector<double, 2> > boundary_locations;
+		for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+			 cell_iter != cell_population.End();
+			 ++cell_iter)
+		{
+			if (cell_iter->HasCellProperty<BoundaryCellProperty>())
+			{
+				boundary_locations[*cell_iter] = cell_population.GetLocationOfCellCentre(*cell_iter);
+			}
+		}
+		TS_ASSERT(!boundary_locations.empty());
+
+		CryptSimulation simulator(cell_population);
+		simulator.SetOutputDirectory("TestCryptPinnedBoundaryCells");
+		simulator.SetDt(0.005);
+		simulator.SetSamplingTimestepMultiple(100);
+		simulator.SetEndTime(1.0);
+
+		SetUpCryptSimulation(simulator, cell_population, false);
+
+		simulator.Solve();
+
+		// With no boundary condition the old locations were never stored
+		TS_ASSERT_EQUALS(simulator.GetNumStepsWithOldLocations(), 0u);
+		TS_ASSERT_EQUALS(simulator.GetNumStepsWithoutOldLocations(), 200u);
+
+		// and the boundary cells didn't move at all
+		for (std::map<CellPtr, c_vector<double, 2> >::iterator iter = boundary_locations.begin();
+			 iter != boundary_locations.end();
+			 ++iter)
+		{
+			TS_ASSERT(!iter->first->IsDead());
+			c_vector<double, 2> location = cell_population.GetLocationOfCellCentre(iter->first);
+			TS_ASSERT_DELTA(location[0], iter->second[0], 1e-12);
+			TS_ASSERT_DELTA(location[1], iter->second[1], 1e-12);
+		}
+	};
+
+	void TestCellAttributes() throw(Exception)
+	{
+		SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 10);
+
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+		// One snapshot per time step, with the same answers as the cells themselves
+		const CryptCellAttributes& r_attributes = cell_population.rGetCellAttributes();
+		for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+			 cell_iter != cell_population.End();
+			 ++cell_iter)
+		{
+			unsigned node_index = cell_population.GetLocationIndexUsingCell(*cell_iter);
+			TS_ASSERT_DELTA(r_attributes.GetAge(node_index), cell_iter->GetAge(), 1e-12);
+			TS_ASSERT_DELTA(r_attributes.GetApoptosisFactor(node_index), 1.0, 1e-12);
+			TS_ASSERT_EQUALS(r_attributes.GetCellClass(node_index) == CryptCellAttributes::MEMBRANE_CELL,
+							 cell_iter->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>());
+			TS_ASSERT_EQUALS(r_attributes.GetCellClass(node_index) == CryptCellAttributes::STROMAL_CELL,
+							 cell_iter->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>());
+			TS_ASSERT_EQUALS(r_attributes.HasProperty<BoundaryCellProperty>(node_index), cell_iter->HasCellProperty<BoundaryCellProperty>());
+			TS_ASSERT_EQUALS(r_attributes.HasProperty<MembraneCellProliferativeType>(node_index),
+							 cell_iter->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>());
+		}
+		TS_ASSERT(r_attributes.IsCurrent(cell_population.GetTopologyVersion()));
+
+		// Changing a cell's properties part way through a step needs the snapshot refreshing
+		CellPtr p_first_cell = *(cell_population.Begin());
+		unsigned first_node_index = cell_population.GetLocationIndexUsingCell(p_first_cell);
+		p_first_cell->SetMutationState(CellPropertyRegistry::Instance()->Get<PanethCellMutationState>());
+		cell_population.InvalidateCellAttributes();
+		TS_ASSERT(cell_population.rGetCellAttributes().HasProperty<PanethCellMutationState>(first_node_index));
+
+		// Out of date at the next time step
+		SimulationTime::Instance()->IncrementTimeOneStep();
+		TS_ASSERT(!r_attributes.IsCurrent(cell_population.GetTopologyVersion()));
+
+		// A cell starting apoptosis halfway through shortens its springs in the next snapshot
+		CellPtr p_cell = *(cell_population.Begin());
+		p_cell->StartApoptosis();
+		unsigned node_index = cell_population.GetLocationIndexUsingCell(p_cell);
+		TS_ASSERT_DELTA(cell_population.rGetCellAttributes().GetApoptosisFactor(node_index), 1.0, 1e-12);
+		SimulationTime::Instance()->IncrementTimeOneStep();
+		TS_ASSERT_DELTA(cell_population.rGetCellAttributes().GetApoptosisFactor(node_index),
+						p_cell->GetTimeUntilDeath()/p_cell->GetApoptosisTime(), 1e-12);
+	};
+
+	void TestGelNeighbourCounts() throw(Exception)
+	{
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+		cell_population.SetRemeshDisplacementThreshold(0.05);
+		cell_population.SetUseLocalRepair(true);
+
+		OffLatticeSimulation<2> simulator(cell_population);
+		simulator.SetOutputDirectory("TestCryptGelNeighbourCounts");
+		simulator.SetDt(0.005);
+		simulator.SetSamplingTimestepMultiple(100);
+		simulator.SetEndTime(0.5);
+
+		MAKE_PTR_ARGS(AnoikisCellKillerMembraneCell, p_anoikis_killer, (&cell_population));
+		simulator.AddCellKiller(p_anoikis_killer);
+
+		MAKE_PTR(LinearSpringForceMembraneCell<2>, p_spring_force);
+		p_spring_force->SetCutOffLength(1.5);
+		simulator.AddForce(p_spring_force);
+
+		MAKE_PTR_ARGS(CryptBoundaryCondition, p_bc, (&cell_population));
+		simulator.AddCellPopulationBoundaryCondition(p_bc);
+
+		// The counts from the mesh edges match the counts from each node's elements
+		CheckGelNeighbourCounts(*p_anoikis_killer, cell_population);
+
+		simulator.Solve();
+
+		// Having been kept up to date through the local repairs, they still do
+		TS_ASSERT_LESS_THAN(0u, cell_population.GetNumLocalRepairs());
+		CheckGelNeighbourCounts(*p_anoikis_killer, cell_population);
+
+		// A membrane cell that becomes stromal changes its neighbours' counts without any change to the mesh
+		SimulationTime::Instance()->ResetEndTimeAndNumberOfTimeSteps(1.0, 100);
+		CellPtr p_membrane_cell;
+		CellPtr p_epithelial_cell;
+		for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+			 cell_iter != cell_population.End();
+			 ++cell_iter)
+		{
+			unsigned node_index = cell_population.GetLocationIndexUsingCell(*cell_iter);
+			if (cell_population.rGetCellAttributes().GetCellClass(node_index) == CryptCellAttributes::MEMBRANE_CELL)
+			{
+				p_membrane_cell = *cell_iter;
+			}
+			else if (cell_population.rGetCellAttributes().GetCellClass(node_index) == CryptCellAttributes::EPITHELIAL_CELL)
+			{
+				p_epithelial_cell = *cell_iter;
+			}
+		}
+		TS_ASSERT(p_membrane_cell);
+		TS_ASSERT(p_epithelial_cell);
+
+		unsigned topology_version = cell_population.GetTopologyVersion();
+		unsigned class_change_version = cell_population.rGetCellAttributes().GetClassChangeVersion();
+		p_membrane_cell->SetCellProliferativeType(CellPropertyRegistry::Instance()->Get<DifferentiatedCellProliferativeType>());
+		SimulationTime::Instance()->IncrementTimeOneStep();
+		TS_ASSERT_EQUALS(cell_population.GetTopologyVersion(), topology_version);
+		TS_ASSERT_EQUALS(cell_population.rGetCellAttributes().GetClassChangeVersion(), class_change_version + 1);
+		TS_ASSERT_EQUALS(cell_population.rGetCellAttributes().rGetNodesWithChangedClass().size(), 1u);
+		CheckGelNeighbourCounts(*p_anoikis_killer, cell_population);
+
+		// A step with no change of class leaves the version alone
+		SimulationTime::Instance()->IncrementTimeOneStep();
+		TS_ASSERT_EQUALS(cell_population.rGetCellAttributes().GetClassChangeVersion(), class_change_version + 1);
+
+		// Every full remesh, whether for births and deaths or not, recounts everything
+		cell_population.Update(false);
+		CheckGelNeighbourCounts(*p_anoikis_killer, cell_population);
+		p_membrane_cell->Kill();
+		cell_population.RemoveDeadCells();
+		CellPtr p_daughter_cell(new Cell(p_epithelial_cell->GetMutationState(), p_epithelial_cell->GetCellCycleModel()->CreateCellCycleModel()));
+		p_daughter_cell->SetCellProliferativeType(p_epithelial_cell->GetCellProliferativeType());
+		cell_population.AddCell(p_daughter_cell, p_epithelial_cell);
+		cell_population.Update(true);
+		TS_ASSERT(!cell_population.IsLastTopologyChangeLocal());
+		CheckGelNeighbourCounts(*p_anoikis_killer, cell_population);
+	};
+
+	void TestSloughingAndCompressionInAnoikisKiller() throw(Exception)
+	{
+		SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 10);
+
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+		EpithelialLayerAnoikisCellKiller killer(&cell_population);
+		killer.SetSloughOrifice(true);
+		killer.SetSloughHeight(12.0);
+		killer.SetCompressionThreshold(10.0);
+		killer.CheckAndLabelCellsForApoptosisOrDeath();
+
+		// Every epithelial cell is sloughed above the slough height, killed by anoikis or, as the
+		// threshold is larger than any spacing, started on apoptosis
+		TS_ASSERT_LESS_THAN(0u, killer.GetNumberCellsSloughed());
+		TS_ASSERT_LESS_THAN(0u, killer.GetNumberCellsRemovedByCompression());
+		for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+			 cell_iter != cell_population.End();
+			 ++cell_iter)
+		{
+			if (!cell_iter->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>())
+			{
+				TS_ASSERT(cell_iter->IsDead() || cell_iter->HasApoptosisBegun());
+				if (cell_population.GetLocationOfCellCentre(*cell_iter)[1] > 12.0)
+				{
+					TS_ASSERT(cell_iter->IsDead());
+				}
+			}
+		}
+
+		// One event for each cell, with its cause
+		const std::vector<c_vector<double,4> >& r_events = killer.GetRemovalEvents();
+		TS_ASSERT_EQUALS(r_events.size(), killer.GetNumberCellsSloughed() + killer.GetNumberCellsRemoved() + killer.GetNumberCellsRemovedByCompression());
+		TS_ASSERT_EQUALS(killer.GetLocationsOfCellsRemovedByAnoikis().size(), killer.GetNumberCellsRemoved());
+		for (unsigned i=0; i<r_events.size(); i++)
+		{
+			if (r_events[i][3] == EpithelialLayerAnoikisCellKiller::SLOUGHING)
+			{
+				TS_ASSERT_LESS_THAN(12.0, r_events[i][2]);
+			}
+		}
+
+		// Cells already undergoing apoptosis are not counted again
+		unsigned num_compressed = killer.GetNumberCellsRemovedByCompression();
+		killer.CheckAndLabelCellsForApoptosisOrDeath();
+		TS_ASSERT_EQUALS(killer.GetNumberCellsRemovedByCompression(), num_compressed);
+	};
+
+	void TestCryptHeightTracker() throw(Exception)
+	{
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+		OffLatticeSimulation<2> simulator(cell_population);
+		simulator.SetOutputDirectory("TestCryptHeightTracker");
+		simulator.SetDt(0.005);
+		simulator.SetSamplingTimestepMultiple(100);
+		simulator.SetEndTime(1.0);
+
+		SetUpCryptSimulation(simulator, cell_population);
+
+		MAKE_PTR(CryptHeightTracker, p_tracker);
+		simulator.AddSimulationModifier(p_tracker);
+
+		simulator.Solve();
+
+		// The tracked extremes are the same as a scan over every cell
+		c_vector<double,4> min_heights = scalar_vector<double>(4, DBL_MAX);
+		c_vector<double,4> max_heights = scalar_vector<double>(4, -DBL_MAX);
+		c_vector<unsigned,4> num_cells = zero_vector<unsigned>(4);
+		for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+			 cell_iter != cell_population.End();
+			 ++cell_iter)
+		{
+			unsigned cell_class = CryptCellAttributes::ClassifyCell(*cell_iter);
+			double height = cell_population.GetLocationOfCellCentre(*cell_iter)[1];
+			min_heights[cell_class] = std::min(min_heights[cell_class], height);
+			max_heights[cell_class] = std::max(max_heights[cell_class], height);
+			num_cells[cell_class]++;
+		}
+		for (unsigned c=0; c<4; c++)
+		{
+			CryptCellAttributes::CellClass cell_class = static_cast<CryptCellAttributes::CellClass>(c);
+			TS_ASSERT_EQUALS(p_tracker->GetNumCells(cell_class), num_cells[c]);
+			TS_ASSERT_DELTA(p_tracker->GetMinHeight(cell_class), min_heights[c], 1e-12);
+			TS_ASSERT_DELTA(p_tracker->GetMaxHeight(cell_class), max_heights[c], 1e-12);
+		}
+		TS_ASSERT_DELTA(p_tracker->GetCryptHeightExtremes()[0], max_heights[CryptCellAttributes::EPITHELIAL_CELL], 1e-12);
+		TS_ASSERT_DELTA(p_tracker->GetCryptHeightExtremes()[1], min_heights[CryptCellAttributes::EPITHELIAL_CELL], 1e-12);
+	};
+
+	void TestTargetCurvatureField() throw(Exception)
+	{
+		// Curved in the base, flat up the sides, with a linear change in between
+		std::vector<double> heights;
+		std::vector<double> curvatures;
+		heights.push_back(0.0);
+		curvatures.push_back(0.2);
+		heights.push_back(5.0);
+		curvatures.push_back(0.2);
+		heights.push_back(8.0);
+		curvatures.push_back(0.0);
+
+		MAKE_PTR(TargetCurvatureField, p_field);
+		p_field->SetControlPoints(heights, curvatures, 161);
+		TS_ASSERT_EQUALS(p_field->GetNumSamples(), 161u);
+		TS_ASSERT_DELTA(p_field->GetTargetCurvature(-1.0), 0.2, 1e-12);
+		TS_ASSERT_DELTA(p_field->GetTargetCurvature(2.0), 0.2, 1e-12);
+		TS_ASSERT_DELTA(p_field->GetTargetCurvature(6.5), 0.1, 1e-12);
+		TS_ASSERT_DELTA(p_field->GetTargetCurvature(8.0), 0.0, 1e-12);
+		TS_ASSERT_DELTA(p_field->GetTargetCurvature(20.0), 0.0, 1e-12);
+
+		// The membrane force takes its target angle from the field at the centre node's height
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+		MembraneCellForce membrane_force;
+		membrane_force.SetTargetCurvatures(0.3, 0.0, 0.0);
+		membrane_force.SetTargetCurvatureField(p_field);
+
+		c_vector<double, 2> left_location;
+		left_location[0] = 0.0;
+		left_location[1] = 6.0;
+		c_vector<double, 2> centre_location;
+		centre_location[0] = 1.0;
+		centre_location[1] = 6.5;
+		c_vector<double, 2> right_location;
+		right_location[0] = 2.0;
+		right_location[1] = 6.0;
+
+		double length = norm_2(right_location - centre_location);
+		TS_ASSERT_DELTA(membrane_force.GetTargetAngle(cell_population, *(cell_population.Begin()), left_location, centre_location, right_location),
+						2.0*acos(length*0.1/2.0), 1e-12);
+	};
+
+	void TestDivisionQueue() throw(Exception)
+	{
+		// The same seeded crypt, dividing from the queue and by asking every cell every step
+		unsigned num_division_checks = 0;
+		std::map<unsigned, double> birth_times = RunDividingCrypt("TestCryptDivisionQueue", true, num_division_checks);
+		unsigned num_polled_checks = 0;
+		std::map<unsigned, double> polled_birth_times = RunDividingCrypt("TestCryptDivisionPolled", false, num_polled_checks);
+
+		// Polling would have asked every cell at each of the 400 time steps; only the cells that were due were asked
+		TS_ASSERT_LESS_THAN(num_division_checks, polled_birth_times.size());
+
+		// The same cells are there at the end, born at the same times
+		TS_ASSERT_LESS_THAN(0u, birth_times.size());
+		TS_ASSERT_EQUALS(birth_times.size(), polled_birth_times.size());
+		for (std::map<unsigned, double>::iterator iter = polled_birth_times.begin();
+			 iter != polled_birth_times.end();
+			 ++iter)
+		{
+			TS_ASSERT_EQUALS(birth_times.count(iter->first), 1u);
+			TS_ASSERT_DELTA(birth_times[iter->first], iter->second, 1e-12);
+		}
+	};
+
+	void TestMembraneBondGraph() throw(Exception)
+	{
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+		unsigned num_membrane_cells = 0;
+		for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+			 cell_iter != cell_population.End();
+			 ++cell_iter)
+		{
+			if (cell_iter->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>())
+			{
+				num_membrane_cells++;
+			}
+		}
+
+		// The graph starts off as the sections found from the mesh
+		MAKE_PTR(MembraneBondGraph, p_graph);
+		MAKE_PTR(MembraneCellForce, p_membrane_force);
+		p_membrane_force->SetBasementMembraneTorsionalStiffness(25.0);
+		p_membrane_force->SetTargetCurvatures(0.2, 0.0, 0.0);
+		p_membrane_force->SetMembraneBondGraph(p_graph);
+		p_membrane_force->InitialiseMembraneBondGraph(cell_population);
+
+		std::vector<std::vector<unsigned> > sections = p_membrane_force->GetMembraneSections(cell_population);
+		std::vector<std::vector<unsigned> > chains = p_graph->GetChains();
+		TS_ASSERT_EQUALS(p_graph->GetNumCells(), num_membrane_cells);
+		TS_ASSERT_EQUALS(chains.size(), sections.size());
+		TS_ASSERT_EQUALS(p_graph->GetNumBonds(), num_membrane_cells - chains.size());
+
+		unsigned longest = 0;
+		for (unsigned i=1; i<chains.size(); i++)
+		{
+			if (chains[i].size() > chains[longest].size())
+			{
+				longest = i;
+			}
+		}
+		TS_ASSERT_LESS_THAN(2u, chains[longest].size());
+
+		// Neighbours either way along a chain
+		unsigned previous_id = chains[longest][0];
+		unsigned centre_id = chains[longest][1];
+		unsigned next_id = chains[longest][2];
+		TS_ASSERT_EQUALS(p_graph->GetNext(previous_id), centre_id);
+		TS_ASSERT_EQUALS(p_graph->GetPrevious(next_id), centre_id);
+
+		// Taking a cell out joins up the cells either side, and putting it back in splits them again
+		CellPtr p_centre_cell = p_graph->GetCell(centre_id);
+		p_graph->RemoveCell(centre_id);
+		TS_ASSERT(!p_graph->HasCell(centre_id));
+		TS_ASSERT_EQUALS(p_graph->GetNext(previous_id), next_id);
+		TS_ASSERT_EQUALS(p_graph->GetNumCells(), num_membrane_cells - 1);
+
+		p_graph->InsertCellBetween(p_centre_cell, p_graph->GetCell(previous_id), p_graph->GetCell(next_id));
+		TS_ASSERT_EQUALS(p_graph->GetNext(previous_id), centre_id);
+		TS_ASSERT_EQUALS(p_graph->GetNext(centre_id), next_id);
+		TS_ASSERT_EQUALS(p_graph->GetNumCells(), num_membrane_cells);
+		TS_ASSERT_EQUALS(p_graph->GetNumBonds(), num_membrane_cells - chains.size());
+
+		// The same sections come back from the graph as from the mesh
+		const std::vector<std::vector<unsigned> >& r_graph_sections = p_membrane_force->rGetCachedMembraneSections(cell_population);
+		TS_ASSERT_EQUALS(r_graph_sections.size(), sections.size());
+
+		// The bonds hold the membrane together through a short simulation, with the spring force sharing the graph
+		OffLatticeSimulation<2> simulator(cell_population);
+		simulator.SetOutputDirectory("TestCryptMembraneBondGraph");
+		simulator.SetDt(0.005);
+		simulator.SetSamplingTimestepMultiple(100);
+		simulator.SetEndTime(1.0);
+
+		MAKE_PTR(LinearSpringForceMembraneCell<2>, p_spring_force);
+		p_spring_force->SetCutOffLength(1.5);
+		p_spring_force->SetMembraneBondGraph(p_graph);
+		simulator.AddForce(p_spring_force);
+		simulator.AddForce(p_membrane_force);
+
+		MAKE_PTR_ARGS(CryptBoundaryCondition, p_bc, (&cell_population));
+		simulator.AddCellPopulationBoundaryCondition(p_bc);
+
+		simulator.Solve();
+
+		TS_ASSERT_EQUALS(p_graph->GetNumBonds(), num_membrane_cells - chains.size());
+		for (unsigned i=0; i<p_graph->rGetCellIds().size(); i++)
+		{
+			unsigned cell_id = p_graph->rGetCellIds()[i];
+			unsigned next_cell_id = p_graph->GetNext(cell_id);
+			if (next_cell_id != MembraneBondGraph::NO_CELL)
+			{
+				c_vector<double, 2> location_a = cell_population.GetLocationOfCellCentre(p_graph->GetCell(cell_id));
+				c_vector<double, 2> location_b = cell_population.GetLocationOfCellCentre(p_graph->GetCell(next_cell_id));
+				TS_ASSERT_LESS_THAN(norm_2(location_b - location_a), 1.5);
+			}
+		}
+
+		// A dead membrane cell is dropped and its neighbours bonded
+		p_graph->GetCell(centre_id)->Kill();
+		TS_ASSERT_EQUALS(p_graph->RemoveDeadCells(), 1u);
+		TS_ASSERT_EQUALS(p_graph->GetNext(previous_id), next_id);
+	};
+
+	void TestBondForceBeyondCutOff() throw(Exception)
+	{
+		TestTubeCryptBuilder builder(GetSmallCryptSpec());
+		std::vector<CellPtr> cells = builder.BuildCells();
+		CryptCellPopulationWithGhostNodes cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+		std::vector<CellPtr> membrane_cells;
+		for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+			 cell_iter != cell_population.End() && membrane_cells.size() < 2;
+			 ++cell_iter)
+		{
+			if (cell_iter->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>())
+			{
+				membrane_cells.push_back(*cell_iter);
+			}
+		}
+		TS_ASSERT_EQUALS(membrane_cells.size(), 2u);
+
+		MAKE_PTR(MembraneBondGraph, p_graph);
+		p_graph->AddBond(membrane_cells[0], membrane_cells[1]);
+
+		MAKE_PTR(LinearSpringForceMembraneCell<2>, p_spring_force);
+		p_spring_force->SetCutOffLength(1.5);
+		p_spring_force->SetMembraneBondGraph(p_graph);
+
+		// Stretch the bond to twice the rest length, past the cut-off
+		unsigned node_a_index = cell_population.GetLocationIndexUsingCell(membrane_cells[0]);
+		unsigned node_b_index = cell_population.GetLocationIndexUsingCell(membrane_cells[1]);
+		c_vector<double, 2> stretched_location = cell_population.GetNode(node_a_index)->rGetLocation();
+		stretched_location[0] += 2.0;
+		cell_population.GetNode(node_b_index)->rGetModifiableLocation() = stretched_location;
+
+		// The mesh spring between the two is left to the bond, which still pulls them together
+		TS_ASSERT_DELTA(norm_2(p_spring_force->CalculateForceBetweenNodes(node_a_index, node_b_index, cell_population)), 0.0, 1e-12);
+
+		for (unsigned i=0; i<cell_population.GetNumNodes(); i++)
+		{
+			cell_population.GetNode(i)->ClearAppliedForce();
+		}
+		p_spring_force->AddBondForceContribution(cell_population);
+
+		c_vector<double, 2> force_on_a = cell_population.GetNode(node_a_index)->rGetAppliedForce();
+		c_vector<double, 2> force_on_b = cell_population.GetNode(node_b_index)->rGetAppliedForce();
+		TS_ASSERT_LESS_THAN(0.0, force_on_a[0]);
+		TS_ASSERT_DELTA(force_on_a[0], -force_on_b[0], 1e-12);
+		TS_ASSERT_DELTA(force_on_a[1], 0.0, 1e-12);
+	};
+};
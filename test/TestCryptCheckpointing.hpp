@@ -0,0 +1,257 @@
+
+/* A Chaste test that checkpoints a test tube crypt and restarts it,
+ * and forks experiments from a stored steady state
+ */
+
+#include <cxxtest/TestSuite.h> //Needed for all test files
+#include "AbstractCellBasedTestSuite.hpp" //Needed for cell-based tests: times simulations, generates random numbers and has cell properties
+#include "CheckpointArchiveTypes.hpp" //Needed if we use GetIdentifier() method (which we do)
+#include "SmartPointers.hpp" //Enables macros to save typing
+
+#include "TestTubeCryptBuilder.hpp"
+#include "OffLatticeSimulation.hpp" //Simulates the evolution of the population
+#include "MeshBasedCellPopulationWithGhostNodes.hpp"
+#include "StemCellProliferativeType.hpp"
+#include "FakePetscSetup.hpp"
+
+#include "AnoikisCellKillerMembraneCell.hpp"
+#include "LinearSpringForceMembraneCell.hpp"
+#include "MembraneCellForce.hpp"
+#include "CryptBoundaryCondition.hpp"
+
+#include "CryptCheckpointArchiver.hpp"
+#include "CryptSnapshotLibrary.hpp"
+#include "OutputFileHandler.hpp"
+#include "TransitCellAnoikisResistantMutationState.hpp"
+#include "AbstractSimpleCellCycleModel.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "CellId.hpp"
+
+#include <map>
+
+class TestCryptCheckpointing : public AbstractCellBasedTestSuite
+{
+	private:
+	/*
+	 * Build a small test tube crypt on the builder's mesh. The returned simulation owns
+	 * its population, but the builder must outlive it as it owns the mesh.
+	 */
+	OffLatticeSimulation<2>* CreateTestTubeCryptSimulation(TestTubeCryptBuilder& rBuilder, std::string outputDirectory)
+	{
+		std::vector<CellPtr> cells = rBuilder.BuildCells();
+		MeshBasedCellPopulationWithGhostNodes<2>* p_cell_population = new MeshBasedCellPopulationWithGhostNodes<2>(*rBuilder.GetMesh(), cells, rBuilder.rGetRealIndices());
+
+		OffLatticeSimulation<2>* p_simulator = new OffLatticeSimulation<2>(*p_cell_population, true);
+		p_simulator->SetOutputDirectory(outputDirectory);
+		p_simulator->SetDt(0.005);
+		p_simulator->SetSamplingTimestepMultiple(100);
+
+		MAKE_PTR_ARGS(AnoikisCellKillerMembraneCell, p_anoikis_killer, (p_cell_population));
+		p_simulator->AddCellKiller(p_anoikis_killer);
+
+		MAKE_PTR(LinearSpringForceMembraneCell<2>, p_spring_force);
+		p_spring_force->SetCutOffLength(1.5);
+		p_simulator->AddForce(p_spring_force);
+
+		MAKE_PTR(MembraneCellForce, p_membrane_force);
+		p_membrane_force->SetBasementMembraneTorsionalStiffness(25.0);
+		p_membrane_force->SetTargetCurvatures(0.2, 0.0, 0.0);
+		p_simulator->AddForce(p_membrane_force);
+
+		MAKE_PTR_ARGS(CryptBoundaryCondition, p_bc, (p_cell_population));
+		p_simulator->AddCellPopulationBoundaryCondition(p_bc);
+
+		return p_simulator;
+	}
+
+	/*
+	 * Record the position, birth time and cell cycle duration of each real cell, by cell id
+	 */
+	void RecordCells(AbstractCellPopulation<2>& rPopulation, std::map<unsigned, c_vector<double,2> >& rLocations,
+			std::map<unsigned, double>& rBirthTimes, std::map<unsigned, double>& rCellCycleDurations)
+	{
+		for (AbstractCellPopulation<2>::Iterator cell_iter = rPopulation.Begin();
+			 cell_iter != rPopulation.End();
+			 ++cell_iter)
+		{
+			unsigned cell_id = cell_iter->GetCellId();
+			rLocations[cell_id] = rPopulation.GetLocationOfCellCentre(*cell_iter);
+			rBirthTimes[cell_id] = cell_iter->GetBirthTime();
+
+			AbstractSimpleCellCycleModel* p_model = dynamic_cast<AbstractSimpleCellCycleModel*>(cell_iter->GetCellCycleModel());
+			rCellCycleDurations[cell_id] = (p_model != NULL) ? p_model->GetCellCycleDuration() : DBL_MAX;
+		}
+	}
+
+	/* Start a run from the same random numbers, time and cell ids as every other run */
+	void ResetForRun()
+	{
+		RandomNumberGenerator::Instance()->Reseed(0);
+		SimulationTime::Destroy();
+		SimulationTime::Instance()->SetStartTime(0.0);
+		CellId::ResetMaxCellId();
+	}
+
+	/* A 20x20 crypt with a lumen of radius 4 */
+	TestTubeCryptSpec GetSmallCryptSpec()
+	{
+		TestTubeCryptSpec spec;
+		spec.cellsAcross = 20;
+		spec.cellsUp = 20;
+		spec.circleCentreY = 8.0;
+		spec.circleRadius = 4.0;
+		return spec;
+	}
+
+	public:
+	void TestCheckpointAndRestart() throw(Exception)
+	{
+		typedef CryptCheckpointArchiver<2, OffLatticeSimulation<2> > Archiver;
+
+		double checkpoint_interval = 0.25;
+		double stop_time = 0.5;
+		double end_time = 1.0;
+		unsigned num_checkpoints_to_keep = 2;
+
+		// Empty both output directories, so no checkpoints from an earlier run of this test are picked up
+		OutputFileHandler reference_handler("TestCryptCheckpointReference/", true);
+		OutputFileHandler restart_handler("TestCryptCheckpoint/", true);
+
+		// The uninterrupted run
+		std::map<unsigned, c_vector<double,2> > reference_locations;
+		std::map<unsigned, double> reference_birth_times;
+		std::map<unsigned, double> reference_durations;
+		{
+			ResetForRun();
+			TestTubeCryptBuilder builder(GetSmallCryptSpec());
+			OffLatticeSimulation<2>* p_simulator = CreateTestTubeCryptSimulation(builder, "TestCryptCheckpointReference");
+
+			Archiver::SolveWithCheckpoints(p_simulator, end_time, checkpoint_interval, num_checkpoints_to_keep);
+			RecordCells(p_simulator->rGetCellPopulation(), reference_locations, reference_birth_times, reference_durations);
+			delete p_simulator;
+		}
+
+		// The same run, stopped part of the way through
+		{
+			ResetForRun();
+			TestTubeCryptBuilder builder(GetSmallCryptSpec());
+			OffLatticeSimulation<2>* p_simulator = CreateTestTubeCryptSimulation(builder, "TestCryptCheckpoint");
+
+			Archiver::SolveWithCheckpoints(p_simulator, stop_time, checkpoint_interval, num_checkpoints_to_keep);
+			delete p_simulator;
+		}
+
+		// Pick up from the last checkpoint and carry on to the end
+		double latest_time = 0.0;
+		TS_ASSERT(Archiver::FindLatestCheckpoint("TestCryptCheckpoint", latest_time));
+		TS_ASSERT_DELTA(latest_time, stop_time, 1e-6);
+
+		OffLatticeSimulation<2>* p_simulator = Archiver::Load("TestCryptCheckpoint", latest_time);
+		TS_ASSERT_DELTA(SimulationTime::Instance()->GetTime(), stop_time, 1e-6);
+
+		Archiver::SolveWithCheckpoints(p_simulator, end_time, checkpoint_interval, num_checkpoints_to_keep);
+		TS_ASSERT_DELTA(SimulationTime::Instance()->GetTime(), end_time, 1e-6);
+
+		std::map<unsigned, c_vector<double,2> > restart_locations;
+		std::map<unsigned, double> restart_birth_times;
+		std::map<unsigned, double> restart_durations;
+		RecordCells(p_simulator->rGetCellPopulation(), restart_locations, restart_birth_times, restart_durations);
+		delete p_simulator;
+
+		// The restarted run should have the same cells, in the same places and at the same point in their cycles
+		TS_ASSERT_EQUALS(restart_locations.size(), reference_locations.size());
+		for (std::map<unsigned, c_vector<double,2> >::iterator iter = reference_locations.begin();
+			 iter != reference_locations.end();
+			 ++iter)
+		{
+			unsigned cell_id = iter->first;
+			TS_ASSERT_EQUALS(restart_locations.count(cell_id), 1u);
+			if (restart_locations.count(cell_id) == 1)
+			{
+				TS_ASSERT_DELTA(restart_locations[cell_id][0], iter->second[0], 1e-6);
+				TS_ASSERT_DELTA(restart_locations[cell_id][1], iter->second[1], 1e-6);
+				TS_ASSERT_DELTA(restart_birth_times[cell_id], reference_birth_times[cell_id], 1e-6);
+				TS_ASSERT_DELTA(restart_durations[cell_id], reference_durations[cell_id], 1e-6);
+			}
+		}
+
+		// The checkpoints from before the restart have been pruned along with the newer ones
+		FileFinder archive_dir("TestCryptCheckpoint/archive/", RelativeTo::ChasteTestOutput);
+		std::vector<FileFinder> archives = archive_dir.FindMatches("cell_population_sim_at_time_*.arch");
+		TS_ASSERT_EQUALS(archives.size(), num_checkpoints_to_keep);
+		TS_ASSERT(Archiver::FindLatestCheckpoint("TestCryptCheckpoint", latest_time));
+		TS_ASSERT_DELTA(latest_time, end_time, 1e-6);
+	};
+
+	void TestWarmStartFromSnapshot() throw(Exception)
+	{
+		double equilibration_time = 2.0;
+		double experiment_time = 1.0;
+
+		// A library of this test's own, emptied first, so nothing left by an earlier run (or older code) is used
+		OutputFileHandler library_handler("TestCryptSnapshotLibrary/", true);
+		CryptSnapshotLibrary library("TestCryptSnapshotLibrary");
+		TS_ASSERT(!library.Contains("TestTubeCryptSteadyState"));
+
+		{
+			TestTubeCryptBuilder builder(GetSmallCryptSpec());
+			OffLatticeSimulation<2>* p_simulator = CreateTestTubeCryptSimulation(builder, "TestCryptEquilibration");
+			p_simulator->SetEndTime(equilibration_time);
+			p_simulator->Solve();
+
+			library.Store(p_simulator, "TestTubeCryptSteadyState");
+			delete p_simulator;
+		}
+		TS_ASSERT(library.Contains("TestTubeCryptSteadyState"));
+		double snapshot_time = library.GetSnapshotTime("TestTubeCryptSteadyState");
+
+		// First experiment: make the epithelial cell nearest the top of the crypt base resistant to anoikis
+		{
+			OffLatticeSimulation<2>* p_simulator = library.Fork("TestTubeCryptSteadyState", "TestCryptWarmStartMutant");
+			TS_ASSERT_DELTA(SimulationTime::Instance()->GetTime(), snapshot_time, 1e-6);
+
+			AbstractCellPopulation<2>& r_population = p_simulator->rGetCellPopulation();
+			boost::shared_ptr<AbstractCellProperty> p_state_mutated = CellPropertyRegistry::Instance()->Get<TransitCellAnoikisResistantMutationState>();
+
+			CellPtr p_mutant;
+			double highest = -DBL_MAX;
+			for (AbstractCellPopulation<2>::Iterator cell_iter = r_population.Begin();
+				 cell_iter != r_population.End();
+				 ++cell_iter)
+			{
+				double y = r_population.GetLocationOfCellCentre(*cell_iter)[1];
+				if (cell_iter->GetCellProliferativeType()->IsType<StemCellProliferativeType>() && y > highest)
+				{
+					highest = y;
+					p_mutant = *cell_iter;
+				}
+			}
+			TS_ASSERT(p_mutant);
+			p_mutant->SetMutationState(p_state_mutated);
+
+			p_simulator->SetEndTime(snapshot_time + experiment_time);
+			p_simulator->Solve();
+			delete p_simulator;
+		}
+
+		// Second experiment: stiffen the membrane
+		{
+			OffLatticeSimulation<2>* p_simulator = library.Fork("TestTubeCryptSteadyState", "TestCryptWarmStartStiffMembrane");
+			TS_ASSERT_DELTA(SimulationTime::Instance()->GetTime(), snapshot_time, 1e-6);
+
+			const std::vector<boost::shared_ptr<AbstractForce<2> > >& r_forces = p_simulator->rGetForceCollection();
+			for (unsigned i=0; i<r_forces.size(); i++)
+			{
+				boost::shared_ptr<MembraneCellForce> p_membrane_force = boost::dynamic_pointer_cast<MembraneCellForce>(r_forces[i]);
+				if (p_membrane_force)
+				{
+					p_membrane_force->SetBasementMembraneTorsionalStiffness(50.0);
+				}
+			}
+
+			p_simulator->SetEndTime(snapshot_time + experiment_time);
+			p_simulator->Solve();
+			delete p_simulator;
+		}
+	};
+};
@@ -0,0 +1,280 @@
+/* A Chaste test that runs an ensemble of stochastic test tube crypt replicates across the cores of the machine
+ */
+
+#include <cxxtest/TestSuite.h> //Needed for all test files
+#include "AbstractCellBasedTestSuite.hpp" //Needed for cell-based tests: times simulations, generates random numbers and has cell properties
+#include "CheckpointArchiveTypes.hpp" //Needed if we use GetIdentifier() method (which we do)
+#include "SmartPointers.hpp" //Enables macros to save typing
+
+#include "TestTubeCryptBuilder.hpp"
+#include "OffLatticeSimulation.hpp" //Simulates the evolution of the population
+#include "MeshBasedCellPopulationWithGhostNodes.hpp"
+#include "TransitCellProliferativeType.hpp"
+#include "StemCellProliferativeType.hpp"
+#include "FakePetscSetup.hpp"
+
+#include "AnoikisCellKillerMembraneCell.hpp"
+#include "LinearSpringForceMembraneCell.hpp"
+#include "MembraneCellForce.hpp"
+#include "CryptBoundaryCondition.hpp"
+
+#include "CryptEnsembleRunner.hpp"
+#include "CryptParameterSweep.hpp"
+#include "OutputFileHandler.hpp"
+
+#include <cerrno>
+#include <sys/wait.h>
+
+/*
+ * A small test tube crypt run for a couple of hours. Any of torsional_stiffness, membraneStiffness
+ * and end_time given in rParameters replace the defaults. Returns the number of cells lost
+ * to anoikis, the final number of cells and the height of the highest epithelial cell.
+ */
+std::vector<double> RunTestTubeCrypt(const std::map<std::string, double>& rParameters, const std::string& rOutputDirectory)
+{
+	std::map<std::string, double> parameters;
+	parameters["torsional_stiffness"] = 25.0;
+	parameters["membraneStiffness"] = 20.0;
+	parameters["end_time"] = 2.0;
+	for (std::map<std::string, double>::const_iterator it = rParameters.begin(); it != rParameters.end(); ++it)
+	{
+		parameters[it->first] = it->second;
+	}
+
+	TestTubeCryptSpec spec;
+	spec.cellsAcross = 20;
+	spec.cellsUp = 20;
+	spec.circleCentreY = 8.0;
+	spec.circleRadius = 4.0;
+	TestTubeCryptBuilder builder(spec);
+
+	std::vector<CellPtr> cells = builder.BuildCells();
+	MeshBasedCellPopulationWithGhostNodes<2> cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+	OffLatticeSimulation<2> simulator(cell_population);
+	simulator.SetOutputDirectory(rOutputDirectory);
+	simulator.SetDt(0.005);
+	simulator.SetEndTime(parameters["end_time"]);
+	simulator.SetSamplingTimestepMultiple(200);
+
+	MAKE_PTR_ARGS(AnoikisCellKillerMembraneCell, p_anoikis_killer, (&cell_population));
+	simulator.AddCellKiller(p_anoikis_killer);
+
+	MAKE_PTR(LinearSpringForceMembraneCell<2>, p_spring_force);
+	p_spring_force->SetCutOffLength(1.5);
+	p_spring_force->SetMembraneSpringStiffness(parameters["membraneStiffness"]);
+	simulator.AddForce(p_spring_force);
+
+	MAKE_PTR(MembraneCellForce, p_membrane_force);
+	p_membrane_force->SetBasementMembraneTorsionalStiffness(parameters["torsional_stiffness"]);
+	p_membrane_force->SetTargetCurvatures(0.2, 0.0, 0.0);
+	simulator.AddForce(p_membrane_force);
+
+	MAKE_PTR_ARGS(CryptBoundaryCondition, p_bc, (&cell_population));
+	simulator.AddCellPopulationBoundaryCondition(p_bc);
+
+	simulator.Solve();
+
+	double crypt_height = 0.0;
+	for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+		 cell_iter != cell_population.End();
+		 ++cell_iter)
+	{
+		if (cell_iter->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || cell_iter->GetCellProliferativeType()->IsType<StemCellProliferativeType>())
+		{
+			crypt_height = std::max(crypt_height, cell_population.GetLocationOfCellCentre(*cell_iter)[1]);
+		}
+	}
+
+	std::vector<double> summary;
+	summary.push_back(p_anoikis_killer->GetNumberCellsRemoved());
+	summary.push_back(cell_population.GetNumRealCells());
+	summary.push_back(crypt_height);
+	return summary;
+}
+
+/* One replicate of the default crypt; the random number generator has already been seeded by the runner */
+std::vector<double> RunTestTubeCryptReplicate(const std::string& rOutputDirectory, unsigned seed)
+{
+	return RunTestTubeCrypt(std::map<std::string, double>(), rOutputDirectory);
+}
+
+/* A replicate that returns two summary values for even seeds and three for odd ones */
+std::vector<double> RunMismatchedReplicate(const std::string& rOutputDirectory, unsigned seed)
+{
+	return std::vector<double>(2 + seed%2, 1.0);
+}
+
+class TestCryptEnsembles : public AbstractCellBasedTestSuite
+{
+	public:
+	void TestTestTubeCryptEnsemble() throw(Exception)
+	{
+		unsigned num_replicates = 8;
+
+		CryptEnsembleRunner runner(RunTestTubeCryptReplicate, num_replicates, "TestTubeCryptEnsemble");
+		runner.SetBaseSeed(100);
+
+		std::vector<std::string> summary_names;
+		summary_names.push_back("anoikis_count");
+		summary_names.push_back("num_cells");
+		summary_names.push_back("crypt_height");
+		runner.SetSummaryNames(summary_names);
+
+		runner.Run();
+
+		TS_ASSERT_EQUALS(runner.GetNumFailedReplicates(), 0u);
+		TS_ASSERT_EQUALS(runner.GetNumCompletedReplicates(), num_replicates);
+		TS_ASSERT_EQUALS(runner.GetMeans().size(), 3u);
+		TS_ASSERT_LESS_THAN(0.0, runner.GetMeans()[1]);
+
+		// Rerunning with the same seeds gives each replicate exactly the same result, whichever process it lands in
+		unsigned num_rerun_replicates = 3;
+		CryptEnsembleRunner rerun(RunTestTubeCryptReplicate, num_rerun_replicates, "TestTubeCryptEnsembleRerun");
+		rerun.SetBaseSeed(100);
+		rerun.SetNumProcesses(2);
+		rerun.SetSummaryNames(summary_names);
+		rerun.Run();
+
+		TS_ASSERT_EQUALS(rerun.GetNumCompletedReplicates(), num_rerun_replicates);
+		for (unsigned replicate=0; replicate<num_rerun_replicates; replicate++)
+		{
+			const std::vector<double>& r_summary = runner.rGetReplicateSummaries()[replicate];
+			const std::vector<double>& r_rerun_summary = rerun.rGetReplicateSummaries()[replicate];
+			TS_ASSERT_EQUALS(r_rerun_summary.size(), r_summary.size());
+			for (unsigned i=0; i<r_summary.size() && i<r_rerun_summary.size(); i++)
+			{
+				TS_ASSERT_EQUALS(r_rerun_summary[i], r_summary[i]);
+			}
+		}
+	};
+
+	void TestEnsembleWithMismatchedSummaries() throw(Exception)
+	{
+		unsigned num_replicates = 6;
+		CryptEnsembleRunner runner(RunMismatchedReplicate, num_replicates, "TestMismatchedEnsemble");
+		runner.SetNumProcesses(2);
+
+		// The error comes once every replicate has been recorded and every child reaped
+		TS_ASSERT_THROWS_CONTAINS(runner.Run(), "summary values, but earlier replicates returned");
+		TS_ASSERT_LESS_THAN(0u, runner.GetNumFailedReplicates());
+		TS_ASSERT_EQUALS(runner.GetNumCompletedReplicates() + runner.GetNumFailedReplicates(), num_replicates);
+
+		int status;
+		TS_ASSERT_EQUALS(waitpid(-1, &status, WNOHANG), -1);
+		TS_ASSERT_EQUALS(errno, ECHILD);
+	};
+
+	void TestTestTubeCryptParameterSweep() throw(Exception)
+	{
+		// Write a small design to sweep over
+		OutputFileHandler handler("TestTubeCryptSweep/", true);
+		out_stream p_config_file = handler.OpenOutputFile("sweep.cfg");
+		*p_config_file << "# Torsional stiffness against membrane spring stiffness\n";
+		*p_config_file << "design grid\n";
+		*p_config_file << "seed 7\n";
+		*p_config_file << "parameter torsional_stiffness 10 40 2\n";
+		*p_config_file << "parameter membraneStiffness 15 25 2\n";
+		*p_config_file << "parameter end_time 0.5 0.5\n";
+		p_config_file->close();
+
+		FileFinder config_file("TestTubeCryptSweep/sweep.cfg", RelativeTo::ChasteTestOutput);
+
+		CryptParameterSweep sweep(RunTestTubeCrypt, "TestTubeCryptSweep");
+		sweep.LoadConfiguration(config_file);
+		sweep.Run();
+
+		TS_ASSERT_EQUALS(sweep.GetNumPoints(), 4u);
+		TS_ASSERT_EQUALS(sweep.GetNumPointsRun(), 4u);
+		TS_ASSERT_EQUALS(sweep.GetNumPointsFailed(), 0u);
+		TS_ASSERT_DELTA(sweep.rGetPoints()[3][0], 40.0, 1e-12);
+		TS_ASSERT_DELTA(sweep.rGetPoints()[3][1], 25.0, 1e-12);
+
+		// Resuming the sweep picks up every result from disk and runs nothing
+		CryptParameterSweep resumed_sweep(RunTestTubeCrypt, "TestTubeCryptSweep");
+		resumed_sweep.LoadConfiguration(config_file);
+		resumed_sweep.Run();
+
+		TS_ASSERT_EQUALS(resumed_sweep.GetNumPointsRun(), 0u);
+		TS_ASSERT_EQUALS(resumed_sweep.GetNumPointsSkipped(), 4u);
+		for (unsigned point=0; point<4; point++)
+		{
+			TS_ASSERT_EQUALS(resumed_sweep.rGetResults()[point].size(), 3u);
+			TS_ASSERT_DELTA(resumed_sweep.rGetResults()[point][1], sweep.rGetResults()[point][1], 1e-12);
+		}
+
+		// Changing the range of the first parameter changes points 2 and 3 only, so only they are run again
+		p_config_file = handler.OpenOutputFile("sweep.cfg");
+		*p_config_file << "design grid\n";
+		*p_config_file << "seed 7\n";
+		*p_config_file << "parameter torsional_stiffness 10 50 2\n";
+		*p_config_file << "parameter membraneStiffness 15 25 2\n";
+		*p_config_file << "parameter end_time 0.5 0.5\n";
+		p_config_file->close();
+
+		CryptParameterSweep changed_sweep(RunTestTubeCrypt, "TestTubeCryptSweep");
+		changed_sweep.LoadConfiguration(config_file);
+		changed_sweep.Run();
+
+		TS_ASSERT_EQUALS(changed_sweep.GetNumPointsSkipped(), 2u);
+		TS_ASSERT_EQUALS(changed_sweep.GetNumPointsRun(), 2u);
+		TS_ASSERT_DELTA(changed_sweep.rGetPoints()[3][0], 50.0, 1e-12);
+	};
+
+	void TestParameterSweepDesign() throw(Exception)
+	{
+		OutputFileHandler handler("TestTubeCryptSweepDesign/", true);
+		FileFinder config_file("TestTubeCryptSweepDesign/sweep.cfg", RelativeTo::ChasteTestOutput);
+
+		// Each parameter of a Latin hypercube uses every one of its strata exactly once
+		out_stream p_config_file = handler.OpenOutputFile("sweep.cfg");
+		*p_config_file << "design lhs\n";
+		*p_config_file << "samples 5\n";
+		*p_config_file << "seed 3\n";
+		*p_config_file << "parameter torsional_stiffness 0 5\n";
+		*p_config_file << "parameter membraneStiffness 10 20\n";
+		p_config_file->close();
+
+		CryptParameterSweep sweep(RunTestTubeCrypt, "TestTubeCryptSweepDesign");
+		sweep.LoadConfiguration(config_file);
+		sweep.GenerateDesign();
+		TS_ASSERT_EQUALS(sweep.GetNumPoints(), 5u);
+
+		std::vector<unsigned> torsional_strata(5, 0);
+		std::vector<unsigned> membrane_strata(5, 0);
+		for (unsigned point=0; point<5; point++)
+		{
+			torsional_strata[static_cast<unsigned>(sweep.rGetPoints()[point][0])]++;
+			membrane_strata[static_cast<unsigned>((sweep.rGetPoints()[point][1] - 10.0)/2.0)]++;
+		}
+		for (unsigned stratum=0; stratum<5; stratum++)
+		{
+			TS_ASSERT_EQUALS(torsional_strata[stratum], 1u);
+			TS_ASSERT_EQUALS(membrane_strata[stratum], 1u);
+		}
+
+		// The same seed gives the same design
+		CryptParameterSweep same_sweep(RunTestTubeCrypt, "TestTubeCryptSweepDesign");
+		same_sweep.LoadConfiguration(config_file);
+		same_sweep.GenerateDesign();
+		for (unsigned point=0; point<5; point++)
+		{
+			TS_ASSERT_EQUALS(same_sweep.rGetPoints()[point][0], sweep.rGetPoints()[point][0]);
+			TS_ASSERT_EQUALS(same_sweep.rGetPoints()[point][1], sweep.rGetPoints()[point][1]);
+		}
+
+		// Samples and seeds must be whole numbers
+		p_config_file = handler.OpenOutputFile("sweep.cfg");
+		*p_config_file << "design lhs\n";
+		*p_config_file << "samples -3\n";
+		p_config_file->close();
+		CryptParameterSweep bad_sweep(RunTestTubeCrypt, "TestTubeCryptSweepDesign");
+		TS_ASSERT_THROWS_CONTAINS(bad_sweep.LoadConfiguration(config_file), "Expected a whole number");
+
+		p_config_file = handler.OpenOutputFile("sweep.cfg");
+		*p_config_file << "seed 7x\n";
+		p_config_file->close();
+		CryptParameterSweep bad_seed_sweep(RunTestTubeCrypt, "TestTubeCryptSweepDesign");
+		TS_ASSERT_THROWS_CONTAINS(bad_seed_sweep.LoadConfiguration(config_file), "Expected a whole number");
+	};
+};
\ No newline at end of file
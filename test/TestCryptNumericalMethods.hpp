@@ -0,0 +1,200 @@
+/* A Chaste test that runs the test tube crypt with the crypt-specific numerical methods
+ */
+
+#include <cxxtest/TestSuite.h> //Needed for all test files
+#include "AbstractCellBasedTestSuite.hpp" //Needed for cell-based tests: times simulations, generates random numbers and has cell properties
+#include "CheckpointArchiveTypes.hpp" //Needed if we use GetIdentifier() method (which we do)
+#include "SmartPointers.hpp" //Enables macros to save typing
+
+#include "TestTubeCryptBuilder.hpp"
+#include "OffLatticeSimulation.hpp" //Simulates the evolution of the population
+#include "MeshBasedCellPopulationWithGhostNodes.hpp"
+#include "FakePetscSetup.hpp"
+
+#include "AnoikisCellKillerMembraneCell.hpp"
+#include "LinearSpringForceMembraneCell.hpp"
+#include "MembraneCellForce.hpp"
+#include "CryptBoundaryCondition.hpp"
+
+#include "CryptAdaptiveNumericalMethod.hpp"
+#include "CryptMultiRateNumericalMethod.hpp"
+#include "CryptSemiImplicitNumericalMethod.hpp"
+#include "ForwardEulerNumericalMethod.hpp"
+
+#include <map>
+
+class TestCryptNumericalMethods : public AbstractCellBasedTestSuite
+{
+	private:
+	/* Add the usual test tube crypt spring force, killer and boundary condition, and return the spring force. The membrane force is left to the caller. */
+	boost::shared_ptr<LinearSpringForceMembraneCell<2> > SetUpCryptSimulation(OffLatticeSimulation<2>& rSimulator, MeshBasedCellPopulationWithGhostNodes<2>& rCellPopulation)
+	{
+		MAKE_PTR_ARGS(AnoikisCellKillerMembraneCell, p_anoikis_killer, (&rCellPopulation));
+		rSimulator.AddCellKiller(p_anoikis_killer);
+
+		MAKE_PTR(LinearSpringForceMembraneCell<2>, p_spring_force);
+		p_spring_force->SetCutOffLength(1.5);
+		rSimulator.AddForce(p_spring_force);
+
+		MAKE_PTR_ARGS(CryptBoundaryCondition, p_bc, (&rCellPopulation));
+		rSimulator.AddCellPopulationBoundaryCondition(p_bc);
+
+		return p_spring_force;
+	}
+
+	boost::shared_ptr<MembraneCellForce> CreateMembraneForce()
+	{
+		MAKE_PTR(MembraneCellForce, p_membrane_force);
+		p_membrane_force->SetBasementMembraneTorsionalStiffness(25.0);
+		p_membrane_force->SetTargetCurvatures(0.2, 0.0, 0.0);
+		return p_membrane_force;
+	}
+
+	/* A 20x20 crypt with a lumen of radius 4 */
+	TestTubeCryptSpec GetSmallCryptSpec()
+	{
+		TestTubeCryptSpec spec;
+		spec.cellsAcross = 20;
+		spec.cellsUp = 20;
+		spec.circleCentreY = 8.0;
+		spec.circleRadius = 4.0;
+		return spec;
+	}
+
+	/*
+	 * Run the small crypt from a clean start, with every cell just born so that none divide, and
+	 * one node pushed 40% of the way towards a neighbour so the springs start far from rest.
+	 * The membrane force is added to the simulation unless the numerical method applies it.
+	 * Returns where each cell ends up, by cell id.
+	 */
+	std::map<unsigned, c_vector<double, 2> > RunPerturbedCrypt(std::string outputDirectory, double dt, double endTime,
+		boost::shared_ptr<AbstractNumericalMethod<2,2> > pNumericalMethod, bool addMembraneForce)
+	{
+		RandomNumberGenerator::Instance()->Reseed(0);
+		SimulationTime::Destroy();
+		SimulationTime::Instance()->SetStartTime(0.0);
+		CellId::ResetMaxCellId();
+
+		TestTubeCryptSpec spec = GetSmallCryptSpec();
+		spec.birthTimeSpread = 0.0;
+		TestTubeCryptBuilder builder(spec);
+
+		unsigned node_index = builder.rGetRealIndices()[builder.rGetRealIndices().size()/2];
+		unsigned neighbour_index = builder.rGetNeighbours(node_index)[0];
+		c_vector<double, 2>& r_location = builder.GetMesh()->GetNode(node_index)->rGetModifiableLocation();
+		r_location += 0.4*(builder.GetMesh()->GetNode(neighbour_index)->rGetLocation() - r_location);
+
+		std::vector<CellPtr> cells = builder.BuildCells();
+		MeshBasedCellPopulationWithGhostNodes<2> cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
+
+		OffLatticeSimulation<2> simulator(cell_population);
+		simulator.SetOutputDirectory(outputDirectory);
+		simulator.SetDt(dt);
+		simulator.SetSamplingTimestepMultiple(unsigned(endTime/dt + 0.5));
+		simulator.SetEndTime(endTime);
+
+		boost::shared_ptr<LinearSpringForceMembraneCell<2> > p_spring_force = SetUpCryptSimulation(simulator, cell_population);
+		if (addMembraneForce)
+		{
+			simulator.AddForce(CreateMembraneForce());
+		}
+
+		// A multi-rate method takes the springs on the membrane onto its fast rate
+		boost::shared_ptr<CryptMultiRateNumericalMethod> p_multi_rate_method = boost::dynamic_pointer_cast<CryptMultiRateNumericalMethod>(pNumericalMethod);
+		if (p_multi_rate_method)
+		{
+			p_multi_rate_method->SetMembraneSpringForce(p_spring_force);
+		}
+		simulator.SetNumericalMethod(pNumericalMethod);
+
+		simulator.Solve();
+
+		// A step size problem would stop the simulation early rather than fail
+		TS_ASSERT_DELTA(SimulationTime::Instance()->GetTime(), endTime, 1e-6);
+
+		std::map<unsigned, c_vector<double, 2> > locations;
+		for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+			 cell_iter != cell_population.End();
+			 ++cell_iter)
+		{
+			locations[cell_iter->GetCellId()] = cell_population.GetLocationOfCellCentre(*cell_iter);
+		}
+		return locations;
+	}
+
+	/* Check that the cells are in the same places in both runs, to within the tolerance */
+	void CompareLocations(const std::map<unsigned, c_vector<double, 2> >& rLocations,
+		const std::map<unsigned, c_vector<double, 2> >& rReferenceLocations, double tolerance)
+	{
+		TS_ASSERT_EQUALS(rLocations.size(), rReferenceLocations.size());
+		for (std::map<unsigned, c_vector<double, 2> >::const_iterator iter = rLocations.begin();
+			 iter != rLocations.end();
+			 ++iter)
+		{
+			std::map<unsigned, c_vector<double, 2> >::const_iterator reference_iter = rReferenceLocations.find(iter->first);
+			TS_ASSERT(reference_iter != rReferenceLocations.end());
+			if (reference_iter != rReferenceLocations.end())
+			{
+				TS_ASSERT_DELTA(norm_2(iter->second - reference_iter->second), 0.0, tolerance);
+			}
+		}
+	}
+
+	public:
+	void TestAdaptiveTimestepping() throw(Exception)
+	{
+		// Four times the usual fixed step; the numerical method substeps where it needs to
+		MAKE_PTR(CryptAdaptiveNumericalMethod, p_numerical_method);
+		p_numerical_method->SetMaxDisplacement(0.05);
+		std::map<unsigned, c_vector<double, 2> > locations = RunPerturbedCrypt("TestCryptAdaptiveTimestepping", 0.02, 1.0, p_numerical_method, true);
+
+		// The pushed node's springs move it too far in one step of 0.02, so some steps must have been split
+		TS_ASSERT_LESS_THAN(1.0, p_numerical_method->GetMeanSubstepsPerTimeStep());
+		TS_ASSERT_LESS_THAN(p_numerical_method->GetSmallestStepSize(), 0.02);
+
+		// The same crypt with the usual fixed step
+		MAKE_PTR(ForwardEulerNumericalMethod<2>, p_reference_method);
+		std::map<unsigned, c_vector<double, 2> > reference_locations = RunPerturbedCrypt("TestCryptAdaptiveTimesteppingReference", 0.005, 1.0, p_reference_method, true);
+
+		CompareLocations(locations, reference_locations, 0.05);
+	};
+
+	void TestMultiRateIntegration() throw(Exception)
+	{
+		// The tissue step is 0.02; the membrane torsion and the springs on the membrane get a quarter of it
+		MAKE_PTR(CryptMultiRateNumericalMethod, p_numerical_method);
+		p_numerical_method->AddFastForce(CreateMembraneForce());
+		p_numerical_method->SetNumSubsteps(4);
+		std::map<unsigned, c_vector<double, 2> > locations = RunPerturbedCrypt("TestCryptMultiRate", 0.02, 1.0, p_numerical_method, false);
+
+		TS_ASSERT(p_numerical_method->GetMembraneSpringForce());
+		TS_ASSERT_EQUALS(p_numerical_method->GetNumSlowForceEvaluations(), 50u);
+		TS_ASSERT_EQUALS(p_numerical_method->GetNumFastForceEvaluations(), 200u);
+
+		// The same crypt on a single fine rate
+		MAKE_PTR(ForwardEulerNumericalMethod<2>, p_reference_method);
+		std::map<unsigned, c_vector<double, 2> > reference_locations = RunPerturbedCrypt("TestCryptMultiRateReference", 0.005, 1.0, p_reference_method, true);
+
+		CompareLocations(locations, reference_locations, 0.05);
+	};
+
+	void TestSemiImplicitMembraneTorsion() throw(Exception)
+	{
+		/*
+		 * Four times the usual step. The springs, which are still explicit, are stable at this step
+		 * (a step of 0.05 would be too long for them), and the membrane torsion is implicit.
+		 * The membrane force goes to the numerical method, not the simulation.
+		 */
+		MAKE_PTR(CryptSemiImplicitNumericalMethod, p_numerical_method);
+		p_numerical_method->SetMembraneForce(CreateMembraneForce());
+		std::map<unsigned, c_vector<double, 2> > locations = RunPerturbedCrypt("TestCryptSemiImplicit", 0.02, 1.0, p_numerical_method, false);
+
+		TS_ASSERT_EQUALS(p_numerical_method->GetNumExplicitFallbacks(), 0u);
+
+		// The same crypt, all explicit with the usual step
+		MAKE_PTR(ForwardEulerNumericalMethod<2>, p_reference_method);
+		std::map<unsigned, c_vector<double, 2> > reference_locations = RunPerturbedCrypt("TestCryptSemiImplicitReference", 0.005, 1.0, p_reference_method, true);
+
+		CompareLocations(locations, reference_locations, 0.05);
+	};
+};
\ No newline at end of file
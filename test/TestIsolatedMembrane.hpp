@@ -395,4 +395,182 @@ class TestIsolatedMembrane : public AbstractCellBasedTestSuite
 		simulator.Solve();
 	}
 
+	void TestNodeBasedMembrane() throw(Exception)
+	{
+		// A curved row of membrane cells above a row of stromal cells, with no mesh and no ghost nodes.
+		// The membrane nodes are numbered out of order along the row, so the chain has to be found from their positions.
+		std::vector<Node<2>*> nodes;
+		unsigned num_membrane_nodes = 20;
+		unsigned num_stromal_nodes = 10;
+		for (unsigned i=0; i<num_membrane_nodes; i++)
+		{
+			double x = 0.5*((7*i) % num_membrane_nodes);
+			double y = 2.0 + 0.05*(x - 4.75)*(x - 4.75);
+			nodes.push_back(new Node<2>(i, false, x, y));
+		}
+		for (unsigned i=0; i<num_stromal_nodes; i++)
+		{
+			nodes.push_back(new Node<2>(num_membrane_nodes + i, false, i, 0.0));
+		}
+
+		NodesOnlyMesh<2> mesh;
+		mesh.ConstructNodesWithoutMesh(nodes, 1.5);
+
+		MAKE_PTR(WildTypeCellMutationState, p_state);
+		MAKE_PTR(MembraneCellProliferativeType, p_membrane_type);
+		MAKE_PTR(DifferentiatedCellProliferativeType, p_stromal_type);
+		std::vector<CellPtr> cells;
+		for (unsigned i=0; i<mesh.GetNumNodes(); i++)
+		{
+			NoCellCycleModel* p_model = new NoCellCycleModel();
+			CellPtr p_cell(new Cell(p_state, p_model));
+			if (i < num_membrane_nodes)
+			{
+				p_cell->SetCellProliferativeType(p_membrane_type);
+			}
+			else
+			{
+				p_cell->SetCellProliferativeType(p_stromal_type);
+			}
+			p_cell->SetBirthTime(0.0);
+			cells.push_back(p_cell);
+		}
+
+		NodeBasedCellPopulation<2> cell_population(mesh, cells);
+
+		MembraneCellForce membrane_force;
+		membrane_force.SetBasementMembraneTorsionalStiffness(1.0);
+		membrane_force.SetTargetCurvatures(0.0, 0.0, 0.0);
+		membrane_force.SetMembraneNeighbourRadius(0.75);
+
+		// One section, in order along the row
+		std::vector<std::vector<unsigned> > sections = membrane_force.GetMembraneSectionsByRadius(cell_population);
+		TS_ASSERT_EQUALS(sections.size(), 1u);
+		TS_ASSERT_EQUALS(sections[0].size(), num_membrane_nodes);
+		for (unsigned i=0; i+1<sections[0].size(); i++)
+		{
+			double x_a = cell_population.GetNode(sections[0][i])->rGetLocation()[0];
+			double x_b = cell_population.GetNode(sections[0][i+1])->rGetLocation()[0];
+			TS_ASSERT_DELTA(fabs(x_a - x_b), 0.5, 1e-12);
+		}
+
+		// The curved membrane is pushed back towards straight
+		membrane_force.AddForceContribution(cell_population);
+		double total_force = 0.0;
+		for (unsigned i=0; i<num_membrane_nodes; i++)
+		{
+			total_force += norm_2(cell_population.GetNode(i)->rGetAppliedForce());
+		}
+		TS_ASSERT_LESS_THAN(1e-6, total_force);
+
+		// and a straight one isn't
+		for (unsigned i=0; i<cell_population.GetNumNodes(); i++)
+		{
+			cell_population.GetNode(i)->ClearAppliedForce();
+			if (i < num_membrane_nodes)
+			{
+				cell_population.GetNode(i)->rGetModifiableLocation()[1] = 2.0;
+			}
+		}
+		membrane_force.AddForceContribution(cell_population);
+		for (unsigned i=0; i<num_membrane_nodes; i++)
+		{
+			TS_ASSERT_DELTA(norm_2(cell_population.GetNode(i)->rGetAppliedForce()), 0.0, 1e-8);
+		}
+
+		for (unsigned i=0; i<nodes.size(); i++)
+		{
+			delete nodes[i];
+		}
+	}
+
+	void TestNodeBasedBasementMembraneForce() throw(Exception)
+	{
+		// A curved row of epithelial cells above a row of gel cells, staggered so each epithelial cell sits between two gel cells
+		unsigned num_epithelial_nodes = 10;
+		unsigned num_gel_nodes = 9;
+		std::vector<Node<2>*> mesh_nodes;
+		std::vector<Node<2>*> nodes;
+		for (unsigned i=0; i<num_epithelial_nodes + num_gel_nodes; i++)
+		{
+			double x = (i < num_epithelial_nodes) ? i : (i - num_epithelial_nodes) + 0.5;
+			double y = 1.0 - 0.02*(x - 4.5)*(x - 4.5) - ((i < num_epithelial_nodes) ? 0.0 : 1.0);
+			mesh_nodes.push_back(new Node<2>(i, false, x, y));
+			nodes.push_back(new Node<2>(i, false, x, y));
+		}
+
+		MutableMesh<2,2> mutable_mesh(mesh_nodes);
+		NodesOnlyMesh<2> nodes_only_mesh;
+		nodes_only_mesh.ConstructNodesWithoutMesh(nodes, 1.5);
+
+		MAKE_PTR(WildTypeCellMutationState, p_state);
+		MAKE_PTR(TransitCellProliferativeType, p_transit_type);
+		MAKE_PTR(DifferentiatedCellProliferativeType, p_gel_type);
+		std::vector<CellPtr> mesh_cells;
+		std::vector<CellPtr> cells;
+		for (unsigned i=0; i<num_epithelial_nodes + num_gel_nodes; i++)
+		{
+			for (unsigned copy=0; copy<2; copy++)
+			{
+				CellPtr p_cell(new Cell(p_state, new NoCellCycleModel()));
+				p_cell->SetCellProliferativeType(i < num_epithelial_nodes ? p_transit_type : p_gel_type);
+				p_cell->SetBirthTime(0.0);
+				(copy == 0 ? mesh_cells : cells).push_back(p_cell);
+			}
+		}
+
+		MeshBasedCellPopulation<2> mesh_population(mutable_mesh, mesh_cells);
+		NodeBasedCellPopulation<2> cell_population(nodes_only_mesh, cells);
+
+		EpithelialLayerBasementMembraneForce force;
+		force.SetBasementMembraneParameter(1.0);
+		force.SetTargetCurvature(0.0);
+		force.SetGelNeighbourRadius(1.5);
+
+		// The pairs within the radius are the epithelial-gel edges of the triangulation...
+		std::vector<c_vector<unsigned, 2> > mesh_pairs = force.GetEpithelialGelPairs(mesh_population);
+		std::vector<c_vector<unsigned, 2> > pairs = force.GetEpithelialGelPairsByRadius(cell_population);
+		std::set<std::pair<unsigned, unsigned> > mesh_pair_set;
+		std::set<std::pair<unsigned, unsigned> > pair_set;
+		for (unsigned i=0; i<mesh_pairs.size(); i++)
+		{
+			mesh_pair_set.insert(std::make_pair(mesh_pairs[i][0], mesh_pairs[i][1]));
+		}
+		for (unsigned i=0; i<pairs.size(); i++)
+		{
+			pair_set.insert(std::make_pair(pairs[i][0], pairs[i][1]));
+		}
+		TS_ASSERT_EQUALS(pair_set.size(), 2*(num_epithelial_nodes - 1));
+		TS_ASSERT(pair_set == mesh_pair_set);
+
+		// ...and their curvatures come from the same spring midpoints
+		double total_curvature = 0.0;
+		for (unsigned i=0; i<pairs.size(); i++)
+		{
+			double curvature = force.GetCurvatureFromNodePairByRadius(cell_population, pairs[i][0], pairs[i][1]);
+			TS_ASSERT_DELTA(curvature, force.GetCurvatureFromNodePair(mesh_population, pairs[i][0], pairs[i][1]), 1e-10);
+			total_curvature += fabs(curvature);
+		}
+		TS_ASSERT_LESS_THAN(1e-6, total_curvature);
+
+		// So the forces are the same
+		for (unsigned i=0; i<num_epithelial_nodes + num_gel_nodes; i++)
+		{
+			mesh_population.GetNode(i)->ClearAppliedForce();
+			cell_population.GetNode(i)->ClearAppliedForce();
+		}
+		force.AddForceContribution(mesh_population);
+		force.AddForceContribution(cell_population);
+		for (unsigned i=0; i<num_epithelial_nodes + num_gel_nodes; i++)
+		{
+			TS_ASSERT_DELTA(cell_population.GetNode(i)->rGetAppliedForce()[0], mesh_population.GetNode(i)->rGetAppliedForce()[0], 1e-10);
+			TS_ASSERT_DELTA(cell_population.GetNode(i)->rGetAppliedForce()[1], mesh_population.GetNode(i)->rGetAppliedForce()[1], 1e-10);
+		}
+
+		for (unsigned i=0; i<nodes.size(); i++)
+		{
+			delete nodes[i];
+		}
+	}
+
 };
\ No newline at end of file
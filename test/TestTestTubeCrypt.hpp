@@ -41,20 +41,41 @@
 #include "BoundaryCellProperty.hpp"
 
 #include "LinearSpringSmallMembraneCell.hpp" // Just to make sure this force works in a different simulation
+#include "AsynchronousOutputModifier.hpp" // Writes samples on a separate thread
+#include "TestTubeCryptBuilder.hpp" // Builds the crypt geometry and cells
+#include "FileFinder.hpp"
+
+#include <fstream>
 
 class TestBasicTestTubeCrypt : public AbstractCellBasedTestSuite
 {
+	private:
+	/* The number of lines in an output file */
+	unsigned CountLines(const std::string& rPath)
+	{
+		FileFinder file_finder(rPath, RelativeTo::ChasteTestOutput);
+		TS_ASSERT(file_finder.IsFile());
+		std::ifstream file(file_finder.GetAbsolutePath().c_str());
+		unsigned num_lines = 0;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			num_lines++;
+		}
+		return num_lines;
+	}
+
 	public:
 	void TestTubeCryptCell() throw(Exception)
 	{
-		unsigned cells_up = 30;
-		unsigned cells_across = 30;
-		unsigned ghosts = 4;
-
 		double dt = 0.005;
 		double end_time = 100;
 		double sampling_multiple = 100;
 
+		// The population writers (Voronoi etc.) block the simulation, so they only run every 10 hours.
+		// The cell positions are sampled every sampling_multiple steps by the asynchronous modifier instead.
+		double blocking_sampling_multiple = 2000;
+
 		//Set all the spring stiffness variables
 		double epithelialStiffness = 15.0; //Epithelial-epithelial spring connections
 		double membraneStiffness = 20.0; //Stiffness of membrane to membrane spring connections
@@ -71,113 +92,14 @@ class TestBasicTestTubeCrypt : public AbstractCellBasedTestSuite
 		double targetCurvatureStemTrans = 0; // Not implemented properly, so keep it the same as TransTrans for now
 		double targetCurvatureTransTrans = 0;
 
-		double lumen_left_edge = 6.5;
-		double lumen_right_edge = 13.5;
-		double lumen_bottom = 4.5;
-
-
-		//Copied wholesale from Axel
-		//used to make the base of the test tube shaped crypt
-		c_vector<double,2> circle_centre;
-		circle_centre(0) = cells_across/2;
-		circle_centre(1) = 10;
-
-		double circle_radius = 5; //Size of hole
-
-		double ring_width = 0.9;
-
-		//Start off with a mesh
-		CylindricalHoneycombMeshGenerator generator(cells_across, cells_up, ghosts);
-		Cylindrical2dMesh* p_mesh = generator.GetCylindricalMesh();
-		// HoneycombMeshGenerator generator(cells_up, cells_across, ghosts);
-		// MutableMesh<2,2>* p_mesh = generator.GetMesh();
-
-		//Sort through the indices and decide which ones are ghost nodes
-		std::vector<unsigned> initial_real_indices = generator.GetCellLocationIndices();
-		std::vector<unsigned> real_indices;
-		std::set<unsigned> real_indices_set;
-
-		//for each index
-			//check if index falls in the crypt lumen
-				//if it doesn't, add to list of non-ghost indices
-
-		for (unsigned i = 0; i < initial_real_indices.size(); i++)
-		{
-			unsigned cell_index = initial_real_indices[i];
-			double x = p_mesh->GetNode(cell_index)->rGetLocation()[0];
-			double y = p_mesh->GetNode(cell_index)->rGetLocation()[1];
-
-			//Make the curved crypt base
-			if ( (pow(x-circle_centre[0],2) + pow(y-circle_centre[1],2) > pow(circle_radius,2)) && y<= circle_centre[1])
-			{
-				real_indices.push_back(cell_index);
-				real_indices_set.insert(cell_index);
-
-			}
-
-			if ( ((x <= circle_centre[0] - circle_radius -.5) || (x >= circle_centre[0] + circle_radius + .5)) && (y > circle_centre[1]))
-			{
-				real_indices.push_back(cell_index);
-				real_indices_set.insert(cell_index);
-			}
-		}
+		//Build the test tube shaped crypt: 30x30 cells with 4 ghost rows, and a lumen of radius 5 with its base centred at height 10
+		TestTubeCryptSpec spec;
+		TestTubeCryptBuilder builder(spec);
 
-		//When instantiating a cell, we need to provide a mutation state
-		boost::shared_ptr<AbstractCellProperty> p_state = CellPropertyRegistry::Instance()->Get<WildTypeCellMutationState>();
-		boost::shared_ptr<AbstractCellProperty> p_trans_type = CellPropertyRegistry::Instance()->Get<TransitCellProliferativeType>();
-		boost::shared_ptr<AbstractCellProperty> p_diff_type = CellPropertyRegistry::Instance()->Get<DifferentiatedCellProliferativeType>();
-		boost::shared_ptr<AbstractCellProperty> p_stem_type = CellPropertyRegistry::Instance()->Get<StemCellProliferativeType>();
-
-		boost::shared_ptr<AbstractCellProperty> p_boundary = CellPropertyRegistry::Instance()->Get<BoundaryCellProperty>();
-
-		//create a vector to store the cells; it is currently empty
-		std::vector<CellPtr> cells;
-
-		//go through the real indices and build some cells
-		for (unsigned i = 0; i<real_indices.size(); i++)
-		{	
-			//Set cell cycle
-			UniformCellCycleModel* p_cycle_model = new UniformCellCycleModel();
-			//p_cycle_model->SetCellCycleDuration(); //randomly chooses a duration
-			double birth_time = 12.0*RandomNumberGenerator::Instance()->ranf(); //Randomly set birth time to stop pulsing behaviour
-			p_cycle_model->SetBirthTime(-birth_time);
-			
-
-			CellPtr p_cell(new Cell(p_state, p_cycle_model));
-
-			unsigned cell_index = real_indices[i];
-			double x = p_mesh->GetNode(cell_index)->rGetLocation()[0];
-			double y = p_mesh->GetNode(cell_index)->rGetLocation()[1];
-
-			p_cell->SetCellProliferativeType(p_diff_type); //set the type to differentiated if it's not a ghost node - types will be reset as follows
-
-			//add stems cells to the base of the crypt
-			if ((pow(x-circle_centre[0],2) + pow(y-circle_centre[1],2) > pow(circle_radius,2)) && (pow(x-circle_centre[0],2) + pow(y-circle_centre[1],2) < pow(circle_radius + ring_width,2)) && y<= circle_centre[1])
-			{
-				p_cell->SetCellProliferativeType(p_stem_type); //set the cell to stem if it's at the base of the lumen
-			}
-
-			//add transit cells to the left edge of lumen
-			if ( ((x <= circle_centre[0] - circle_radius -.5) && (x >= circle_centre[0] - circle_radius -1)) && (y > circle_centre[1]))
-			{
-				p_cell->SetCellProliferativeType(p_trans_type);
-			}
-			//add transit cells to the right edge of lumen
-			if ( ((x >= circle_centre[0] + circle_radius +.5) && (x <= circle_centre[0] + circle_radius +1)) && (y > circle_centre[1]))
-			{
-				p_cell->SetCellProliferativeType(p_trans_type); 
-			}
-			if (y==0){
-				p_cell->AddCellProperty(p_boundary);
-			}
-
-			p_cell->InitialiseCellCycleModel();
-
-			cells.push_back(p_cell);
-		}
+		std::vector<CellPtr> cells = builder.BuildCells();
 
 		//Pull it all together
-		MeshBasedCellPopulationWithGhostNodes<2> cell_population(*p_mesh, cells, real_indices);
+		MeshBasedCellPopulationWithGhostNodes<2> cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
 
 		cell_population.AddPopulationWriter<VoronoiDataWriter>();
 
@@ -188,7 +110,7 @@ class TestBasicTestTubeCrypt : public AbstractCellBasedTestSuite
 		simulator.SetOutputDirectory("TestCryptBMCells");
         simulator.SetEndTime(end_time);
         simulator.SetDt(dt);
-        simulator.SetSamplingTimestepMultiple(sampling_multiple);
+        simulator.SetSamplingTimestepMultiple(blocking_sampling_multiple);
 
         /* Add an anoikis-based cell killer. */
 		MAKE_PTR_ARGS(AnoikisCellKillerMembraneCell, p_anoikis_killer, (&cell_population));
@@ -215,86 +137,28 @@ class TestBasicTestTubeCrypt : public AbstractCellBasedTestSuite
 		MAKE_PTR_ARGS(CryptBoundaryCondition, p_bc, (&cell_population));
 		simulator.AddCellPopulationBoundaryCondition(p_bc);
 
-		//mutate a cell so it does not die from anoikis
-        boost::shared_ptr<AbstractCellProperty> p_state_mutated = CellPropertyRegistry::Instance()->Get<TransitCellAnoikisResistantMutationState>();
-        //"mutate" a differentiated cell if it is under the monolayer
-        boost::shared_ptr<AbstractCellProperty> p_membrane = CellPropertyRegistry::Instance()->Get<MembraneCellProliferativeType>();
-
-
-
-        // Make sure we have a monolayer, and pick a cell to make mutant
-        for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
-             cell_iter != cell_population.End();
-             ++cell_iter)
-        {
-            unsigned node_index = cell_population.GetLocationIndexUsingCell(*cell_iter);
-
-            if (node_index == 822) // Chosen from looking at the results from steady state
-            {
-                //cell_iter->SetMutationState(p_state_mutated);
-            }
-            //if cell type is epithelial or stem, then make sure it's a monolayer and make all the connected differentiated cells a mutated type (if they haven't already)
-            if (cell_iter->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || cell_iter->GetCellProliferativeType()->IsType<StemCellProliferativeType>())
-            {
-	            std::set<unsigned> neighbouring_node_indices = cell_population.GetNeighbouringNodeIndices(node_index);
-	            //loop to make sure we have a monolayer
-	            unsigned real_neighbour_count=0;
-	            for (std::set<unsigned>::iterator iter = neighbouring_node_indices.begin();
-	         			iter != neighbouring_node_indices.end();
-	         				++iter)
-	    		{
-	    			//count the number of non-ghost neighbours
-	    			if (real_indices_set.find(*iter) != real_indices_set.end())
-	    			{
-	    				real_neighbour_count +=1;
-	    			}
-	    		}
-	    		//if the cell doesn't have any ghost neighbours, then it's not a monolayer, so convert back to differntiated type
-	    		if (real_neighbour_count == neighbouring_node_indices.size())
-	    		{
-	    			//std::cout <<"Changed "<< node_index << std::endl;
-	    			cell_iter->SetCellProliferativeType(p_diff_type);
-	    		} else {
-	    		//loop to make the membrane cells
-	    			//loop through neighbours
-		    		for (std::set<unsigned>::iterator iter = neighbouring_node_indices.begin();
-		         			iter != neighbouring_node_indices.end();
-		         				++iter)
-		    		{
-		    			if (real_indices_set.find(*iter) != real_indices_set.end()) //make sure the node is not a ghost first
-		    			{
-		    				CellPtr neighbour = cell_population.GetCellUsingLocationIndex(*iter);
-		    				//check if the cell type is differentiated, then if it is, add the "mutation"
-			    			if (neighbour->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>())
-			    			{
-								NoCellCycleModel* p_no_cycle_model = new NoCellCycleModel();
-								neighbour->SetCellProliferativeType(p_membrane);
-								neighbour->SetCellCycleModel(p_no_cycle_model);
-			    			}
-		    			}
-		    		}
-		    	}
-	    	}
-        }
-
-        
-
         //Make the force for the membrane
         MAKE_PTR(MembraneCellForce, p_membrane_force);
         p_membrane_force->SetBasementMembraneTorsionalStiffness(torsional_stiffness);
         p_membrane_force->SetTargetCurvatures(targetCurvatureStemStem, targetCurvatureStemTrans, targetCurvatureTransTrans);
         simulator.AddForce(p_membrane_force);
 
+        // Sample the cell positions without holding up the simulation while they're written
+        MAKE_PTR(AsynchronousOutputModifier, p_output_modifier);
+        p_output_modifier->SetSamplingTimestepMultiple(sampling_multiple);
+        simulator.AddSimulationModifier(p_output_modifier);
+
         simulator.Solve();
 
+        // One line per output time: the blocking writers ran once every 10 hours, the samples every half hour
+        unsigned num_blocking_outputs = CountLines("TestCryptBMCells/results_from_time_0/results.viznodes");
+        unsigned num_samples = CountLines("TestCryptBMCells/results_from_time_0/cellsamples.dat");
+        TS_ASSERT_EQUALS(num_blocking_outputs, unsigned(end_time/(dt*blocking_sampling_multiple) + 0.5) + 1);
+        TS_ASSERT_EQUALS(num_samples, unsigned(end_time/(dt*sampling_multiple) + 0.5) + 1);
 	};
 
 	void xTestTubeCryptForce() throw(Exception)
 	{
-		unsigned cells_up = 30;
-		unsigned cells_across = 30;
-		unsigned ghosts = 4;
-
 		double dt = 0.005;
 		double end_time = 1;
 		double sampling_multiple = 10;
@@ -315,114 +179,21 @@ class TestBasicTestTubeCrypt : public AbstractCellBasedTestSuite
 		double targetCurvatureStemTrans = 0; // Not implemented properly, so keep it the same as TransTrans for now
 		double targetCurvatureTransTrans = 0;
 
-		double lumen_left_edge = 6.5;
-		double lumen_right_edge = 13.5;
-		double lumen_bottom = 4.5;
-
-
 		//double stiffness_ratio = 4.5; // For paneth cells
 
 		double bm_force = 10.0; //Set the basement membrane stiffness
 		double target_curvature = 0.2; //Set the target curvature, i.e. how circular the layer wants to be
 
-		//Copied wholesale from Axel
-		//used to make the base of the test tube shaped crypt
-		c_vector<double,2> circle_centre;
-		circle_centre(0) = cells_across/2;
-		circle_centre(1) = 10;
-
-		double circle_radius = 5; //Size of hole
-
-		double ring_width = 0.9;
+		//Build the test tube shaped crypt: 30x30 cells with 4 ghost rows, and a lumen of radius 5 with its base centred at height 10
+		TestTubeCryptSpec spec;
+		spec.markBoundaryCells = false;
+		spec.addMembraneLayer = false;
+		TestTubeCryptBuilder builder(spec);
 
-		//Start off with a mesh
-		// HoneycombMeshGenerator generator(cells_up, cells_across, ghosts);
-		// MutableMesh<2,2>* p_mesh = generator.GetMesh();
-		CylindricalHoneycombMeshGenerator generator(cells_across, cells_up, ghosts);
-		Cylindrical2dMesh* p_mesh = generator.GetCylindricalMesh();
-
-		//Sort through the indices and decide which ones are ghost nodes
-		std::vector<unsigned> initial_real_indices = generator.GetCellLocationIndices();
-		std::vector<unsigned> real_indices;
-		std::set<unsigned> real_indices_set;
-
-		//for each index
-			//check if index falls in the crypt lumen
-				//if it doesn't, add to list of non-ghost indices
-
-		for (unsigned i = 0; i < initial_real_indices.size(); i++)
-		{
-			unsigned cell_index = initial_real_indices[i];
-			double x = p_mesh->GetNode(cell_index)->rGetLocation()[0];
-			double y = p_mesh->GetNode(cell_index)->rGetLocation()[1];
-
-			//Make the curved crypt base
-			if ( (pow(x-circle_centre[0],2) + pow(y-circle_centre[1],2) > pow(circle_radius,2)) && y<= circle_centre[1])
-			{
-				real_indices.push_back(cell_index);
-				real_indices_set.insert(cell_index);
-
-			}
-
-			if ( ((x <= circle_centre[0] - circle_radius -.5) || (x >= circle_centre[0] + circle_radius + .5)) && (y > circle_centre[1]))
-			{
-				real_indices.push_back(cell_index);
-				real_indices_set.insert(cell_index);
-			}
-		}
-
-		//When instantiating a cell, we need to provide a mutation state
-		boost::shared_ptr<AbstractCellProperty> p_state = CellPropertyRegistry::Instance()->Get<WildTypeCellMutationState>();
-		boost::shared_ptr<AbstractCellProperty> p_trans_type = CellPropertyRegistry::Instance()->Get<TransitCellProliferativeType>();
-		boost::shared_ptr<AbstractCellProperty> p_diff_type = CellPropertyRegistry::Instance()->Get<DifferentiatedCellProliferativeType>();
-		boost::shared_ptr<AbstractCellProperty> p_stem_type = CellPropertyRegistry::Instance()->Get<StemCellProliferativeType>();
-
-		//create a vector to store the cells; it is currently empty
-		std::vector<CellPtr> cells;
-
-		//go through the real indices and build some cells
-		for (unsigned i = 0; i<real_indices.size(); i++)
-		{	
-			//Set cell cycle
-			UniformCellCycleModel* p_cycle_model = new UniformCellCycleModel();
-			//p_cycle_model->SetCellCycleDuration(); //randomly chooses a duration
-			double birth_time = 12.0*RandomNumberGenerator::Instance()->ranf(); //Randomly set birth time to stop pulsing behaviour
-			p_cycle_model->SetBirthTime(-birth_time);
-			
-
-			CellPtr p_cell(new Cell(p_state, p_cycle_model));
-
-			unsigned cell_index = real_indices[i];
-			double x = p_mesh->GetNode(cell_index)->rGetLocation()[0];
-			double y = p_mesh->GetNode(cell_index)->rGetLocation()[1];
-
-			p_cell->SetCellProliferativeType(p_diff_type); //set the type to differentiated if it's not a ghost node - types will be reset as follows
-
-			//add stems cells to the base of the crypt
-			if ((pow(x-circle_centre[0],2) + pow(y-circle_centre[1],2) > pow(circle_radius,2)) && (pow(x-circle_centre[0],2) + pow(y-circle_centre[1],2) < pow(circle_radius + ring_width,2)) && y<= circle_centre[1])
-			{
-				p_cell->SetCellProliferativeType(p_stem_type); //set the cell to stem if it's at the base of the lumen
-			}
-
-			//add transit cells to the left edge of lumen
-			if ( ((x <= circle_centre[0] - circle_radius -.5) && (x >= circle_centre[0] - circle_radius -1)) && (y > circle_centre[1]))
-			{
-				p_cell->SetCellProliferativeType(p_trans_type);
-			}
-			//add transit cells to the right edge of lumen
-			if ( ((x >= circle_centre[0] + circle_radius +.5) && (x <= circle_centre[0] + circle_radius +1)) && (y > circle_centre[1]))
-			{
-				p_cell->SetCellProliferativeType(p_trans_type); 
-			}
-			
-
-			p_cell->InitialiseCellCycleModel();
-
-			cells.push_back(p_cell);
-		}
+		std::vector<CellPtr> cells = builder.BuildCells();
 
 		//Pull it all together
-		MeshBasedCellPopulationWithGhostNodes<2> cell_population(*p_mesh, cells, real_indices);
+		MeshBasedCellPopulationWithGhostNodes<2> cell_population(*builder.GetMesh(), cells, builder.rGetRealIndices());
 
 		cell_population.AddPopulationWriter<VoronoiDataWriter>();
 
@@ -456,49 +227,6 @@ class TestBasicTestTubeCrypt : public AbstractCellBasedTestSuite
 		p_spring_force->SetPanethCellStiffnessRatio(stiffness_ratio);
 		simulator.AddForce(p_spring_force);
 
-		//mutate a cell so it does not die from anoikis
-        boost::shared_ptr<AbstractCellProperty> p_state_mutated = CellPropertyRegistry::Instance()->Get<TransitCellAnoikisResistantMutationState>();
-        //"mutate" a differentiated cell if it is under the monolayer
-        boost::shared_ptr<AbstractCellProperty> p_membrane = CellPropertyRegistry::Instance()->Get<MembraneCellProliferativeType>();
-
-
-
-        // Make sure we have a monolayer, and pick a cell to make mutant
-        for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
-             cell_iter != cell_population.End();
-             ++cell_iter)
-        {
-            unsigned node_index = cell_population.GetLocationIndexUsingCell(*cell_iter);
-
-            if (node_index == 822) // Chosen from looking at the results from steady state
-            {
-                //cell_iter->SetMutationState(p_state_mutated);
-            }
-            //if cell type is epithelial or stem, then make sure it's a monolayer and make all the connected differentiated cells a mutated type (if they haven't already)
-            if (cell_iter->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || cell_iter->GetCellProliferativeType()->IsType<StemCellProliferativeType>())
-            {
-	            std::set<unsigned> neighbouring_node_indices = cell_population.GetNeighbouringNodeIndices(node_index);
-	            //loop to make sure we have a monolayer
-	            unsigned real_neighbour_count=0;
-	            for (std::set<unsigned>::iterator iter = neighbouring_node_indices.begin();
-	         			iter != neighbouring_node_indices.end();
-	         				++iter)
-	    		{
-	    			//count the number of non-ghost neighbours
-	    			if (real_indices_set.find(*iter) != real_indices_set.end())
-	    			{
-	    				real_neighbour_count +=1;
-	    			}
-	    		}
-	    		//if the cell doesn't have any ghost neighbours, then it's not a monolayer, so convert back to differentiated type
-	    		if (real_neighbour_count == neighbouring_node_indices.size())
-	    		{
-	    			//std::cout <<"Changed "<< node_index << std::endl;
-	    			cell_iter->SetCellProliferativeType(p_diff_type);
-	    		}
-	    	}
-        }
-
         // Now we have an ordered vector of membrane indices, starting at the left and going anticlockwise through the stem cell niche
 
         // Make the force for the membrane
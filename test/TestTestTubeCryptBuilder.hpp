@@ -0,0 +1,301 @@
+/* Checks that the test tube crypt builder makes the same crypt as the set-up loop it replaced,
+ * and that crypt specs are read from file correctly
+ */
+
+#include <cxxtest/TestSuite.h> //Needed for all test files
+#include "AbstractCellBasedTestSuite.hpp" //Needed for cell-based tests: times simulations, generates random numbers and has cell properties
+#include "CheckpointArchiveTypes.hpp" //Needed if we use GetIdentifier() method (which we do)
+#include "SmartPointers.hpp" //Enables macros to save typing
+
+#include "TestTubeCryptBuilder.hpp"
+#include "CylindricalHoneycombMeshGenerator.hpp"
+#include "MeshBasedCellPopulationWithGhostNodes.hpp"
+#include "UniformCellCycleModel.hpp"
+#include "NoCellCycleModel.hpp"
+#include "WildTypeCellMutationState.hpp"
+#include "DifferentiatedCellProliferativeType.hpp"
+#include "TransitCellProliferativeType.hpp"
+#include "StemCellProliferativeType.hpp"
+#include "MembraneCellProliferativeType.hpp"
+#include "BoundaryCellProperty.hpp"
+#include "OutputFileHandler.hpp"
+#include "FakePetscSetup.hpp"
+
+#include <cmath>
+#include <set>
+
+class TestTestTubeCryptBuilder : public AbstractCellBasedTestSuite
+{
+	private:
+
+	/*
+	 * The set-up loop from TestTestTubeCrypt before the builder, for the default spec: cut the lumen out
+	 * of a 30x30 cylindrical honeycomb, give the cells types by position, and then (if convertInPlace)
+	 * go through the population making a monolayer with a layer of membrane cells under it.
+	 */
+	void RunOriginalSetUp(bool convertInPlace, std::vector<c_vector<double, 2> >& rLocations, std::vector<unsigned>& rRealIndices, std::vector<CellPtr>& rCells)
+	{
+		unsigned cells_up = 30;
+		unsigned cells_across = 30;
+		unsigned ghosts = 4;
+
+		c_vector<double,2> circle_centre;
+		circle_centre(0) = cells_across/2;
+		circle_centre(1) = 10;
+
+		double circle_radius = 5;
+		double ring_width = 0.9;
+
+		CylindricalHoneycombMeshGenerator generator(cells_across, cells_up, ghosts);
+		Cylindrical2dMesh* p_mesh = generator.GetCylindricalMesh();
+
+		std::vector<unsigned> initial_real_indices = generator.GetCellLocationIndices();
+		std::vector<unsigned> real_indices;
+		std::set<unsigned> real_indices_set;
+
+		for (unsigned i = 0; i < initial_real_indices.size(); i++)
+		{
+			unsigned cell_index = initial_real_indices[i];
+			double x = p_mesh->GetNode(cell_index)->rGetLocation()[0];
+			double y = p_mesh->GetNode(cell_index)->rGetLocation()[1];
+
+			if ( (pow(x-circle_centre[0],2) + pow(y-circle_centre[1],2) > pow(circle_radius,2)) && y<= circle_centre[1])
+			{
+				real_indices.push_back(cell_index);
+				real_indices_set.insert(cell_index);
+			}
+
+			if ( ((x <= circle_centre[0] - circle_radius -.5) || (x >= circle_centre[0] + circle_radius + .5)) && (y > circle_centre[1]))
+			{
+				real_indices.push_back(cell_index);
+				real_indices_set.insert(cell_index);
+			}
+		}
+
+		boost::shared_ptr<AbstractCellProperty> p_state = CellPropertyRegistry::Instance()->Get<WildTypeCellMutationState>();
+		boost::shared_ptr<AbstractCellProperty> p_trans_type = CellPropertyRegistry::Instance()->Get<TransitCellProliferativeType>();
+		boost::shared_ptr<AbstractCellProperty> p_diff_type = CellPropertyRegistry::Instance()->Get<DifferentiatedCellProliferativeType>();
+		boost::shared_ptr<AbstractCellProperty> p_stem_type = CellPropertyRegistry::Instance()->Get<StemCellProliferativeType>();
+		boost::shared_ptr<AbstractCellProperty> p_membrane = CellPropertyRegistry::Instance()->Get<MembraneCellProliferativeType>();
+		boost::shared_ptr<AbstractCellProperty> p_boundary = CellPropertyRegistry::Instance()->Get<BoundaryCellProperty>();
+
+		std::vector<CellPtr> cells;
+		for (unsigned i = 0; i<real_indices.size(); i++)
+		{
+			UniformCellCycleModel* p_cycle_model = new UniformCellCycleModel();
+			double birth_time = 12.0*RandomNumberGenerator::Instance()->ranf();
+			p_cycle_model->SetBirthTime(-birth_time);
+
+			CellPtr p_cell(new Cell(p_state, p_cycle_model));
+
+			unsigned cell_index = real_indices[i];
+			double x = p_mesh->GetNode(cell_index)->rGetLocation()[0];
+			double y = p_mesh->GetNode(cell_index)->rGetLocation()[1];
+
+			p_cell->SetCellProliferativeType(p_diff_type);
+
+			if ((pow(x-circle_centre[0],2) + pow(y-circle_centre[1],2) > pow(circle_radius,2)) && (pow(x-circle_centre[0],2) + pow(y-circle_centre[1],2) < pow(circle_radius + ring_width,2)) && y<= circle_centre[1])
+			{
+				p_cell->SetCellProliferativeType(p_stem_type);
+			}
+			if ( ((x <= circle_centre[0] - circle_radius -.5) && (x >= circle_centre[0] - circle_radius -1)) && (y > circle_centre[1]))
+			{
+				p_cell->SetCellProliferativeType(p_trans_type);
+			}
+			if ( ((x >= circle_centre[0] + circle_radius +.5) && (x <= circle_centre[0] + circle_radius +1)) && (y > circle_centre[1]))
+			{
+				p_cell->SetCellProliferativeType(p_trans_type);
+			}
+			if (y==0){
+				p_cell->AddCellProperty(p_boundary);
+			}
+
+			p_cell->InitialiseCellCycleModel();
+
+			cells.push_back(p_cell);
+		}
+
+		for (unsigned i=0; i<p_mesh->GetNumNodes(); i++)
+		{
+			rLocations.push_back(p_mesh->GetNode(i)->rGetLocation());
+		}
+
+		MeshBasedCellPopulationWithGhostNodes<2> cell_population(*p_mesh, cells, real_indices);
+
+		if (convertInPlace)
+		{
+			for (AbstractCellPopulation<2>::Iterator cell_iter = cell_population.Begin();
+				 cell_iter != cell_population.End();
+				 ++cell_iter)
+			{
+				unsigned node_index = cell_population.GetLocationIndexUsingCell(*cell_iter);
+
+				if (cell_iter->GetCellProliferativeType()->IsType<TransitCellProliferativeType>() || cell_iter->GetCellProliferativeType()->IsType<StemCellProliferativeType>())
+				{
+					std::set<unsigned> neighbouring_node_indices = cell_population.GetNeighbouringNodeIndices(node_index);
+					unsigned real_neighbour_count=0;
+					for (std::set<unsigned>::iterator iter = neighbouring_node_indices.begin();
+						 iter != neighbouring_node_indices.end();
+						 ++iter)
+					{
+						if (real_indices_set.find(*iter) != real_indices_set.end())
+						{
+							real_neighbour_count +=1;
+						}
+					}
+					if (real_neighbour_count == neighbouring_node_indices.size())
+					{
+						cell_iter->SetCellProliferativeType(p_diff_type);
+					}
+					else
+					{
+						for (std::set<unsigned>::iterator iter = neighbouring_node_indices.begin();
+							 iter != neighbouring_node_indices.end();
+							 ++iter)
+						{
+							if (real_indices_set.find(*iter) != real_indices_set.end())
+							{
+								CellPtr neighbour = cell_population.GetCellUsingLocationIndex(*iter);
+								if (neighbour->GetCellProliferativeType()->IsType<DifferentiatedCellProliferativeType>())
+								{
+									NoCellCycleModel* p_no_cycle_model = new NoCellCycleModel();
+									neighbour->SetCellProliferativeType(p_membrane);
+									neighbour->SetCellCycleModel(p_no_cycle_model);
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		rRealIndices = real_indices;
+		rCells = cells;
+	}
+
+	/* Build the default crypt both ways from the same seed and check they match node for node and cell for cell */
+	void CompareWithOriginalSetUp(bool convertInPlace)
+	{
+		RandomNumberGenerator::Instance()->Reseed(0);
+		std::vector<c_vector<double, 2> > original_locations;
+		std::vector<unsigned> original_real_indices;
+		std::vector<CellPtr> original_cells;
+		RunOriginalSetUp(convertInPlace, original_locations, original_real_indices, original_cells);
+
+		RandomNumberGenerator::Instance()->Reseed(0);
+		TestTubeCryptSpec spec;
+		spec.enforceMonolayer = convertInPlace;
+		spec.addMembraneLayer = convertInPlace;
+		TestTubeCryptBuilder builder(spec);
+		std::vector<CellPtr> cells = builder.BuildCells();
+
+		// The same nodes, and so the same ghosts
+		Cylindrical2dMesh* p_mesh = builder.GetMesh();
+		TS_ASSERT_EQUALS(p_mesh->GetNumNodes(), original_locations.size());
+		for (unsigned i=0; i<p_mesh->GetNumNodes() && i<original_locations.size(); i++)
+		{
+			TS_ASSERT_DELTA(p_mesh->GetNode(i)->rGetLocation()[0], original_locations[i][0], 1e-12);
+			TS_ASSERT_DELTA(p_mesh->GetNode(i)->rGetLocation()[1], original_locations[i][1], 1e-12);
+		}
+
+		const std::vector<unsigned>& r_real_indices = builder.rGetRealIndices();
+		TS_ASSERT_EQUALS(r_real_indices.size(), original_real_indices.size());
+		TS_ASSERT_EQUALS(cells.size(), original_cells.size());
+		for (unsigned i=0; i<r_real_indices.size() && i<original_real_indices.size(); i++)
+		{
+			TS_ASSERT_EQUALS(r_real_indices[i], original_real_indices[i]);
+
+			// The same type, cell cycle and boundary marking on each cell
+			CellPtr p_cell = cells[i];
+			CellPtr p_original_cell = original_cells[i];
+			TS_ASSERT_EQUALS(p_cell->GetCellProliferativeType()->GetIdentifier(), p_original_cell->GetCellProliferativeType()->GetIdentifier());
+			TS_ASSERT_EQUALS(dynamic_cast<NoCellCycleModel*>(p_cell->GetCellCycleModel()) != NULL,
+							 dynamic_cast<NoCellCycleModel*>(p_original_cell->GetCellCycleModel()) != NULL);
+			TS_ASSERT_EQUALS(p_cell->HasCellProperty<BoundaryCellProperty>(), p_original_cell->HasCellProperty<BoundaryCellProperty>());
+
+			UniformCellCycleModel* p_model = dynamic_cast<UniformCellCycleModel*>(p_cell->GetCellCycleModel());
+			UniformCellCycleModel* p_original_model = dynamic_cast<UniformCellCycleModel*>(p_original_cell->GetCellCycleModel());
+			if (p_model && p_original_model)
+			{
+				TS_ASSERT_DELTA(p_model->GetBirthTime(), p_original_model->GetBirthTime(), 1e-12);
+				TS_ASSERT_EQUALS(p_model->GetCellCycleDuration(), p_original_model->GetCellCycleDuration());
+			}
+		}
+	}
+
+	public:
+	void TestBuilderMatchesOriginalSetUp() throw(Exception)
+	{
+		// As TestTubeCryptCell set it up, with types by position only
+		CompareWithOriginalSetUp(false);
+
+		// As TestTubeCryptMembraneCell set it up, converting the population to a monolayer over a membrane
+		CompareWithOriginalSetUp(true);
+	};
+
+	void TestLoadFromFile() throw(Exception)
+	{
+		OutputFileHandler handler("TestTubeCryptBuilderSpec/", true);
+		FileFinder spec_file("TestTubeCryptBuilderSpec/crypt.spec", RelativeTo::ChasteTestOutput);
+
+		out_stream p_spec_file = handler.OpenOutputFile("crypt.spec");
+		*p_spec_file << "# A small crypt\n";
+		*p_spec_file << "cells_across 20\n";
+		*p_spec_file << "cells_up 20   # and as tall as it is wide\n";
+		*p_spec_file << "\n";
+		*p_spec_file << "circle_centre_y 8\n";
+		*p_spec_file << "circle_radius 4.0\n";
+		*p_spec_file << "birth_time_spread 0\n";
+		*p_spec_file << "add_membrane_layer 0\n";
+		p_spec_file->close();
+
+		// Keys that are given replace the defaults; the rest are left alone
+		TestTubeCryptSpec spec;
+		spec.LoadFromFile(spec_file);
+		TS_ASSERT_EQUALS(spec.cellsAcross, 20u);
+		TS_ASSERT_EQUALS(spec.cellsUp, 20u);
+		TS_ASSERT_DELTA(spec.circleCentreY, 8.0, 1e-12);
+		TS_ASSERT_DELTA(spec.circleRadius, 4.0, 1e-12);
+		TS_ASSERT_DELTA(spec.birthTimeSpread, 0.0, 1e-12);
+		TS_ASSERT_EQUALS(spec.addMembraneLayer, false);
+		TS_ASSERT_EQUALS(spec.numGhosts, 4u);
+		TS_ASSERT_DELTA(spec.ringWidth, 0.9, 1e-12);
+		TS_ASSERT_EQUALS(spec.enforceMonolayer, true);
+
+		// The spec builds a crypt with no membrane cells, all just born
+		TestTubeCryptBuilder builder(spec);
+		std::vector<CellPtr> cells = builder.BuildCells();
+		TS_ASSERT_LESS_THAN(0u, cells.size());
+		for (unsigned i=0; i<cells.size(); i++)
+		{
+			TS_ASSERT(!cells[i]->GetCellProliferativeType()->IsType<MembraneCellProliferativeType>());
+			TS_ASSERT_DELTA(cells[i]->GetBirthTime(), 0.0, 1e-12);
+		}
+
+		// A key that isn't a member of the spec
+		p_spec_file = handler.OpenOutputFile("crypt.spec");
+		*p_spec_file << "cells_across 20\n";
+		*p_spec_file << "cell_across 20\n";
+		p_spec_file->close();
+		TestTubeCryptSpec unknown_key_spec;
+		TS_ASSERT_THROWS_CONTAINS(unknown_key_spec.LoadFromFile(spec_file), "Unknown key 'cell_across'");
+
+		// A value that isn't a number, and a key with no value
+		p_spec_file = handler.OpenOutputFile("crypt.spec");
+		*p_spec_file << "circle_radius five\n";
+		p_spec_file->close();
+		TestTubeCryptSpec bad_value_spec;
+		TS_ASSERT_THROWS_CONTAINS(bad_value_spec.LoadFromFile(spec_file), "Bad value for 'circle_radius'");
+
+		p_spec_file = handler.OpenOutputFile("crypt.spec");
+		*p_spec_file << "cells_up\n";
+		p_spec_file->close();
+		TestTubeCryptSpec missing_value_spec;
+		TS_ASSERT_THROWS_CONTAINS(missing_value_spec.LoadFromFile(spec_file), "Bad value for 'cells_up'");
+
+		// A file that isn't there
+		FileFinder missing_file("TestTubeCryptBuilderSpec/missing.spec", RelativeTo::ChasteTestOutput);
+		TestTubeCryptSpec missing_file_spec;
+		TS_ASSERT_THROWS_CONTAINS(missing_file_spec.LoadFromFile(missing_file), "Could not open crypt spec file");
+	};
+};